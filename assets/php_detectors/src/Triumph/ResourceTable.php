@@ -30,6 +30,37 @@ class Triumph_ResourceTable extends Zend_Db_Table_Abstract {
 	
 	protected $_primary = array('file_item_id', 'key');
 	
+	/**
+	 * The tags of most sources are not in the tags db, they are in a shard
+	 * file next to it (tags.db => tags.source12.db). The shards are attached
+	 * and combined with the tags db in a temporary view that has the same name
+	 * as the table, the same way that Triumph does it (see TagShardsClass).
+	 * This way the queries see the tags of all of the sources.
+	 */
+	public function init() {
+		$config = $this->_db->getConfig();
+		$pathInfo = pathinfo($config['dbname']);
+		$extension = isset($pathInfo['extension']) ? '.' . $pathInfo['extension'] : '';
+		$attached = array();
+		foreach ($this->_db->fetchAll('PRAGMA database_list') as $row) {
+			$attached[] = $row['name'];
+		}
+		$sql = 'SELECT * FROM main.resources';
+		foreach ($this->_db->fetchCol('SELECT source_id FROM sources') as $sourceId) {
+			$shardFileName = $pathInfo['dirname'] . DIRECTORY_SEPARATOR . $pathInfo['filename'] . '.source' . $sourceId . $extension;
+			$schema = 'shard' . intval($sourceId);
+			if (!in_array($schema, $attached) && is_file($shardFileName)) {
+				$this->_db->query('ATTACH DATABASE ? AS ' . $schema, array($shardFileName));
+				$attached[] = $schema;
+			}
+			if (in_array($schema, $attached)) {
+				$sql .= ' UNION ALL SELECT * FROM ' . $schema . '.resources';
+			}
+		}
+		$this->_db->query('DROP VIEW IF EXISTS temp.resources');
+		$this->_db->query('CREATE TEMP VIEW resources AS ' . $sql);
+	}
+	
 	/**
 	 * Retrieves all of the methods from the given files. Only resources that 
 	 * are methods will be returned. Only public methods are returned.
@@ -60,6 +60,16 @@ CREATE TABLE IF NOT EXISTS file_items (
 	-- this is up to the second precision. this time is used to check to see if
 	-- the file needs to be parsed
 	last_modified DATETIME NOT NULL, 
+
+	-- the size of the file, in bytes, when it was last parsed. Along with
+	-- last_modified, this is the quick check to see if the file changed
+	file_size INTEGER NOT NULL DEFAULT 0,
+
+	-- a hash of the contents of the file when it was last parsed. When
+	-- last_modified changes but the size does not, the hash is checked so that
+	-- files that were touched but not changed are not parsed again.
+	-- empty when the hash is not known (ie. tags came from an unsaved buffer)
+	content_hash TEXT NOT NULL DEFAULT '',
 	
 	-- 1 when the file has been parsed for resources
 	is_parsed INTEGER NOT NULL, 
@@ -77,8 +87,12 @@ CREATE TABLE IF NOT EXISTS file_items (
 -- and one will be the "fully qualified" entry.  This will make it easy to
 -- perform all lookups using a single index (this is the purpose of the key
 -- column).
+-- the tags of a source directory may also be in a tag shard (tag_shard.sql);
+-- the columns of the shard tables must be in the same order as these.
 CREATE TABLE IF NOT EXISTS resources (
 
+	-- the id is only unique within a source, since each tag shard has its
+	-- own ids. a tag is identified by its source_id and id
 	id INTEGER NOT NULL PRIMARY KEY,
 	
 	-- the file that the resource is located in
@@ -183,7 +197,13 @@ CREATE TABLE IF NOT EXISTS resources (
 	-- 1 if this is a function / method that has variable arguments. variable argument
 	-- detection works based off whether the body of the function / method
 	-- has a call to func_get_arg or its friends
-	has_variable_args INTEGER NOT NULL
+	has_variable_args INTEGER NOT NULL,
+
+	-- the line (1-based) where the resource was declared, as of the time
+	-- the file was parsed. This is used to jump to the resource without
+	-- having to search the entire file.
+	-- 0 when the line is not known (native or dynamic resources)
+	line_number INTEGER NOT NULL DEFAULT 0
 );
 
 -- This table stores all of the trait relationships that have been found by Triumph.
@@ -233,6 +253,24 @@ CREATE TABLE IF NOT EXISTS trait_resources (
 	instead_ofs TEXT NOT NULL
 );
 
+--
+-- This table is a log of the files whose tags were written. Every writer
+-- adds the IDs of the files that it changed, so that the in-memory tag
+-- indexes of the other connections (see TagIndexClass) only need to
+-- re-read the files that changed.
+-- A file_item_id of 0 means that too many files changed to list (ie. a
+-- source directory was deleted) and the tags should be re-read in full.
+-- Writers delete the old rows; a reader that is behind the oldest row
+-- re-reads all tags.
+CREATE TABLE IF NOT EXISTS tag_changes (
+
+	-- ids are never re-used, readers remember the last change they read
+	tag_change_id INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+
+	-- the file whose tags were added, removed or updated
+	file_item_id INTEGER NOT NULL
+);
+
 --
 -- This table will store any table names that we
 -- detect from the configured database connections
@@ -317,7 +355,7 @@ CREATE INDEX IF NOT EXISTS idxFileCabinetName ON file_cabinet_items(name);
 --
 -- This number must match the version in CacheDbVersionActionClass.cpp
 --
-INSERT INTO schema_version (version_number) VALUES(10);
+INSERT INTO schema_version (version_number) VALUES(14);
 
 --
 -- Write ahead logging to allow for concurrent reads and writes
@@ -0,0 +1,79 @@
+-------------------------------------------------------------------
+-- This software is released under the terms of the MIT License
+-- 
+-- Permission is hereby granted, free of charge, to any person obtaining a copy
+-- of this software and associated documentation files (the "Software"), to deal
+-- in the Software without restriction, including without limitation the rights
+-- to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+-- copies of the Software, and to permit persons to whom the Software is
+-- furnished to do so, subject to the following conditions:
+-- 
+-- The above copyright notice and this permission notice shall be included in
+-- all copies or substantial portions of the Software.
+-- 
+-- THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+-- IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+-- FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+-- AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+-- LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+-- OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+-- THE SOFTWARE.
+--
+-- @copyright  2015 Roberto Perpuly
+-- @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+-------------------------------------------------------------------
+
+--
+-- A tag shard holds the tags of a single source directory. The shards are
+-- attached to the tags database (resources.sql); the sources and file_items
+-- tables are only in the tags database. See TagShardsClass for details.
+--
+-- The columns of these tables MUST be in the same order as the columns
+-- of the resources and trait_resources tables in resources.sql, the shards
+-- are combined with the tags database with "SELECT *" views.
+-- See resources.sql for the description of each column.
+--
+-- The shards are deleted when the tags database is re-created, so a change
+-- to this file also needs a new tags schema version.
+--
+
+-- the ids of each shard start at 1, a tag is identified by its source_id
+-- and id (see ParsedTagFinderClass::FindById)
+CREATE TABLE IF NOT EXISTS resources (
+	id INTEGER NOT NULL PRIMARY KEY,
+	file_item_id INTEGER NOT NULL,
+	source_id INTEGER NOT NULL,
+	key TEXT NOT NULL COLLATE NOCASE,
+	identifier TEXT NOT NULL COLLATE NOCASE,
+	class_name TEXT NOT NULL COLLATE NOCASE,
+	type INTEGER NOT NULL,
+	namespace_name TEXT NOT NULL COLLATE NOCASE,
+	signature TEXT NOT NULL,
+	comment TEXT NOT NULL,
+	return_type TEXT NOT NULL COLLATE NOCASE,
+	is_protected INTEGER NOT NULL,
+	is_private INTEGER NOT NULL,
+	is_static INTEGER NOT NULL,
+	is_dynamic INTEGER NOT NULL,
+	is_native INTEGER NOT NULL,
+	has_variable_args INTEGER NOT NULL,
+	line_number INTEGER NOT NULL DEFAULT 0
+);
+
+CREATE TABLE IF NOT EXISTS trait_resources (
+	file_item_id INTEGER NOT NULL,
+	source_id INTEGER NOT NULL,
+	key TEXT NOT NULL COLLATE NOCASE,
+	class_name TEXT NOT NULL COLLATE NOCASE,
+	namespace_name TEXT NOT NULL COLLATE NOCASE,
+	trait_name TEXT NOT NULL COLLATE NOCASE,
+	trait_namespace_name TEXT NOT NULL COLLATE NOCASE,
+	aliases TEXT NOT NULL,
+	instead_ofs TEXT NOT NULL
+);
+
+-- same indexes as the tags database
+CREATE INDEX IF NOT EXISTS idxResourceKey ON resources(key, type);
+CREATE INDEX IF NOT EXISTS idxResourceFileItem ON resources(file_item_id);
+CREATE INDEX IF NOT EXISTS idxResourceSource ON resources(source_id);
+CREATE INDEX IF NOT EXISTS idxTraitKey ON trait_resources(key);
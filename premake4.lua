@@ -278,6 +278,38 @@ function pickywarnings(action)
 	end
 end
 
+-- a console program that only needs the tag code (the tag indexer, the
+-- tag service, the tag profilers...). The program's main() is in
+-- profilers/<name>.cpp
+-- more settings can be added to the project after calling this
+function tagtoolproject(name)
+	project(name)
+		language "C++"
+		kind "ConsoleApp"
+		files {
+			string.format("profilers/%s.cpp", name),
+			"src/globals/*.cpp",
+			"src/language_php/*.cpp",
+			"src/language_sql/*.cpp",
+			"src/search/*.cpp",
+			"lib/pelet/src/*.cpp"
+		}
+		includedirs { "src", "lib/pelet/include" }
+
+		configuration "Debug"
+			pickywarnings(_ACTION)
+			sociconfiguration("Debug")
+			icuconfiguration("Debug", _ACTION)
+			wxconfiguration("Debug", _ACTION)
+			boostconfiguration("Debug", _ACTION)
+		configuration { "Release"}
+			pickywarnings(_ACTION)
+			sociconfiguration("Release")
+			icuconfiguration("Release", _ACTION)
+			wxconfiguration("Release", _ACTION)
+			boostconfiguration("Release", _ACTION)
+end
+
 -- solution directory structure
 -- the toolset files will be deposited in the build/ directory
 -- each toolset will have its own directory
@@ -518,30 +550,42 @@ solution "triumph4php"
 			boostconfiguration("Release", _ACTION)
 			wxappconfiguration("Release", _ACTION)
 
-	project "tag_finder_profiler"
-		language "C++"
-		kind "ConsoleApp"
-		files {
-			"profilers/tag_finder_profiler.cpp",
-			"src/globals/*.cpp",
-			"src/language_php/*.cpp",
-			"src/language_sql/*.cpp",
-			"src/search/*.cpp",
-			"lib/pelet/src/*.cpp"
-		}
-		includedirs { "src", "lib/pelet/include" }
+	tagtoolproject("tag_finder_profiler")
+
+	-- benchmarks building the tag index on a generated project; run with --help
+	-- for the options. results are printed as JSON so that they can be
+	-- compared across builds
+	tagtoolproject("tag_index_benchmark")
+
+	-- builds or updates the tag cache of the given sources without the app;
+	-- used to pre-warm caches and to time indexing on machines without a
+	-- display. run with --help for the options
+	tagtoolproject("tag_indexer")
 
+	-- serves the tags of a tag db to the app instances on the same machine
+	-- over a Unix domain socket; run with --help for the options
+	tagtoolproject("tag_service")
+
+	-- generates the native tag image from the native functions db
+	-- the image is re-generated after every build so that it is always
+	-- in sync with the db
+	tagtoolproject("native_tag_image")
 		configuration "Debug"
-			pickywarnings(_ACTION)
-			sociconfiguration("Debug")
-			icuconfiguration("Debug", _ACTION)
-			wxconfiguration("Debug", _ACTION)
+			postbuildcommands {
+				string.format("%s %s %s",
+					normalizepath("Debug/native_tag_image"),
+					normalizepath("assets/php.db"),
+					normalizepath("assets/php.tagimage")
+				)
+			}
 		configuration { "Release"}
-			pickywarnings(_ACTION)
-			sociconfiguration("Release")
-			icuconfiguration("Release", _ACTION)
-			wxconfiguration("Release", _ACTION)
-
+			postbuildcommands {
+				string.format("%s %s %s",
+					normalizepath("Release/native_tag_image"),
+					normalizepath("assets/php.db"),
+					normalizepath("assets/php.tagimage")
+				)
+			}
 
 	project "call_stack_profiler"
 		language "C++"
@@ -566,11 +610,13 @@ solution "triumph4php"
 			sociconfiguration("Debug")
 			icuconfiguration("Debug", _ACTION)
 			wxconfiguration("Debug", _ACTION)
+			boostconfiguration("Debug", _ACTION)
 		configuration { "Release"}
 			pickywarnings(_ACTION)
 			sociconfiguration("Release")
 			icuconfiguration("Release", _ACTION)
 			wxconfiguration("Release", _ACTION)
+			boostconfiguration("Release", _ACTION)
 
 	project "action_profiler"
 		language "C++"
@@ -645,12 +691,14 @@ solution "triumph4php"
 			sociconfiguration("Debug")
 			wxconfiguration("Debug", _ACTION)
 			wxappconfiguration("Debug", _ACTION)
+			boostconfiguration("Debug", _ACTION)
 			icuconfiguration("Debug", _ACTION)
 		configuration "Release"
 			pickywarnings(_ACTION)
 			sociconfiguration("Release")
 			wxconfiguration("Release", _ACTION)
 			wxappconfiguration("Release", _ACTION)
+			boostconfiguration("Release", _ACTION)
 			icuconfiguration("Release", _ACTION)
 
 	project "unit_test++"
@@ -0,0 +1,75 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <soci/soci.h>
+#include <unicode/uclean.h>
+#include <wx/filename.h>
+#include <iostream>
+#include "globals/Sqlite.h"
+#include "globals/String.h"
+#include "language_php/NativeTagImageClass.h"
+
+/**
+ * Generates the native tag image (see NativeTagImageClass) from the native
+ * functions tag db. This program is run after it is built, so that the image
+ * that is shipped is always in sync with the db.
+ *
+ * usage: native_tag_image [db file] [image file]
+ */
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "this is a program that is used to generate the native tag image" << std::endl
+                  << "usage: native_tag_image [db file] [image file]" << std::endl;
+        return 1;
+    }
+    wxFileName dbFileName(t4p::CharToWx(argv[1]));
+    wxFileName imageFileName(t4p::CharToWx(argv[2]));
+    if (!dbFileName.FileExists()) {
+        // the db is generated by a separate script; when it has not been
+        // generated, there is nothing to do. The app will use the db
+        // directly when there is no image.
+        std::cout << "native tag db not found, skipping image: " << argv[1] << std::endl;
+        return 0;
+    }
+    int ret = 0;
+    soci::session session;
+    if (t4p::SqliteOpen(session, dbFileName.GetFullPath())) {
+        wxString error;
+        if (t4p::NativeTagImageClass::Write(session, imageFileName, error)) {
+            std::cout << "wrote native tag image: " << argv[2] << std::endl;
+        } else {
+            std::cout << "could not write native tag image: " << t4p::WxToChar(error) << std::endl;
+            ret = 1;
+        }
+        session.close();
+    } else {
+        std::cout << "could not open native tag db: " << argv[1] << std::endl;
+        ret = 1;
+    }
+
+    // calling cleanup here so that we can run this binary through a memory leak detector
+    // ICU will cache many things and that will cause the detector to output "possible leaks"
+    u_cleanup();
+    return ret;
+}
@@ -268,6 +268,32 @@ void ProfileParser() {
     printf("time for parsing a native.php:%ld ms\n", time.ToLong());
 }
 
+/**
+ * walks DirName with the given tag parser and prints the number of
+ * resources written per second
+ *
+ * @param label the name of the run
+ * @param session the connection to the tag db, all tags are wiped before the walk
+ * @param tagParser the tag parser to walk with
+ */
+static void ProfileTagParserWalk(const char* label, soci::session& session, t4p::TagParserClass& tagParser) {
+    tagParser.WipeAll();
+    t4p::DirectorySearchClass search;
+    wxLongLong time = wxGetLocalTimeMillis();
+    search.Init(DirName);
+    while (search.More()) {
+        search.Walk(tagParser);
+    }
+    time = wxGetLocalTimeMillis() - time;
+
+    int rowCount = 0;
+    session << "SELECT COUNT(*) FROM resources", soci::into(rowCount);
+    long millis = time.ToLong();
+    double rowsPerSecond = millis > 0 ? (rowCount * 1000.0) / millis : 0.0;
+    printf("time for tagParser on entire project (%s):%ld ms rows:%d rows/sec:%.0f\n",
+           label, millis, rowCount, rowsPerSecond);
+}
+
 void ProfileTagParserOnLargeProject() {
     printf("*******\n");
     // initialize the sqlite db
@@ -285,24 +311,23 @@ void ProfileTagParserOnLargeProject() {
     }
 
     t4p::TagParserClass tagParser;
-    t4p::ParsedTagFinderClass tagFinder(session);
-
-    t4p::DirectorySearchClass search;
-    wxLongLong time;
     if (DirName.IsEmpty() || !wxDirExists(DirName)) {
         printf("Nor running ProfileResourceFinderOnLargeProject because file was not found: %s",
                (const char*)DirName.ToAscii());
         return;
     }
-    time = wxGetLocalTimeMillis();
     tagParser.PhpFileExtensions.push_back(wxT("*.php"));
     tagParser.Init(&session);
-    search.Init(DirName);
-    while (search.More()) {
-        search.Walk(tagParser);
-    }
-    time = wxGetLocalTimeMillis() - time;
-    printf("time for tagFinder on entire project:%ld ms\n", time.ToLong());
+
+    // one row per INSERT, this is how resources used to be written
+    tagParser.SetResourcesPerInsert(1);
+    ProfileTagParserWalk("1 row per insert", session, tagParser);
+
+    tagParser.SetResourcesPerInsert(500);
+    ProfileTagParserWalk("500 rows per insert", session, tagParser);
+
+    tagParser.SetParserThreads(0);
+    ProfileTagParserWalk("500 rows per insert, parser threads", session, tagParser);
 }
 
 void ProfileTagSearch() {
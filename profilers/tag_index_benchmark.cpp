@@ -0,0 +1,673 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <soci/soci.h>
+#include <unicode/uclean.h>
+#include <wx/ffile.h>
+#include <wx/filefn.h>
+#include <wx/filename.h>
+#include <wx/utils.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/Sqlite.h"
+#include "globals/String.h"
+#include "language_php/TagCollectorClass.h"
+#include "language_php/TagFinderList.h"
+#include "search/Directory.h"
+#include "search/DirectorySearchClass.h"
+
+/**
+ * Benchmarks building and querying the tag index on a generated PHP project.
+ * The project is generated from a seed, so that runs with the same options
+ * index exactly the same code; the results of different builds can then
+ * be compared to track indexing regressions.
+ *
+ * Each phase is timed separately:
+ *   generate - writing the project to disk
+ *   walk     - listing the project files, without opening them
+ *   parse    - parsing the files for tags, without writing them
+ *   index    - parsing the files and writing the tags to the tag db
+ *   load     - reading the tag db into the in-memory tag index
+ *   query    - near matches, exact matches and class hierarchy lookups
+ *
+ * The results are printed as JSON, one object per run.
+ *
+ * usage: tag_index_benchmark [--option=value ...]
+ */
+
+/**
+ * the options of a run, see PrintUsage()
+ */
+class BenchmarkOptionsClass {
+ public:
+    BenchmarkOptionsClass();
+
+    /**
+     * sets the option given on the command line
+     * @return bool FALSE if the argument is not a known option
+     */
+    bool Parse(const std::string& arg);
+
+    wxString Dir;
+    wxString Output;
+    int Seed;
+    int Files;
+    int ClassesPerFile;
+    int MethodsPerClass;
+    int Namespaces;
+    int Traits;
+    int Depth;
+    int HugeFiles;
+    int HugeFileMethods;
+    int Queries;
+    int ParserThreads;
+};
+
+/**
+ * a small linear congruential generator; the generated project must be
+ * the same on all platforms, so rand() cannot be used
+ */
+class BenchmarkRandomClass {
+ public:
+    explicit BenchmarkRandomClass(int seed);
+
+    /**
+     * @return a number in the range [0, max)
+     */
+    int Next(int max);
+
+ private:
+    unsigned int State;
+};
+
+/**
+ * the time and item count of one phase
+ */
+class BenchmarkPhaseClass {
+ public:
+    BenchmarkPhaseClass(const std::string& name, long millis, long items);
+
+    std::string Name;
+    long Millis;
+    long Items;
+};
+
+/**
+ * counts the files of the project, without opening them
+ */
+class CountingWalkerClass : public t4p::DirectoryWalkerClass {
+ public:
+    CountingWalkerClass();
+
+    virtual bool Walk(const wxString& file);
+
+    long Count;
+};
+
+/**
+ * parses each file of the project for tags, but does not write
+ * the tags anywhere
+ */
+class CollectingWalkerClass : public t4p::DirectoryWalkerClass {
+ public:
+    CollectingWalkerClass();
+
+    virtual bool Walk(const wxString& file);
+
+    long TagCount;
+
+ private:
+    t4p::TagCollectorClass Collector;
+    t4p::ParsedFileTagsClass Parsed;
+};
+
+/**
+ * writes the project to the given directory
+ *
+ * @param fileCount will be set to the number of files written
+ * @param classNames will be filled with the fully qualified name of
+ *        every class in the project
+ * @return the number of lines written, -1 if the project could not be written
+ */
+static long GenerateProject(const BenchmarkOptionsClass& options, const wxString& dir, long& fileCount,
+                            std::vector<std::string>& classNames);
+
+/**
+ * runs all of the phases
+ * @return bool FALSE if a phase could not be run
+ */
+static bool RunBenchmark(const BenchmarkOptionsClass& options, std::vector<BenchmarkPhaseClass>& phases,
+                         long& lineCount, long& tagCount);
+
+/**
+ * @return the results as a JSON object
+ */
+static std::string ResultsJson(const BenchmarkOptionsClass& options, const std::vector<BenchmarkPhaseClass>& phases,
+                               long lineCount, long tagCount);
+
+static void PrintUsage();
+
+int main(int argc, char** argv) {
+    BenchmarkOptionsClass options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (!options.Parse(arg)) {
+            std::cout << "unknown option:" << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    std::vector<BenchmarkPhaseClass> phases;
+    long lineCount = 0;
+    long tagCount = 0;
+    int ret = 0;
+    if (RunBenchmark(options, phases, lineCount, tagCount)) {
+        std::string json = ResultsJson(options, phases, lineCount, tagCount);
+        if (options.Output.IsEmpty()) {
+            std::cout << json << std::endl;
+        } else {
+            wxFFile file;
+            if (file.Open(options.Output, wxT("ab"))) {
+                file.Write(json.c_str(), json.length());
+                file.Write("\n", 1);
+                file.Close();
+            } else {
+                std::cout << "could not write results to:" << t4p::WxToChar(options.Output) << std::endl;
+                ret = 1;
+            }
+        }
+    } else {
+        ret = 1;
+    }
+
+    // calling cleanup here so that we can run this binary through a memory leak detector
+    // ICU will cache many things and that will cause the detector to output "possible leaks"
+    u_cleanup();
+    return ret;
+}
+
+static void PrintUsage() {
+    std::cout << "this is a program that is used to benchmark building the tag index" << std::endl
+              << "usage: tag_index_benchmark [--option=value ...]" << std::endl
+              << "options:" << std::endl
+              << "--dir=[dir]            where the project and tag db are written (default: temp dir)" << std::endl
+              << "--output=[file]        append the JSON results to this file (default: stdout)" << std::endl
+              << "--seed=[n]             the seed of the generated project (default: 1)" << std::endl
+              << "--files=[n]            number of files (default: 500)" << std::endl
+              << "--classes=[n]          classes per file (default: 4)" << std::endl
+              << "--methods=[n]          methods per class (default: 10)" << std::endl
+              << "--namespaces=[n]       number of namespaces (default: 20)" << std::endl
+              << "--traits=[n]           number of traits (default: 20)" << std::endl
+              << "--depth=[n]            depth of the class hierarchies (default: 6)" << std::endl
+              << "--huge-files=[n]       number of huge files (default: 2)" << std::endl
+              << "--huge-methods=[n]     methods in each huge file (default: 5000)" << std::endl
+              << "--queries=[n]          number of queries of each kind (default: 1000)" << std::endl
+              << "--threads=[n]          parser threads, 0 for one per CPU (default: 1)" << std::endl;
+}
+
+BenchmarkOptionsClass::BenchmarkOptionsClass()
+    : Dir()
+    , Output()
+    , Seed(1)
+    , Files(500)
+    , ClassesPerFile(4)
+    , MethodsPerClass(10)
+    , Namespaces(20)
+    , Traits(20)
+    , Depth(6)
+    , HugeFiles(2)
+    , HugeFileMethods(5000)
+    , Queries(1000)
+    , ParserThreads(1) {
+    wxFileName dir;
+    dir.AssignDir(wxFileName::GetTempDir());
+    dir.AppendDir(wxT("tag_index_benchmark"));
+    Dir = dir.GetPath();
+}
+
+bool BenchmarkOptionsClass::Parse(const std::string& arg) {
+    size_t equals = arg.find('=');
+    if (arg.find("--") != 0 || equals == std::string::npos) {
+        return false;
+    }
+    std::string name = arg.substr(2, equals - 2);
+    std::string value = arg.substr(equals + 1);
+    if (name == "dir") {
+        Dir = t4p::CharToWx(value.c_str());
+        return true;
+    }
+    if (name == "output") {
+        Output = t4p::CharToWx(value.c_str());
+        return true;
+    }
+    int number = 0;
+    std::istringstream stream(value);
+    if (!(stream >> number) || number < 0) {
+        return false;
+    }
+    if (name == "seed") {
+        Seed = number;
+    } else if (name == "files") {
+        Files = number;
+    } else if (name == "classes") {
+        ClassesPerFile = number;
+    } else if (name == "methods") {
+        MethodsPerClass = number;
+    } else if (name == "namespaces") {
+        Namespaces = number > 0 ? number : 1;
+    } else if (name == "traits") {
+        Traits = number;
+    } else if (name == "depth") {
+        Depth = number > 0 ? number : 1;
+    } else if (name == "huge-files") {
+        HugeFiles = number;
+    } else if (name == "huge-methods") {
+        HugeFileMethods = number;
+    } else if (name == "queries") {
+        Queries = number;
+    } else if (name == "threads") {
+        ParserThreads = number;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+BenchmarkRandomClass::BenchmarkRandomClass(int seed)
+    : State(static_cast<unsigned int>(seed) * 2654435761u + 1u) {
+}
+
+int BenchmarkRandomClass::Next(int max) {
+    if (max <= 0) {
+        return 0;
+    }
+    State = State * 1103515245u + 12345u;
+    return static_cast<int>((State >> 8) % static_cast<unsigned int>(max));
+}
+
+BenchmarkPhaseClass::BenchmarkPhaseClass(const std::string& name, long millis, long items)
+    : Name(name)
+    , Millis(millis)
+    , Items(items) {
+}
+
+CountingWalkerClass::CountingWalkerClass()
+    : Count(0) {
+}
+
+bool CountingWalkerClass::Walk(const wxString& file) {
+    if (file.EndsWith(wxT(".php"))) {
+        Count++;
+    }
+    return false;
+}
+
+CollectingWalkerClass::CollectingWalkerClass()
+    : TagCount(0)
+    , Collector()
+    , Parsed() {
+    Collector.SetVersion(pelet::PHP_54);
+}
+
+bool CollectingWalkerClass::Walk(const wxString& file) {
+    if (file.EndsWith(wxT(".php")) && Collector.CollectFile(file, 0, Parsed)) {
+        TagCount += Parsed.Tags.size();
+    }
+    return false;
+}
+
+/**
+ * @return the name of the Nth namespace
+ */
+static std::string NamespaceName(int index) {
+    std::ostringstream stream;
+    stream << "Bench\\Ns" << index;
+    return stream.str();
+}
+
+/**
+ * @return the name of the class that is the Nth class of the project
+ */
+static std::string ClassName(int index) {
+    std::ostringstream stream;
+    stream << "Class" << index;
+    return stream.str();
+}
+
+/**
+ * writes a method with a doc comment, the return type is a class of the
+ * project so that type resolution has something to resolve
+ */
+static void WriteMethod(std::ostringstream& code, int index, const std::string& returnType, long& lineCount) {
+    code << "    /**\n"
+         << "     * method " << index << "\n"
+         << "     * @return " << returnType << "\n"
+         << "     */\n"
+         << "    public function method" << index << "($arg" << index << ", $other = null) {\n"
+         << "        $local = $arg" << index << ";\n"
+         << "        return $local;\n"
+         << "    }\n\n";
+    lineCount += 9;
+}
+
+/**
+ * writes the given code to the given file, creating the directory if needed
+ */
+static bool WriteFile(const wxFileName& fileName, const std::string& code) {
+    if (!fileName.DirExists() && !wxMkdir(fileName.GetPath(), 0777)) {
+        return false;
+    }
+    wxFFile file;
+    if (!file.Open(fileName.GetFullPath(), wxT("wb"))) {
+        return false;
+    }
+    bool written = file.Write(code.c_str(), code.length()) == code.length();
+    file.Close();
+    return written;
+}
+
+static long GenerateProject(const BenchmarkOptionsClass& options, const wxString& dir, long& fileCount,
+                            std::vector<std::string>& classNames) {
+    BenchmarkRandomClass random(options.Seed);
+    long lineCount = 0;
+    fileCount = 0;
+
+    // the traits, each trait may use the trait before it
+    if (options.Traits > 0) {
+        std::ostringstream code;
+        code << "<?php\n"
+             << "namespace " << NamespaceName(0) << ";\n\n";
+        lineCount += 3;
+        for (int i = 0; i < options.Traits; ++i) {
+            code << "trait Trait" << i << " {\n";
+            if (i > 0 && random.Next(2) == 0) {
+                code << "    use Trait" << (i - 1) << ";\n";
+                lineCount++;
+            }
+            code << "    public function traitMethod" << i << "() {}\n"
+                 << "}\n\n";
+            lineCount += 4;
+        }
+        wxFileName fileName(dir, wxT("Traits.php"));
+        fileName.AppendDir(wxT("Ns0"));
+        if (!WriteFile(fileName, code.str())) {
+            return -1;
+        }
+        fileCount++;
+    }
+
+    // the classes are numbered across the project; each class extends the
+    // class before it, unless it starts a new hierarchy. the namespace
+    // of each class is kept since a parent may be in another namespace
+    std::vector<int> classNamespaces;
+    int classIndex = 0;
+    for (int i = 0; i < options.Files; ++i) {
+        int ns = random.Next(options.Namespaces);
+        std::ostringstream code;
+        code << "<?php\n"
+             << "namespace " << NamespaceName(ns) << ";\n\n";
+        lineCount += 3;
+        for (int j = 0; j < options.ClassesPerFile; ++j) {
+            classNamespaces.push_back(ns);
+            classNames.push_back("\\" + NamespaceName(ns) + "\\" + ClassName(classIndex));
+            code << "/**\n"
+                 << " * class " << classIndex << "\n"
+                 << " */\n"
+                 << "class " << ClassName(classIndex);
+            if (classIndex % options.Depth != 0) {
+                code << " extends \\" << NamespaceName(classNamespaces[classIndex - 1]) << "\\" << ClassName(classIndex - 1);
+            }
+            code << " {\n";
+            lineCount += 4;
+            if (options.Traits > 0 && random.Next(3) == 0) {
+                code << "    use \\" << NamespaceName(0) << "\\Trait" << random.Next(options.Traits) << ";\n";
+                lineCount++;
+            }
+            code << "    const CONSTANT_" << classIndex << " = " << classIndex << ";\n"
+                 << "    protected $property" << classIndex << ";\n\n";
+            lineCount += 3;
+            for (int k = 0; k < options.MethodsPerClass; ++k) {
+                int returnClass = random.Next(classIndex + 1);
+                std::string returnType = "\\" + NamespaceName(classNamespaces[returnClass]) + "\\" + ClassName(returnClass);
+                WriteMethod(code, k, returnType, lineCount);
+            }
+            code << "}\n\n";
+            lineCount += 2;
+            classIndex++;
+        }
+        code << "function function" << i << "() {}\n";
+        lineCount++;
+
+        std::ostringstream name;
+        name << "File" << i << ".php";
+        std::ostringstream nsDir;
+        nsDir << "Ns" << ns;
+        wxFileName fileName(dir, t4p::CharToWx(name.str().c_str()));
+        fileName.AppendDir(t4p::CharToWx(nsDir.str().c_str()));
+        if (!WriteFile(fileName, code.str())) {
+            return -1;
+        }
+        fileCount++;
+    }
+
+    // huge files; a single class with many methods
+    for (int i = 0; i < options.HugeFiles; ++i) {
+        std::ostringstream className;
+        className << "HugeClass" << i;
+        std::ostringstream code;
+        code << "<?php\n"
+             << "namespace " << NamespaceName(0) << ";\n\n"
+             << "class " << className.str() << " {\n";
+        lineCount += 4;
+        for (int k = 0; k < options.HugeFileMethods; ++k) {
+            WriteMethod(code, k, "\\" + NamespaceName(0) + "\\" + className.str(), lineCount);
+        }
+        code << "}\n";
+        lineCount++;
+
+        std::ostringstream name;
+        name << "HugeFile" << i << ".php";
+        wxFileName fileName(dir, t4p::CharToWx(name.str().c_str()));
+        fileName.AppendDir(wxT("Huge"));
+        if (!WriteFile(fileName, code.str())) {
+            return -1;
+        }
+        fileCount++;
+    }
+    return lineCount;
+}
+
+/**
+ * @return the milliseconds since the given time
+ */
+static long MillisSince(const wxLongLong& start) {
+    return (wxGetLocalTimeMillis() - start).ToLong();
+}
+
+static bool RunBenchmark(const BenchmarkOptionsClass& options, std::vector<BenchmarkPhaseClass>& phases,
+                         long& lineCount, long& tagCount) {
+    // start from scratch every time, so that runs are comparable
+    wxFileName projectDir;
+    projectDir.AssignDir(options.Dir);
+    projectDir.AppendDir(wxT("project"));
+    wxFileName dbFileName(options.Dir, wxT("tags.db"));
+    if (projectDir.DirExists()) {
+        t4p::RecursiveRmDir(projectDir.GetPath());
+    }
+    if (dbFileName.FileExists()) {
+        wxRemoveFile(dbFileName.GetFullPath());
+    }
+    if (!projectDir.Mkdir(0777, wxPATH_MKDIR_FULL)) {
+        std::cout << "could not create directory:" << t4p::WxToChar(projectDir.GetPath()) << std::endl;
+        return false;
+    }
+
+    wxLongLong start = wxGetLocalTimeMillis();
+    long fileCount = 0;
+    std::vector<std::string> classNames;
+    lineCount = GenerateProject(options, projectDir.GetPath(), fileCount, classNames);
+    if (lineCount < 0) {
+        std::cout << "could not write project to:" << t4p::WxToChar(projectDir.GetPath()) << std::endl;
+        return false;
+    }
+    phases.push_back(BenchmarkPhaseClass("generate", MillisSince(start), fileCount));
+
+    t4p::DirectorySearchClass search;
+    CountingWalkerClass countingWalker;
+    start = wxGetLocalTimeMillis();
+    search.Init(projectDir.GetPath());
+    while (search.More()) {
+        search.Walk(countingWalker);
+    }
+    phases.push_back(BenchmarkPhaseClass("walk", MillisSince(start), countingWalker.Count));
+
+    CollectingWalkerClass collectingWalker;
+    start = wxGetLocalTimeMillis();
+    search.Init(projectDir.GetPath());
+    while (search.More()) {
+        search.Walk(collectingWalker);
+    }
+    phases.push_back(BenchmarkPhaseClass("parse", MillisSince(start), collectingWalker.TagCount));
+
+    // the app creates the tag db schema in TagCacheDbVersionActionClass
+    soci::session session;
+    wxString error;
+    bool created = t4p::SqliteOpen(session, dbFileName.GetFullPath())
+                   && t4p::SqliteSqlScript(t4p::ResourceSqlSchemaAsset(), session, error);
+    session.close();
+    if (!created) {
+        std::cout << "could not create tag db:" << t4p::WxToChar(dbFileName.GetFullPath()) << " "
+                  << t4p::WxToChar(error) << std::endl;
+        return false;
+    }
+
+    t4p::TagFinderListClass finders;
+    std::vector<wxString> phpFileExtensions;
+    std::vector<wxString> miscFileExtensions;
+    phpFileExtensions.push_back(wxT("*.php"));
+    finders.InitGlobalTag(dbFileName, phpFileExtensions, miscFileExtensions, pelet::PHP_54);
+    if (!finders.IsTagFinderInit) {
+        std::cout << "could not create tag db:" << t4p::WxToChar(dbFileName.GetFullPath()) << std::endl;
+        return false;
+    }
+    finders.TagParser.SetParserThreads(options.ParserThreads);
+    start = wxGetLocalTimeMillis();
+    search.Init(projectDir.GetPath());
+    while (search.More()) {
+        finders.Walk(search);
+    }
+    long millis = MillisSince(start);
+    int rowCount = 0;
+    finders.TagDbSession << "SELECT COUNT(*) FROM resources", soci::into(rowCount);
+    tagCount = rowCount;
+    phases.push_back(BenchmarkPhaseClass("index", millis, rowCount));
+
+    start = wxGetLocalTimeMillis();
+    if (!finders.LoadTagIndex()) {
+        std::cout << "could not load the tag index" << std::endl;
+        return false;
+    }
+    phases.push_back(BenchmarkPhaseClass("load", MillisSince(start), finders.TagIndex.Count()));
+    if (classNames.empty()) {
+        return true;
+    }
+
+    // the queries are generated from the seed as well
+    BenchmarkRandomClass random(options.Seed);
+    std::vector<wxFileName> sourceDirs;
+    sourceDirs.push_back(projectDir);
+    long found = 0;
+    start = wxGetLocalTimeMillis();
+    for (int i = 0; i < options.Queries; ++i) {
+        // a prefix of a class name, as if the user were typing it
+        std::string className = ClassName(random.Next(static_cast<int>(classNames.size())));
+        std::string prefix = className.substr(0, 5 + random.Next(static_cast<int>(className.length()) - 4));
+        std::vector<t4p::PhpTagClass> matches;
+        t4p::TagSearchClass tagSearch(t4p::CharToIcu(prefix.c_str()));
+        finders.NearMatchesFromAll(tagSearch, matches, sourceDirs);
+        found += matches.size();
+    }
+    phases.push_back(BenchmarkPhaseClass("query_near", MillisSince(start), found));
+
+    found = 0;
+    start = wxGetLocalTimeMillis();
+    for (int i = 0; i < options.Queries; ++i) {
+        // the methods are inherited, the deeper the class the
+        // more classes need to be looked at
+        std::ostringstream resource;
+        resource << classNames[random.Next(static_cast<int>(classNames.size()))]
+                 << "::method" << random.Next(options.MethodsPerClass > 0 ? options.MethodsPerClass : 1);
+        UnicodeString type = finders.ResolveResourceType(t4p::CharToIcu(resource.str().c_str()), sourceDirs);
+        found += type.isEmpty() ? 0 : 1;
+    }
+    phases.push_back(BenchmarkPhaseClass("query_resolve", MillisSince(start), found));
+
+    found = 0;
+    start = wxGetLocalTimeMillis();
+    for (int i = 0; i < options.Queries; ++i) {
+        UnicodeString className = t4p::CharToIcu(classNames[random.Next(static_cast<int>(classNames.size()))].c_str());
+        std::vector<UnicodeString> parents = finders.ClassParents(className, UNICODE_STRING_SIMPLE(""));
+        std::vector<UnicodeString> traits = finders.ClassUsedTraits(className, parents, UNICODE_STRING_SIMPLE(""), sourceDirs);
+        found += parents.size() + traits.size();
+    }
+    phases.push_back(BenchmarkPhaseClass("query_hierarchy", MillisSince(start), found));
+    return true;
+}
+
+static std::string ResultsJson(const BenchmarkOptionsClass& options, const std::vector<BenchmarkPhaseClass>& phases,
+                               long lineCount, long tagCount) {
+    std::ostringstream json;
+    json << "{\"benchmark\":\"tag_index\""
+         << ",\"seed\":" << options.Seed
+         << ",\"files\":" << options.Files
+         << ",\"classes\":" << options.ClassesPerFile
+         << ",\"methods\":" << options.MethodsPerClass
+         << ",\"namespaces\":" << options.Namespaces
+         << ",\"traits\":" << options.Traits
+         << ",\"depth\":" << options.Depth
+         << ",\"huge_files\":" << options.HugeFiles
+         << ",\"huge_methods\":" << options.HugeFileMethods
+         << ",\"queries\":" << options.Queries
+         << ",\"threads\":" << options.ParserThreads
+         << ",\"lines\":" << lineCount
+         << ",\"tags\":" << tagCount
+         << ",\"phases\":[";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        if (i > 0) {
+            json << ",";
+        }
+        json << "{\"name\":\"" << phases[i].Name << "\""
+             << ",\"ms\":" << phases[i].Millis
+             << ",\"items\":" << phases[i].Items << "}";
+    }
+    json << "]}";
+    return json.str();
+}
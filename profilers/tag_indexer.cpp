@@ -0,0 +1,465 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <soci/soci.h>
+#include <soci/sqlite3/soci-sqlite3.h>
+#include <unicode/uclean.h>
+#include <wx/dir.h>
+#include <wx/ffile.h>
+#include <wx/filename.h>
+#include <wx/utils.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/Sqlite.h"
+#include "globals/String.h"
+#include "language_php/TagFinderList.h"
+#include "language_php/TagShardsClass.h"
+#include "search/DirectorySearchClass.h"
+#include "search/RecursiveDirTraverserClass.h"
+
+/**
+ * Builds or updates the tag cache of the given source directories, without
+ * a display. This does the same thing as the "Project Resource Parsing"
+ * action of the app (see ProjectTagActionClass) so that caches can be
+ * pre-warmed on machines that have no display, and indexing can be timed
+ * on a real project.
+ *
+ * The tag db is created when it does not exist, or re-created when it was
+ * made by another version of the app. When a detector db and a PHP
+ * executable are given, the tag detectors are run after the sources are
+ * tagged, the same way that TagDetectorActionClass runs them.
+ *
+ * The timings are printed as JSON, one object per run.
+ *
+ * usage: tag_indexer --db=[file] --source=[dir] [--source=[dir] ...] [--option=value ...]
+ */
+
+/**
+ * the options of a run, see PrintUsage()
+ */
+class IndexerOptionsClass {
+ public:
+    IndexerOptionsClass();
+
+    /**
+     * sets the option given on the command line
+     * @return bool FALSE if the argument is not a known option
+     */
+    bool Parse(const std::string& arg);
+
+    wxString TagDb;
+    wxString DetectorDb;
+    wxString PhpExecutable;
+    wxString Output;
+    wxString ImportBundle;
+    wxString ExportBundle;
+    std::vector<wxString> Sources;
+    std::vector<wxString> PhpFileExtensions;
+    pelet::Versions Version;
+    int ParserThreads;
+    bool DoBulkLoad;
+};
+
+/**
+ * the time and item count of one phase
+ */
+class IndexerPhaseClass {
+ public:
+    IndexerPhaseClass(const std::string& name, long millis, long items);
+
+    std::string Name;
+    long Millis;
+    long Items;
+};
+
+/**
+ * makes sure that the given db has the schema of the given script; the db
+ * is (re-)created when its schema version is not the same as the version
+ * of the script.
+ *
+ * @param isTagDb TRUE if the db is a tag db, its shards are removed when
+ *        the db is re-created
+ * @return bool FALSE if the db could not be created
+ */
+static bool CreateDb(const wxFileName& dbFileName, const wxFileName& sqlScript, bool isTagDb);
+
+/**
+ * runs the tag detector scripts on each source
+ * @return the number of detectors that ran successfully
+ */
+static long RunTagDetectors(const IndexerOptionsClass& options);
+
+/**
+ * runs all of the phases
+ * @return bool FALSE if a phase could not be run
+ */
+static bool RunIndexer(const IndexerOptionsClass& options, std::vector<IndexerPhaseClass>& phases, long& tagCount);
+
+/**
+ * @return the results as a JSON object
+ */
+static std::string ResultsJson(const IndexerOptionsClass& options, const std::vector<IndexerPhaseClass>& phases, long tagCount);
+
+static void PrintUsage();
+
+int main(int argc, char** argv) {
+    IndexerOptionsClass options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (!options.Parse(arg)) {
+            std::cout << "unknown option:" << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (options.TagDb.IsEmpty() || options.Sources.empty()) {
+        PrintUsage();
+        return 1;
+    }
+    if ((!options.ImportBundle.IsEmpty() || !options.ExportBundle.IsEmpty()) && options.Sources.size() != 1) {
+        std::cout << "bundles can only be used with a single source" << std::endl;
+        return 1;
+    }
+    if (options.PhpFileExtensions.empty()) {
+        options.PhpFileExtensions.push_back(wxT("*.php"));
+    }
+    std::vector<IndexerPhaseClass> phases;
+    long tagCount = 0;
+    int ret = 0;
+    if (RunIndexer(options, phases, tagCount)) {
+        std::string json = ResultsJson(options, phases, tagCount);
+        if (options.Output.IsEmpty()) {
+            std::cout << json << std::endl;
+        } else {
+            wxFFile file;
+            if (file.Open(options.Output, wxT("ab"))) {
+                file.Write(json.c_str(), json.length());
+                file.Write("\n", 1);
+                file.Close();
+            } else {
+                std::cout << "could not write results to:" << t4p::WxToChar(options.Output) << std::endl;
+                ret = 1;
+            }
+        }
+    } else {
+        ret = 1;
+    }
+
+    // calling cleanup here so that we can run this binary through a memory leak detector
+    // ICU will cache many things and that will cause the detector to output "possible leaks"
+    u_cleanup();
+    return ret;
+}
+
+static void PrintUsage() {
+    std::cout << "this is a program that is used to build the tag cache without the app" << std::endl
+              << "usage: tag_indexer --db=[file] --source=[dir] [--source=[dir] ...] [--option=value ...]" << std::endl
+              << "options:" << std::endl
+              << "--db=[file]             the tag db to create or update (required)" << std::endl
+              << "--source=[dir]          a source directory to tag, can be given many times (required)" << std::endl
+              << "--ext=[wildcard]        PHP file extension, can be given many times (default: *.php)" << std::endl
+              << "--php-version=[5.3|5.4] the PHP version to parse with (default: 5.4)" << std::endl
+              << "--threads=[n]           parser threads, 0 for one per CPU (default: 1)" << std::endl
+              << "--bulk=[0|1]            delete the tags of the sources and re-tag them in bulk (default: 0)" << std::endl
+              << "--import-bundle=[file]  import a tag bundle before tagging the source" << std::endl
+              << "--export-bundle=[file]  export a tag bundle after tagging the source" << std::endl
+              << "--detector-db=[file]    the detector db to create or update" << std::endl
+              << "--php=[file]            the PHP executable used to run the tag detectors" << std::endl
+              << "--output=[file]         append the JSON results to this file (default: stdout)" << std::endl;
+}
+
+IndexerOptionsClass::IndexerOptionsClass()
+    : TagDb()
+    , DetectorDb()
+    , PhpExecutable()
+    , Output()
+    , ImportBundle()
+    , ExportBundle()
+    , Sources()
+    , PhpFileExtensions()
+    , Version(pelet::PHP_54)
+    , ParserThreads(1)
+    , DoBulkLoad(false) {
+}
+
+bool IndexerOptionsClass::Parse(const std::string& arg) {
+    size_t equals = arg.find('=');
+    if (arg.find("--") != 0 || equals == std::string::npos) {
+        return false;
+    }
+    std::string name = arg.substr(2, equals - 2);
+    std::string value = arg.substr(equals + 1);
+    wxString wxValue = t4p::CharToWx(value.c_str());
+    if (name == "db") {
+        TagDb = wxValue;
+    } else if (name == "source") {
+        wxFileName dir;
+        dir.AssignDir(wxValue);
+        dir.MakeAbsolute();
+        Sources.push_back(dir.GetPath());
+    } else if (name == "ext") {
+        PhpFileExtensions.push_back(wxValue);
+    } else if (name == "php-version") {
+        if (value == "5.3") {
+            Version = pelet::PHP_53;
+        } else if (value == "5.4") {
+            Version = pelet::PHP_54;
+        } else {
+            return false;
+        }
+    } else if (name == "detector-db") {
+        DetectorDb = wxValue;
+    } else if (name == "php") {
+        PhpExecutable = wxValue;
+    } else if (name == "output") {
+        Output = wxValue;
+    } else if (name == "import-bundle") {
+        ImportBundle = wxValue;
+    } else if (name == "export-bundle") {
+        ExportBundle = wxValue;
+    } else if (name == "threads" || name == "bulk") {
+        int number = 0;
+        std::istringstream stream(value);
+        if (!(stream >> number) || number < 0) {
+            return false;
+        }
+        if (name == "threads") {
+            ParserThreads = number;
+        } else {
+            DoBulkLoad = number != 0;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+IndexerPhaseClass::IndexerPhaseClass(const std::string& name, long millis, long items)
+    : Name(name)
+    , Millis(millis)
+    , Items(items) {
+}
+
+/**
+ * @return the milliseconds since the given time
+ */
+static long MillisSince(const wxLongLong& start) {
+    return (wxGetLocalTimeMillis() - start).ToLong();
+}
+
+static bool CreateDb(const wxFileName& dbFileName, const wxFileName& sqlScript, bool isTagDb) {
+    // the schema version is in the script itself; run it on a scratch db
+    // to get it
+    bool ret = false;
+    try {
+        soci::session scriptSession(*soci::factory_sqlite3(), ":memory:");
+        wxString error;
+        if (!t4p::SqliteSqlScript(sqlScript, scriptSession, error)) {
+            std::cout << "could not read schema:" << t4p::WxToChar(error) << std::endl;
+            return false;
+        }
+        int scriptVersion = t4p::SqliteSchemaVersion(scriptSession);
+        scriptSession.close();
+
+        soci::session session;
+        if (!t4p::SqliteOpen(session, dbFileName.GetFullPath())) {
+            return false;
+        }
+        ret = true;
+        if (t4p::SqliteSchemaVersion(session) != scriptVersion) {
+            if (isTagDb) {
+                // the shards have the tags of the old schema too
+                t4p::TagShardsClass::RemoveFiles(dbFileName);
+            }
+            ret = t4p::SqliteSqlScript(sqlScript, session, error);
+            if (!ret) {
+                std::cout << "could not create db:" << t4p::WxToChar(error) << std::endl;
+            }
+        }
+        session.close();
+    } catch (std::exception& e) {
+        std::cout << "could not create db:" << e.what() << std::endl;
+        ret = false;
+    }
+    return ret;
+}
+
+static long RunTagDetectors(const IndexerOptionsClass& options) {
+    std::vector<wxString> scripts;
+    t4p::RecursiveDirTraverserClass traverser(scripts);
+    wxDir globalDir;
+    if (globalDir.Open(t4p::TagDetectorsGlobalAsset().GetFullPath())) {
+        globalDir.Traverse(traverser, wxEmptyString, wxDIR_DIRS | wxDIR_FILES);
+    }
+    wxDir localDir;
+    if (localDir.Open(t4p::TagDetectorsLocalAsset().GetFullPath())) {
+        localDir.Traverse(traverser, wxEmptyString, wxDIR_DIRS | wxDIR_FILES);
+    }
+
+    // same command line as TagDetectorParamsClass::BuildCmdLine
+    long count = 0;
+    wxFileName tagDbFileName(options.TagDb);
+    wxFileName detectorDbFileName(options.DetectorDb);
+    tagDbFileName.MakeAbsolute();
+    detectorDbFileName.MakeAbsolute();
+    for (size_t i = 0; i < options.Sources.size(); ++i) {
+        for (size_t j = 0; j < scripts.size(); ++j) {
+            wxString cmdLine = wxT("\"") + options.PhpExecutable + wxT("\"") +
+                               wxT(" -d include_path=") + wxT("\"") + t4p::PhpDetectorsBaseAsset().GetPath() + wxT("\"") +
+                               wxT(" ") + wxT("\"") + scripts[j] + wxT("\"") +
+                               wxT(" --sourceDir=") + wxT("\"") + options.Sources[i] + wxT("\"") +
+                               wxT(" --resourceDbFileName=") + wxT("\"") + tagDbFileName.GetFullPath() + wxT("\"") +
+                               wxT(" --outputDbFileName=") + wxT("\"") + detectorDbFileName.GetFullPath() + wxT("\"");
+            wxArrayString output;
+            wxArrayString errors;
+            if (wxExecute(cmdLine, output, errors, wxEXEC_SYNC) == 0) {
+                count++;
+            } else {
+                std::cout << "detector failed:" << t4p::WxToChar(scripts[j]) << std::endl;
+                for (size_t k = 0; k < errors.GetCount(); ++k) {
+                    std::cout << t4p::WxToChar(errors[k]) << std::endl;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+static bool RunIndexer(const IndexerOptionsClass& options, std::vector<IndexerPhaseClass>& phases, long& tagCount) {
+    wxFileName dbFileName(options.TagDb);
+    wxLongLong start = wxGetLocalTimeMillis();
+    if (!CreateDb(dbFileName, t4p::ResourceSqlSchemaAsset(), true)) {
+        std::cout << "could not create tag db:" << t4p::WxToChar(dbFileName.GetFullPath()) << std::endl;
+        return false;
+    }
+    phases.push_back(IndexerPhaseClass("create", MillisSince(start), 1));
+
+    t4p::TagFinderListClass finders;
+    std::vector<wxString> miscFileExtensions;
+    finders.InitGlobalTag(dbFileName, options.PhpFileExtensions, miscFileExtensions, options.Version);
+    if (!finders.IsTagFinderInit) {
+        std::cout << "could not open tag db:" << t4p::WxToChar(dbFileName.GetFullPath()) << std::endl;
+        return false;
+    }
+    finders.TagParser.SetParserThreads(options.ParserThreads);
+    if (options.DoBulkLoad) {
+        start = wxGetLocalTimeMillis();
+        for (size_t i = 0; i < options.Sources.size(); ++i) {
+            wxFileName sourceDir;
+            sourceDir.AssignDir(options.Sources[i]);
+            finders.TagParser.DeleteSource(sourceDir);
+        }
+        phases.push_back(IndexerPhaseClass("delete", MillisSince(start), options.Sources.size()));
+    }
+
+    // the bundle is imported before walking, so that the files in the bundle
+    // are not parsed
+    if (!options.ImportBundle.IsEmpty()) {
+        wxFileName sourceDir;
+        sourceDir.AssignDir(options.Sources[0]);
+        start = wxGetLocalTimeMillis();
+        int imported = finders.TagParser.ImportBundle(wxFileName(options.ImportBundle), sourceDir);
+        phases.push_back(IndexerPhaseClass("import_bundle", MillisSince(start), imported));
+    }
+    if (options.DoBulkLoad) {
+        finders.TagParser.BeginBulkLoad();
+    } else {
+        // in case a previous bulk load did not finish
+        finders.TagParser.CreateIndexes();
+    }
+
+    t4p::DirectorySearchClass search;
+    long fileCount = 0;
+    start = wxGetLocalTimeMillis();
+    for (size_t i = 0; i < options.Sources.size(); ++i) {
+        if (!search.Init(options.Sources[i])) {
+            std::cout << "could not open source:" << t4p::WxToChar(options.Sources[i]) << std::endl;
+            continue;
+        }
+        while (search.More()) {
+            finders.Walk(search);
+            fileCount++;
+        }
+    }
+    phases.push_back(IndexerPhaseClass("index", MillisSince(start), fileCount));
+    if (options.DoBulkLoad) {
+        start = wxGetLocalTimeMillis();
+        finders.TagParser.EndBulkLoad();
+        phases.push_back(IndexerPhaseClass("create_indexes", MillisSince(start), 0));
+    }
+    if (!options.ExportBundle.IsEmpty()) {
+        wxFileName sourceDir;
+        sourceDir.AssignDir(options.Sources[0]);
+        start = wxGetLocalTimeMillis();
+        if (!finders.TagParser.ExportBundle(sourceDir, wxFileName(options.ExportBundle))) {
+            std::cout << "could not export bundle:" << t4p::WxToChar(options.ExportBundle) << std::endl;
+            return false;
+        }
+        phases.push_back(IndexerPhaseClass("export_bundle", MillisSince(start), 1));
+    }
+    int rowCount = 0;
+    finders.TagDbSession << "SELECT COUNT(*) FROM resources", soci::into(rowCount);
+    tagCount = rowCount;
+
+    if (!options.DetectorDb.IsEmpty()) {
+        start = wxGetLocalTimeMillis();
+        if (!CreateDb(wxFileName(options.DetectorDb), t4p::DetectorSqlSchemaAsset(), false)) {
+            std::cout << "could not create detector db:" << t4p::WxToChar(options.DetectorDb) << std::endl;
+            return false;
+        }
+        long detectorCount = 0;
+        if (!options.PhpExecutable.IsEmpty()) {
+            detectorCount = RunTagDetectors(options);
+        }
+        phases.push_back(IndexerPhaseClass("detect", MillisSince(start), detectorCount));
+    }
+    return true;
+}
+
+static std::string ResultsJson(const IndexerOptionsClass& options, const std::vector<IndexerPhaseClass>& phases, long tagCount) {
+    std::ostringstream json;
+    json << "{\"indexer\":\"tag\""
+         << ",\"sources\":" << options.Sources.size()
+         << ",\"threads\":" << options.ParserThreads
+         << ",\"bulk\":" << (options.DoBulkLoad ? "true" : "false")
+         << ",\"tags\":" << tagCount
+         << ",\"phases\":[";
+    for (size_t i = 0; i < phases.size(); ++i) {
+        if (i > 0) {
+            json << ",";
+        }
+        json << "{\"name\":\"" << phases[i].Name << "\""
+             << ",\"ms\":" << phases[i].Millis
+             << ",\"items\":" << phases[i].Items << "}";
+    }
+    json << "]}";
+    return json.str();
+}
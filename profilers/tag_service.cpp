@@ -0,0 +1,329 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <boost/asio.hpp>
+#include <unicode/uclean.h>
+#include <wx/filename.h>
+#include <wx/utils.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/String.h"
+#include "language_php/TagFinderList.h"
+#include "language_php/TagServiceClass.h"
+#include "language_php/TagServiceSocket.h"
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <poll.h>
+#endif
+
+/**
+ * Serves the tags of a tag db to all of the app instances on the same
+ * machine. The service owns the in-memory tag index and the tagging of
+ * the projects; the instances send it their tag queries and their tagging
+ * requests through a Unix domain socket that is next to the tag db (see
+ * TagServiceSocketFileName()). When the service is not running, the
+ * instances do the work in-process.
+ *
+ * Requests are answered one at a time. While projects are being tagged,
+ * a few files are tagged in between requests so that queries are still
+ * answered. The tag index is refreshed in between requests too; an instance
+ * that does not send its request (or read its response) in time is
+ * dropped, so that it cannot hold up the other instances.
+ *
+ * usage: tag_service --db=[file] [--option=value ...]
+ */
+
+/**
+ * the options of the service, see PrintUsage()
+ */
+class ServiceOptionsClass {
+ public:
+    ServiceOptionsClass();
+
+    /**
+     * sets the option given on the command line
+     * @return bool FALSE if the argument is not a known option
+     */
+    bool Parse(const std::string& arg);
+
+    wxString TagDb;
+    wxString DetectorDb;
+    wxString NativeDb;
+    wxString Socket;
+    pelet::Versions Version;
+    int ParserThreads;
+    int BatchSize;
+};
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+/**
+ * the most time (in milliseconds) that an instance has to send its
+ * request, and then to read the response
+ */
+static const int CONNECTION_TIMEOUT = 1000;
+
+/**
+ * the most time (in milliseconds) to wait for a connection before
+ * refreshing the tag index
+ */
+static const int IDLE_WAIT = 500;
+
+/**
+ * waits for a connection to the acceptor
+ *
+ * @return bool TRUE if a connection can be accepted, FALSE if the wait timed out
+ */
+static bool WaitForConnection(boost::asio::local::stream_protocol::acceptor& acceptor, int timeoutMillis);
+
+/**
+ * reads one request from the socket and writes the response
+ */
+static void ServeConnection(t4p::TagServiceClass& service, boost::asio::local::stream_protocol::socket& socket);
+
+/**
+ * accepts connections until an error happens
+ * @return bool FALSE if the socket could not be opened
+ */
+static bool Serve(t4p::TagServiceClass& service, const ServiceOptionsClass& options);
+
+#endif
+
+static void PrintUsage();
+
+int main(int argc, char** argv) {
+    ServiceOptionsClass options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            PrintUsage();
+            return 0;
+        }
+        if (!options.Parse(arg)) {
+            std::cout << "unknown option:" << arg << std::endl;
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (options.TagDb.IsEmpty()) {
+        PrintUsage();
+        return 1;
+    }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    wxFileName tagDbFileName(options.TagDb);
+    tagDbFileName.MakeAbsolute();
+    if (!tagDbFileName.FileExists()) {
+        std::cout << "tag db does not exist:" << t4p::WxToChar(tagDbFileName.GetFullPath()) << std::endl;
+        return 1;
+    }
+    if (options.Socket.IsEmpty()) {
+        options.Socket = t4p::TagServiceSocketFileName(tagDbFileName).GetFullPath();
+    }
+    t4p::TagServiceClientClass client;
+    if (client.Init(tagDbFileName)) {
+        std::cout << "the service is already running for:" << t4p::WxToChar(tagDbFileName.GetFullPath()) << std::endl;
+        return 1;
+    }
+
+    t4p::TagFinderListClass finders;
+    std::vector<wxString> phpFileExtensions;
+    std::vector<wxString> miscFileExtensions;
+    phpFileExtensions.push_back(wxT("*.php"));
+    finders.InitGlobalTag(tagDbFileName, phpFileExtensions, miscFileExtensions, options.Version);
+    if (!finders.IsTagFinderInit) {
+        std::cout << "could not open tag db:" << t4p::WxToChar(tagDbFileName.GetFullPath()) << std::endl;
+        return 1;
+    }
+    finders.TagParser.SetParserThreads(options.ParserThreads);
+    if (wxFileName::FileExists(options.NativeDb)) {
+        finders.InitNativeTag(wxFileName(options.NativeDb));
+    }
+    if (!options.DetectorDb.IsEmpty() && wxFileName::FileExists(options.DetectorDb)) {
+        finders.InitDetectorTag(wxFileName(options.DetectorDb));
+    }
+    wxLongLong start = wxGetLocalTimeMillis();
+    if (finders.LoadTagIndex()) {
+        std::cout << "loaded tags in " << (wxGetLocalTimeMillis() - start).ToLong() << " ms" << std::endl;
+    }
+
+    t4p::TagServiceClass service(finders);
+    int ret = Serve(service, options) ? 0 : 1;
+
+    // calling cleanup here so that we can run this binary through a memory leak detector
+    // ICU will cache many things and that will cause the detector to output "possible leaks"
+    u_cleanup();
+    return ret;
+#else
+    std::cout << "local sockets are not available on this platform" << std::endl;
+    return 1;
+#endif
+}
+
+static void PrintUsage() {
+    std::cout << "this is a program that serves the tags of a tag db to the app instances on this machine" << std::endl
+              << "usage: tag_service --db=[file] [--option=value ...]" << std::endl
+              << "options:" << std::endl
+              << "--db=[file]             the tag db to serve (required)" << std::endl
+              << "--detector-db=[file]    the detector db to query" << std::endl
+              << "--native-db=[file]      the native functions db to query (default: the app's asset)" << std::endl
+              << "--socket=[file]         the socket to listen on (default: next to the tag db)" << std::endl
+              << "--php-version=[5.3|5.4] the PHP version to parse with (default: 5.4)" << std::endl
+              << "--threads=[n]           parser threads, 0 for one per CPU (default: 0)" << std::endl
+              << "--batch=[n]             files to tag in between requests (default: 20)" << std::endl;
+}
+
+ServiceOptionsClass::ServiceOptionsClass()
+    : TagDb()
+    , DetectorDb()
+    , NativeDb(t4p::NativeFunctionsAsset().GetFullPath())
+    , Socket()
+    , Version(pelet::PHP_54)
+    , ParserThreads(0)
+    , BatchSize(20) {
+}
+
+bool ServiceOptionsClass::Parse(const std::string& arg) {
+    size_t equals = arg.find('=');
+    if (arg.find("--") != 0 || equals == std::string::npos) {
+        return false;
+    }
+    std::string name = arg.substr(2, equals - 2);
+    std::string value = arg.substr(equals + 1);
+    wxString wxValue = t4p::CharToWx(value.c_str());
+    if (name == "db") {
+        TagDb = wxValue;
+    } else if (name == "detector-db") {
+        DetectorDb = wxValue;
+    } else if (name == "native-db") {
+        NativeDb = wxValue;
+    } else if (name == "socket") {
+        Socket = wxValue;
+    } else if (name == "php-version") {
+        if (value == "5.3") {
+            Version = pelet::PHP_53;
+        } else if (value == "5.4") {
+            Version = pelet::PHP_54;
+        } else {
+            return false;
+        }
+    } else if (name == "threads" || name == "batch") {
+        int number = 0;
+        std::istringstream stream(value);
+        if (!(stream >> number) || number < 0) {
+            return false;
+        }
+        if (name == "threads") {
+            ParserThreads = number;
+        } else {
+            BatchSize = number > 0 ? number : 1;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+static void ServeConnection(t4p::TagServiceClass& service, boost::asio::local::stream_protocol::socket& socket) {
+    std::string request;
+    if (!t4p::TagServiceRead(socket, request, wxGetLocalTimeMillis() + CONNECTION_TIMEOUT)) {
+        // the instance went away or got stuck before sending its request
+        return;
+    }
+    std::string response = service.Handle(request);
+    t4p::TagServiceWrite(socket, response, wxGetLocalTimeMillis() + CONNECTION_TIMEOUT);
+}
+
+static bool WaitForConnection(boost::asio::local::stream_protocol::acceptor& acceptor, int timeoutMillis) {
+    pollfd fd;
+    fd.fd = acceptor.native_handle();
+    fd.events = POLLIN;
+    fd.revents = 0;
+    return poll(&fd, 1, timeoutMillis) > 0;
+}
+
+static bool Serve(t4p::TagServiceClass& service, const ServiceOptionsClass& options) {
+    std::string socketPath = t4p::WxToChar(options.Socket);
+
+    // the socket file of a service that did not shut down cleanly
+    // would make the bind fail. we already know that no service is
+    // answering on it
+    if (wxFileName::FileExists(options.Socket)) {
+        wxRemoveFile(options.Socket);
+    }
+    boost::asio::io_service ioService;
+    boost::asio::local::stream_protocol::acceptor acceptor(ioService);
+    try {
+        boost::asio::local::stream_protocol::endpoint endpoint(socketPath);
+        acceptor.open(endpoint.protocol());
+        acceptor.bind(endpoint);
+        acceptor.listen();
+    } catch (std::exception& e) {
+        std::cout << "could not listen on:" << socketPath << " " << e.what() << std::endl;
+        return false;
+    }
+    std::cout << "listening on:" << socketPath << std::endl;
+
+    // only check for connections so that we can tag and refresh the tag
+    // index when nobody is asking for anything
+    acceptor.non_blocking(true);
+    bool ret = true;
+    while (ret) {
+        boost::asio::local::stream_protocol::socket socket(ioService);
+        boost::system::error_code error;
+        acceptor.accept(socket, error);
+        if (error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+            bool doRefresh = true;
+            if (service.IsIndexing()) {
+                service.IndexFiles(options.BatchSize);
+                if (!service.IsIndexing()) {
+                    std::cout << "tagging done" << std::endl;
+                }
+            } else {
+                doRefresh = !WaitForConnection(acceptor, IDLE_WAIT);
+            }
+
+            // the tags may have been written by our own indexing or by
+            // another connection
+            if (doRefresh) {
+                service.RefreshTagIndex();
+            }
+        } else if (error) {
+            std::cout << "accept error:" << error.message() << std::endl;
+            ret = false;
+        } else {
+            ServeConnection(service, socket);
+            socket.close();
+        }
+    }
+    acceptor.close();
+    wxRemoveFile(options.Socket);
+    return ret;
+}
+
+#endif
@@ -28,12 +28,13 @@
 #include <vector>
 #include "globals/Assets.h"
 #include "globals/Errors.h"
+#include "language_php/TagShardsClass.h"
 
 /**
  * This number must match the number on the schema_version table
  * of the tags db; if numbers do not match the db will be recreated.
  */
-static const int SCHEMA_VERSION_TAGS = 10;
+static const int SCHEMA_VERSION_TAGS = 14;
 
 /**
  * This number must match the number on the schema_version table of the
@@ -69,10 +70,15 @@ void t4p::TagCacheDbVersionActionClass::BackgroundWork() {
                 Session.open(*soci::factory_sqlite3(), stdFilename);
                 int versionNumber = t4p::SqliteSchemaVersion(Session);
                 if (versionNumber != SCHEMA_VERSION_TAGS) {
+                    // the shards have the tags of the old schema too
+                    t4p::TagShardsClass::RemoveFiles(*filename);
                     wxString error;
                     bool good = t4p::SqliteSqlScript(t4p::ResourceSqlSchemaAsset(), Session, error);
                     if (!good) {
                         t4p::EditorLogError(t4p::ERR_TAG_READ, error);
+                    } else {
+                        // the tables were just re-created, the VACUUM is quick
+                        t4p::SqliteSetIncrementalAutoVacuum(Session);
                     }
                 }
                 Session.close();
@@ -27,6 +27,7 @@
 #include <soci/sqlite3/soci-sqlite3.h>
 #include <string>
 #include <vector>
+#include "globals/Sqlite.h"
 
 t4p::DetectorDbInitActionClass::DetectorDbInitActionClass(t4p::RunningThreadsClass& runningThreads, int eventId)
     : InitializerGlobalActionClass(runningThreads, eventId) {
@@ -41,8 +42,9 @@ void t4p::DetectorDbInitActionClass::Work(t4p::GlobalsClass &globals) {
     if (!globals.DetectorCacheDbFileName.Exists()) {
         return;
     }
-    std::string sqliteFile = t4p::WxToChar(globals.DetectorCacheDbFileName.GetFullPath());
-    globals.DetectorCacheSession.open(*soci::factory_sqlite3(), sqliteFile);
+    if (t4p::SqliteOpen(globals.DetectorCacheSession, globals.DetectorCacheDbFileName.GetFullPath())) {
+        t4p::SqliteSetStorageProfile(globals.DetectorCacheSession);
+    }
 
     // reload the detected database tags
 
@@ -0,0 +1,238 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "actions/PhpCodeCompletionActionClass.h"
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/FileName.h"
+#include "globals/String.h"
+#include "language_php/TagFinderList.h"
+
+t4p::PhpCodeCompletionCompleteEventClass::PhpCodeCompletionCompleteEventClass(int eventId, int actionId)
+    : wxEvent(eventId, t4p::EVENT_PHP_CODE_COMPLETION_COMPLETE)
+    , ActionId(actionId)
+    , FileIdentifier()
+    , Pos(0)
+    , Syntax(pelet::LanguageDiscoveryClass::SYNTAX_PHP_SCRIPT)
+    , LastExpression()
+    , ChainListStart()
+    , ChainListSize(0)
+    , VariableScope()
+    , VariableMatches()
+    , ResourceMatches()
+    , Error() {
+}
+
+wxEvent* t4p::PhpCodeCompletionCompleteEventClass::Clone() const {
+    t4p::PhpCodeCompletionCompleteEventClass* evt = new t4p::PhpCodeCompletionCompleteEventClass(GetId(), ActionId);
+    evt->FileIdentifier = FileIdentifier.c_str();
+    evt->Pos = Pos;
+    evt->Syntax = Syntax;
+    evt->LastExpression = LastExpression;
+    evt->ChainListStart = ChainListStart;
+    evt->ChainListSize = ChainListSize;
+    evt->VariableScope.Copy(VariableScope);
+    evt->VariableMatches = VariableMatches;
+    evt->ResourceMatches = ResourceMatches;
+    evt->Error = Error;
+    return evt;
+}
+
+t4p::PhpCodeCompletionTagsClass::PhpCodeCompletionTagsClass()
+    : TagFinderList(NULL)
+    , TagCacheDbFullPath()
+    , DetectorCacheDbFullPath()
+    , PhpFileExtensions()
+    , MiscFileExtensions() {
+}
+
+t4p::PhpCodeCompletionTagsClass::~PhpCodeCompletionTagsClass() {
+    if (TagFinderList) {
+        delete TagFinderList;
+    }
+}
+
+t4p::TagFinderListClass& t4p::PhpCodeCompletionTagsClass::Open(const wxFileName& tagCacheDbFileName,
+        const wxFileName& detectorCacheDbFileName,
+        const std::vector<wxString>& phpFileExtensions,
+        const std::vector<wxString>& miscFileExtensions, pelet::Versions version) {
+    bool isSame = TagFinderList != NULL
+                  && TagCacheDbFullPath == tagCacheDbFileName.GetFullPath()
+                  && DetectorCacheDbFullPath == detectorCacheDbFileName.GetFullPath()
+                  && PhpFileExtensions == phpFileExtensions
+                  && MiscFileExtensions == miscFileExtensions;
+    if (isSame) {
+        TagFinderList->SetVersion(version);
+        return *TagFinderList;
+    }
+    if (TagFinderList) {
+        delete TagFinderList;
+    }
+    TagCacheDbFullPath = tagCacheDbFileName.GetFullPath();
+    DetectorCacheDbFullPath = detectorCacheDbFileName.GetFullPath();
+    t4p::DeepCopy(PhpFileExtensions, phpFileExtensions);
+    t4p::DeepCopy(MiscFileExtensions, miscFileExtensions);
+
+    TagFinderList = new t4p::TagFinderListClass;
+    TagFinderList->InitGlobalTag(tagCacheDbFileName, phpFileExtensions, miscFileExtensions, version);
+    TagFinderList->InitNativeTag(t4p::NativeFunctionsAsset());
+    TagFinderList->InitDetectorTag(detectorCacheDbFileName);
+
+    // we are in the completion thread; the index is loaded once here and
+    // then kept current with RefreshTagIndex() on each completion
+    TagFinderList->LoadTagIndex();
+    return *TagFinderList;
+}
+
+t4p::PhpCodeCompletionActionClass::PhpCodeCompletionActionClass(t4p::RunningThreadsClass& runningThreads,
+        int eventId)
+    : ActionClass(runningThreads, eventId)
+    , TagCache()
+    , Tags(NULL)
+    , TagCacheDbFileName()
+    , DetectorCacheDbFileName()
+    , PhpFileExtensions()
+    , MiscFileExtensions()
+    , Snapshot()
+    , FileIdentifier()
+    , Pos(0)
+    , SourceDirs()
+    , Version(pelet::PHP_53)
+    , DoDuckTyping(false) {
+}
+
+void t4p::PhpCodeCompletionActionClass::SetCompletion(t4p::GlobalsClass& globals, const wxString& fileIdentifier,
+        const t4p::CodeSnapshotClass& snapshot, int pos, bool doDuckTyping,
+        t4p::PhpCodeCompletionTagsClass& tags) {
+    // make sure these are deep copies since we access the variables in a separate thread
+    TagCacheDbFileName.Assign(globals.TagCacheDbFileName.GetFullPath());
+    DetectorCacheDbFileName.Assign(globals.DetectorCacheDbFileName.GetFullPath());
+    t4p::DeepCopy(PhpFileExtensions, globals.FileTypes.GetPhpFileExtensions());
+    t4p::DeepCopy(MiscFileExtensions, globals.FileTypes.GetMiscFileExtensions());
+    Snapshot = snapshot;
+    FileIdentifier = fileIdentifier.c_str();
+    Pos = pos;
+    SourceDirs = t4p::DeepCopyFileNames(globals.AllEnabledSourceDirectories());
+    Version = globals.Environment.Php.Version;
+    DoDuckTyping = doDuckTyping;
+    Tags = &tags;
+
+    // the working cache is replaced by the working cache builder while
+    // we run, so we need our own copy of the symbol table
+    t4p::WorkingCacheClass* workingCache = globals.TagCache.GetWorking(fileIdentifier);
+    if (workingCache) {
+        t4p::WorkingCacheClass* cache = new t4p::WorkingCacheClass();
+        cache->FileName = workingCache->FileName.c_str();
+        cache->FileIdentifier = FileIdentifier;
+        cache->IsNew = workingCache->IsNew;
+        cache->SymbolTable.SetVersion(Version);
+        cache->SymbolTable.Copy(workingCache->SymbolTable);
+        cache->ScopeMap = workingCache->ScopeMap;
+        TagCache.RegisterWorking(FileIdentifier, cache);
+    }
+}
+
+void t4p::PhpCodeCompletionActionClass::BackgroundWork() {
+    // the text is needed for the scope map, the code (up to the
+    // position) for everything else
+    UnicodeString text = Snapshot.GetText();
+    UnicodeString code = Snapshot.GetSubstring(0, Pos);
+    t4p::PhpCodeCompletionCompleteEventClass evt(wxID_ANY, GetActionId());
+    evt.FileIdentifier = FileIdentifier;
+    evt.Pos = Pos;
+    pelet::LanguageDiscoveryClass languageDiscovery;
+    if (code.isEmpty() || !languageDiscovery.Open(code)) {
+        // post an empty result (nothing to complete) so that the
+        // provider stops waiting on this action
+        if (!IsCancelled()) {
+            PostEvent(evt);
+        }
+        return;
+    }
+    evt.Syntax = languageDiscovery.at(code.length() - 1);
+    languageDiscovery.Close();
+
+    bool isPhp = pelet::LanguageDiscoveryClass::SYNTAX_PHP_SCRIPT == evt.Syntax
+                 || pelet::LanguageDiscoveryClass::SYNTAX_PHP_BACKTICK == evt.Syntax
+                 || pelet::LanguageDiscoveryClass::SYNTAX_PHP_DOUBLE_QUOTE_STRING == evt.Syntax
+                 || pelet::LanguageDiscoveryClass::SYNTAX_PHP_HEREDOC == evt.Syntax;
+    if (isPhp) {
+        pelet::LexicalAnalyzerClass lexer;
+        lexer.SetVersion(Version);
+        evt.LastExpression = lexer.LastExpression(code);
+    }
+    if (!evt.LastExpression.isEmpty()) {
+        pelet::ParserClass parser;
+        parser.SetVersion(Version);
+        pelet::ScopeClass scope;
+        pelet::VariableClass parsedVariable(scope);
+        parser.ParseExpression(evt.LastExpression, parsedVariable);
+        evt.ChainListSize = parsedVariable.ChainList.size();
+        if (!parsedVariable.ChainList.empty()) {
+            evt.ChainListStart = parsedVariable.ChainList[0].Name;
+        }
+
+        // finding the scope with the scope finder parses the entire code; the
+        // scope map can answer most of the time without parsing
+        if (!TagCache.GetScopeAtPosition(FileIdentifier, text, code.length() - 1, evt.VariableScope)) {
+            t4p::ScopeFinderClass scopeFinder;
+            scopeFinder.SetVersion(Version);
+            scopeFinder.GetScopeString(code, code.length() - 1, evt.VariableScope);
+        }
+        if (IsCancelled()) {
+            return;
+        }
+
+        t4p::WorkingCacheClass* workingCache = TagCache.GetWorking(FileIdentifier);
+        if (!workingCache) {
+            evt.Error.Type = t4p::SymbolTableMatchErrorClass::UNREGISTERED_FILE;
+        } else {
+            t4p::TagFinderListClass& tagFinderList = Tags->Open(TagCacheDbFileName, DetectorCacheDbFileName,
+                    PhpFileExtensions, MiscFileExtensions, Version);
+
+            // the tag service may have been started or stopped since the
+            // last completion
+            tagFinderList.TagService.Init(TagCacheDbFileName);
+            if (IsCancelled()) {
+                return;
+            }
+            tagFinderList.RefreshTagIndex();
+            if (IsCancelled()) {
+                return;
+            }
+            workingCache->SymbolTable.ExpressionCompletionMatches(parsedVariable, evt.VariableScope, SourceDirs,
+                    tagFinderList, evt.VariableMatches, evt.ResourceMatches, DoDuckTyping, evt.Error);
+        }
+    }
+    if (!IsCancelled()) {
+        // PostEvent will set the correct event ID
+        PostEvent(evt);
+    }
+}
+
+wxString t4p::PhpCodeCompletionActionClass::GetLabel() const {
+    return wxT("PHP Code Completion");
+}
+
+const wxEventType t4p::EVENT_PHP_CODE_COMPLETION_COMPLETE = wxNewEventType();
@@ -0,0 +1,254 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_ACTIONS_PHPCODECOMPLETIONACTIONCLASS_H_
+#define SRC_ACTIONS_PHPCODECOMPLETIONACTIONCLASS_H_
+
+#include <pelet/LanguageDiscoveryClass.h>
+#include <pelet/ParserClass.h>
+#include <unicode/unistr.h>
+#include <wx/event.h>
+#include <wx/filename.h>
+#include <wx/string.h>
+#include <vector>
+#include "actions/ActionClass.h"
+#include "globals/CodeSnapshotClass.h"
+#include "globals/GlobalsClass.h"
+#include "language_php/CompactTagListClass.h"
+#include "language_php/SymbolTableClass.h"
+#include "language_php/TagCacheClass.h"
+
+namespace t4p {
+/**
+ * event that is generated when code completion matches have been
+ * computed. this event contains the matches along with the position
+ * where the completion was requested, so that the receiver can
+ * tell whether the results are still valid.
+ */
+class PhpCodeCompletionCompleteEventClass : public wxEvent {
+ public:
+    /**
+     * the ID of the action that generated this event; the receiver uses
+     * this to discard results of requests that were superseded
+     */
+    int ActionId;
+
+    /**
+     * the file that the completion was requested for
+     */
+    wxString FileIdentifier;
+
+    /**
+     * the position (as given by the code control) where completion was
+     * requested
+     */
+    int Pos;
+
+    /**
+     * the syntax that the position is in; the receiver uses this
+     * to add the HTML, keyword, and SQL matches.
+     */
+    pelet::LanguageDiscoveryClass::Syntax Syntax;
+
+    /**
+     * the expression that was completed; ie. "$this->get"
+     * only set when the position is in PHP code
+     */
+    UnicodeString LastExpression;
+
+    /**
+     * the first item of the parsed expression, and the number of items
+     * in the parsed expression (see pelet::VariableClass::ChainList)
+     */
+    UnicodeString ChainListStart;
+    size_t ChainListSize;
+
+    /**
+     * the scope (function, class, namespace) that the position is in
+     */
+    pelet::ScopeClass VariableScope;
+
+    /**
+     * the matching variables; filled only when the expression is a variable
+     */
+    std::vector<UnicodeString> VariableMatches;
+
+    /**
+     * the matching functions, classes, methods, ...
+     */
+    t4p::CompactTagListClass ResourceMatches;
+
+    /**
+     * the reason why the expression could not be completed
+     */
+    t4p::SymbolTableMatchErrorClass Error;
+
+    PhpCodeCompletionCompleteEventClass(int eventId, int actionId);
+
+    wxEvent* Clone() const;
+};
+
+extern const wxEventType EVENT_PHP_CODE_COMPLETION_COMPLETE;
+
+typedef void (wxEvtHandler::*PhpCodeCompletionCompleteEventClassFunction)(PhpCodeCompletionCompleteEventClass&);
+
+#define EVENT_PHP_CODE_COMPLETION_COMPLETE(id, fn) \
+        DECLARE_EVENT_TABLE_ENTRY(t4p::EVENT_PHP_CODE_COMPLETION_COMPLETE, id, -1, \
+    (wxObjectEventFunction) (wxEventFunction) \
+    wxStaticCastEvent(PhpCodeCompletionCompleteEventClassFunction, & fn), (wxObject *) NULL),
+
+/**
+ * the tag finders that the code completion actions use. The tag dbs are
+ * opened once, by the first completion action, and are kept open
+ * for the completions that come after it; they are re-opened only when the
+ * tag db locations or the file extensions change.
+ *
+ * An instance is owned by the code completion provider and given to each
+ * action; it is only used from the completion thread. This is safe because
+ * completion actions are run one at a time (the completion running threads
+ * has a max of 1 thread), and the provider outlives the completion thread.
+ */
+class PhpCodeCompletionTagsClass {
+ public:
+    PhpCodeCompletionTagsClass();
+
+    ~PhpCodeCompletionTagsClass();
+
+    /**
+     * opens the tag dbs if they are not yet open, or re-opens them if they
+     * are not the given dbs.  This method should be called from the completion
+     * thread, since opening the dbs may have to wait on another thread that
+     * is writing to them. The tag index is loaded when the dbs are (re)opened.
+     *
+     * @return the opened tag finders, they stay open until the next call
+     *         to Open() with different dbs
+     */
+    t4p::TagFinderListClass& Open(const wxFileName& tagCacheDbFileName, const wxFileName& detectorCacheDbFileName,
+                                  const std::vector<wxString>& phpFileExtensions,
+                                  const std::vector<wxString>& miscFileExtensions, pelet::Versions version);
+
+ private:
+    /**
+     * the opened tag finders, NULL until Open() is called
+     */
+    t4p::TagFinderListClass* TagFinderList;
+
+    /**
+     * the dbs and file extensions that TagFinderList was opened with
+     */
+    wxString TagCacheDbFullPath;
+    wxString DetectorCacheDbFullPath;
+    std::vector<wxString> PhpFileExtensions;
+    std::vector<wxString> MiscFileExtensions;
+};
+
+/**
+ * class that computes PHP code completion matches in the background: it
+ * finds the scope of the position being completed (which parses the code),
+ * resolves the expression against the symbol table and queries the tag dbs.
+ * The results are posted in an event of type EVENT_PHP_CODE_COMPLETION_COMPLETE.
+ * The action works on copies of the code and of the file's symbol table, so
+ * the user can keep editing while the matches are computed.
+ */
+class PhpCodeCompletionActionClass : public t4p::ActionClass {
+ public:
+    PhpCodeCompletionActionClass(t4p::RunningThreadsClass& runningThreads, int eventId);
+
+    /**
+     * set the completion parameters.  this should be called before the action is
+     * added to the run queue
+     *
+     * @param globals to get the locations of the tag dbs, the symbol table of the file
+     *        and the enabled source directories
+     * @param fileIdentifier the file being completed
+     * @param snapshot the code of the file; it is converted to UTF-16 in the
+     *        background thread
+     * @param pos the position being completed (byte offset into snapshot), given
+     *        back in the generated event
+     * @param doDuckTyping if TRUE, unresolved expression chains will be looked up in all classes
+     * @param tags the tag finders to query; they are opened in the background thread.
+     *        tags must outlive the action
+     */
+    void SetCompletion(t4p::GlobalsClass& globals, const wxString& fileIdentifier,
+                       const t4p::CodeSnapshotClass& snapshot, int pos, bool doDuckTyping,
+                       t4p::PhpCodeCompletionTagsClass& tags);
+
+    wxString GetLabel() const;
+
+ protected:
+    void BackgroundWork();
+
+ private:
+    /**
+     * a copy of the symbol table and scope map of the file being completed
+     */
+    t4p::TagCacheClass TagCache;
+
+    /**
+     * the tag dbs to look in, shared by all completion actions
+     */
+    t4p::PhpCodeCompletionTagsClass* Tags;
+
+    /**
+     * the locations of the tag dbs
+     */
+    wxFileName TagCacheDbFileName;
+    wxFileName DetectorCacheDbFileName;
+
+    /**
+     * the file extensions that the tag finder needs
+     */
+    std::vector<wxString> PhpFileExtensions;
+    std::vector<wxString> MiscFileExtensions;
+
+    /**
+     * the source code, shared with the code control
+     */
+    t4p::CodeSnapshotClass Snapshot;
+
+    /**
+     * the file being completed
+     */
+    wxString FileIdentifier;
+
+    /**
+     * the position being completed
+     */
+    int Pos;
+
+    /**
+     * only tags from these directories are matched
+     */
+    std::vector<wxFileName> SourceDirs;
+
+    /**
+     * the version of PHP to parse the code with
+     */
+    pelet::Versions Version;
+
+    bool DoDuckTyping;
+};
+}  // namespace t4p
+
+#endif  // SRC_ACTIONS_PHPCODECOMPLETIONACTIONCLASS_H_
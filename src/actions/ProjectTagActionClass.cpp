@@ -23,9 +23,11 @@
  * THE SOFTWARE.
  */
 #include "actions/ProjectTagActionClass.h"
+#include <algorithm>
 #include <vector>
 #include "code_control/ResourceCacheBuilderClass.h"
 #include "globals/Assets.h"
+#include "globals/String.h"
 #include "search/RecursiveDirTraverserClass.h"
 
 t4p::ProjectTagActionClass::ProjectTagActionClass(t4p::RunningThreadsClass& runningThreads, int eventId)
@@ -35,6 +37,7 @@ t4p::ProjectTagActionClass::ProjectTagActionClass(t4p::RunningThreadsClass& runn
     , DirectorySearch()
     , TagFinderList()
     , DoTouchedProjects(false)
+    , DoBulkLoad(false)
     , FilesCompleted(0)
     , FilesTotal(0) {
 }
@@ -44,6 +47,10 @@ void t4p::ProjectTagActionClass::SetTouchedProjects(const std::vector<t4p::Proje
     Projects = touchedProjects;
 }
 
+void t4p::ProjectTagActionClass::SetBulkLoad(bool bulkLoad) {
+    DoBulkLoad = bulkLoad;
+}
+
 bool t4p::ProjectTagActionClass::Init(t4p::GlobalsClass& globals) {
     SetStatus(_("Tag Cache"));
     SetProgressMode(t4p::ActionClass::DETERMINATE);
@@ -54,6 +61,14 @@ bool t4p::ProjectTagActionClass::Init(t4p::GlobalsClass& globals) {
                                 globals.FileTypes.GetNonPhpFileExtensions(),
                                 globals.Environment.Php.Version);
 
+    // parse files using all cores; the tags are still written by
+    // this action's thread only
+    TagFinderList.TagParser.SetParserThreads(wxThread::GetCPUCount());
+
+    // when the tag service is running, it tags the projects for all
+    // of the instances
+    TagFinderList.TagService.Init(globals.TagCacheDbFileName);
+
     // if we were not given projects, scan all of them
     if (!DoTouchedProjects) {
         Projects.clear();
@@ -70,6 +85,15 @@ bool t4p::ProjectTagActionClass::Init(t4p::GlobalsClass& globals) {
 
 
 void t4p::ProjectTagActionClass::BackgroundWork() {
+    if (TagFinderList.TagService.IsOk() && IterateWithTagService()) {
+        return;
+    }
+    if (DoBulkLoad) {
+        TagFinderList.TagParser.BeginBulkLoad();
+    } else {
+        // in case a previous bulk load did not finish
+        TagFinderList.TagParser.CreateIndexes();
+    }
     for (size_t i = 0; !IsCancelled() && i < Projects.size(); ++i) {
         FilesCompleted = 0;
         FilesTotal = 0;
@@ -81,6 +105,13 @@ void t4p::ProjectTagActionClass::BackgroundWork() {
             IterateDirectory();
         }
     }
+    if (DoBulkLoad) {
+        // re-build the indexes even if we were cancelled, tag
+        // lookups are very slow without them
+        SetStatus(_("Tag Cache / Indexing"));
+        SetProgressMode(t4p::ActionClass::INDETERMINATE);
+        TagFinderList.TagParser.EndBulkLoad();
+    }
 }
 
 void t4p::ProjectTagActionClass::IterateDirectory() {
@@ -114,6 +145,40 @@ void t4p::ProjectTagActionClass::IterateDirectory() {
     }
 }
 
+bool t4p::ProjectTagActionClass::IterateWithTagService() {
+    SetStatus(_("Tag Cache / Service"));
+    for (size_t i = 0; i < Projects.size(); ++i) {
+        if (!TagFinderList.TagService.Index(Projects[i].AllSources(FileTypes), FileTypes.GetPhpFileExtensions(),
+                                            FileTypes.GetNonPhpFileExtensions())) {
+            return false;
+        }
+    }
+
+    // the service tags in its own process; we only show its progress.
+    // if we are cancelled the service still finishes tagging
+    bool isIndexing = true;
+    int filesCompleted = 0;
+    int filesTotal = 0;
+    while (!IsCancelled() && isIndexing) {
+        if (!TagFinderList.TagService.Status(isIndexing, filesCompleted, filesTotal)) {
+            return false;
+        }
+        if (filesTotal > 0) {
+            int newProgressWhole = static_cast<int>(floor((filesCompleted * 100.0) / filesTotal));
+            SetPercentComplete(newProgressWhole < 1 ? 1 : newProgressWhole);
+        }
+        if (isIndexing) {
+            wxThread::Sleep(200);
+        }
+    }
+    if (!IsCancelled()) {
+        // eventId will be set by the PostEvent method
+        t4p::TagFinderListCompleteEventClass evt(wxID_ANY);
+        PostEvent(evt);
+    }
+    return true;
+}
+
 wxString t4p::ProjectTagActionClass::GetLabel() const {
     return _("Project Resource Parsing");
 }
@@ -148,6 +213,15 @@ void t4p::ProjectTagInitActionClass::Work(t4p::GlobalsClass &globals) {
     // dir to a non-existing location.
     if (globals.TagCacheDbFileName.FileExists()) {
         tagFinderList->InitGlobalTag(globals.TagCacheDbFileName, globals.FileTypes.GetPhpFileExtensions(), otherFileExtensions, version);
+
+        // when the tag service is running it has the tags in memory and
+        // queries go to it. otherwise the tags are kept in memory; this action
+        // runs in the UI thread so they are not read here, the tag feature
+        // loads them in a background thread the first time that they are
+        // needed (see TagCacheClass::SetTagIndexHandler())
+        if (!tagFinderList->TagService.Init(globals.TagCacheDbFileName)) {
+            tagFinderList->UseTagIndex();
+        }
     }
     if (globals.DetectorCacheDbFileName.FileExists()) {
         tagFinderList->InitDetectorTag(globals.DetectorCacheDbFileName);
@@ -157,7 +231,9 @@ void t4p::ProjectTagInitActionClass::Work(t4p::GlobalsClass &globals) {
     // the JS tags db is created by the triumph-js-tools project
     // we don't want to create the tables here
     if (globals.JsCacheDbFileName.FileExists()) {
-        t4p::SqliteOpen(globals.JsCacheSession, globals.JsCacheDbFileName.GetFullPath());
+        if (t4p::SqliteOpen(globals.JsCacheSession, globals.JsCacheDbFileName.GetFullPath())) {
+            t4p::SqliteSetStorageProfile(globals.JsCacheSession);
+        }
     }
 }
 
@@ -286,6 +362,86 @@ wxString t4p::ProjectTagSingleFileActionClass::GetLabel() const {
     return wxT("Tag Cache Single File");
 }
 
+t4p::ProjectTagMultipleFileActionClass::ProjectTagMultipleFileActionClass(t4p::RunningThreadsClass& runningThreads, int eventId)
+    : GlobalActionClass(runningThreads, eventId)
+    , FilesToParse()
+    , SourceDirs()
+    , SourceFiles()
+    , TagFinderList() {
+}
+
+void t4p::ProjectTagMultipleFileActionClass::SetFilesToParse(const std::vector<wxString>& fullPaths) {
+    t4p::DeepCopy(FilesToParse, fullPaths);
+}
+
+bool t4p::ProjectTagMultipleFileActionClass::Init(t4p::GlobalsClass& globals) {
+    // group the files by the source that they are in, so that each
+    // source is tagged in a single pass
+    // TODO(roberto): what if the file is in more than 1 project?
+    SourceDirs.clear();
+    SourceFiles.clear();
+    std::vector<t4p::ProjectClass>::const_iterator project;
+    std::vector<t4p::SourceClass>::const_iterator src;
+    for (size_t i = 0; i < FilesToParse.size(); ++i) {
+        bool isFileFromProject = false;
+        for (project = globals.Projects.begin(); !isFileFromProject && project != globals.Projects.end(); ++project) {
+            if (!project->IsEnabled || !project->IsASourceFile(FilesToParse[i], globals.FileTypes)) {
+                continue;
+            }
+            for (src = project->Sources.begin(); src != project->Sources.end(); ++src) {
+                if (src->Contains(FilesToParse[i])) {
+                    isFileFromProject = true;
+                    wxString dir = src->RootDirectory.GetPath();
+                    std::vector<wxString>::iterator found = std::find(SourceDirs.begin(), SourceDirs.end(), dir);
+                    if (found == SourceDirs.end()) {
+                        SourceDirs.push_back(dir.c_str());
+                        SourceFiles.push_back(std::vector<wxString>());
+                        found = SourceDirs.end() - 1;
+                    }
+                    SourceFiles[found - SourceDirs.begin()].push_back(FilesToParse[i]);
+                    break;
+                }
+            }
+        }
+    }
+    if (SourceDirs.empty()) {
+        return false;
+    }
+    TagFinderList.InitGlobalTag(globals.TagCacheDbFileName, globals.FileTypes.GetPhpFileExtensions(),
+                                globals.FileTypes.GetNonPhpFileExtensions(), globals.Environment.Php.Version);
+
+    // parse files using all cores; the tags are still written by
+    // this action's thread only
+    if (FilesToParse.size() > 1) {
+        TagFinderList.TagParser.SetParserThreads(wxThread::GetCPUCount());
+    }
+    return true;
+}
+
+void t4p::ProjectTagMultipleFileActionClass::BackgroundWork() {
+    SetStatus(_("Tag Cache Re-tag"));
+    for (size_t i = 0; !IsCancelled() && i < SourceDirs.size(); ++i) {
+        // this specific sequence is needed so that the source_id
+        // is set properly in the database. only the file items of
+        // the batch are read, not all of the file items of the source
+        const std::vector<wxString>& files = SourceFiles[i];
+        TagFinderList.TagParser.BeginSearch(SourceDirs[i], files);
+        for (size_t j = 0; !IsCancelled() && j < files.size(); ++j) {
+            // the file may have been deleted after it was modified
+            if (wxFileName::FileExists(files[j])) {
+                TagFinderList.TagParser.Walk(files[j]);
+            } else {
+                TagFinderList.TagParser.DeleteFromFile(files[j]);
+            }
+        }
+        TagFinderList.TagParser.EndSearch();
+    }
+}
+
+wxString t4p::ProjectTagMultipleFileActionClass::GetLabel() const {
+    return wxT("Tag Cache Multiple Files");
+}
+
 t4p::ProjectTagSingleFileRenameActionClass::ProjectTagSingleFileRenameActionClass(t4p::RunningThreadsClass& runningThreads,
         int eventId)
     : GlobalActionClass(runningThreads, eventId)
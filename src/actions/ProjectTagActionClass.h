@@ -65,6 +65,14 @@ class ProjectTagActionClass : public GlobalActionClass {
      */
     void SetTouchedProjects(const std::vector<t4p::ProjectClass>& touchedProjects);
 
+    /**
+     * When bulk load is on, the tag db indexes are dropped while the projects are
+     * parsed and re-built at the end (see TagParserClass::BeginBulkLoad()). This
+     * is much faster when most files need to be parsed, like after the tags
+     * have been wiped. This method must be called before the Init method.
+     */
+    void SetBulkLoad(bool bulkLoad);
+
     /**
      * Files will be parsed for resouces in a background thread.
      */
@@ -98,11 +106,25 @@ class ProjectTagActionClass : public GlobalActionClass {
      */
     bool DoTouchedProjects;
 
+    /**
+     * TRUE if the tag db indexes should be dropped while parsing
+     */
+    bool DoBulkLoad;
+
     /**
      * recurse through all sources in a single project
      */
     void IterateDirectory();
 
+    /**
+     * hands the projects to the tag service, and waits until the service
+     * has tagged them.
+     *
+     * @return bool FALSE if the service stopped answering; the projects
+     *         should then be tagged in-process
+     */
+    bool IterateWithTagService();
+
     /**
      * recurse though all of the queued projects
      */
@@ -222,6 +244,61 @@ class ProjectTagSingleFileActionClass : public t4p::GlobalActionClass {
     t4p::TagFinderListClass TagFinderList;
 };
 
+/**
+ * this action will re-tag many files at once. All of the files are
+ * tagged with the same db connection and, for each source, in the same
+ * transaction; the files are parsed in parallel. This is used when many
+ * files are changed outside of the editor at once, for example after a
+ * 'git pull'.
+ */
+class ProjectTagMultipleFileActionClass : public t4p::GlobalActionClass {
+ public:
+    ProjectTagMultipleFileActionClass(t4p::RunningThreadsClass& runningThreads, int eventId);
+
+    /**
+     * Set the files to be parsed
+     * @param fullPaths files to be scanned (full path, including name).
+     */
+    void SetFilesToParse(const std::vector<wxString>& fullPaths);
+
+    /**
+     * prepare to iterate through the files given in SetFilesToParse. Files that
+     * are not part of an enabled project, or that do not match the
+     * wildcards that have been set in globals, are ignored.
+     *
+     * @param globals to get the tag cache location
+     * @return bool false if none of the files given in SetFilesToParse is inside
+     *         any enabled projects
+     */
+    bool Init(t4p::GlobalsClass& globals);
+
+    /**
+     * Files will be re-tagged in a background thread; the tags of files
+     * that no longer exist are removed.
+     */
+    void BackgroundWork();
+
+    wxString GetLabel() const;
+
+ protected:
+    /**
+     * the files to re-parse
+     */
+    std::vector<wxString> FilesToParse;
+
+    /**
+     * the root directories of the sources that contain the files to
+     * re-parse; SourceFiles[i] are the files that are in SourceDirs[i]
+     */
+    std::vector<wxString> SourceDirs;
+    std::vector<std::vector<wxString> > SourceFiles;
+
+    /**
+     * This object will perform the parsing and storing of the tags
+     */
+    t4p::TagFinderListClass TagFinderList;
+};
+
 /**
  * this action will rename the file tag for a single file only
  */
@@ -184,7 +184,11 @@ bool t4p::SequenceClass::TagCacheWipeAndIndex(const std::vector<t4p::ProjectClas
     AddStep(new t4p::DatabaseTagDetectorActionClass(RunningThreads, t4p::ID_EVENT_ACTION_DATABASE_TAG_DETECTOR));
 
     // this will recurse though all directories and parse the source code
-    AddStep(new t4p::ProjectTagActionClass(RunningThreads, t4p::ID_EVENT_ACTION_TAG_FINDER_LIST));
+    // all of the files will be parsed, faster to build the indexes at the end
+    t4p::ProjectTagActionClass* action =
+        new t4p::ProjectTagActionClass(RunningThreads, t4p::ID_EVENT_ACTION_TAG_FINDER_LIST);
+    action->SetBulkLoad(true);
+    AddStep(action);
 
     // this will detect the urls (entry points) that a project has
     AddStep(new t4p::UrlTagDetectorActionClass(RunningThreads, t4p::ID_EVENT_ACTION_URL_TAG_DETECTOR));
@@ -0,0 +1,158 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "actions/TagCacheMaintenanceActionClass.h"
+#include <wx/dir.h>
+#include <string>
+#include <vector>
+#include "globals/Errors.h"
+#include "globals/Sqlite.h"
+#include "globals/String.h"
+
+/**
+ * the number of pages to free in one step of the incremental vacuum; each
+ * step is its own transaction
+ */
+static const int VACUUM_STEP_PAGES = 128;
+
+/**
+ * the amount of time (in milliseconds) to wait between vacuum steps, so
+ * that other connections can get the write lock
+ */
+static const int VACUUM_STEP_DELAY = 20;
+
+t4p::TagCacheMaintenanceActionClass::TagCacheMaintenanceActionClass(t4p::RunningThreadsClass& runningThreads, int eventId)
+    : GlobalActionClass(runningThreads, eventId)
+    , DbFileNames() {
+}
+
+bool t4p::TagCacheMaintenanceActionClass::Init(t4p::GlobalsClass& globals) {
+    SetStatus(_("Tag Cache Maintenance"));
+    if (!globals.TagCacheDbFileName.FileExists()) {
+        return false;
+    }
+
+    // use Assign() since we will access the filenames from the background thread
+    wxFileName tagDbFileName;
+    tagDbFileName.Assign(globals.TagCacheDbFileName.GetFullPath());
+    DbFileNames.push_back(tagDbFileName);
+
+    // the shards of the tag db, see TagShardsClass::ShardFileName(). the
+    // wildcard ends with the extension so that it does not match the
+    // sqlite journal files
+    wxArrayString shardFiles;
+    wxDir::GetAllFiles(tagDbFileName.GetPath(), &shardFiles,
+                       tagDbFileName.GetName() + wxT(".source*.") + tagDbFileName.GetExt(), wxDIR_FILES);
+    for (size_t i = 0; i < shardFiles.GetCount(); ++i) {
+        DbFileNames.push_back(wxFileName(shardFiles[i].c_str()));
+    }
+    return true;
+}
+
+void t4p::TagCacheMaintenanceActionClass::BackgroundWork() {
+    SetStatus(_("Tag Cache Maintenance"));
+    SetProgressMode(t4p::ActionClass::INDETERMINATE);
+    int totalPages = 0;
+    int totalFreePages = 0;
+    wxLongLong totalBytes = 0;
+    for (size_t i = 0; i < DbFileNames.size() && !IsCancelled(); ++i) {
+        int pageCount = 0;
+        int freePageCount = 0;
+        wxLongLong byteCount = 0;
+        if (MaintainDb(DbFileNames[i], pageCount, freePageCount, byteCount)) {
+            totalPages += pageCount;
+            totalFreePages += freePageCount;
+            totalBytes += byteCount;
+        }
+    }
+    if (!IsCancelled()) {
+        wxThreadEvent evt(t4p::EVENT_TAG_CACHE_MAINTENANCE, GetEventId());
+        evt.SetString(wxString::Format(_("%s, %d files, %d pages, %d free"),
+                                       wxFileName::GetHumanReadableSize(wxULongLong(totalBytes.GetValue())).c_str(),
+                                       static_cast<int>(DbFileNames.size()), totalPages, totalFreePages));
+        PostEvent(evt);
+    }
+}
+
+bool t4p::TagCacheMaintenanceActionClass::MaintainDb(const wxFileName& dbFileName, int& pageCount, int& freePageCount, wxLongLong& byteCount) {
+    soci::session session;
+    if (!t4p::SqliteOpen(session, dbFileName.GetFullPath())) {
+        return false;
+    }
+    t4p::SqliteSetStorageProfile(session);
+    bool ret = true;
+    try {
+        // no full VACUUM here, it would lock out the tag writers for as long
+        // as it takes to rewrite the file. dbs are switched to incremental
+        // mode when they are created or wiped; in other dbs no pages are freed
+        VacuumInSteps(session);
+        if (!IsCancelled()) {
+            session << "ANALYZE";
+        }
+        if (!IsCancelled()) {
+            // quick_check skips verifying that the indexes match their
+            // tables, it is much faster than integrity_check
+            std::string check;
+            session << "PRAGMA quick_check(1)", soci::into(check);
+            if (check != "ok") {
+                t4p::EditorLogWarning(t4p::ERR_TAG_READ, dbFileName.GetFullPath() + wxT(": ") + t4p::CharToWx(check.c_str()));
+                ret = false;
+            }
+        }
+        int pageSize = 0;
+        if (t4p::SqlitePageCounts(session, pageSize, pageCount, freePageCount)) {
+            byteCount = wxLongLong(pageSize) * pageCount;
+        }
+    } catch (std::exception& e) {
+        // the db is locked by a long write, or it is corrupt. we will
+        // try again the next time that the app is idle
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        ret = false;
+    }
+    session.close();
+    return ret;
+}
+
+void t4p::TagCacheMaintenanceActionClass::VacuumInSteps(soci::session& session) {
+    int pageSize = 0;
+    int pageCount = 0;
+    int freePageCount = 0;
+    int lastFreePageCount = -1;
+    while (!IsCancelled() && t4p::SqlitePageCounts(session, pageSize, pageCount, freePageCount) && freePageCount > 0) {
+        // stop when a step did not free anything; the db is locked by
+        // another writer or it is not in incremental mode
+        if (freePageCount == lastFreePageCount || !t4p::SqliteIncrementalVacuum(session, VACUUM_STEP_PAGES)) {
+            break;
+        }
+        lastFreePageCount = freePageCount;
+        wxThread::Sleep(VACUUM_STEP_DELAY);
+    }
+}
+
+wxString t4p::TagCacheMaintenanceActionClass::GetLabel() const {
+    return wxT("Tag Cache Maintenance");
+}
+
+const wxEventType t4p::EVENT_TAG_CACHE_MAINTENANCE = wxNewEventType();
@@ -0,0 +1,97 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_ACTIONS_TAGCACHEMAINTENANCEACTIONCLASS_H_
+#define SRC_ACTIONS_TAGCACHEMAINTENANCEACTIONCLASS_H_
+
+#include <soci/soci.h>
+#include <wx/filename.h>
+#include <vector>
+#include "actions/GlobalActionClass.h"
+
+namespace t4p {
+/**
+ * event generated by the maintenance action when it is done. The
+ * event string contains a short summary of the size of the tag db, to
+ * be shown along with the cache status.
+ * The event is of type wxThreadEvent.
+ */
+extern const wxEventType EVENT_TAG_CACHE_MAINTENANCE;
+#define EVT_TAG_CACHE_MAINTENANCE(id, fn) \
+    DECLARE_EVENT_TABLE_ENTRY(t4p::EVENT_TAG_CACHE_MAINTENANCE, id, -1, \
+    (wxObjectEventFunction) (wxEventFunction) \
+    wxStaticCastEvent(wxThreadEventFunction, & fn), (wxObject *) NULL),
+
+/**
+ * Low priority upkeep of the tag db and its shards, run when the app is
+ * idle. Deleting tags (re-tagging files, removing sources) leaves
+ * free pages in the db files, and nothing else updates the statistics
+ * that SQLite uses to pick query plans. For each db file this action:
+ *
+ * - frees the unused pages a few at a time, so that other writers are
+ *   not locked out for long. Only dbs in incremental auto vacuum mode can
+ *   free pages; the dbs are switched to that mode when they are created or
+ *   wiped (see SqliteSetIncrementalAutoVacuum), never here
+ * - runs ANALYZE
+ * - runs a quick integrity check; a corrupt db is reported in
+ *   the editor messages
+ *
+ * The action stops between steps when it is cancelled; the tag feature
+ * cancels it as soon as there are tags to write.
+ */
+class TagCacheMaintenanceActionClass : public t4p::GlobalActionClass {
+ public:
+    TagCacheMaintenanceActionClass(t4p::RunningThreadsClass& runningThreads, int eventId);
+
+    bool Init(t4p::GlobalsClass& globals);
+
+    wxString GetLabel() const;
+
+ protected:
+    void BackgroundWork();
+
+ private:
+    /**
+     * runs all of the maintenance steps on one db file
+     *
+     * @param [out] pageCount the pages in the db file after maintenance
+     * @param [out] freePageCount the unused pages in the db file after maintenance
+     * @param [out] byteCount the size of the db file after maintenance
+     * @return bool FALSE if the db could not be opened or is corrupt
+     */
+    bool MaintainDb(const wxFileName& dbFileName, int& pageCount, int& freePageCount, wxLongLong& byteCount);
+
+    /**
+     * frees the unused pages of the db, a few at a time
+     */
+    void VacuumInSteps(soci::session& session);
+
+    /**
+     * the tag db and its shards
+     */
+    std::vector<wxFileName> DbFileNames;
+};
+}  // namespace t4p
+
+#endif  // SRC_ACTIONS_TAGCACHEMAINTENANCEACTIONCLASS_H_
@@ -0,0 +1,83 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "actions/TagIndexLoadActionClass.h"
+#include <vector>
+#include "globals/String.h"
+#include "language_php/TagFinderList.h"
+#include "language_php/TagIndexClass.h"
+
+t4p::TagIndexLoadedEventClass::TagIndexLoadedEventClass(int eventId, t4p::TagIndexClass* tagIndex)
+    : wxEvent(eventId, t4p::EVENT_TAG_INDEX_LOADED)
+    , TagIndex(tagIndex) {
+}
+
+wxEvent* t4p::TagIndexLoadedEventClass::Clone() const {
+    t4p::TagIndexLoadedEventClass* evt = new t4p::TagIndexLoadedEventClass(GetId(), TagIndex);
+    return evt;
+}
+
+t4p::TagIndexLoadActionClass::TagIndexLoadActionClass(t4p::RunningThreadsClass& runningThreads, int eventId)
+    : GlobalActionClass(runningThreads, eventId)
+    , TagCacheDbFileName()
+    , PhpFileExtensions()
+    , MiscFileExtensions()
+    , Version(pelet::PHP_53) {
+}
+
+bool t4p::TagIndexLoadActionClass::Init(t4p::GlobalsClass& globals) {
+    SetStatus(_("Tag Index Load"));
+    if (!globals.TagCacheDbFileName.FileExists()) {
+        return false;
+    }
+
+    // make sure these are deep copies since we access the variables in a separate thread
+    TagCacheDbFileName.Assign(globals.TagCacheDbFileName.GetFullPath());
+    t4p::DeepCopy(PhpFileExtensions, globals.FileTypes.GetPhpFileExtensions());
+    t4p::DeepCopy(MiscFileExtensions, globals.FileTypes.GetMiscFileExtensions());
+    Version = globals.Environment.Php.Version;
+    return true;
+}
+
+void t4p::TagIndexLoadActionClass::BackgroundWork() {
+    SetProgressMode(t4p::ActionClass::INDETERMINATE);
+    t4p::TagFinderListClass tagFinderList;
+    tagFinderList.InitGlobalTag(TagCacheDbFileName, PhpFileExtensions, MiscFileExtensions, Version);
+    t4p::TagIndexClass* tagIndex = NULL;
+    if (tagFinderList.LoadTagIndex()) {
+        tagIndex = new t4p::TagIndexClass;
+        tagIndex->Swap(tagFinderList.TagIndex);
+    }
+
+    // the event is posted even when the tags could not be read, so that
+    // the next stale index is loaded again
+    t4p::TagIndexLoadedEventClass evt(wxID_ANY, tagIndex);
+    PostEvent(evt);
+}
+
+wxString t4p::TagIndexLoadActionClass::GetLabel() const {
+    return wxT("Tag Index Load");
+}
+
+const wxEventType t4p::EVENT_TAG_INDEX_LOADED = wxNewEventType();
@@ -0,0 +1,97 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_ACTIONS_TAGINDEXLOADACTIONCLASS_H_
+#define SRC_ACTIONS_TAGINDEXLOADACTIONCLASS_H_
+
+#include <wx/event.h>
+#include <wx/filename.h>
+#include <vector>
+#include "actions/GlobalActionClass.h"
+
+namespace t4p {
+// forward declaration
+class TagIndexClass;
+
+/**
+ * event generated by the tag index load action when all of the
+ * tags have been read
+ */
+extern const wxEventType EVENT_TAG_INDEX_LOADED;
+
+class TagIndexLoadedEventClass : public wxEvent {
+ public:
+    /**
+     * the loaded tags, NULL if the tags could not be read.
+     * This will be owned by the event handler
+     */
+    t4p::TagIndexClass* TagIndex;
+
+    /**
+     * @param eventId the event ID
+     * @param tagIndex the loaded tags. this pointer will be owned by the
+     *        event handler.
+     */
+    TagIndexLoadedEventClass(int eventId, t4p::TagIndexClass* tagIndex);
+
+    wxEvent* Clone() const;
+};
+
+/**
+ * Reads all of the tags of the tag db into a new tag index, in a
+ * background thread. Reading all of the tags of a big project takes
+ * seconds; the UI thread swaps the loaded index into the global
+ * tag cache (see TagCacheClass::SwapGlobalTagIndex()) instead of
+ * reading the tags itself.
+ */
+class TagIndexLoadActionClass : public t4p::GlobalActionClass {
+ public:
+    TagIndexLoadActionClass(t4p::RunningThreadsClass& runningThreads, int eventId);
+
+    bool Init(t4p::GlobalsClass& globals);
+
+    wxString GetLabel() const;
+
+ protected:
+    void BackgroundWork();
+
+ private:
+    wxFileName TagCacheDbFileName;
+
+    std::vector<wxString> PhpFileExtensions;
+
+    std::vector<wxString> MiscFileExtensions;
+
+    pelet::Versions Version;
+};
+}  // namespace t4p
+
+typedef void (wxEvtHandler::*TagIndexLoadedEventClassFunction)(t4p::TagIndexLoadedEventClass&);
+
+#define EVT_TAG_INDEX_LOADED(id, fn) \
+    DECLARE_EVENT_TABLE_ENTRY(t4p::EVENT_TAG_INDEX_LOADED, id, -1, \
+    (wxObjectEventFunction) (wxEventFunction) \
+    wxStaticCastEvent(TagIndexLoadedEventClassFunction, & fn), (wxObject *) NULL),
+
+#endif  // SRC_ACTIONS_TAGINDEXLOADACTIONCLASS_H_
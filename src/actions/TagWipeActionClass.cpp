@@ -29,6 +29,7 @@
 #include "globals/FileName.h"
 #include "language_php/DetectorDbClass.h"
 #include "language_php/TagParserClass.h"
+#include "language_php/TagShardsClass.h"
 
 t4p::TagWipeActionClass::TagWipeActionClass(t4p::RunningThreadsClass& runningThreads, int eventId)
     : GlobalActionClass(runningThreads, eventId)
@@ -55,8 +56,11 @@ void t4p::TagWipeActionClass::BackgroundWork() {
     soci::session detectorSession;
     try {
         session.open(*soci::factory_sqlite3(), t4p::WxToChar(ResourceDbFileName.GetFullPath()));
+        t4p::TagShardsClass tagShards;
+        tagShards.Init(&session, ResourceDbFileName);
         t4p::TagParserClass tagParser;
         tagParser.Init(&session);
+        tagParser.SetTagShards(&tagShards);
         tagParser.WipeAll();
 
         detectorSession.open(*soci::factory_sqlite3(), t4p::WxToChar(DetectorDbFileName.GetFullPath()));
@@ -104,8 +108,11 @@ void t4p::TagDeleteSourceActionClass::BackgroundWork() {
     soci::session detectorSession;
     try {
         session.open(*soci::factory_sqlite3(), t4p::WxToChar(ResourceDbFileName.GetFullPath()));
+        t4p::TagShardsClass tagShards;
+        tagShards.Init(&session, ResourceDbFileName);
         t4p::TagParserClass tagParser;
         tagParser.Init(&session);
+        tagParser.SetTagShards(&tagShards);
 
         detectorSession.open(*soci::factory_sqlite3(), t4p::WxToChar(DetectorDbFileName.GetFullPath()));
         t4p::DetectorDbClass detectorDb;
@@ -150,8 +157,11 @@ void t4p::TagDeleteDirectoryActionClass::BackgroundWork() {
         soci::session session;
         try {
             session.open(*soci::factory_sqlite3(), t4p::WxToChar(it->GetFullPath()));
+            t4p::TagShardsClass tagShards;
+            tagShards.Init(&session, *it);
             t4p::TagParserClass tagParser;
             tagParser.Init(&session);
+            tagParser.SetTagShards(&tagShards);
             tagParser.DeleteDirectories(DirsToDelete);
         } catch(std::exception const& e) {
             session.close();
@@ -189,8 +199,11 @@ void t4p::TagDeleteFileActionClass::BackgroundWork() {
         soci::session session;
         try {
             session.open(*soci::factory_sqlite3(), t4p::WxToChar(it->GetFullPath()));
+            t4p::TagShardsClass tagShards;
+            tagShards.Init(&session, *it);
             t4p::TagParserClass tagParser;
             tagParser.Init(&session);
+            tagParser.SetTagShards(&tagShards);
             for (size_t i = 0; i < FilesToDelete.size(); ++i) {
                 tagParser.DeleteFromFile(FilesToDelete[i].GetFullPath());
             }
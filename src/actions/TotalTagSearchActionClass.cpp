@@ -30,6 +30,7 @@
 #include "globals/Assets.h"
 #include "globals/FileCabinetItemClass.h"
 #include "globals/FileName.h"
+#include "globals/Sqlite.h"
 #include "globals/TagList.h"
 #include "language_php/TagFinderList.h"
 
@@ -68,22 +69,23 @@ t4p::TotalTagResultClass::TotalTagResultClass(const t4p::TotalTagResultClass& sr
     Copy(src);
 }
 
-t4p::TotalTagResultClass::TotalTagResultClass(const t4p::PhpTagClass& phpTag)
+t4p::TotalTagResultClass::TotalTagResultClass(const t4p::PhpTagViewClass& phpTag)
     : FileTag()
     , PhpTag(phpTag)
     , TableTag()
     , Type(t4p::TotalTagResultClass::CLASS_TAG) {
-    if (t4p::PhpTagClass::CLASS == PhpTag.Type) {
+    t4p::PhpTagClass::Types tagType = PhpTag.Type();
+    if (t4p::PhpTagClass::CLASS == tagType) {
         Type = t4p::TotalTagResultClass::CLASS_TAG;
-    } else if (t4p::PhpTagClass::FUNCTION == PhpTag.Type) {
+    } else if (t4p::PhpTagClass::FUNCTION == tagType) {
         Type = t4p::TotalTagResultClass::FUNCTION_TAG;
-    } else if (t4p::PhpTagClass::MEMBER == PhpTag.Type) {
+    } else if (t4p::PhpTagClass::MEMBER == tagType) {
         Type = t4p::TotalTagResultClass::METHOD_TAG;
-    } else if (t4p::PhpTagClass::METHOD == PhpTag.Type) {
+    } else if (t4p::PhpTagClass::METHOD == tagType) {
         Type = t4p::TotalTagResultClass::METHOD_TAG;
-    } else if (t4p::PhpTagClass::CLASS_CONSTANT == PhpTag.Type) {
+    } else if (t4p::PhpTagClass::CLASS_CONSTANT == tagType) {
         Type = t4p::TotalTagResultClass::METHOD_TAG;
-    } else if (t4p::PhpTagClass::DEFINE == PhpTag.Type) {
+    } else if (t4p::PhpTagClass::DEFINE == tagType) {
         Type = t4p::TotalTagResultClass::FUNCTION_TAG;
     }
 }
@@ -125,9 +127,9 @@ void t4p::TotalTagSearchActionClass::SetSearch(t4p::GlobalsClass& globals, const
                          globals.Environment.Php.Version);
     TagCache.RegisterGlobal(cache);
 
-    Session.open(
-        *soci::factory_sqlite3(),
-        t4p::WxToChar(globals.TagCacheDbFileName.GetFullPath()));
+    if (t4p::SqliteOpen(Session, globals.TagCacheDbFileName.GetFullPath())) {
+        t4p::SqliteSetStorageProfile(Session);
+    }
 }
 
 void t4p::TotalTagSearchActionClass::BackgroundWork() {
@@ -156,18 +158,28 @@ wxString t4p::TotalTagSearchActionClass::GetLabel() const {
     return wxT("Total Tag Search");
 }
 
+void t4p::TotalTagSearchActionClass::AppendTagResults(const t4p::CompactTagListClass& tags,
+        std::vector<t4p::TotalTagResultClass>& matches) {
+    // the views are created once all of the tags are in the list; appending
+    // to a list that has views would copy the list
+    matches.reserve(matches.size() + tags.Size());
+    for (size_t i = 0; i < tags.Size(); ++i) {
+        t4p::TotalTagResultClass result(tags.View(i));
+        matches.push_back(result);
+    }
+}
+
 bool t4p::TotalTagSearchActionClass::SearchExact(std::vector<t4p::TotalTagResultClass>& matches) {
     bool found = false;
 
+    t4p::CompactTagListClass tags;
     t4p::TagResultClass* results = TagCache.ExactTags(SearchString, SearchDirs);
     while (results->More()) {
-        results->Next();
-
-        t4p::TotalTagResultClass result(results->Tag);
-        matches.push_back(result);
+        results->Next(tags);
         found = true;
     }
     delete results;
+    AppendTagResults(tags, matches);
 
     if (matches.empty()) {
         t4p::FileTagResultClass* fileTagResults = TagCache.ExactFileTags(SearchString, SearchDirs);
@@ -225,16 +237,15 @@ bool t4p::TotalTagSearchActionClass::SearchExact(std::vector<t4p::TotalTagResult
 
 bool t4p::TotalTagSearchActionClass::SearchNearMatch(std::vector<t4p::TotalTagResultClass>& matches) {
     bool found = false;
+    t4p::CompactTagListClass tags;
     t4p::TagResultClass* results = TagCache.NearMatchTags(SearchString, SearchDirs);
     while (results->More()) {
-        results->Next();
-
-        t4p::TotalTagResultClass result(results->Tag);
-        matches.push_back(result);
+        results->Next(tags);
         found = true;
     }
 
     delete results;
+    AppendTagResults(tags, matches);
     if (matches.empty()) {
         t4p::FileTagResultClass* fileTagResults = TagCache.NearMatchFileTags(SearchString, SearchDirs);
         while (fileTagResults->More()) {
@@ -31,6 +31,7 @@
 #include <vector>
 #include "actions/ActionClass.h"
 #include "globals/GlobalsClass.h"
+#include "language_php/CompactTagListClass.h"
 #include "language_php/DatabaseTableTagClass.h"
 #include "language_php/PhpTagClass.h"
 
@@ -52,9 +53,11 @@ class TotalTagResultClass {
     t4p::FileTagClass FileTag;
 
     /**
-     * will only be valid when this result is a class, function, or method
+     * will only be valid when this result is a class, function, or method.
+     * a view so that copying results (into events, into the dialog) does
+     * not copy the tag strings
      */
-    t4p::PhpTagClass PhpTag;
+    t4p::PhpTagViewClass PhpTag;
 
     /**
      * will only be valid when this result is a database table
@@ -65,7 +68,7 @@ class TotalTagResultClass {
 
     TotalTagResultClass();
     TotalTagResultClass(const t4p::FileTagClass& file);
-    TotalTagResultClass(const t4p::PhpTagClass& tag);
+    TotalTagResultClass(const t4p::PhpTagViewClass& tag);
     TotalTagResultClass(const t4p::DatabaseTableTagClass& table);
 
     TotalTagResultClass(const t4p::TotalTagResultClass& src);
@@ -136,6 +139,14 @@ class TotalTagSearchActionClass : public t4p::ActionClass {
     void BackgroundWork();
 
  private:
+    /**
+     * adds a result for each of the given tags
+     *
+     * @param tags the tags to add
+     * @param matches the vector to append to
+     */
+    void AppendTagResults(const t4p::CompactTagListClass& tags, std::vector<t4p::TotalTagResultClass>& matches);
+
     /**
      * perform a search on all items using exact, case
      * insensitive searches
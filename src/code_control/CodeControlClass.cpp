@@ -419,6 +419,8 @@ t4p::CodeControlClass::CodeControlClass(wxWindow* parent, CodeControlOptionsClas
     , Type(t4p::FILE_TYPE_TEXT)
     , IsHidden(false)
     , IsTouched(false)
+    , Revision(0)
+    , Snapshot()
     , HasSearchMarkers(false)
     , HasFileSignature(false)
     , Charset() {
@@ -599,20 +601,14 @@ void t4p::CodeControlClass::GotoLineAndEnsureVisible(int lineNumber) {
 }
 
 void t4p::CodeControlClass::SetSelectionByCharacterPosition(int start, int end, bool setPos) {
-    int documentLength = GetTextLength();
-    char* buf = new char[documentLength];
-
-    // GET_TEXT  message
-    SendMsg(2182, documentLength, (long)buf);
-
-    int byteStart = t4p::CharToUtf8Pos(buf, documentLength, start);
-    int byteEnd = t4p::CharToUtf8Pos(buf, documentLength, end);
+    t4p::CodeSnapshotClass snapshot = GetSnapshot();
+    int byteStart = t4p::CharToUtf8Pos(snapshot.GetUtf8(), snapshot.GetUtf8Length(), start);
+    int byteEnd = t4p::CharToUtf8Pos(snapshot.GetUtf8(), snapshot.GetUtf8Length(), end);
     SetSelection(byteStart, byteEnd);
 
     if (setPos) {
         GotoPos(byteStart);
     }
-    delete[] buf;
 }
 
 void t4p::CodeControlClass::OnCharAdded(wxStyledTextEvent &event) {
@@ -822,21 +818,17 @@ void t4p::CodeControlClass::OnContextMenu(wxContextMenuEvent& event) {
 }
 
 UnicodeString t4p::CodeControlClass::GetSafeText() {
-    // copied from the implementation of GetText method in stc.cpp
-    int len  = GetTextLength();
-    wxMemoryBuffer mbuf(len + 1);   // leave room for the null...
-    char* buf = reinterpret_cast<char*>(mbuf.GetWriteBuf(len + 1));
-
-    SendMsg(2182, len + 1, (long)buf);
-    mbuf.UngetWriteBuf(len);
-    mbuf.AppendByte(0);
-    UnicodeString str(' ', len, 0);
-    int32_t written = 0;
-    UErrorCode error = U_ZERO_ERROR;
-    u_strFromUTF8(str.getBuffer(len + 1), len, &written, (const char*)mbuf, len, &error);
-    str.releaseBuffer(written);
-    assert(U_SUCCESS(error));
-    return str;
+    return GetSnapshot().GetText();
+}
+
+t4p::CodeSnapshotClass t4p::CodeControlClass::GetSnapshot() {
+    int len = GetTextLength();
+    if (Snapshot.GetRevision() != Revision || Snapshot.GetUtf8Length() != len) {
+        // the character pointer points to scintilla's buffer, no
+        // copy is made until the snapshot is created
+        Snapshot = t4p::CodeSnapshotClass(GetCharacterPointer(), len, Revision);
+    }
+    return Snapshot;
 }
 
 UnicodeString t4p::CodeControlClass::GetSafeSubstring(int startPos, int endPos) {
@@ -935,13 +927,8 @@ void t4p::CodeControlClass::MarkLintError(const pelet::LintResultsClass& result)
         MarkerAdd(result.LineNumber - 1, CODE_CONTROL_LINT_RESULT_MARKER);
 
         int charNumber = result.CharacterPosition;
-
-        int documentLength = GetTextLength();
-        char* buf = new char[documentLength];
-
-        // GET_TEXT  message
-        SendMsg(2182, documentLength, (long)buf);
-        byteNumber = t4p::CharToUtf8Pos(buf, documentLength, charNumber);
+        t4p::CodeSnapshotClass snapshot = GetSnapshot();
+        byteNumber = t4p::CharToUtf8Pos(snapshot.GetUtf8(), snapshot.GetUtf8Length(), charNumber);
 
         SetIndicatorCurrent(CODE_CONTROL_INDICATOR_PHP_LINT);
         SetIndicatorValue(CODE_CONTROL_INDICATOR_PHP_LINT);
@@ -949,8 +936,6 @@ void t4p::CodeControlClass::MarkLintError(const pelet::LintResultsClass& result)
         // fill until the end of the word
         int end = WordEndPosition(byteNumber, true);
         IndicatorFillRange(byteNumber, end - byteNumber);
-
-        delete[] buf;
     }
     Colourise(0, -1);
 
@@ -967,13 +952,8 @@ void t4p::CodeControlClass::MarkLintErrorAndGoto(const pelet::LintResultsClass&
     if (result.CharacterPosition >= 0) {
         MarkLintError(result);
         int charNumber = result.CharacterPosition;
-
-        int documentLength = GetTextLength();
-        char* buf = new char[documentLength];
-
-        // GET_TEXT  message
-        SendMsg(2182, documentLength, (long)buf);
-        byteNumber = t4p::CharToUtf8Pos(buf, documentLength, charNumber);
+        t4p::CodeSnapshotClass snapshot = GetSnapshot();
+        byteNumber = t4p::CharToUtf8Pos(snapshot.GetUtf8(), snapshot.GetUtf8Length(), charNumber);
 
         // make sure that selection ends up in the middle of the screen, hence the new caret policy
         SetYCaretPolicy(wxSTC_CARET_JUMPS | wxSTC_CARET_EVEN, 0);
@@ -982,8 +962,6 @@ void t4p::CodeControlClass::MarkLintErrorAndGoto(const pelet::LintResultsClass&
 
         EnsureCaretVisible();
         SetYCaretPolicy(wxSTC_CARET_EVEN, 0);
-
-        delete[] buf;
     }
 }
 
@@ -1102,13 +1080,8 @@ t4p::FileType t4p::CodeControlClass::GetFileType() {
 }
 
 int t4p::CodeControlClass::LineFromCharacter(int charPos) {
-    int documentLength = GetTextLength();
-    char* buf = new char[documentLength];
-
-    // GET_TEXT  message
-    SendMsg(2182, documentLength, (long)buf);
-    int pos = t4p::CharToUtf8Pos(buf, documentLength, charPos);
-    delete[] buf;
+    t4p::CodeSnapshotClass snapshot = GetSnapshot();
+    int pos = t4p::CharToUtf8Pos(snapshot.GetUtf8(), snapshot.GetUtf8Length(), charPos);
     return LineFromPosition(pos);
 }
 
@@ -1244,6 +1217,9 @@ void t4p::CodeControlClass::OnTimerComplete(wxTimerEvent& event) {
 }
 
 void t4p::CodeControlClass::OnModified(wxStyledTextEvent& event) {
+    if (event.GetModificationType() & (wxSTC_MOD_INSERTTEXT | wxSTC_MOD_DELETETEXT)) {
+        Revision++;
+    }
     EventSink.Publish(event);
 }
 
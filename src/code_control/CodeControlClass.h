@@ -31,6 +31,7 @@
 #include <wx/timer.h>
 #include <vector>
 #include "globals/CodeControlOptionsClass.h"
+#include "globals/CodeSnapshotClass.h"
 #include "globals/FileTypeClass.h"
 #include "language_php/PhpTagClass.h"
 #include "language_sql/DatabaseTagClass.h"
@@ -137,7 +138,9 @@ class CodeCompletionProviderClass {
      * Sub classes can implement their own logic for auto completion.
      * This method may be called in response to a user keypress; speed is
      * crucial here. Subclasses will need to invoke the AutoCompleteShow() method
-     * of the wxSTC control.
+     * of the wxSTC control. Subclasses that need to do expensive work (parsing,
+     * tag lookups) should do it in a background action and show the
+     * list once the action completes.
      *
      * @param ctrl the control that contains the code. used to get the current position
      *        as well as the source code text
@@ -438,10 +441,20 @@ class CodeControlClass : public wxStyledTextCtrl {
      * method accounts for high ascii characters correctly.
      *
      * ALWAYS USE THIS METHOD INSTEAD OF GetText()
+     * The string is converted from the current snapshot; calling this method
+     * many times without modifying the document converts the document only once.
      * @return UnicodeString
      */
     UnicodeString GetSafeText();
 
+    /**
+     * Returns an immutable copy of the contents of the code control. The document
+     * is copied (but not converted) only when it has been modified since the
+     * last snapshot was taken.  Prefer this over GetSafeText() when the code
+     * is given to a background action; the action can do the conversion.
+     */
+    t4p::CodeSnapshotClass GetSnapshot();
+
     /**
      * Use this method whenever you need to get a UnicodeString that is being calculated from Scintilla
      * positions (GetCurrentPos(), GetWordStart(), etc...)
@@ -864,6 +877,17 @@ class CodeControlClass : public wxStyledTextCtrl {
      */
     bool IsTouched;
 
+    /**
+     * incremented each time text is inserted or deleted; used to know
+     * whether Snapshot is up-to-date
+     */
+    int Revision;
+
+    /**
+     * the last snapshot taken, re-used until the document is modified
+     */
+    t4p::CodeSnapshotClass Snapshot;
+
     /**
      * if true then this control has at least one search marker visible
      */
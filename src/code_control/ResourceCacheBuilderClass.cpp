@@ -32,7 +32,7 @@ t4p::WorkingCacheBuilderClass::WorkingCacheBuilderClass(
     t4p::RunningThreadsClass& runningThreads, int eventId)
     : ActionClass(runningThreads, eventId)
     , TagCacheDbFileName()
-    , Code()
+    , Snapshot()
     , FileName()
     , SourceDir()
     , FileIdentifier()
@@ -45,11 +45,11 @@ t4p::WorkingCacheBuilderClass::WorkingCacheBuilderClass(
 void t4p::WorkingCacheBuilderClass::Update(t4p::GlobalsClass& globals,
         const wxString& fileName,
         const wxString& fileIdentifier,
-        const UnicodeString& code, bool isNew, pelet::Versions version,
+        const t4p::CodeSnapshotClass& snapshot, bool isNew, pelet::Versions version,
         bool doParseTags) {
     // make sure these is are deep copies since we access the variables in a separate thread
     TagCacheDbFileName.Assign(globals.TagCacheDbFileName.GetFullPath());
-    Code = code;
+    Snapshot = snapshot;
     FileName = fileName.c_str();
     FileIdentifier = fileIdentifier.c_str();
     Version = version;
@@ -59,6 +59,9 @@ void t4p::WorkingCacheBuilderClass::Update(t4p::GlobalsClass& globals,
 
     t4p::WorkingCacheClass* workingCache = globals.TagCache.GetWorking(fileIdentifier);
     if (workingCache) {
+        // not a deep copy; the tables share their scopes. the background
+        // thread only reads PreviousSymbolTable, and a shared table is copied
+        // before it is modified
         PreviousSymbolTable.Copy(workingCache->SymbolTable);
     }
 
@@ -103,16 +106,20 @@ void t4p::WorkingCacheBuilderClass::BackgroundWork() {
         std::vector<wxString> miscFileExtensions;
         tagFinderlist->InitGlobalTag(TagCacheDbFileName, phpFileExtensions, miscFileExtensions, Version);
 
+        // the conversion is done here so that the UI thread only copies the bytes
+        UnicodeString code = Snapshot.GetText();
         t4p::WorkingCacheClass* workingCache = new t4p::WorkingCacheClass();
-        workingCache->Init(FileName, FileIdentifier, FileIsNew, Version, true, PreviousSymbolTable);
-        bool good = workingCache->Update(Code, PreviousSymbolTable);
+        // no need to parse the file when we have the buffer contents, Update
+        // will build the symbols from the buffer
+        workingCache->Init(FileName, FileIdentifier, FileIsNew, Version, code.isEmpty(), PreviousSymbolTable);
+        bool good = workingCache->Update(code, PreviousSymbolTable);
         if (good && !IsCancelled()) {
             // parse any tags from the source code
             // note that we only parse the file if it is valid syntax
             // since BuildResourceCacheForFile kills existing tags in the file
             // we want to keep previous tags if the code contains a syntax error
             if (DoParseTags) {
-                tagFinderlist->TagParser.BuildResourceCacheForFile(SourceDir, FileName, Code, FileIsNew);
+                tagFinderlist->TagParser.BuildResourceCacheForFile(SourceDir, FileName, code, FileIsNew);
             }
 
             // only send the event if the code passes the lint check
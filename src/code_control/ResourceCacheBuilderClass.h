@@ -26,6 +26,7 @@
 #define SRC_CODE_CONTROL_RESOURCECACHEBUILDERCLASS_H_
 
 #include "actions/ActionClass.h"
+#include "globals/CodeSnapshotClass.h"
 #include "language_php/TagCacheClass.h"
 
 namespace t4p {
@@ -58,7 +59,8 @@ class WorkingCacheBuilderClass : public t4p::ActionClass {
      * @param globals to get the projects' directories to be scanned (recursively scan all sources in all projects)
      * @param fileName full path to the file. this can be empty string is contents are new.
      * @param fileIdentifier unique identifier for a file
-     * @param code the file's most up-to-date source code (from the user-edited buffer)
+     * @param snapshot the file's most up-to-date source code (from the user-edited buffer); it is
+     *        converted to UTF-16 in the background thread
      * @param bool if TRUE then tileName is a new file that is not yet written to disk
      * @param version The version of PHP to check against
      * @param bool if TRUE then the code will parsed for PHP tags.  This should be true most of time,
@@ -66,7 +68,7 @@ class WorkingCacheBuilderClass : public t4p::ActionClass {
      *       the file is opened).
      */
     void Update(t4p::GlobalsClass& globals, const wxString& fileName, const wxString& fileIdentifier,
-                const UnicodeString& code, bool isNew, pelet::Versions version, bool doParseTags);
+                const t4p::CodeSnapshotClass& snapshot, bool isNew, pelet::Versions version, bool doParseTags);
 
     wxString GetLabel() const;
 
@@ -83,9 +85,10 @@ class WorkingCacheBuilderClass : public t4p::ActionClass {
     wxFileName TagCacheDbFileName;
 
     /**
-     * the code that is being worked on by the background thread.
+     * the code that is being worked on by the background thread. The snapshot is
+     * shared with the code control; it is only read.
      */
-    UnicodeString Code;
+    t4p::CodeSnapshotClass Snapshot;
 
     /**
      * full path to the file that is being worked on by the background thread.
@@ -109,6 +112,8 @@ class WorkingCacheBuilderClass : public t4p::ActionClass {
      * the previous symbol table's variables as a starting point. Ultimately,
      * we want code completion to be possible even when the current file
      * has syntax errors.
+     * The previous table also lets us re-parse only the function that
+     * the user is editing.
      */
     t4p::SymbolTableClass PreviousSymbolTable;
 
@@ -27,6 +27,7 @@
 #include <wx/filename.h>
 #include <wx/valgen.h>
 #include <vector>
+#include "actions/TagCacheMaintenanceActionClass.h"
 #include "actions/TagWipeActionClass.h"
 #include "globals/Assets.h"
 #include "globals/Errors.h"
@@ -34,26 +35,110 @@
 #include "globals/Number.h"
 #include "globals/String.h"
 #include "globals/TagList.h"
+#include "language_php/TagIndexClass.h"
 #include "Triumph.h"
 
+static int ID_RETAG_TIMER = wxNewId();
+static int ID_MAINTENANCE_TIMER = wxNewId();
+static int ID_TAG_CACHE_MAINTENANCE = wxNewId();
+static int ID_TAG_INDEX_LOAD = wxNewId();
+
+/**
+ * the amount of time (in milliseconds) to collect externally modified
+ * files before re-tagging them
+ */
+static const int RETAG_DELAY = 500;
+
+/**
+ * the amount of time (in milliseconds) without any tags being written
+ * before the tag db maintenance is run
+ */
+static const int MAINTENANCE_IDLE_DELAY = 10 * 60 * 1000;
+
 t4p::TagFeatureClass::TagFeatureClass(t4p::AppClass& app)
     : FeatureClass(app)
     , JumpToText()
-    , CacheState(CACHE_STALE) {
+    , CacheState(CACHE_STALE)
+    , FilesToRetag()
+    , RetagTimer(this, ID_RETAG_TIMER)
+    , MaintenanceTimer(this, ID_MAINTENANCE_TIMER)
+    , MaintenanceActionId(-1)
+    , MaintenanceSummary() {
+    App.Globals.TagCache.SetTagIndexHandler(this);
+}
+
+t4p::TagFeatureClass::~TagFeatureClass() {
+    App.Globals.TagCache.SetTagIndexHandler(NULL);
 }
 
 void t4p::TagFeatureClass::OnAppStartSequenceComplete(wxCommandEvent& event) {
     CacheState = CACHE_OK;
+    RestartMaintenanceTimer();
 }
 
 wxString t4p::TagFeatureClass::CacheStatus() {
+    wxString status = _("Stale");
     if (CACHE_OK == CacheState) {
-        return _("OK");
+        status = _("OK");
     }
-    return _("Stale");
+    if (!MaintenanceSummary.IsEmpty()) {
+        status += wxT(" (") + MaintenanceSummary + wxT(")");
+    }
+    return status;
+}
+
+void t4p::TagFeatureClass::RestartMaintenanceTimer() {
+    if (MaintenanceActionId >= 0) {
+        App.SqliteRunningThreads.CancelAction(MaintenanceActionId);
+        MaintenanceActionId = -1;
+    }
+    MaintenanceTimer.Start(MAINTENANCE_IDLE_DELAY, wxTIMER_ONE_SHOT);
+}
+
+void t4p::TagFeatureClass::OnMaintenanceTimer(wxTimerEvent& event) {
+    if (App.Sequences.Running()) {
+        // projects are being indexed, wait until they are done
+        MaintenanceTimer.Start(MAINTENANCE_IDLE_DELAY, wxTIMER_ONE_SHOT);
+        return;
+    }
+    t4p::TagCacheMaintenanceActionClass* action = new t4p::TagCacheMaintenanceActionClass(App.SqliteRunningThreads, ID_TAG_CACHE_MAINTENANCE);
+    if (action->Init(App.Globals)) {
+        MaintenanceActionId = App.SqliteRunningThreads.Queue(action);
+    } else {
+        delete action;
+    }
+}
+
+void t4p::TagFeatureClass::OnTagCacheMaintenance(wxThreadEvent& event) {
+    MaintenanceActionId = -1;
+    MaintenanceSummary = event.GetString();
+}
+
+void t4p::TagFeatureClass::OnTagIndexStale(wxCommandEvent& event) {
+    t4p::TagIndexLoadActionClass* action = new t4p::TagIndexLoadActionClass(App.RunningThreads, ID_TAG_INDEX_LOAD);
+    if (action->Init(App.Globals)) {
+        App.RunningThreads.Queue(action);
+    } else {
+        // no tag db, the lookups keep going to the tag db until
+        // the index is stale again
+        delete action;
+        App.Globals.TagCache.SwapGlobalTagIndex(NULL);
+    }
+}
+
+void t4p::TagFeatureClass::OnTagIndexLoaded(t4p::TagIndexLoadedEventClass& event) {
+    App.Globals.TagCache.SwapGlobalTagIndex(event.TagIndex);
+    if (event.TagIndex) {
+        delete event.TagIndex;
+    }
+}
+
+void t4p::TagFeatureClass::OnAppFileSaved(t4p::CodeControlEventClass& event) {
+    RestartMaintenanceTimer();
 }
 
 void t4p::TagFeatureClass::OnAppFileDeleted(wxCommandEvent& event) {
+    RestartMaintenanceTimer();
     // clean up the cache in a background thread
     std::vector<wxFileName> filesToDelete;
     filesToDelete.push_back(wxFileName(event.GetString()));
@@ -64,6 +149,7 @@ void t4p::TagFeatureClass::OnAppFileDeleted(wxCommandEvent& event) {
 }
 
 void t4p::TagFeatureClass::OnAppFileRenamed(t4p::RenameEventClass& event) {
+    RestartMaintenanceTimer();
     t4p::ProjectTagSingleFileRenameActionClass* action = new t4p::ProjectTagSingleFileRenameActionClass(App.SqliteRunningThreads, wxID_ANY);
     action->SetPaths(event.OldPath.GetFullPath(), event.NewPath.GetFullPath());
     action->Init(App.Globals);
@@ -76,9 +162,22 @@ void t4p::TagFeatureClass::OnAppFileExternallyModified(wxCommandEvent& event) {
     // see the comment for EVENT_APP_FILE_EXTERNALLY_MODIFIED in Events.h
     // if the file is from an active project, then re-tag it
     // otherwise do nothing
-    wxString fileName = event.GetString();
-    t4p::ProjectTagSingleFileActionClass* tagAction = new t4p::ProjectTagSingleFileActionClass(App.SqliteRunningThreads, t4p::ID_EVENT_ACTION_TAG_FINDER_LIST);
-    tagAction->SetFileToParse(fileName);
+    // the file watcher sends one event per file; wait a bit so
+    // that files modified at the same time are re-tagged together
+    FilesToRetag.push_back(event.GetString());
+    RestartMaintenanceTimer();
+    if (!RetagTimer.IsRunning()) {
+        RetagTimer.Start(RETAG_DELAY, wxTIMER_ONE_SHOT);
+    }
+}
+
+void t4p::TagFeatureClass::OnRetagTimer(wxTimerEvent& event) {
+    if (FilesToRetag.empty()) {
+        return;
+    }
+    t4p::ProjectTagMultipleFileActionClass* tagAction = new t4p::ProjectTagMultipleFileActionClass(App.SqliteRunningThreads, t4p::ID_EVENT_ACTION_TAG_FINDER_LIST);
+    tagAction->SetFilesToParse(FilesToRetag);
+    FilesToRetag.clear();
     if (tagAction->Init(App.Globals)) {
         App.SqliteRunningThreads.Queue(tagAction);
     } else {
@@ -87,6 +186,7 @@ void t4p::TagFeatureClass::OnAppFileExternallyModified(wxCommandEvent& event) {
 }
 
 void t4p::TagFeatureClass::OnAppDirCreated(wxCommandEvent& event) {
+    RestartMaintenanceTimer();
     t4p::ProjectTagDirectoryActionClass* tagAction =  new t4p::ProjectTagDirectoryActionClass(App.SqliteRunningThreads, wxID_ANY);
     tagAction->SetDirToParse(event.GetString());
     if (tagAction->Init(App.Globals)) {
@@ -97,6 +197,7 @@ void t4p::TagFeatureClass::OnAppDirCreated(wxCommandEvent& event) {
 }
 
 void t4p::TagFeatureClass::OnAppDirDeleted(wxCommandEvent& event) {
+    RestartMaintenanceTimer();
     std::vector<wxFileName> dirsToDelete;
     wxFileName dir;
     dir.AssignDir(event.GetString());
@@ -110,6 +211,7 @@ void t4p::TagFeatureClass::OnAppDirDeleted(wxCommandEvent& event) {
 }
 
 void t4p::TagFeatureClass::OnAppDirRenamed(t4p::RenameEventClass& event) {
+    RestartMaintenanceTimer();
     t4p::ProjectTagDirectoryRenameActionClass* action = new t4p::ProjectTagDirectoryRenameActionClass(App.SqliteRunningThreads, wxID_ANY);
     action->SetPaths(event.OldPath.GetPath(), event.NewPath.GetPath());
     action->Init(App.Globals);
@@ -126,6 +228,12 @@ BEGIN_EVENT_TABLE(t4p::TagFeatureClass, wxEvtHandler)
     // we will treat new exernal file and file external modified the same
     EVT_COMMAND(wxID_ANY, t4p::EVENT_APP_FILE_EXTERNALLY_CREATED, t4p::TagFeatureClass::OnAppFileExternallyModified)
     EVT_COMMAND(wxID_ANY, t4p::EVENT_APP_FILE_EXTERNALLY_MODIFIED, t4p::TagFeatureClass::OnAppFileExternallyModified)
+    EVT_TIMER(ID_RETAG_TIMER, t4p::TagFeatureClass::OnRetagTimer)
+    EVT_TIMER(ID_MAINTENANCE_TIMER, t4p::TagFeatureClass::OnMaintenanceTimer)
+    EVT_TAG_CACHE_MAINTENANCE(ID_TAG_CACHE_MAINTENANCE, t4p::TagFeatureClass::OnTagCacheMaintenance)
+    EVT_COMMAND(wxID_ANY, t4p::EVENT_TAG_INDEX_STALE, t4p::TagFeatureClass::OnTagIndexStale)
+    EVT_TAG_INDEX_LOADED(ID_TAG_INDEX_LOAD, t4p::TagFeatureClass::OnTagIndexLoaded)
+    EVT_APP_FILE_SAVED(t4p::TagFeatureClass::OnAppFileSaved)
 
 
     EVT_COMMAND(wxID_ANY, t4p::EVENT_SEQUENCE_COMPLETE, t4p::TagFeatureClass::OnAppStartSequenceComplete)
@@ -26,9 +26,12 @@
 #define SRC_FEATURES_TAGFEATURECLASS_H_
 
 #include <wx/string.h>
+#include <wx/timer.h>
 #include <queue>
+#include <vector>
 #include "actions/ProjectTagActionClass.h"
 #include "actions/TagCacheSearchActionClass.h"
+#include "actions/TagIndexLoadActionClass.h"
 #include "code_control/ResourceCacheBuilderClass.h"
 #include "features/BackgroundFileReaderClass.h"
 #include "features/FeatureClass.h"
@@ -64,8 +67,11 @@ class TagFeatureClass : public FeatureClass {
 
     TagFeatureClass(t4p::AppClass& app);
 
+    ~TagFeatureClass();
+
     /**
-     * returns a short string describing the status of the cache.
+     * returns a short string describing the status of the cache, along
+     * with the size of the tag db as of the last maintenance.
      */
     wxString CacheStatus();
 
@@ -98,10 +104,53 @@ class TagFeatureClass : public FeatureClass {
     void OnAppDirRenamed(t4p::RenameEventClass& event);
 
     /**
-     * if a file is modified externally re-tag it
+     * if a file is modified externally re-tag it. The file is not re-tagged
+     * right away; files are collected for a short time so that when
+     * many files are modified at once (ie. a 'git pull') they are
+     * all re-tagged by a single action.
      */
     void OnAppFileExternallyModified(wxCommandEvent& event);
 
+    /**
+     * re-tag all of the files that have been modified externally
+     * since the timer was started
+     */
+    void OnRetagTimer(wxTimerEvent& event);
+
+    /**
+     * the tags have not changed for a while; queue the tag db
+     * maintenance
+     */
+    void OnMaintenanceTimer(wxTimerEvent& event);
+
+    /**
+     * keep the db summary to show it with the cache status
+     */
+    void OnTagCacheMaintenance(wxThreadEvent& event);
+
+    /**
+     * all of the tags of the global tag index need to be re-read; they
+     * are read in a background thread
+     */
+    void OnTagIndexStale(wxCommandEvent& event);
+
+    /**
+     * swap the tags that were read in the background thread into
+     * the global tag index
+     */
+    void OnTagIndexLoaded(t4p::TagIndexLoadedEventClass& event);
+
+    /**
+     * saved files are re-tagged, the app is not idle
+     */
+    void OnAppFileSaved(t4p::CodeControlEventClass& event);
+
+    /**
+     * cancels the maintenance if it is queued or running, since there
+     * are tags to write, and waits for the app to be idle again
+     */
+    void RestartMaintenanceTimer();
+
     void OnProjectsUpdated(wxCommandEvent& event);
 
     void OnAppFileClosed(t4p::CodeControlEventClass& event);
@@ -131,6 +180,36 @@ class TagFeatureClass : public FeatureClass {
         CACHE_OK
     } CacheState;
 
+    /**
+     * the files that have been modified externally and are waiting
+     * to be re-tagged
+     */
+    std::vector<wxString> FilesToRetag;
+
+    /**
+     * started when the first externally modified file is received; when
+     * it fires all of the files in FilesToRetag are re-tagged
+     */
+    wxTimer RetagTimer;
+
+    /**
+     * restarted every time that tags are written; when it fires the
+     * app has been idle and the tag db maintenance is queued
+     */
+    wxTimer MaintenanceTimer;
+
+    /**
+     * the ID of the queued maintenance action, so that it can be
+     * cancelled when there are tags to write. -1 when it is not queued
+     */
+    int MaintenanceActionId;
+
+    /**
+     * the size of the tag db as of the last maintenance, shown with
+     * the cache status
+     */
+    wxString MaintenanceSummary;
+
     DECLARE_EVENT_TABLE()
 };
 }  // namespace t4p
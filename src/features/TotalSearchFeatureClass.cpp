@@ -23,13 +23,23 @@
  * THE SOFTWARE.
  */
 #include "features/TotalSearchFeatureClass.h"
+#include <vector>
 #include "globals/Assets.h"
 #include "globals/Number.h"
+#include "language_php/CompactTagListClass.h"
+#include "language_php/TagIndexClass.h"
 #include "search/FindInFilesClass.h"
 #include "Triumph.h"
 
+/**
+ * the maximum number of fuzzy matches shown to the user
+ */
+static const size_t FUZZY_LIMIT = 100;
+
 t4p::TotalSearchFeatureClass::TotalSearchFeatureClass(t4p::AppClass& app)
-    : FeatureClass(app) {
+    : FeatureClass(app)
+    , TableMatcher()
+    , Tables() {
 }
 
 
@@ -68,3 +78,84 @@ void t4p::TotalSearchFeatureClass::OpenDbData(const t4p::DatabaseTableTagClass&
     App.EventSink.Publish(cmd);
 }
 
+void t4p::TotalSearchFeatureClass::LoadTables() {
+    std::vector<UnicodeString> tableNames;
+    std::vector<UnicodeString> connectionHashes;
+    App.Globals.SqlResourceFinder.AllTables(tableNames, connectionHashes);
+
+    TableMatcher.Clear();
+    Tables.clear();
+    for (size_t i = 0; i < tableNames.size(); ++i) {
+        t4p::DatabaseTableTagClass tableTag;
+        tableTag.TableName = t4p::IcuToWx(tableNames[i]);
+        tableTag.ConnectionHash = t4p::IcuToWx(connectionHashes[i]);
+        Tables.push_back(tableTag);
+        TableMatcher.Add(tableNames[i], UNICODE_STRING_SIMPLE(""), 0, 0, static_cast<int>(i), 0);
+    }
+}
+
+bool t4p::TotalSearchFeatureClass::FuzzySearch(const wxString& search, std::vector<t4p::TotalTagResultClass>& results,
+        int& lineNumber) {
+    t4p::TagIndexClass* tagIndex = App.Globals.TagCache.GlobalTagIndex();
+    if (!tagIndex) {
+        return false;
+    }
+    UnicodeString query = t4p::WxToIcu(search);
+    t4p::TagSearchClass tagSearch(query);
+    lineNumber = tagSearch.GetLineNumber();
+    if (t4p::TagSearchClass::FILE_NAME_LINE_NUMBER == tagSearch.GetResourceType()) {
+        query = tagSearch.GetFileName();
+    }
+
+    // tags are matched by their name only, the namespace is not
+    // part of the name
+    int32_t namespacePos = query.lastIndexOf(UNICODE_STRING_SIMPLE("\\"));
+    if (namespacePos >= 0) {
+        query.remove(0, namespacePos + 1);
+    }
+
+    std::vector<t4p::FuzzyMatchClass> tagMatches;
+    tagIndex->FuzzyMatches(query, App.Globals.AllEnabledSourceDirectories(), FUZZY_LIMIT, tagMatches);
+    std::vector<int> allGroups;
+    std::vector<t4p::FuzzyMatchClass> tableMatches;
+    TableMatcher.Match(query, allGroups, FUZZY_LIMIT, tableMatches);
+
+    // all of the tags are put in one list before any views are made; appending
+    // to a list that has views would copy the list
+    t4p::CompactTagListClass tags;
+    std::vector<size_t> tagPositions(tagMatches.size(), 0);
+    for (size_t i = 0; i < tagMatches.size(); ++i) {
+        if (t4p::TagIndexClass::FUZZY_TAG == tagMatches[i].Kind) {
+            tagPositions[i] = tags.Size();
+            tags.Append(tagIndex->FuzzyMatchTag(tagMatches[i]));
+        }
+    }
+
+    // both lists are sorted best first; merge them
+    results.clear();
+    size_t tagPos = 0;
+    size_t tablePos = 0;
+    while (results.size() < FUZZY_LIMIT && (tagPos < tagMatches.size() || tablePos < tableMatches.size())) {
+        bool isTable = tablePos < tableMatches.size() &&
+                       (tagPos >= tagMatches.size() || tableMatches[tablePos].Score > tagMatches[tagPos].Score);
+        if (isTable) {
+            t4p::TotalTagResultClass result(Tables[tableMatches[tablePos].Payload]);
+            results.push_back(result);
+
+            result.Type = t4p::TotalTagResultClass::TABLE_DEFINITION_TAG;
+            results.push_back(result);
+            tablePos++;
+        } else {
+            const t4p::FuzzyMatchClass& match = tagMatches[tagPos];
+            if (t4p::TagIndexClass::FUZZY_FILE == match.Kind) {
+                t4p::TotalTagResultClass result(tagIndex->FuzzyMatchFile(match));
+                results.push_back(result);
+            } else {
+                t4p::TotalTagResultClass result(tags.View(tagPositions[tagPos]));
+                results.push_back(result);
+            }
+            tagPos++;
+        }
+    }
+    return true;
+}
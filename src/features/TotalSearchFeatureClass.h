@@ -26,9 +26,11 @@
 #define SRC_FEATURES_TOTALSEARCHFEATURECLASS_H_
 
 #include <wx/timer.h>
+#include <vector>
 #include "actions/ActionClass.h"
 #include "actions/TotalTagSearchActionClass.h"
 #include "features/FeatureClass.h"
+#include "search/FuzzyMatcherClass.h"
 
 namespace t4p {
 /**
@@ -48,6 +50,35 @@ class TotalSearchFeatureClass : public t4p::FeatureClass {
     void OpenDbTable(const t4p::DatabaseTableTagClass& tableTag);
 
     void OpenDbData(const t4p::DatabaseTableTagClass& tableTag);
+
+    /**
+     * Reads the database tables from the tag db so that they can be
+     * matched by FuzzySearch(). This should be called every time that the
+     * search dialog is shown, since the tables may have been re-read.
+     */
+    void LoadTables();
+
+    /**
+     * Fuzzy matches the given search against the project tags and database
+     * tables that are in memory. This is fast enough to be done in the main
+     * thread while the user types.
+     *
+     * @param search the search string, can be either file name, class name, function name,
+     *        or method name (Class::method). A file name can be followed by a line number (user.php:299)
+     * @param results will be filled with the best matches, best match first
+     * @param lineNumber will be filled with the line number parsed from the search
+     * @return bool FALSE if the project tags are not in memory; in this case
+     *         the search should be made with a TotalTagSearchActionClass
+     */
+    bool FuzzySearch(const wxString& search, std::vector<t4p::TotalTagResultClass>& results, int& lineNumber);
+
+ private:
+    /**
+     * the names of the tables read in LoadTables(); the matcher's payload
+     * is the position in the Tables vector
+     */
+    t4p::FuzzyMatcherClass TableMatcher;
+    std::vector<t4p::DatabaseTableTagClass> Tables;
 };
 }  // namespace t4p
 
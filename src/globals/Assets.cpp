@@ -68,6 +68,12 @@ wxFileName t4p::NativeFunctionsAsset() {
     return dbFile;
 }
 
+wxFileName t4p::NativeTagImageAsset() {
+    wxFileName asset = AssetRootDir();
+    wxFileName imageFile(asset.GetPath(), wxT("php.tagimage"));
+    return imageFile;
+}
+
 wxFileName t4p::ResourceSqlSchemaAsset() {
     wxFileName asset = AssetRootDir();
     asset.AppendDir(wxT("sql"));
@@ -76,6 +82,14 @@ wxFileName t4p::ResourceSqlSchemaAsset() {
     return sqlFile;
 }
 
+wxFileName t4p::TagShardSqlSchemaAsset() {
+    wxFileName asset = AssetRootDir();
+    asset.AppendDir(wxT("sql"));
+
+    wxFileName sqlFile(asset.GetPath(), wxT("tag_shard.sql"));
+    return sqlFile;
+}
+
 wxFileName t4p::JsTagsSqlSchemaAsset() {
     wxFileName asset = AssetRootDir();
     asset.AppendDir(wxT("sql"));
@@ -36,11 +36,24 @@ namespace t4p {
  */
 wxFileName NativeFunctionsAsset();
 
+/**
+ * @return the file location of the image of the PHP native functions SQLite file. The
+ *         image is generated from the native functions file at build time by the
+ *         native_tag_image program, see NativeTagImageClass
+ */
+wxFileName NativeTagImageAsset();
+
 /**
  * @return the file location of the SQL script to create the resources database.
  */
 wxFileName ResourceSqlSchemaAsset();
 
+/**
+ * @return the file location of the SQL script to create a tag shard; the
+ *         tables of a single source directory (see TagShardsClass)
+ */
+wxFileName TagShardSqlSchemaAsset();
+
 /**
  * @return the file location of the SQL script to create the JS tags database.
  */
@@ -0,0 +1,133 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "globals/CodeSnapshotClass.h"
+#include <unicode/ustring.h>
+#include <wx/thread.h>
+#include <algorithm>
+#include <string>
+
+namespace t4p {
+/**
+ * the data of a CodeSnapshotClass, shared among the copies of the snapshot
+ */
+class CodeSnapshotDataClass : public t4p::SharedDataClass {
+ public:
+    /**
+     * the document contents, never modified after construction
+     */
+    std::string Utf8;
+
+    int Revision;
+
+    /**
+     * guards Text and IsConverted; the text may be requested
+     * from different threads at the same time
+     */
+    wxMutex Mutex;
+
+    /**
+     * the UTF-16 contents; only valid when IsConverted is TRUE
+     */
+    UnicodeString Text;
+
+    bool IsConverted;
+
+    CodeSnapshotDataClass(const char* utf8, int length, int revision)
+        : SharedDataClass()
+        , Utf8(utf8, length)
+        , Revision(revision)
+        , Mutex()
+        , Text()
+        , IsConverted(false) {
+    }
+};
+}  // namespace t4p
+
+/**
+ * converts the given UTF-8 bytes to a UnicodeString
+ */
+static UnicodeString Utf8ToIcu(const char* bytes, int length) {
+    UnicodeString str;
+    if (length <= 0) {
+        return str;
+    }
+    int32_t written = 0;
+    UErrorCode error = U_ZERO_ERROR;
+
+    // UTF-16 never needs more code units than UTF-8 needs bytes
+    u_strFromUTF8(str.getBuffer(length + 1), length + 1, &written, bytes, length, &error);
+    str.releaseBuffer(U_SUCCESS(error) ? written : 0);
+    return str;
+}
+
+t4p::CodeSnapshotClass::CodeSnapshotClass()
+    : Data(new t4p::CodeSnapshotDataClass("", 0, -1)) {
+}
+
+t4p::CodeSnapshotClass::CodeSnapshotClass(const char* utf8, int length, int revision)
+    : Data(new t4p::CodeSnapshotDataClass(utf8, length, revision)) {
+}
+
+t4p::CodeSnapshotClass::CodeSnapshotClass(const t4p::CodeSnapshotClass& src)
+    : Data(src.Data) {
+}
+
+t4p::CodeSnapshotClass::~CodeSnapshotClass() {
+}
+
+t4p::CodeSnapshotClass& t4p::CodeSnapshotClass::operator=(const t4p::CodeSnapshotClass& src) {
+    Data = src.Data;
+    return *this;
+}
+
+const char* t4p::CodeSnapshotClass::GetUtf8() const {
+    return Data->Utf8.data();
+}
+
+int t4p::CodeSnapshotClass::GetUtf8Length() const {
+    return Data->Utf8.length();
+}
+
+int t4p::CodeSnapshotClass::GetRevision() const {
+    return Data->Revision;
+}
+
+UnicodeString t4p::CodeSnapshotClass::GetText() const {
+    wxMutexLocker locker(Data->Mutex);
+    if (!Data->IsConverted) {
+        Data->Text = Utf8ToIcu(Data->Utf8.data(), Data->Utf8.length());
+        Data->IsConverted = true;
+    }
+
+    // UnicodeString copies share the (reference counted) buffer
+    return Data->Text;
+}
+
+UnicodeString t4p::CodeSnapshotClass::GetSubstring(int startPos, int endPos) const {
+    int length = Data->Utf8.length();
+    startPos = std::max(0, std::min(startPos, length));
+    endPos = std::max(startPos, std::min(endPos, length));
+    return Utf8ToIcu(Data->Utf8.data() + startPos, endPos - startPos);
+}
@@ -0,0 +1,115 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_GLOBALS_CODESNAPSHOTCLASS_H_
+#define SRC_GLOBALS_CODESNAPSHOTCLASS_H_
+
+#include <unicode/unistr.h>
+#include "globals/SharedDataClass.h"
+
+namespace t4p {
+// forward declaration, the snapshot data is private
+class CodeSnapshotDataClass;
+
+/**
+ * An immutable copy of the contents of a code control at a given
+ * revision. The contents are stored as they are in scintilla (UTF-8);
+ * they are converted to UTF-16 only when a consumer asks for the
+ * UnicodeString, and the conversion is done at most once per snapshot.
+ *
+ * Copies of a snapshot share the same data (the data is reference
+ * counted), so a snapshot can be given to background actions without
+ * copying the document again. The reference count is atomic and the
+ * conversion is guarded by a mutex; a snapshot can be read from any
+ * thread.
+ */
+class CodeSnapshotClass {
+ public:
+    /**
+     * an empty snapshot
+     */
+    CodeSnapshotClass();
+
+    /**
+     * @param utf8 the document contents, the bytes are copied
+     * @param length the number of bytes in utf8
+     * @param revision the revision of the document that the
+     *        bytes belong to
+     */
+    CodeSnapshotClass(const char* utf8, int length, int revision);
+
+    /**
+     * the new snapshot shares the data of src; this is not a deep copy
+     */
+    CodeSnapshotClass(const t4p::CodeSnapshotClass& src);
+
+    ~CodeSnapshotClass();
+
+    /**
+     * this snapshot will share the data of src; this is not a deep copy
+     */
+    t4p::CodeSnapshotClass& operator=(const t4p::CodeSnapshotClass& src);
+
+    /**
+     * @return the document contents, UTF-8 encoded. The pointer is valid
+     *         for as long as this snapshot (or a copy of it) exists.
+     *         This is not null terminated; use GetUtf8Length()
+     */
+    const char* GetUtf8() const;
+
+    /**
+     * @return the number of bytes in the document
+     */
+    int GetUtf8Length() const;
+
+    /**
+     * @return the revision of the document that this snapshot was taken
+     *         at, -1 for an empty snapshot
+     */
+    int GetRevision() const;
+
+    /**
+     * @return the entire document as a UnicodeString.  The document is
+     *         converted on the first call; later calls (from any copy of
+     *         this snapshot) return the same string.
+     */
+    UnicodeString GetText() const;
+
+    /**
+     * @return a part of the document as a UnicodeString. Only the part is
+     *         converted.
+     * @param startPos byte offset
+     * @param endPos byte offset, EXCLUSIVE the character at endPos will NOT be included
+     */
+    UnicodeString GetSubstring(int startPos, int endPos) const;
+
+ private:
+    /**
+     * shared among copies of this snapshot, never NULL
+     */
+    t4p::SharedDataPtrClass<t4p::CodeSnapshotDataClass> Data;
+};
+}  // namespace t4p
+
+#endif  // SRC_GLOBALS_CODESNAPSHOTCLASS_H_
@@ -0,0 +1,142 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_GLOBALS_SHAREDDATACLASS_H_
+#define SRC_GLOBALS_SHAREDDATACLASS_H_
+
+#include <wx/atomic.h>
+
+namespace t4p {
+/**
+ * Base class for the data of objects that are cheap to copy: the copies
+ * of an object share its data, and the data is copied only when one of
+ * the copies is modified (copy on write). The data is reference counted,
+ * see SharedDataPtrClass. The count is atomic so that copies can be given
+ * to other threads; the data itself is not guarded.
+ */
+class SharedDataClass {
+ public:
+    /**
+     * the number of objects that share this data
+     */
+    wxAtomicInt RefCount;
+
+    SharedDataClass()
+        : RefCount(1) {
+    }
+
+ private:
+    // the count is not copied; a copy of the data has
+    // one owner, see SharedDataPtrClass::Detach()
+    SharedDataClass(const t4p::SharedDataClass&);
+    void operator=(const t4p::SharedDataClass&);
+};
+
+/**
+ * A pointer to data that is shared among copies of an object. Copying the
+ * pointer shares the data; the data is deleted when its last owner goes
+ * away. The pointer is never NULL.
+ *
+ * T must be a SharedDataClass. Detach() also needs T to have a copy
+ * constructor. The owner's copy constructor, assignment and destructor
+ * must be defined where T is a complete type (ie. in the owner's .cpp file)
+ * so that the data can be private to the .cpp file.
+ */
+template <typename T>
+class SharedDataPtrClass {
+ public:
+    /**
+     * @param data the newly created data, this pointer will own it
+     */
+    explicit SharedDataPtrClass(T* data)
+        : Data(data) {
+    }
+
+    SharedDataPtrClass(const t4p::SharedDataPtrClass<T>& src)
+        : Data(src.Data) {
+        wxAtomicInc(Data->RefCount);
+    }
+
+    ~SharedDataPtrClass() {
+        Release();
+    }
+
+    t4p::SharedDataPtrClass<T>& operator=(const t4p::SharedDataPtrClass<T>& src) {
+        if (Data != src.Data) {
+            wxAtomicInc(src.Data->RefCount);
+            Release();
+            Data = src.Data;
+        }
+        return *this;
+    }
+
+    /**
+     * stops sharing the current data and owns the given data
+     *
+     * @param data the newly created data, this pointer will own it
+     */
+    void Reset(T* data) {
+        Release();
+        Data = data;
+    }
+
+    /**
+     * makes sure that this pointer is the only owner of its data, so that
+     * the data can be modified. The data is copied if it is shared.
+     */
+    void Detach() {
+        if (Data->RefCount > 1) {
+            T* copy = new T(*Data);
+            Release();
+            Data = copy;
+        }
+    }
+
+    T* operator->() const {
+        return Data;
+    }
+
+    T& operator*() const {
+        return *Data;
+    }
+
+    /**
+     * @return the data, this pointer retains ownership
+     */
+    T* Get() const {
+        return Data;
+    }
+
+ private:
+    void Release() {
+        if (wxAtomicDec(Data->RefCount) == 0) {
+            delete Data;
+        }
+    }
+
+    T* Data;
+};
+}  // namespace t4p
+
+#endif  // SRC_GLOBALS_SHAREDDATACLASS_H_
@@ -31,6 +31,11 @@
 #include <vector>
 #include "globals/String.h"
 
+/**
+ * value of PRAGMA auto_vacuum when the db is in incremental mode
+ */
+static const int AUTO_VACUUM_INCREMENTAL = 2;
+
 std::string t4p::SqliteSqlLikeEscape(const std::string& value, char e) {
     std::string escaped;
     for (size_t i = 0; i < value.size(); i++) {
@@ -132,6 +137,85 @@ void t4p::SqliteSetBusyTimeout(soci::session& session, int timeoutMs) {
     sqlite_api::sqlite3_busy_timeout(backend->conn_, timeoutMs);
 }
 
+void t4p::SqliteSetStorageProfile(soci::session& session, bool canWrite) {
+    // journal mode and synchronous change the db file; they are
+    // only set when we can write
+    const char* writePragmas[] = {
+        "PRAGMA journal_mode = WAL",
+        "PRAGMA synchronous = NORMAL"
+    };
+
+    // mmap_size is in bytes (256 MB), a negative cache_size is
+    // in kilobytes (16 MB)
+    const char* readPragmas[] = {
+        "PRAGMA mmap_size = 268435456",
+        "PRAGMA cache_size = -16384",
+        "PRAGMA temp_store = MEMORY"
+    };
+
+    // get the 'raw' sqlite connection
+    soci::sqlite3_session_backend* backend = static_cast<soci::sqlite3_session_backend*>(session.get_backend());
+    if (canWrite) {
+        for (size_t i = 0; i < sizeof(writePragmas) / sizeof(writePragmas[0]); ++i) {
+            sqlite_api::sqlite3_exec(backend->conn_, writePragmas[i], NULL, NULL, NULL);
+        }
+    }
+    for (size_t i = 0; i < sizeof(readPragmas) / sizeof(readPragmas[0]); ++i) {
+        sqlite_api::sqlite3_exec(backend->conn_, readPragmas[i], NULL, NULL, NULL);
+    }
+}
+
+int t4p::SqliteAttachLimit(soci::session& session) {
+    // get the 'raw' sqlite connection
+    soci::sqlite3_session_backend* backend = static_cast<soci::sqlite3_session_backend*>(session.get_backend());
+
+    // a negative value does not change the limit, just returns it
+    return sqlite_api::sqlite3_limit(backend->conn_, SQLITE_LIMIT_ATTACHED, -1);
+}
+
+bool t4p::SqliteIncrementalVacuum(soci::session& session, int maxPages) {
+    // get the 'raw' sqlite connection
+    soci::sqlite3_session_backend* backend = static_cast<soci::sqlite3_session_backend*>(session.get_backend());
+    std::string sql = "PRAGMA incremental_vacuum(" + t4p::WxToChar(wxString::Format(wxT("%d"), maxPages)) + ")";
+    return sqlite_api::sqlite3_exec(backend->conn_, sql.c_str(), NULL, NULL, NULL) == SQLITE_OK;
+}
+
+bool t4p::SqliteSetIncrementalAutoVacuum(soci::session& session) {
+    bool ret = false;
+    try {
+        int autoVacuum = 0;
+        session << "PRAGMA auto_vacuum", soci::into(autoVacuum);
+        if (autoVacuum != AUTO_VACUUM_INCREMENTAL) {
+            session << "PRAGMA auto_vacuum = INCREMENTAL";
+            session << "VACUUM";
+        }
+        ret = true;
+    } catch (std::exception& e) {
+        // the db is locked by another connection; the db stays in
+        // its current mode
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+    }
+    return ret;
+}
+
+bool t4p::SqlitePageCounts(soci::session& session, int& pageSize, int& pageCount, int& freePageCount) {
+    bool ret = false;
+    try {
+        session << "PRAGMA page_size", soci::into(pageSize);
+        session << "PRAGMA page_count", soci::into(pageCount);
+        session << "PRAGMA freelist_count", soci::into(freePageCount);
+        ret = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+    }
+    return ret;
+}
+
 int t4p::SqliteInsertId(soci::statement& stmt) {
     soci::sqlite3_statement_backend* backend = static_cast<soci::sqlite3_statement_backend*>(stmt.get_backend());
     return sqlite3_last_insert_rowid(backend->session_.conn_);
@@ -100,6 +100,67 @@ bool SqliteTables(soci::session& session, std::vector<std::string>& tableNames,
  */
 void SqliteSetBusyTimeout(soci::session& session, int timeoutMs = 100);
 
+/**
+ * set the storage profile for the tag, detector and JS caches on the opened
+ * sqlite connection. The caches are written by one thread while being
+ * read by many others, and all of their data can be re-created from
+ * the source files; the profile is:
+ *
+ * - write ahead logging, so that readers are not blocked while tags are
+ *   being written and the writer is not blocked by readers
+ * - synchronous NORMAL; in WAL mode this is safe against application
+ *   crashes, only a power loss may lose the last transactions
+ * - memory mapped I/O and a bigger page cache for faster reads
+ * - temp tables and indices in memory
+ *
+ * This function will never throw an exception; a PRAGMA that fails
+ * is skipped.
+ *
+ * @param session opened connection. MUST BE a SQLITE connection otherwise the program will crash!
+ * @param canWrite if FALSE, the db is never written to (ie. the native tags db that
+ *        may be in a read-only location) only the read settings are set.
+ */
+void SqliteSetStorageProfile(soci::session& session, bool canWrite = true);
+
+/**
+ * @param session opened connection. MUST BE a SQLITE connection otherwise the program will crash!
+ * @return the maximum number of databases that can be attached to the connection
+ */
+int SqliteAttachLimit(soci::session& session);
+
+/**
+ * Frees up to the given number of pages from the end of the db file. The db
+ * must be in incremental auto vacuum mode, otherwise nothing is freed. The
+ * pragma returns one row per freed page, so it is run through sqlite3_exec
+ * which steps it to completion.
+ *
+ * @param session opened connection. MUST BE a SQLITE connection otherwise the program will crash!
+ * @param maxPages the most pages to free
+ * @return bool FALSE if the pragma could not be run (ie. the db is locked)
+ */
+bool SqliteIncrementalVacuum(soci::session& session, int maxPages);
+
+/**
+ * Switches the db to incremental auto vacuum, so that SqliteIncrementalVacuum
+ * can free its unused pages. The mode of a db that has tables only changes
+ * after a full VACUUM, which rewrites the entire file and locks out all other
+ * connections while it runs; call this only right after the db is created or
+ * wiped, when the VACUUM is quick.
+ *
+ * @param session opened connection. MUST BE a SQLITE connection otherwise the program will crash!
+ * @return bool FALSE if the mode could not be changed (ie. the db is locked)
+ */
+bool SqliteSetIncrementalAutoVacuum(soci::session& session);
+
+/**
+ * @param session opened connection. MUST BE a SQLITE connection otherwise the program will crash!
+ * @param [out] pageSize the size of a page, in bytes
+ * @param [out] pageCount the pages in the db file
+ * @param [out] freePageCount the unused pages in the db file
+ * @return bool FALSE if the counts could not be read
+ */
+bool SqlitePageCounts(soci::session& session, int& pageSize, int& pageCount, int& freePageCount);
+
 /**
  * Get the ID of the last insert, useful for auto incremented primary keys
  *
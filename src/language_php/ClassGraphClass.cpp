@@ -0,0 +1,186 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/ClassGraphClass.h"
+#include <unicode/ustring.h>
+#include <algorithm>
+#include <set>
+#include <vector>
+
+/**
+ * @return the key used for the graph maps
+ */
+static UnicodeString FoldClassKey(const UnicodeString& classKey) {
+    UnicodeString folded(classKey);
+    folded.foldCase();
+    return folded;
+}
+
+t4p::ClassGraphClass::ClassGraphClass()
+    : Classes()
+    , UsedTraits()
+    , FileKeys() {
+}
+
+void t4p::ClassGraphClass::AddClass(int fileTagId, const UnicodeString& classKey, const UnicodeString& signature) {
+    UnicodeString folded = FoldClassKey(classKey);
+    ClassNode node;
+    node.FileTagId = fileTagId;
+    node.ParentClassName = ParentClassFromSignature(signature);
+    Classes[folded].push_back(node);
+    FileKeys[fileTagId].push_back(folded);
+}
+
+void t4p::ClassGraphClass::AddTrait(int fileTagId, int sourceId, const UnicodeString& classKey,
+                                    const UnicodeString& traitClassName) {
+    UnicodeString folded = FoldClassKey(classKey);
+    TraitEdge edge;
+    edge.FileTagId = fileTagId;
+    edge.SourceId = sourceId;
+    edge.TraitClassName = traitClassName;
+    UsedTraits[folded].push_back(edge);
+    FileKeys[fileTagId].push_back(folded);
+}
+
+void t4p::ClassGraphClass::RemoveFiles(const std::vector<int>& fileTagIds) {
+    for (size_t i = 0; i < fileTagIds.size(); ++i) {
+        int fileTagId = fileTagIds[i];
+        std::map<int, std::vector<UnicodeString> >::iterator file = FileKeys.find(fileTagId);
+        if (file == FileKeys.end()) {
+            continue;
+        }
+
+        // a key is listed once for every class or trait in the file
+        std::set<UnicodeString> keys(file->second.begin(), file->second.end());
+        for (std::set<UnicodeString>::const_iterator key = keys.begin(); key != keys.end(); ++key) {
+            std::map<UnicodeString, std::vector<ClassNode>, t4p::UnicodeStringComparatorClass>::iterator cls = Classes.find(*key);
+            if (cls != Classes.end()) {
+                std::vector<ClassNode> kept;
+                for (size_t j = 0; j < cls->second.size(); ++j) {
+                    if (cls->second[j].FileTagId != fileTagId) {
+                        kept.push_back(cls->second[j]);
+                    }
+                }
+                if (kept.empty()) {
+                    Classes.erase(cls);
+                } else {
+                    cls->second.swap(kept);
+                }
+            }
+            std::map<UnicodeString, std::vector<TraitEdge>, t4p::UnicodeStringComparatorClass>::iterator trait = UsedTraits.find(*key);
+            if (trait != UsedTraits.end()) {
+                std::vector<TraitEdge> kept;
+                for (size_t j = 0; j < trait->second.size(); ++j) {
+                    if (trait->second[j].FileTagId != fileTagId) {
+                        kept.push_back(trait->second[j]);
+                    }
+                }
+                if (kept.empty()) {
+                    UsedTraits.erase(trait);
+                } else {
+                    trait->second.swap(kept);
+                }
+            }
+        }
+        FileKeys.erase(file);
+    }
+}
+
+void t4p::ClassGraphClass::Clear() {
+    Classes.clear();
+    UsedTraits.clear();
+    FileKeys.clear();
+}
+
+void t4p::ClassGraphClass::Swap(t4p::ClassGraphClass& other) {
+    Classes.swap(other.Classes);
+    UsedTraits.swap(other.UsedTraits);
+    FileKeys.swap(other.FileKeys);
+}
+
+bool t4p::ClassGraphClass::ParentClassName(const UnicodeString& classKey, UnicodeString& parentClassName) const {
+    std::map<UnicodeString, std::vector<ClassNode>, t4p::UnicodeStringComparatorClass>::const_iterator cls;
+    cls = Classes.find(FoldClassKey(classKey));
+    if (cls == Classes.end() || cls->second.empty()) {
+        return false;
+    }
+
+    // same as ParsedTagFinderClass::ParentClassName(); when a class is
+    // defined more than once the first one is used
+    parentClassName = cls->second.front().ParentClassName;
+    return true;
+}
+
+void t4p::ClassGraphClass::Traits(const UnicodeString& classKey, const std::vector<int>& sourceIds,
+                                  std::vector<UnicodeString>& traits) const {
+    std::map<UnicodeString, std::vector<TraitEdge>, t4p::UnicodeStringComparatorClass>::const_iterator trait;
+    trait = UsedTraits.find(FoldClassKey(classKey));
+    if (trait == UsedTraits.end()) {
+        return;
+    }
+    std::vector<UnicodeString> classTraits;
+    for (size_t i = 0; i < trait->second.size(); ++i) {
+        const TraitEdge& edge = trait->second[i];
+        if (!sourceIds.empty() && !std::binary_search(sourceIds.begin(), sourceIds.end(), edge.SourceId)) {
+            continue;
+        }
+        classTraits.push_back(edge.TraitClassName);
+    }
+
+    // same order as ParsedTagFinderClass::GetResourceTraits()
+    std::sort(classTraits.begin(), classTraits.end());
+    std::vector<UnicodeString>::iterator end = std::unique(classTraits.begin(), classTraits.end());
+    traits.insert(traits.end(), classTraits.begin(), end);
+}
+
+size_t t4p::ClassGraphClass::Count() const {
+    return Classes.size();
+}
+
+UnicodeString t4p::ClassGraphClass::ParentClassFromSignature(const UnicodeString& signature) {
+    // look for the parent class. tokenize the signature and get the
+    // class name after the 'extends' keyword note that since the signature is re-constructed by the parser
+    // the parent class is always fully qualified
+    UnicodeString parentClassName;
+    UChar* saveState = NULL;
+    const UChar* delims =  UNICODE_STRING_SIMPLE(" ").getTerminatedBuffer();
+    UChar* sig = new UChar[signature.length() + 1];
+    u_strncpy(sig, signature.getBuffer(), signature.length());
+    sig[signature.length()] = '\0';
+    UChar* next = u_strtok_r(sig, delims, &saveState);
+    if (next) {
+        do {
+            UnicodeString token(next);
+            if (token.caseCompare(UNICODE_STRING_SIMPLE("extends"), 0) == 0) {
+                next = u_strtok_r(NULL, delims, &saveState);
+                if (next) {
+                    parentClassName.setTo(next, u_strlen(next));
+                }
+            }
+            next = u_strtok_r(NULL, delims, &saveState);
+        } while (next != NULL);
+    }
+    delete[] sig;
+    return parentClassName;
+}
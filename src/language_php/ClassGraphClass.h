@@ -0,0 +1,156 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_CLASSGRAPHCLASS_H_
+#define SRC_LANGUAGE_PHP_CLASSGRAPHCLASS_H_
+
+#include <unicode/unistr.h>
+#include <map>
+#include <vector>
+#include "globals/String.h"
+
+namespace t4p {
+/**
+ * The class graph holds the inheritance (class -> parent class) and the
+ * trait (class -> used traits) relationships of the classes in a tag db.
+ * The graph is kept by the TagIndexClass and it is updated along with
+ * the index, so that finding the ancestors or traits of a class does
+ * not need to query the db (and parse the class signature) for each
+ * level of the hierarchy.
+ *
+ * A class is stored under each of its keys (ie. "UserClass" and
+ * "\Models\UserClass"), lookups are case-insensitive.
+ *
+ * This class is not thread-safe.
+ */
+class ClassGraphClass {
+ public:
+    ClassGraphClass();
+
+    /**
+     * adds a class to the graph.
+     *
+     * @param fileTagId the file that the class is in
+     * @param classKey the key of the class tag
+     * @param signature the signature of the class tag; the parent
+     *        class is taken from it
+     */
+    void AddClass(int fileTagId, const UnicodeString& classKey, const UnicodeString& signature);
+
+    /**
+     * adds a trait that is used by a class.
+     *
+     * @param fileTagId the file that the class is in
+     * @param sourceId the source that the class is in
+     * @param classKey the key of the class that uses the trait
+     * @param traitClassName the name of the trait, as returned by
+     *        ParsedTagFinderClass::GetResourceTraits()
+     */
+    void AddTrait(int fileTagId, int sourceId, const UnicodeString& classKey, const UnicodeString& traitClassName);
+
+    /**
+     * removes all of the classes and traits of the given files
+     */
+    void RemoveFiles(const std::vector<int>& fileTagIds);
+
+    void Clear();
+
+    /**
+     * exchanges the classes and traits of this graph with those of the given graph
+     */
+    void Swap(ClassGraphClass& other);
+
+    /**
+     * @param classKey the class to look for, case does not matter
+     * @param parentClassName will be set to the parent of the class, as
+     *        it is written in the class signature. Will be empty
+     *        when the class has no parent.
+     * @return bool TRUE if the class is in the graph
+     */
+    bool ParentClassName(const UnicodeString& classKey, UnicodeString& parentClassName) const;
+
+    /**
+     * appends the traits used by the given class (but not the traits
+     * used by its parents, or by its traits) to traits. Each trait is
+     * appended at most once.
+     *
+     * @param classKey the class to look for, case does not matter
+     * @param sourceIds only traits used in these sources are appended;
+     *        if empty traits from all sources are appended. Must
+     *        be sorted.
+     * @param traits the vector to append to
+     */
+    void Traits(const UnicodeString& classKey, const std::vector<int>& sourceIds, std::vector<UnicodeString>& traits) const;
+
+    /**
+     * @return the number of classes in the graph
+     */
+    size_t Count() const;
+
+    /**
+     * @return the parent class in a class signature (the class after the
+     *         'extends' keyword), empty string if the signature does not
+     *         have a parent class
+     */
+    static UnicodeString ParentClassFromSignature(const UnicodeString& signature);
+
+ private:
+    /**
+     * a class -> parent edge
+     */
+    struct ClassNode {
+        int FileTagId;
+        UnicodeString ParentClassName;
+    };
+
+    /**
+     * a class -> trait edge
+     */
+    struct TraitEdge {
+        int FileTagId;
+        int SourceId;
+        UnicodeString TraitClassName;
+    };
+
+    /**
+     * the classes, keyed by case folded class key. Usually there is
+     * only one class per key, but a project may have the same class
+     * in different files.
+     */
+    std::map<UnicodeString, std::vector<ClassNode>, t4p::UnicodeStringComparatorClass> Classes;
+
+    /**
+     * the traits used by each class, keyed by case folded class key
+     */
+    std::map<UnicodeString, std::vector<TraitEdge>, t4p::UnicodeStringComparatorClass> UsedTraits;
+
+    /**
+     * the folded keys of the classes and traits in each file, so that a file's
+     * classes can be removed without walking the entire graph
+     */
+    std::map<int, std::vector<UnicodeString> > FileKeys;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_CLASSGRAPHCLASS_H_
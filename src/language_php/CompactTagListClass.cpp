@@ -0,0 +1,557 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/CompactTagListClass.h"
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "globals/String.h"
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/TagIndexClass.h"
+
+/**
+ * bits of the Flags column; the first 6 bits are the same as the bits
+ * of the TagIndexClass Flags column
+ */
+static const int FLAG_PROTECTED = 1;
+static const int FLAG_PRIVATE = 2;
+static const int FLAG_STATIC = 4;
+static const int FLAG_DYNAMIC = 8;
+static const int FLAG_NATIVE = 16;
+static const int FLAG_VARIABLE_ARGS = 32;
+static const int FLAG_FILE_IS_NEW = 64;
+
+namespace t4p {
+/**
+ * a single tag; strings are IDs into the string pool
+ */
+class CompactTagRowClass {
+ public:
+    int Key;
+    int Identifier;
+    int ClassName;
+    int NamespaceName;
+    int Signature;
+    int ReturnType;
+    int Comment;
+    int FullPath;
+    int Id;
+    int FileTagId;
+    int SourceId;
+    int LineNumber;
+    int Type;
+    int Flags;
+
+    CompactTagRowClass()
+        : Key(0)
+        , Identifier(0)
+        , ClassName(0)
+        , NamespaceName(0)
+        , Signature(0)
+        , ReturnType(0)
+        , Comment(0)
+        , FullPath(0)
+        , Id(0)
+        , FileTagId(0)
+        , SourceId(0)
+        , LineNumber(0)
+        , Type(0)
+        , Flags(0) {
+    }
+};
+
+/**
+ * the data of a CompactTagListClass, shared among the copies of the list
+ */
+class CompactTagDataClass : public t4p::SharedDataClass {
+ public:
+    /**
+     * the string pool; the tag strings and the full paths are stored
+     * separately since full paths are wxStrings. Strings can be
+     * looked up by their UTF-8 value too, since that is what is in the
+     * db.
+     */
+    std::vector<UnicodeString> Strings;
+    std::map<UnicodeString, int, t4p::UnicodeStringComparatorClass> StringIds;
+    std::map<std::string, int> Utf8StringIds;
+    std::vector<wxString> Paths;
+    std::map<wxString, int> PathIds;
+    std::map<std::string, int> Utf8PathIds;
+
+    std::vector<t4p::CompactTagRowClass> Rows;
+
+    CompactTagDataClass()
+        : SharedDataClass()
+        , Strings()
+        , StringIds()
+        , Utf8StringIds()
+        , Paths()
+        , PathIds()
+        , Utf8PathIds()
+        , Rows() {
+        // ID zero is always the empty string
+        Intern(UNICODE_STRING_SIMPLE(""));
+        InternPath(wxT(""));
+    }
+
+    /**
+     * copies the tags of src, the new data is not shared
+     */
+    explicit CompactTagDataClass(const t4p::CompactTagDataClass& src)
+        : SharedDataClass()
+        , Strings(src.Strings)
+        , StringIds(src.StringIds)
+        , Utf8StringIds(src.Utf8StringIds)
+        , Paths(src.Paths)
+        , PathIds(src.PathIds)
+        , Utf8PathIds(src.Utf8PathIds)
+        , Rows(src.Rows) {
+    }
+
+    int Intern(const UnicodeString& str) {
+        std::map<UnicodeString, int, t4p::UnicodeStringComparatorClass>::const_iterator it = StringIds.find(str);
+        if (it != StringIds.end()) {
+            return it->second;
+        }
+        int id = Strings.size();
+        Strings.push_back(str);
+        StringIds[str] = id;
+        return id;
+    }
+
+    int InternUtf8(const std::string& str) {
+        std::map<std::string, int>::const_iterator it = Utf8StringIds.find(str);
+        if (it != Utf8StringIds.end()) {
+            return it->second;
+        }
+        int id = Intern(t4p::CharToIcu(str.c_str()));
+        Utf8StringIds[str] = id;
+        return id;
+    }
+
+    int InternPath(const wxString& path) {
+        std::map<wxString, int>::const_iterator it = PathIds.find(path);
+        if (it != PathIds.end()) {
+            return it->second;
+        }
+        int id = Paths.size();
+
+        // deep copy, wxString is not thread safe and this data may be read from
+        // other threads
+        Paths.push_back(path.c_str());
+        PathIds[Paths.back()] = id;
+        return id;
+    }
+
+    int InternUtf8Path(const std::string& path) {
+        std::map<std::string, int>::const_iterator it = Utf8PathIds.find(path);
+        if (it != Utf8PathIds.end()) {
+            return it->second;
+        }
+        int id = InternPath(t4p::CharToWx(path.c_str()));
+        Utf8PathIds[path] = id;
+        return id;
+    }
+
+ private:
+    // not assignable
+    void operator=(const t4p::CompactTagDataClass&);
+};
+
+/**
+ * orders rows by key, case insensitive; same as PhpTagClass::operator<
+ */
+class CompactTagRowKeyLessClass {
+ public:
+    explicit CompactTagRowKeyLessClass(const std::vector<UnicodeString>& strings)
+        : Strings(strings) {
+    }
+
+    bool operator()(const t4p::CompactTagRowClass& a, const t4p::CompactTagRowClass& b) const {
+        return Strings[a.Key].caseCompare(Strings[b.Key], 0) < 0;
+    }
+
+ private:
+    const std::vector<UnicodeString>& Strings;
+};
+}  // namespace t4p
+
+t4p::CompactTagListClass::CompactTagListClass()
+    : Data(new t4p::CompactTagDataClass()) {
+}
+
+t4p::CompactTagListClass::CompactTagListClass(const t4p::CompactTagListClass& src)
+    : Data(src.Data) {
+}
+
+t4p::CompactTagListClass::~CompactTagListClass() {
+}
+
+t4p::CompactTagListClass& t4p::CompactTagListClass::operator=(const t4p::CompactTagListClass& src) {
+    Data = src.Data;
+    return *this;
+}
+
+void t4p::CompactTagListClass::Append(const t4p::PhpTagClass& tag) {
+    Data.Detach();
+    t4p::CompactTagRowClass row;
+    row.Key = Data->Intern(tag.Key);
+    row.Identifier = Data->Intern(tag.Identifier);
+    row.ClassName = Data->Intern(tag.ClassName);
+    row.NamespaceName = Data->Intern(tag.NamespaceName);
+    row.Signature = Data->Intern(tag.Signature);
+    row.ReturnType = Data->Intern(tag.ReturnType);
+    row.Comment = Data->Intern(tag.Comment);
+    row.FullPath = Data->InternPath(tag.FullPath);
+    row.Id = tag.Id;
+    row.FileTagId = tag.FileTagId;
+    row.SourceId = tag.SourceId;
+    row.LineNumber = tag.LineNumber;
+    row.Type = tag.Type;
+    row.Flags = (tag.IsProtected ? FLAG_PROTECTED : 0)
+                | (tag.IsPrivate ? FLAG_PRIVATE : 0)
+                | (tag.IsStatic ? FLAG_STATIC : 0)
+                | (tag.IsDynamic ? FLAG_DYNAMIC : 0)
+                | (tag.IsNative ? FLAG_NATIVE : 0)
+                | (tag.HasVariableArgs ? FLAG_VARIABLE_ARGS : 0)
+                | (tag.FileIsNew ? FLAG_FILE_IS_NEW : 0);
+    Data->Rows.push_back(row);
+}
+
+void t4p::CompactTagListClass::Append(const std::vector<t4p::PhpTagClass>& tags) {
+    Data.Detach();
+    Data->Rows.reserve(Data->Rows.size() + tags.size());
+    for (size_t i = 0; i < tags.size(); ++i) {
+        Append(tags[i]);
+    }
+}
+
+void t4p::CompactTagListClass::Append(const t4p::TagResultClass& result) {
+    Data.Detach();
+
+    // same as TagResultClass::Next
+    t4p::CompactTagRowClass row;
+    row.Key = Data->InternUtf8(result.Key);
+    row.Identifier = Data->InternUtf8(result.Identifier);
+    row.ClassName = Data->InternUtf8(result.ClassName);
+    row.NamespaceName = Data->InternUtf8(result.NamespaceName);
+    row.Signature = Data->InternUtf8(result.Signature);
+    row.ReturnType = Data->InternUtf8(result.ReturnType);
+    row.Comment = Data->InternUtf8(result.Comment);
+    if (soci::i_ok == result.FullPathIndicator) {
+        row.FullPath = Data->InternUtf8Path(result.FullPath);
+    }
+    row.Id = result.Id;
+    if (soci::i_ok == result.FileTagIdIndicator) {
+        row.FileTagId = result.FileTagId;
+    }
+    row.SourceId = result.SourceId;
+    row.Type = result.Type;
+    row.LineNumber = result.LineNumber;
+    row.Flags = (result.IsProtected ? FLAG_PROTECTED : 0)
+                | (result.IsPrivate ? FLAG_PRIVATE : 0)
+                | (result.IsStatic ? FLAG_STATIC : 0)
+                | (result.IsDynamic ? FLAG_DYNAMIC : 0)
+                | (result.IsNative ? FLAG_NATIVE : 0)
+                | (result.HasVariableArgs ? FLAG_VARIABLE_ARGS : 0)
+                | (soci::i_ok != result.FileIsNewIndicator || result.FileIsNew ? FLAG_FILE_IS_NEW : 0);
+    Data->Rows.push_back(row);
+}
+
+void t4p::CompactTagListClass::Append(const t4p::TagIndexClass& index, size_t row) {
+    Data.Detach();
+
+    // same as TagIndexClass::TagAt
+    t4p::CompactTagRowClass tagRow;
+    tagRow.Key = Data->Intern(index.Strings[index.Keys[row]]);
+    tagRow.Identifier = Data->Intern(index.Strings[index.Identifiers[row]]);
+    tagRow.ClassName = Data->Intern(index.Strings[index.ClassNames[row]]);
+    tagRow.NamespaceName = Data->Intern(index.Strings[index.NamespaceNames[row]]);
+    tagRow.Signature = Data->Intern(index.Strings[index.Signatures[row]]);
+    tagRow.ReturnType = Data->Intern(index.Strings[index.ReturnTypes[row]]);
+    tagRow.Comment = Data->Intern(index.Strings[index.Comments[row]]);
+    tagRow.Id = index.Ids[row];
+    tagRow.FileTagId = index.FileTagIds[row];
+    tagRow.SourceId = index.SourceIds[row];
+    tagRow.Type = index.Types[row];
+    tagRow.LineNumber = index.LineNumbers[row];
+    tagRow.Flags = index.Flags[row] & (FLAG_PROTECTED | FLAG_PRIVATE | FLAG_STATIC
+                                       | FLAG_DYNAMIC | FLAG_NATIVE | FLAG_VARIABLE_ARGS);
+
+    // a tag without a file is considered new
+    std::map<int, t4p::FileTagClass>::const_iterator file = index.Files.find(index.FileTagIds[row]);
+    if (file != index.Files.end()) {
+        tagRow.FullPath = Data->InternPath(file->second.FullPath);
+        tagRow.Flags |= file->second.IsNew ? FLAG_FILE_IS_NEW : 0;
+    } else {
+        tagRow.Flags |= FLAG_FILE_IS_NEW;
+    }
+    Data->Rows.push_back(tagRow);
+}
+
+void t4p::CompactTagListClass::Append(const t4p::CompactTagListClass& src, size_t index) {
+    // src may be this list, keep its data while this list is detached
+    t4p::CompactTagListClass source(src);
+    Data.Detach();
+    t4p::CompactTagRowClass row = source.Data->Rows[index];
+    if (source.Data.Get() != Data.Get()) {
+        const t4p::CompactTagDataClass& srcData = *source.Data;
+        row.Key = Data->Intern(srcData.Strings[row.Key]);
+        row.Identifier = Data->Intern(srcData.Strings[row.Identifier]);
+        row.ClassName = Data->Intern(srcData.Strings[row.ClassName]);
+        row.NamespaceName = Data->Intern(srcData.Strings[row.NamespaceName]);
+        row.Signature = Data->Intern(srcData.Strings[row.Signature]);
+        row.ReturnType = Data->Intern(srcData.Strings[row.ReturnType]);
+        row.Comment = Data->Intern(srcData.Strings[row.Comment]);
+        row.FullPath = Data->InternPath(srcData.Paths[row.FullPath]);
+    }
+    Data->Rows.push_back(row);
+}
+
+void t4p::CompactTagListClass::SetIdentifier(size_t index, const UnicodeString& identifier) {
+    Data.Detach();
+    Data->Rows[index].Identifier = Data->Intern(identifier);
+}
+
+void t4p::CompactTagListClass::Sort() {
+    Data.Detach();
+    std::sort(Data->Rows.begin(), Data->Rows.end(), t4p::CompactTagRowKeyLessClass(Data->Strings));
+}
+
+void t4p::CompactTagListClass::Clear() {
+    // no need to copy the data that is going to be cleared
+    Data.Reset(new t4p::CompactTagDataClass());
+}
+
+size_t t4p::CompactTagListClass::Size() const {
+    return Data->Rows.size();
+}
+
+bool t4p::CompactTagListClass::Empty() const {
+    return Data->Rows.empty();
+}
+
+t4p::PhpTagViewClass t4p::CompactTagListClass::View(size_t index) const {
+    return t4p::PhpTagViewClass(*this, index);
+}
+
+t4p::PhpTagClass t4p::CompactTagListClass::Tag(size_t index) const {
+    const t4p::CompactTagRowClass& row = Data->Rows[index];
+    t4p::PhpTagClass tag;
+    tag.Key = Data->Strings[row.Key];
+    tag.Identifier = Data->Strings[row.Identifier];
+    tag.ClassName = Data->Strings[row.ClassName];
+    tag.NamespaceName = Data->Strings[row.NamespaceName];
+    tag.Signature = Data->Strings[row.Signature];
+    tag.ReturnType = Data->Strings[row.ReturnType];
+    tag.Comment = Data->Strings[row.Comment];
+    tag.SetFullPath(Data->Paths[row.FullPath]);
+    tag.Id = row.Id;
+    tag.FileTagId = row.FileTagId;
+    tag.SourceId = row.SourceId;
+    tag.LineNumber = row.LineNumber;
+    tag.Type = (t4p::PhpTagClass::Types)row.Type;
+    tag.IsProtected = (row.Flags & FLAG_PROTECTED) != 0;
+    tag.IsPrivate = (row.Flags & FLAG_PRIVATE) != 0;
+    tag.IsStatic = (row.Flags & FLAG_STATIC) != 0;
+    tag.IsDynamic = (row.Flags & FLAG_DYNAMIC) != 0;
+    tag.IsNative = (row.Flags & FLAG_NATIVE) != 0;
+    tag.HasVariableArgs = (row.Flags & FLAG_VARIABLE_ARGS) != 0;
+    tag.FileIsNew = (row.Flags & FLAG_FILE_IS_NEW) != 0;
+    return tag;
+}
+
+const UnicodeString& t4p::CompactTagListClass::Key(size_t index) const {
+    return Data->Strings[Data->Rows[index].Key];
+}
+
+const UnicodeString& t4p::CompactTagListClass::Identifier(size_t index) const {
+    return Data->Strings[Data->Rows[index].Identifier];
+}
+
+const UnicodeString& t4p::CompactTagListClass::ClassName(size_t index) const {
+    return Data->Strings[Data->Rows[index].ClassName];
+}
+
+const UnicodeString& t4p::CompactTagListClass::NamespaceName(size_t index) const {
+    return Data->Strings[Data->Rows[index].NamespaceName];
+}
+
+const UnicodeString& t4p::CompactTagListClass::Signature(size_t index) const {
+    return Data->Strings[Data->Rows[index].Signature];
+}
+
+const UnicodeString& t4p::CompactTagListClass::ReturnType(size_t index) const {
+    return Data->Strings[Data->Rows[index].ReturnType];
+}
+
+const UnicodeString& t4p::CompactTagListClass::Comment(size_t index) const {
+    return Data->Strings[Data->Rows[index].Comment];
+}
+
+const wxString& t4p::CompactTagListClass::FullPath(size_t index) const {
+    return Data->Paths[Data->Rows[index].FullPath];
+}
+
+t4p::PhpTagClass::Types t4p::CompactTagListClass::Type(size_t index) const {
+    return (t4p::PhpTagClass::Types)Data->Rows[index].Type;
+}
+
+int t4p::CompactTagListClass::Id(size_t index) const {
+    return Data->Rows[index].Id;
+}
+
+int t4p::CompactTagListClass::FileTagId(size_t index) const {
+    return Data->Rows[index].FileTagId;
+}
+
+int t4p::CompactTagListClass::SourceId(size_t index) const {
+    return Data->Rows[index].SourceId;
+}
+
+int t4p::CompactTagListClass::LineNumber(size_t index) const {
+    return Data->Rows[index].LineNumber;
+}
+
+bool t4p::CompactTagListClass::IsProtected(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_PROTECTED) != 0;
+}
+
+bool t4p::CompactTagListClass::IsPrivate(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_PRIVATE) != 0;
+}
+
+bool t4p::CompactTagListClass::IsStatic(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_STATIC) != 0;
+}
+
+bool t4p::CompactTagListClass::IsDynamic(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_DYNAMIC) != 0;
+}
+
+bool t4p::CompactTagListClass::IsNative(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_NATIVE) != 0;
+}
+
+bool t4p::CompactTagListClass::HasVariableArgs(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_VARIABLE_ARGS) != 0;
+}
+
+bool t4p::CompactTagListClass::FileIsNew(size_t index) const {
+    return (Data->Rows[index].Flags & FLAG_FILE_IS_NEW) != 0;
+}
+
+bool t4p::CompactTagListClass::HasParameters(size_t index) const {
+    // same as PhpTagClass::HasParameters
+    return Signature(index).indexOf(Identifier(index) + UNICODE_STRING_SIMPLE("()")) < 0;
+}
+
+UnicodeString t4p::CompactTagListClass::FullyQualifiedClassName(size_t index) const {
+    UnicodeString qualifiedName = NamespaceName(index);
+    if (!qualifiedName.endsWith(UNICODE_STRING_SIMPLE("\\"))) {
+        qualifiedName.append(UNICODE_STRING_SIMPLE("\\"));
+    }
+    qualifiedName.append(ClassName(index));
+    return qualifiedName;
+}
+
+t4p::PhpTagViewClass::PhpTagViewClass()
+    : List()
+    , Index(0) {
+}
+
+t4p::PhpTagViewClass::PhpTagViewClass(const t4p::CompactTagListClass& list, size_t index)
+    : List(list)
+    , Index(index) {
+    wxASSERT_MSG(index < list.Size(), wxT("tag view index is out of bounds"));
+}
+
+bool t4p::PhpTagViewClass::IsOk() const {
+    return Index < List.Size();
+}
+
+t4p::PhpTagClass t4p::PhpTagViewClass::Tag() const {
+    return List.Tag(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::Key() const {
+    return List.Key(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::Identifier() const {
+    return List.Identifier(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::ClassName() const {
+    return List.ClassName(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::NamespaceName() const {
+    return List.NamespaceName(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::Signature() const {
+    return List.Signature(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::ReturnType() const {
+    return List.ReturnType(Index);
+}
+
+const UnicodeString& t4p::PhpTagViewClass::Comment() const {
+    return List.Comment(Index);
+}
+
+const wxString& t4p::PhpTagViewClass::FullPath() const {
+    return List.FullPath(Index);
+}
+
+t4p::PhpTagClass::Types t4p::PhpTagViewClass::Type() const {
+    return List.Type(Index);
+}
+
+int t4p::PhpTagViewClass::LineNumber() const {
+    return List.LineNumber(Index);
+}
+
+bool t4p::PhpTagViewClass::IsProtected() const {
+    return List.IsProtected(Index);
+}
+
+bool t4p::PhpTagViewClass::IsPrivate() const {
+    return List.IsPrivate(Index);
+}
+
+bool t4p::PhpTagViewClass::IsStatic() const {
+    return List.IsStatic(Index);
+}
+
+bool t4p::PhpTagViewClass::HasParameters() const {
+    return List.HasParameters(Index);
+}
+
+UnicodeString t4p::PhpTagViewClass::FullyQualifiedClassName() const {
+    return List.FullyQualifiedClassName(Index);
+}
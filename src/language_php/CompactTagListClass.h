@@ -0,0 +1,241 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_COMPACTTAGLISTCLASS_H_
+#define SRC_LANGUAGE_PHP_COMPACTTAGLISTCLASS_H_
+
+#include <unicode/unistr.h>
+#include <wx/string.h>
+#include <vector>
+#include "globals/SharedDataClass.h"
+#include "language_php/PhpTagClass.h"
+
+namespace t4p {
+// forward declaration, defined in another file
+class TagResultClass;
+
+// forward declaration, defined in another file
+class TagIndexClass;
+
+// forward declaration, defined below
+class PhpTagViewClass;
+
+// forward declaration, the list data is private
+class CompactTagDataClass;
+
+/**
+ * A list of tags that is cheap to build and to copy. Result sets of
+ * near matches can have thousands of tags, and a PhpTagClass has many
+ * strings; most of the strings are the same across tags (tags of the
+ * same class have the same class name, namespace and file). This list stores
+ * each string only once (interned), and each tag is a row of string IDs
+ * and flags.
+ *
+ * Copies of a list share the same data (the data is reference counted);
+ * copying a list into an event or a view is not a deep copy. Appending to a
+ * list that is shared with another copy will first make a private copy of
+ * the data (copy-on-write), so a list that was given to another thread
+ * should not be appended to; that would be a deep copy.
+ *
+ * Lists can be given to other threads (ie. in events); the reference count
+ * is atomic and the data is never modified once it is shared.
+ */
+class CompactTagListClass {
+ public:
+    CompactTagListClass();
+
+    /**
+     * the new list shares the data of src; this is not a deep copy
+     */
+    CompactTagListClass(const t4p::CompactTagListClass& src);
+
+    ~CompactTagListClass();
+
+    /**
+     * this list will share the data of src; this is not a deep copy
+     */
+    t4p::CompactTagListClass& operator=(const t4p::CompactTagListClass& src);
+
+    /**
+     * adds a tag to the end of this list, the strings of the tag are
+     * interned
+     */
+    void Append(const t4p::PhpTagClass& tag);
+
+    /**
+     * adds the tags to the end of this list, the strings of the tags are
+     * interned
+     */
+    void Append(const std::vector<t4p::PhpTagClass>& tags);
+
+    /**
+     * adds the current row of the given result to the end of this list. The
+     * row is read straight from the db columns, without building a
+     * PhpTagClass; strings that were already seen are not converted
+     * again. Use TagResultClass::Next(CompactTagListClass&) instead of
+     * calling this directly.
+     */
+    void Append(const t4p::TagResultClass& result);
+
+    /**
+     * adds the tag at the given position of the index to the end of this
+     * list. The tag is read straight from the index columns, without
+     * building a PhpTagClass. Use TagIndexClass::ExactMatches(..., CompactTagListClass&)
+     * instead of calling this directly.
+     */
+    void Append(const t4p::TagIndexClass& index, size_t row);
+
+    /**
+     * adds the tag at the given position of src to the end of this list
+     */
+    void Append(const t4p::CompactTagListClass& src, size_t index);
+
+    /**
+     * changes the identifier of the tag at the given position
+     */
+    void SetIdentifier(size_t index, const UnicodeString& identifier);
+
+    /**
+     * sorts the tags by key; same order as sorting PhpTagClass objects
+     */
+    void Sort();
+
+    /**
+     * removes all tags from this list
+     */
+    void Clear();
+
+    /**
+     * @return the number of tags in this list
+     */
+    size_t Size() const;
+
+    /**
+     * @return TRUE if this list has no tags
+     */
+    bool Empty() const;
+
+    /**
+     * @return a view of the tag at the given position, the view shares
+     *         the data of this list
+     */
+    t4p::PhpTagViewClass View(size_t index) const;
+
+    /**
+     * @return a copy of the tag at the given position; use this only
+     *         when a PhpTagClass is needed, since this allocates all of
+     *         the strings of the tag.
+     */
+    t4p::PhpTagClass Tag(size_t index) const;
+
+    /**
+     * the columns of the tag at the given position; see the PhpTagClass
+     * members of the same names
+     */
+    const UnicodeString& Key(size_t index) const;
+    const UnicodeString& Identifier(size_t index) const;
+    const UnicodeString& ClassName(size_t index) const;
+    const UnicodeString& NamespaceName(size_t index) const;
+    const UnicodeString& Signature(size_t index) const;
+    const UnicodeString& ReturnType(size_t index) const;
+    const UnicodeString& Comment(size_t index) const;
+    const wxString& FullPath(size_t index) const;
+    t4p::PhpTagClass::Types Type(size_t index) const;
+    int Id(size_t index) const;
+    int FileTagId(size_t index) const;
+    int SourceId(size_t index) const;
+    int LineNumber(size_t index) const;
+    bool IsProtected(size_t index) const;
+    bool IsPrivate(size_t index) const;
+    bool IsStatic(size_t index) const;
+    bool IsDynamic(size_t index) const;
+    bool IsNative(size_t index) const;
+    bool HasVariableArgs(size_t index) const;
+    bool FileIsNew(size_t index) const;
+
+    /**
+     * @see PhpTagClass::HasParameters
+     */
+    bool HasParameters(size_t index) const;
+
+    /**
+     * @see PhpTagClass::FullyQualifiedClassName
+     */
+    UnicodeString FullyQualifiedClassName(size_t index) const;
+
+ private:
+    /**
+     * shared among copies of this list, never NULL. Detach() before
+     * modifying it
+     */
+    t4p::SharedDataPtrClass<t4p::CompactTagDataClass> Data;
+};
+
+/**
+ * A view of a single tag of a CompactTagListClass. A view is small (a list
+ * and a position) and copying it does not copy any strings; use this instead
+ * of a PhpTagClass when a tag result needs to be stored or passed around.
+ */
+class PhpTagViewClass {
+ public:
+    /**
+     * creates an invalid view
+     */
+    PhpTagViewClass();
+
+    PhpTagViewClass(const t4p::CompactTagListClass& list, size_t index);
+
+    /**
+     * @return TRUE if this view points to a tag
+     */
+    bool IsOk() const;
+
+    /**
+     * @return a copy of the tag, see CompactTagListClass::Tag
+     */
+    t4p::PhpTagClass Tag() const;
+
+    const UnicodeString& Key() const;
+    const UnicodeString& Identifier() const;
+    const UnicodeString& ClassName() const;
+    const UnicodeString& NamespaceName() const;
+    const UnicodeString& Signature() const;
+    const UnicodeString& ReturnType() const;
+    const UnicodeString& Comment() const;
+    const wxString& FullPath() const;
+    t4p::PhpTagClass::Types Type() const;
+    int LineNumber() const;
+    bool IsProtected() const;
+    bool IsPrivate() const;
+    bool IsStatic() const;
+    bool HasParameters() const;
+    UnicodeString FullyQualifiedClassName() const;
+
+ private:
+    t4p::CompactTagListClass List;
+    size_t Index;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_COMPACTTAGLISTCLASS_H_
@@ -23,12 +23,123 @@
  * THE SOFTWARE.
  */
 #include "language_php/FileTags.h"
+#include <wx/ffile.h>
 #include <algorithm>
 #include <string>
 #include <vector>
 #include "globals/Sqlite.h"
 #include "globals/String.h"
 
+/**
+ * the xxHash64 primes
+ */
+static const wxUint64 HASH_PRIME_1 = wxULL(11400714785074694791);
+static const wxUint64 HASH_PRIME_2 = wxULL(14029467366897019727);
+static const wxUint64 HASH_PRIME_3 = wxULL(1609587929392839161);
+static const wxUint64 HASH_PRIME_4 = wxULL(9650029242287828579);
+static const wxUint64 HASH_PRIME_5 = wxULL(2870177450012600261);
+
+static wxUint64 HashRotate(wxUint64 value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/**
+ * reads little endian bytes, so that the hash is the same in all platforms
+ */
+static wxUint64 HashRead(const unsigned char* bytes, int count) {
+    wxUint64 value = 0;
+    for (int i = count - 1; i >= 0; --i) {
+        value = (value << 8) | bytes[i];
+    }
+    return value;
+}
+
+static wxUint64 HashRound(wxUint64 acc, wxUint64 input) {
+    acc += input * HASH_PRIME_2;
+    acc = HashRotate(acc, 31);
+    acc *= HASH_PRIME_1;
+    return acc;
+}
+
+static wxUint64 HashMergeRound(wxUint64 acc, wxUint64 value) {
+    acc ^= HashRound(0, value);
+    acc = acc * HASH_PRIME_1 + HASH_PRIME_4;
+    return acc;
+}
+
+/**
+ * @return the xxHash64 (seed 0) of the given bytes
+ */
+static wxUint64 Hash64(const unsigned char* bytes, size_t length) {
+    const unsigned char* end = bytes + length;
+    wxUint64 hash = 0;
+    if (length >= 32) {
+        const unsigned char* limit = end - 32;
+        wxUint64 v1 = HASH_PRIME_1 + HASH_PRIME_2;
+        wxUint64 v2 = HASH_PRIME_2;
+        wxUint64 v3 = 0;
+        wxUint64 v4 = 0 - HASH_PRIME_1;
+        do {
+            v1 = HashRound(v1, HashRead(bytes, 8));
+            v2 = HashRound(v2, HashRead(bytes + 8, 8));
+            v3 = HashRound(v3, HashRead(bytes + 16, 8));
+            v4 = HashRound(v4, HashRead(bytes + 24, 8));
+            bytes += 32;
+        } while (bytes <= limit);
+        hash = HashRotate(v1, 1) + HashRotate(v2, 7) + HashRotate(v3, 12) + HashRotate(v4, 18);
+        hash = HashMergeRound(hash, v1);
+        hash = HashMergeRound(hash, v2);
+        hash = HashMergeRound(hash, v3);
+        hash = HashMergeRound(hash, v4);
+    } else {
+        hash = HASH_PRIME_5;
+    }
+    hash += static_cast<wxUint64>(length);
+    while (bytes + 8 <= end) {
+        hash ^= HashRound(0, HashRead(bytes, 8));
+        hash = HashRotate(hash, 27) * HASH_PRIME_1 + HASH_PRIME_4;
+        bytes += 8;
+    }
+    if (bytes + 4 <= end) {
+        hash ^= HashRead(bytes, 4) * HASH_PRIME_1;
+        hash = HashRotate(hash, 23) * HASH_PRIME_2 + HASH_PRIME_3;
+        bytes += 4;
+    }
+    while (bytes < end) {
+        hash ^= (*bytes) * HASH_PRIME_5;
+        hash = HashRotate(hash, 11) * HASH_PRIME_1;
+        bytes++;
+    }
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME_2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * converts the date to a struct that soci can bind to a DATETIME column
+ */
+static std::tm FileTagTm(const wxDateTime& dateTime) {
+    std::tm tm;
+    if (dateTime.IsValid()) {
+        wxDateTime::Tm wxTm = dateTime.GetTm();
+        tm.tm_hour = wxTm.hour;
+        tm.tm_isdst = dateTime.IsDST();
+        tm.tm_mday = wxTm.mday;
+        tm.tm_min = wxTm.min;
+        tm.tm_mon = wxTm.mon;
+        tm.tm_sec = wxTm.sec;
+        tm.tm_wday = dateTime.GetWeekDay();
+        tm.tm_yday = dateTime.GetDayOfYear();
+
+        // tm holds number of years since 1900 (2012 = 112)
+        tm.tm_year = wxTm.year - 1900;
+    }
+    return tm;
+}
+
 std::vector<int> t4p::FileTagIdsForDirs(soci::session& session, const std::vector<wxFileName>& dirs, bool& error, wxString& errorMsg) {
     std::vector<int> fileTagIds;
     if (dirs.empty()) {
@@ -65,36 +176,167 @@ std::vector<int> t4p::FileTagIdsForDirs(soci::session& session, const std::vecto
 }
 
 bool t4p::FileTagPersist(soci::session& session, t4p::FileTagClass& fileTag) {
-    std::string fullPath = t4p::WxToChar(fileTag.FullPath);
-    std::string name = t4p::WxToChar(fileTag.Name());
-    std::tm tm;
-    int isParsed = fileTag.IsParsed ? 1 : 0;
-    int isNew = fileTag.IsNew ? 1 : 0;
-    int sourceId = fileTag.SourceId;
-    if (fileTag.DateTime.IsValid()) {
-        wxDateTime::Tm wxTm = fileTag.DateTime.GetTm();
-        tm.tm_hour = wxTm.hour;
-        tm.tm_isdst = fileTag.DateTime.IsDST();
-        tm.tm_mday = wxTm.mday;
-        tm.tm_min = wxTm.min;
-        tm.tm_mon = wxTm.mon;
-        tm.tm_sec = wxTm.sec;
-        tm.tm_wday = fileTag.DateTime.GetWeekDay();
-        tm.tm_yday = fileTag.DateTime.GetDayOfYear();
+    t4p::FileTagPersistClass persist;
+    bool success = persist.Init(session) && persist.Persist(fileTag);
+    return success;
+}
 
-        // tm holds number of years since 1900 (2012 = 112)
-        tm.tm_year = wxTm.year - 1900;
+t4p::FileTagPersistClass::FileTagPersistClass()
+    : Stmt(NULL)
+    , ModifiedStmt(NULL)
+    , ContentHashStmt(NULL)
+    , UpdateFileTagId(0)
+    , SourceId(0)
+    , FullPath()
+    , Name()
+    , LastModified()
+    , IsParsed(0)
+    , IsNew(0)
+    , FileSize(0)
+    , ContentHash() {
+}
+
+t4p::FileTagPersistClass::~FileTagPersistClass() {
+    Close();
+}
+
+bool t4p::FileTagPersistClass::Init(soci::session& session) {
+    Close();
+    bool success = false;
+    try {
+        Stmt = new soci::statement(session);
+        *Stmt = (session.prepare <<
+                 "INSERT INTO file_items " <<
+                 "(file_item_id, source_id, full_path, name, last_modified, is_parsed, is_new, file_size, content_hash)" <<
+                 "VALUES(NULL, ?, ?, ?, ?, ?, ?, ?, ?)",
+                 soci::use(SourceId), soci::use(FullPath), soci::use(Name),
+                 soci::use(LastModified), soci::use(IsParsed), soci::use(IsNew),
+                 soci::use(FileSize), soci::use(ContentHash));
+        ModifiedStmt = new soci::statement(session);
+        *ModifiedStmt = (session.prepare <<
+                         "UPDATE file_items SET last_modified = ? WHERE file_item_id = ?",
+                         soci::use(LastModified), soci::use(UpdateFileTagId));
+        ContentHashStmt = new soci::statement(session);
+        *ContentHashStmt = (session.prepare <<
+                            "UPDATE file_items SET content_hash = ? WHERE file_item_id = ?",
+                            soci::use(ContentHash), soci::use(UpdateFileTagId));
+        success = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = wxString::FromAscii(e.what());
+        wxASSERT_MSG(false, msg);
+        Close();
+    }
+    return success;
+}
+
+bool t4p::FileTagPersistClass::Persist(t4p::FileTagClass& fileTag) {
+    if (!Stmt) {
+        return false;
     }
+    FullPath = t4p::WxToChar(fileTag.FullPath);
+    Name = t4p::WxToChar(fileTag.Name());
+    LastModified = FileTagTm(fileTag.DateTime);
+    IsParsed = fileTag.IsParsed ? 1 : 0;
+    IsNew = fileTag.IsNew ? 1 : 0;
+    SourceId = fileTag.SourceId;
+    FileSize = fileTag.FileSize;
+    ContentHash = t4p::WxToChar(fileTag.ContentHash);
+    bool success = false;
+    try {
+        Stmt->execute(true);
+        fileTag.FileId = t4p::SqliteInsertId(*Stmt);
+        success = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = wxString::FromAscii(e.what());
+        wxASSERT_MSG(false, msg);
+    }
+    return success;
+}
+
+bool t4p::FileTagPersistClass::PersistModified(const t4p::FileTagClass& fileTag) {
+    if (!ModifiedStmt) {
+        return false;
+    }
+    LastModified = FileTagTm(fileTag.DateTime);
+    UpdateFileTagId = fileTag.FileId;
+    bool success = false;
+    try {
+        ModifiedStmt->execute(true);
+        success = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = wxString::FromAscii(e.what());
+        wxASSERT_MSG(false, msg);
+    }
+    return success;
+}
+
+bool t4p::FileTagPersistClass::PersistContentHash(int fileTagId, const wxString& contentHash) {
+    if (!ContentHashStmt) {
+        return false;
+    }
+    ContentHash = t4p::WxToChar(contentHash);
+    UpdateFileTagId = fileTagId;
+    bool success = false;
+    try {
+        ContentHashStmt->execute(true);
+        success = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = wxString::FromAscii(e.what());
+        wxASSERT_MSG(false, msg);
+    }
+    return success;
+}
+
+void t4p::FileTagPersistClass::Close() {
+    if (Stmt) {
+        delete Stmt;
+        Stmt = NULL;
+    }
+    if (ModifiedStmt) {
+        delete ModifiedStmt;
+        ModifiedStmt = NULL;
+    }
+    if (ContentHashStmt) {
+        delete ContentHashStmt;
+        ContentHashStmt = NULL;
+    }
+}
+
+bool t4p::FileTagPersistModified(soci::session& session, const t4p::FileTagClass& fileTag) {
+    std::tm tm = FileTagTm(fileTag.DateTime);
+    int fileTagId = fileTag.FileId;
+    bool success = false;
+    try {
+        soci::statement stmt = (session.prepare <<
+                                "UPDATE file_items SET last_modified = ? WHERE file_item_id = ?",
+                                soci::use(tm), soci::use(fileTagId));
+        stmt.execute(true);
+        success = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = wxString::FromAscii(e.what());
+        wxASSERT_MSG(false, msg);
+    }
+    return success;
+}
+
+bool t4p::FileTagPersistContentHash(soci::session& session, int fileTagId, const wxString& contentHash) {
+    std::string stdContentHash = t4p::WxToChar(contentHash);
     bool success = false;
     try {
         soci::statement stmt = (session.prepare <<
-                                "INSERT INTO file_items " <<
-                                "(file_item_id, source_id, full_path, name, last_modified, is_parsed, is_new)" <<
-                                "VALUES(NULL, ?, ?, ?, ?, ?, ?)",
-                                soci::use(sourceId), soci::use(fullPath), soci::use(name),
-                                soci::use(tm), soci::use(isParsed), soci::use(isNew));
+                                "UPDATE file_items SET content_hash = ? WHERE file_item_id = ?",
+                                soci::use(stdContentHash), soci::use(fileTagId));
         stmt.execute(true);
-        fileTag.FileId = t4p::SqliteInsertId(stmt);
         success = true;
     } catch (std::exception& e) {
         // ATTN: at some point bubble these exceptions up?
@@ -104,3 +346,39 @@ bool t4p::FileTagPersist(soci::session& session, t4p::FileTagClass& fileTag) {
     }
     return success;
 }
+
+bool t4p::FileTagContentHash(FILE* fp, wxString& contentHash) {
+    if (!fp) {
+        return false;
+    }
+    std::string contents;
+    char buffer[4096];
+    size_t read = fread(buffer, 1, sizeof(buffer), fp);
+    while (read > 0) {
+        contents.append(buffer, read);
+        read = fread(buffer, 1, sizeof(buffer), fp);
+    }
+    if (ferror(fp)) {
+        return false;
+    }
+    wxUint64 hash = Hash64(reinterpret_cast<const unsigned char*>(contents.data()), contents.size());
+
+    // 16 hex characters, most significant first
+    const char* digits = "0123456789abcdef";
+    char hex[17];
+    for (int i = 15; i >= 0; --i) {
+        hex[i] = digits[hash & 0xF];
+        hash >>= 4;
+    }
+    hex[16] = '\0';
+    contentHash = wxString::FromAscii(hex);
+    return true;
+}
+
+bool t4p::FileTagContentHash(const wxString& fullPath, wxString& contentHash) {
+    wxFFile file;
+    if (!file.Open(fullPath, wxT("rb"))) {
+        return false;
+    }
+    return t4p::FileTagContentHash(file.fp(), contentHash);
+}
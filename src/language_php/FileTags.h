@@ -27,6 +27,10 @@
 
 #include <soci/soci.h>
 #include <wx/filename.h>
+#include <wx/string.h>
+#include <cstdio>
+#include <ctime>
+#include <string>
 #include <vector>
 #include "language_php/PhpTagClass.h"
 
@@ -53,5 +57,123 @@ std::vector<int> FileTagIdsForDirs(soci::session& session, const std::vector<wxF
  * @return bool TRUE if INSERT succeeded
  */
 bool FileTagPersist(soci::session& session, t4p::FileTagClass& fileTag);
+
+/**
+ * Inserts and updates file_items rows using prepared statements; use this
+ * class instead of FileTagPersist(), FileTagPersistModified() and
+ * FileTagPersistContentHash() when many file items are written with the
+ * same connection.
+ */
+class FileTagPersistClass {
+ public:
+    FileTagPersistClass();
+
+    ~FileTagPersistClass();
+
+    /**
+     * prepares the INSERT and UPDATE statements. Init() can be called again to
+     * prepare the statements for another connection.
+     *
+     * @param session the db connection to insert the file items to
+     * @return bool TRUE if the statement was prepared
+     */
+    bool Init(soci::session& session);
+
+    /**
+     * Inserts a file_items row; the same as FileTagPersist(). Init() must
+     * have been called.
+     *
+     * @param fileTag the file tag to insert; upon success the newly created
+     *        file_item_id is set on the tag instance.
+     * @return bool TRUE if INSERT succeeded
+     */
+    bool Persist(t4p::FileTagClass& fileTag);
+
+    /**
+     * Updates the last modified time of a file_items row; the same as
+     * FileTagPersistModified(). Init() must have been called.
+     *
+     * @param fileTag the file tag to update, the FileId and DateTime are used
+     * @return bool TRUE if UPDATE succeeded
+     */
+    bool PersistModified(const t4p::FileTagClass& fileTag);
+
+    /**
+     * Updates the content hash of a file_items row; the same as
+     * FileTagPersistContentHash(). Init() must have been called.
+     *
+     * @param fileTagId the file_item_id to update
+     * @param contentHash the hash to store
+     * @return bool TRUE if UPDATE succeeded
+     */
+    bool PersistContentHash(int fileTagId, const wxString& contentHash);
+
+    /**
+     * cleans up the prepared statements
+     */
+    void Close();
+
+ private:
+    /**
+     * the prepared statements and the variables bound to them.
+     * This class owns the pointers.
+     */
+    soci::statement* Stmt;
+    soci::statement* ModifiedStmt;
+    soci::statement* ContentHashStmt;
+    int UpdateFileTagId;
+    int SourceId;
+    std::string FullPath;
+    std::string Name;
+    std::tm LastModified;
+    int IsParsed;
+    int IsNew;
+    long long FileSize;
+    std::string ContentHash;
+};
+
+/**
+ * Updates the last modified time of a file_items row. This is used when a file
+ * was touched but its contents did not change; the file does not need to be
+ * parsed but we want the next check to be a cheap one.
+ *
+ * @param session the db connection to update the file item in
+ * @param fileTag the file tag to update, the FileId and DateTime are used
+ * @return bool TRUE if UPDATE succeeded
+ */
+bool FileTagPersistModified(soci::session& session, const t4p::FileTagClass& fileTag);
+
+/**
+ * Updates the content hash of a file_items row.
+ *
+ * @param session the db connection to update the file item in
+ * @param fileTagId the file_item_id to update
+ * @param contentHash the hash to store, as computed by FileTagContentHash
+ * @return bool TRUE if UPDATE succeeded
+ */
+bool FileTagPersistContentHash(soci::session& session, int fileTagId, const wxString& contentHash);
+
+/**
+ * Computes a hash of the contents of a file. This is a 64 bit xxHash
+ * (xxHash64), it is fast and good enough to detect file changes; it is
+ * NOT a cryptographic hash.  The file is read from the current position
+ * until the end of the file; the caller must rewind the file if it wants
+ * to read it again.
+ *
+ * @param fp the file to read
+ * @param contentHash the hash, as a 16 character hex string, will be set here
+ * @return bool TRUE if the file could be read
+ */
+bool FileTagContentHash(FILE* fp, wxString& contentHash);
+
+/**
+ * Computes a hash of the contents of the given file.
+ * @see FileTagContentHash(FILE*, wxString&)
+ *
+ * @param fullPath the file to read
+ * @param contentHash the hash, as a 16 character hex string, will be set here
+ * @return bool TRUE if the file could be read
+ */
+bool FileTagContentHash(const wxString& fullPath, wxString& contentHash);
 }  // namespace t4p
 #endif  // SRC_LANGUAGE_PHP_FILETAGS_H_
@@ -0,0 +1,957 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/NativeTagImageClass.h"
+#include <unicode/uchar.h>
+#include <wx/ffile.h>
+#include <wx/thread.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/String.h"
+#include "language_php/ClassGraphClass.h"
+
+#if defined(__WXMSW__)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * the maximum amount of tags returned by a single query; same as the
+ * LIMIT used by the TagResultClass queries
+ */
+static const size_t MATCH_LIMIT = 100;
+
+/**
+ * "T4PI"; identifies an image file. Since the magic is written as an int,
+ * an image with a different byte order will not match
+ */
+static const int32_t IMAGE_MAGIC = 0x54345049;
+
+/**
+ * must be incremented whenever the image layout changes
+ */
+static const int32_t IMAGE_VERSION = 2;
+
+/**
+ * the header items, the header is at the start of the image
+ */
+enum HeaderItems {
+    HEADER_MAGIC,
+    HEADER_VERSION,
+    HEADER_TAG_COUNT,
+    HEADER_KEY_COUNT,
+    HEADER_BUCKET_COUNT,
+    HEADER_SLOT_COUNT,
+    HEADER_STRING_COUNT,
+    HEADER_POOL_LENGTH,
+    HEADER_TRAIT_COUNT,
+    HEADER_SIZE
+};
+
+/**
+ * the columns of each tag record; string columns contain a string ID
+ */
+enum TagColumns {
+    COLUMN_ID,
+    COLUMN_FILE_TAG_ID,
+    COLUMN_SOURCE_ID,
+    COLUMN_KEY,
+    COLUMN_IDENTIFIER,
+    COLUMN_CLASS_NAME,
+    COLUMN_NAMESPACE_NAME,
+    COLUMN_SIGNATURE,
+    COLUMN_RETURN_TYPE,
+    COLUMN_COMMENT,
+    COLUMN_TYPE,
+    COLUMN_FLAGS,
+    TAG_COLUMNS
+};
+
+/**
+ * the columns of each trait record; all columns contain a string ID.
+ * aliases and instead ofs are comma-separated lists, same as
+ * the trait_resources table
+ */
+enum TraitColumns {
+    TRAIT_COLUMN_KEY,
+    TRAIT_COLUMN_TRAIT_NAME,
+    TRAIT_COLUMN_TRAIT_NAMESPACE_NAME,
+    TRAIT_COLUMN_ALIASES,
+    TRAIT_COLUMN_INSTEAD_OFS,
+    TRAIT_COLUMNS
+};
+
+/**
+ * bits of the flags column; same as the TagIndexClass flags
+ */
+static const int32_t FLAG_PROTECTED = 1;
+static const int32_t FLAG_PRIVATE = 2;
+static const int32_t FLAG_STATIC = 4;
+static const int32_t FLAG_DYNAMIC = 8;
+static const int32_t FLAG_NATIVE = 16;
+static const int32_t FLAG_VARIABLE_ARGS = 32;
+
+/**
+ * @return the key folded one character at a time; the
+ * same folding is done to the keys being looked up
+ */
+static UnicodeString FoldKey(const UnicodeString& key) {
+    UnicodeString folded(key);
+    for (int32_t i = 0; i < folded.length(); ++i) {
+        folded.setCharAt(i, static_cast<UChar>(u_foldCase(folded.charAt(i), U_FOLD_CASE_DEFAULT)));
+    }
+    return folded;
+}
+
+/**
+ * the hash used for the perfect hash; FNV-1a over the UTF-16 code units
+ * followed by a final mix so that different seeds give unrelated hashes.
+ */
+static uint32_t HashKey(const UnicodeString& key, uint32_t seed) {
+    uint32_t hash = 2166136261U ^ (seed * 16777619U);
+    for (int32_t i = 0; i < key.length(); ++i) {
+        hash ^= key.charAt(i);
+        hash *= 16777619U;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bU;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35U;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * appends name to namespace
+ */
+static UnicodeString QualifyName(const UnicodeString& namespaceName, const UnicodeString& name) {
+    UnicodeString qualifiedName;
+    qualifiedName.append(namespaceName);
+    if (!qualifiedName.endsWith(UNICODE_STRING_SIMPLE("\\"))) {
+        qualifiedName.append(UNICODE_STRING_SIMPLE("\\"));
+    }
+    qualifiedName.append(name);
+    return qualifiedName;
+}
+
+/**
+ * @return the items of a comma-separated list
+ */
+static std::vector<UnicodeString> SplitList(const UnicodeString& list) {
+    std::vector<UnicodeString> items;
+    int32_t start = 0;
+    while (start < list.length()) {
+        int32_t end = list.indexOf(UNICODE_STRING_SIMPLE(","), start);
+        if (end < 0) {
+            end = list.length();
+        }
+        if (end > start) {
+            items.push_back(UnicodeString(list, start, end - start));
+        }
+        start = end + 1;
+    }
+    return items;
+}
+
+static std::vector<int> NonMemberTypes() {
+    std::vector<int> types;
+    types.push_back(t4p::PhpTagClass::DEFINE);
+    types.push_back(t4p::PhpTagClass::CLASS);
+    types.push_back(t4p::PhpTagClass::FUNCTION);
+    return types;
+}
+
+static std::vector<int> MemberTypes() {
+    std::vector<int> types;
+    types.push_back(t4p::PhpTagClass::CLASS_CONSTANT);
+    types.push_back(t4p::PhpTagClass::MEMBER);
+    types.push_back(t4p::PhpTagClass::METHOD);
+    return types;
+}
+
+namespace t4p {
+/**
+ * the strings of an image that is being written. Each string is
+ * stored once.
+ */
+class NativeTagImageStringsClass {
+ public:
+    std::vector<UnicodeString> Strings;
+
+    std::map<UnicodeString, int, t4p::UnicodeStringComparatorClass> StringIds;
+
+    int Intern(const UnicodeString& str) {
+        std::map<UnicodeString, int, t4p::UnicodeStringComparatorClass>::const_iterator it = StringIds.find(str);
+        if (it != StringIds.end()) {
+            return it->second;
+        }
+        int id = static_cast<int>(Strings.size());
+        Strings.push_back(str);
+        StringIds[str] = id;
+        return id;
+    }
+};
+
+/**
+ * orders tag positions by their folded key
+ */
+class NativeTagImageKeyComparatorClass {
+ public:
+    NativeTagImageKeyComparatorClass(const std::vector<UnicodeString>& foldedKeys)
+        : FoldedKeys(foldedKeys) {
+    }
+
+    bool operator()(int a, int b) const {
+        return FoldedKeys[a] < FoldedKeys[b];
+    }
+
+ private:
+    const std::vector<UnicodeString>& FoldedKeys;
+};
+
+/**
+ * orders hash buckets by their size, largest first
+ */
+class NativeTagImageBucketComparatorClass {
+ public:
+    NativeTagImageBucketComparatorClass(const std::vector<std::vector<int> >& buckets)
+        : Buckets(buckets) {
+    }
+
+    bool operator()(int a, int b) const {
+        return Buckets[a].size() > Buckets[b].size();
+    }
+
+ private:
+    const std::vector<std::vector<int> >& Buckets;
+};
+}  // namespace t4p
+
+/**
+ * builds a perfect hash of the given keys using "hash and displace": keys
+ * are first hashed into buckets, then, starting with the largest bucket,
+ * a displacement is searched for that places all of the keys of the bucket
+ * into free slots.
+ *
+ * @param keys the distinct keys to hash
+ * @param displacements will be filled with the displacement of each bucket;
+ *        zero for empty buckets
+ * @param slots will be filled with the key index of each slot; -1 for
+ *        free slots
+ * @return bool FALSE if a perfect hash could not be found
+ */
+static bool BuildPerfectHash(const std::vector<UnicodeString>& keys, std::vector<int32_t>& displacements,
+                             std::vector<int32_t>& slots) {
+    size_t bucketCount = keys.size() / 4 + 1;
+    size_t slotCount = keys.size() + keys.size() / 4 + 1;
+    std::vector<std::vector<int> > buckets(bucketCount);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        buckets[HashKey(keys[i], 0) % bucketCount].push_back(static_cast<int>(i));
+    }
+    std::vector<int> bucketOrder;
+    for (size_t i = 0; i < bucketCount; ++i) {
+        bucketOrder.push_back(static_cast<int>(i));
+    }
+    t4p::NativeTagImageBucketComparatorClass comparator(buckets);
+    std::stable_sort(bucketOrder.begin(), bucketOrder.end(), comparator);
+
+    displacements.assign(bucketCount, 0);
+    slots.assign(slotCount, -1);
+    std::vector<size_t> bucketSlots;
+    for (size_t i = 0; i < bucketOrder.size(); ++i) {
+        const std::vector<int>& bucket = buckets[bucketOrder[i]];
+        if (bucket.empty()) {
+            // buckets are sorted by size, the rest are empty too
+            break;
+        }
+        bool placed = false;
+        for (uint32_t displacement = 1; !placed && displacement < 100000; ++displacement) {
+            bucketSlots.clear();
+            placed = true;
+            for (size_t j = 0; placed && j < bucket.size(); ++j) {
+                size_t slot = HashKey(keys[bucket[j]], displacement) % slotCount;
+                placed = slots[slot] < 0 && std::find(bucketSlots.begin(), bucketSlots.end(), slot) == bucketSlots.end();
+                bucketSlots.push_back(slot);
+            }
+            if (placed) {
+                displacements[bucketOrder[i]] = static_cast<int32_t>(displacement);
+                for (size_t j = 0; j < bucket.size(); ++j) {
+                    slots[bucketSlots[j]] = bucket[j];
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+t4p::NativeTagImageClass::NativeTagImageClass()
+    : Data(NULL)
+    , Size(0)
+    , Header(NULL)
+    , Tags(NULL)
+    , Traits(NULL)
+    , KeyStrings(NULL)
+    , KeyStarts(NULL)
+    , Displacements(NULL)
+    , Slots(NULL)
+    , StringOffsets(NULL)
+    , Pool(NULL) {
+}
+
+t4p::NativeTagImageClass::~NativeTagImageClass() {
+    Close();
+}
+
+bool t4p::NativeTagImageClass::Write(soci::session& session, const wxFileName& imageFileName, wxString& error) {
+    // the image layout is
+    // header: HEADER_SIZE ints
+    // tags: TAG_COLUMNS ints per tag, sorted by folded key
+    // traits: TRAIT_COLUMNS ints per trait, sorted by folded key
+    // key strings: the string ID of each distinct folded key, sorted
+    // key starts: the position of the first tag of each key, plus the tag count
+    // displacements: the perfect hash displacement of each bucket
+    // slots: the key position of each perfect hash slot, -1 if the slot is free
+    // string offsets: the offset of each string in the pool, plus the pool length
+    // pool: the UTF-16 code units of all of the strings
+    t4p::NativeTagImageStringsClass strings;
+    std::vector<int32_t> tags;
+    std::vector<UnicodeString> foldedKeys;
+    int id;
+    int fileTagId;
+    int sourceId;
+    std::string key;
+    std::string identifier;
+    std::string className;
+    int type;
+    std::string namespaceName;
+    std::string signature;
+    std::string returnType;
+    std::string comment;
+    int isProtected;
+    int isPrivate;
+    int isStatic;
+    int isDynamic;
+    int isNative;
+    int hasVariableArgs;
+    soci::indicator fileTagIdIndicator;
+    std::string sql;
+    sql += "SELECT id, file_item_id, source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args ";
+    sql += "FROM resources";
+    try {
+        soci::statement stmt = (session.prepare << sql,
+                                soci::into(id), soci::into(fileTagId, fileTagIdIndicator), soci::into(sourceId),
+                                soci::into(key), soci::into(identifier), soci::into(className),
+                                soci::into(type), soci::into(namespaceName), soci::into(signature),
+                                soci::into(returnType), soci::into(comment),
+                                soci::into(isProtected), soci::into(isPrivate),
+                                soci::into(isStatic), soci::into(isDynamic), soci::into(isNative), soci::into(hasVariableArgs));
+        if (stmt.execute(true)) {
+            do {
+                UnicodeString uniKey = t4p::CharToIcu(key.c_str());
+                foldedKeys.push_back(FoldKey(uniKey));
+
+                int32_t flags = 0;
+                flags |= isProtected ? FLAG_PROTECTED : 0;
+                flags |= isPrivate ? FLAG_PRIVATE : 0;
+                flags |= isStatic ? FLAG_STATIC : 0;
+                flags |= isDynamic ? FLAG_DYNAMIC : 0;
+                flags |= isNative ? FLAG_NATIVE : 0;
+                flags |= hasVariableArgs ? FLAG_VARIABLE_ARGS : 0;
+
+                tags.push_back(id);
+                tags.push_back(soci::i_ok == fileTagIdIndicator ? fileTagId : -1);
+                tags.push_back(sourceId);
+                tags.push_back(strings.Intern(uniKey));
+                tags.push_back(strings.Intern(t4p::CharToIcu(identifier.c_str())));
+                tags.push_back(strings.Intern(t4p::CharToIcu(className.c_str())));
+                tags.push_back(strings.Intern(t4p::CharToIcu(namespaceName.c_str())));
+                tags.push_back(strings.Intern(t4p::CharToIcu(signature.c_str())));
+                tags.push_back(strings.Intern(t4p::CharToIcu(returnType.c_str())));
+                tags.push_back(strings.Intern(t4p::CharToIcu(comment.c_str())));
+                tags.push_back(type);
+                tags.push_back(flags);
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        error = t4p::CharToWx(e.what());
+        return false;
+    }
+
+    std::vector<int32_t> traits;
+    std::vector<UnicodeString> traitFoldedKeys;
+    std::string traitName;
+    std::string traitNamespaceName;
+    std::string aliases;
+    std::string insteadOfs;
+    try {
+        soci::statement stmt = (session.prepare <<
+                                "SELECT key, trait_name, trait_namespace_name, aliases, instead_ofs FROM trait_resources",
+                                soci::into(key), soci::into(traitName), soci::into(traitNamespaceName),
+                                soci::into(aliases), soci::into(insteadOfs));
+        if (stmt.execute(true)) {
+            do {
+                UnicodeString foldedKey = FoldKey(t4p::CharToIcu(key.c_str()));
+                traitFoldedKeys.push_back(foldedKey);
+                traits.push_back(strings.Intern(foldedKey));
+                traits.push_back(strings.Intern(t4p::CharToIcu(traitName.c_str())));
+                traits.push_back(strings.Intern(t4p::CharToIcu(traitNamespaceName.c_str())));
+                traits.push_back(strings.Intern(t4p::CharToIcu(aliases.c_str())));
+                traits.push_back(strings.Intern(t4p::CharToIcu(insteadOfs.c_str())));
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        error = t4p::CharToWx(e.what());
+        return false;
+    }
+    std::vector<int> traitOrder;
+    for (size_t i = 0; i < traitFoldedKeys.size(); ++i) {
+        traitOrder.push_back(static_cast<int>(i));
+    }
+    t4p::NativeTagImageKeyComparatorClass traitComparator(traitFoldedKeys);
+    std::stable_sort(traitOrder.begin(), traitOrder.end(), traitComparator);
+    std::vector<int32_t> sortedTraits;
+    sortedTraits.reserve(traits.size());
+    for (size_t i = 0; i < traitOrder.size(); ++i) {
+        int row = traitOrder[i];
+        sortedTraits.insert(sortedTraits.end(), traits.begin() + row * TRAIT_COLUMNS, traits.begin() + (row + 1) * TRAIT_COLUMNS);
+    }
+
+    // sort the tags by key and group the tags that have the same key
+    size_t tagCount = foldedKeys.size();
+    std::vector<int> order;
+    for (size_t i = 0; i < tagCount; ++i) {
+        order.push_back(static_cast<int>(i));
+    }
+    t4p::NativeTagImageKeyComparatorClass comparator(foldedKeys);
+    std::stable_sort(order.begin(), order.end(), comparator);
+
+    std::vector<int32_t> sortedTags;
+    std::vector<UnicodeString> keys;
+    std::vector<int32_t> keyStrings;
+    std::vector<int32_t> keyStarts;
+    sortedTags.reserve(tags.size());
+    for (size_t i = 0; i < tagCount; ++i) {
+        int row = order[i];
+        sortedTags.insert(sortedTags.end(), tags.begin() + row * TAG_COLUMNS, tags.begin() + (row + 1) * TAG_COLUMNS);
+        if (keys.empty() || keys.back() != foldedKeys[row]) {
+            keys.push_back(foldedKeys[row]);
+            keyStrings.push_back(strings.Intern(foldedKeys[row]));
+            keyStarts.push_back(static_cast<int32_t>(i));
+        }
+    }
+    keyStarts.push_back(static_cast<int32_t>(tagCount));
+
+    std::vector<int32_t> displacements;
+    std::vector<int32_t> slots;
+    if (!BuildPerfectHash(keys, displacements, slots)) {
+        error = wxT("Could not build a perfect hash of the tag keys");
+        return false;
+    }
+
+    std::vector<int32_t> stringOffsets;
+    std::vector<UChar> pool;
+    for (size_t i = 0; i < strings.Strings.size(); ++i) {
+        const UnicodeString& str = strings.Strings[i];
+        stringOffsets.push_back(static_cast<int32_t>(pool.size()));
+        pool.insert(pool.end(), str.getBuffer(), str.getBuffer() + str.length());
+    }
+    stringOffsets.push_back(static_cast<int32_t>(pool.size()));
+
+    std::vector<int32_t> header(HEADER_SIZE, 0);
+    header[HEADER_MAGIC] = IMAGE_MAGIC;
+    header[HEADER_VERSION] = IMAGE_VERSION;
+    header[HEADER_TAG_COUNT] = static_cast<int32_t>(tagCount);
+    header[HEADER_KEY_COUNT] = static_cast<int32_t>(keys.size());
+    header[HEADER_BUCKET_COUNT] = static_cast<int32_t>(displacements.size());
+    header[HEADER_SLOT_COUNT] = static_cast<int32_t>(slots.size());
+    header[HEADER_STRING_COUNT] = static_cast<int32_t>(strings.Strings.size());
+    header[HEADER_POOL_LENGTH] = static_cast<int32_t>(pool.size());
+    header[HEADER_TRAIT_COUNT] = static_cast<int32_t>(traitOrder.size());
+
+    std::vector<int32_t> ints;
+    ints.insert(ints.end(), header.begin(), header.end());
+    ints.insert(ints.end(), sortedTags.begin(), sortedTags.end());
+    ints.insert(ints.end(), sortedTraits.begin(), sortedTraits.end());
+    ints.insert(ints.end(), keyStrings.begin(), keyStrings.end());
+    ints.insert(ints.end(), keyStarts.begin(), keyStarts.end());
+    ints.insert(ints.end(), displacements.begin(), displacements.end());
+    ints.insert(ints.end(), slots.begin(), slots.end());
+    ints.insert(ints.end(), stringOffsets.begin(), stringOffsets.end());
+
+    wxFFile file;
+    if (!file.Open(imageFileName.GetFullPath(), wxT("wb"))) {
+        error = wxT("Could not open ") + imageFileName.GetFullPath();
+        return false;
+    }
+    bool written = file.Write(&ints[0], ints.size() * sizeof(int32_t)) == ints.size() * sizeof(int32_t);
+    if (written && !pool.empty()) {
+        written = file.Write(&pool[0], pool.size() * sizeof(UChar)) == pool.size() * sizeof(UChar);
+    }
+    written = file.Close() && written;
+    if (!written) {
+        error = wxT("Could not write ") + imageFileName.GetFullPath();
+    }
+    return written;
+}
+
+bool t4p::NativeTagImageClass::Open(const wxFileName& imageFileName) {
+    Close();
+#if defined(__WXMSW__)
+    HANDLE file = ::CreateFileW(imageFileName.GetFullPath().wc_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == file) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = NULL;
+    if (::GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        mapping = ::CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping) {
+        Data = static_cast<char*>(::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        Size = Data ? static_cast<size_t>(fileSize.QuadPart) : 0;
+
+        // the view keeps the mapping alive
+        ::CloseHandle(mapping);
+    }
+    ::CloseHandle(file);
+#else
+    int file = ::open(imageFileName.GetFullPath().fn_str(), O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat fileStat;
+    if (::fstat(file, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* mapped = ::mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, file, 0);
+        if (mapped != MAP_FAILED) {
+            Data = static_cast<char*>(mapped);
+            Size = fileStat.st_size;
+        }
+    }
+
+    // the mapping stays valid after the file is closed
+    ::close(file);
+#endif
+    if (!Data) {
+        return false;
+    }
+
+    // make sure that the image is one that we can read and that
+    // it is not truncated
+    if (Size < HEADER_SIZE * sizeof(int32_t)) {
+        Close();
+        return false;
+    }
+    Header = reinterpret_cast<const int32_t*>(Data);
+    if (Header[HEADER_MAGIC] != IMAGE_MAGIC || Header[HEADER_VERSION] != IMAGE_VERSION) {
+        Close();
+        return false;
+    }
+    for (int i = HEADER_TAG_COUNT; i < HEADER_SIZE; ++i) {
+        if (Header[i] < 0) {
+            Close();
+            return false;
+        }
+    }
+    size_t intCount = HEADER_SIZE
+                      + static_cast<size_t>(Header[HEADER_TAG_COUNT]) * TAG_COLUMNS
+                      + static_cast<size_t>(Header[HEADER_TRAIT_COUNT]) * TRAIT_COLUMNS
+                      + static_cast<size_t>(Header[HEADER_KEY_COUNT]) * 2 + 1
+                      + Header[HEADER_BUCKET_COUNT]
+                      + Header[HEADER_SLOT_COUNT]
+                      + Header[HEADER_STRING_COUNT] + 1;
+    size_t expectedSize = intCount * sizeof(int32_t) + static_cast<size_t>(Header[HEADER_POOL_LENGTH]) * sizeof(UChar);
+    if (expectedSize != Size || Header[HEADER_BUCKET_COUNT] == 0 || Header[HEADER_SLOT_COUNT] == 0) {
+        Close();
+        return false;
+    }
+    Tags = Header + HEADER_SIZE;
+    Traits = Tags + Header[HEADER_TAG_COUNT] * TAG_COLUMNS;
+    KeyStrings = Traits + Header[HEADER_TRAIT_COUNT] * TRAIT_COLUMNS;
+    KeyStarts = KeyStrings + Header[HEADER_KEY_COUNT];
+    Displacements = KeyStarts + Header[HEADER_KEY_COUNT] + 1;
+    Slots = Displacements + Header[HEADER_BUCKET_COUNT];
+    StringOffsets = Slots + Header[HEADER_SLOT_COUNT];
+    Pool = reinterpret_cast<const UChar*>(StringOffsets + Header[HEADER_STRING_COUNT] + 1);
+    return true;
+}
+
+void t4p::NativeTagImageClass::Close() {
+    if (Data) {
+#if defined(__WXMSW__)
+        ::UnmapViewOfFile(Data);
+#else
+        ::munmap(Data, Size);
+#endif
+    }
+    Data = NULL;
+    Size = 0;
+    Header = NULL;
+    Tags = NULL;
+    Traits = NULL;
+    KeyStrings = NULL;
+    KeyStarts = NULL;
+    Displacements = NULL;
+    Slots = NULL;
+    StringOffsets = NULL;
+    Pool = NULL;
+}
+
+bool t4p::NativeTagImageClass::IsOpen() const {
+    return Data != NULL;
+}
+
+size_t t4p::NativeTagImageClass::Count() const {
+    return Header ? Header[HEADER_TAG_COUNT] : 0;
+}
+
+void t4p::NativeTagImageClass::ExactMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) const {
+    if (!IsOpen()) {
+        return;
+    }
+    std::vector<int> rows;
+    if (t4p::TagSearchClass::CLASS_NAME_METHOD_NAME == tagSearch.GetResourceType()) {
+        // check the entire class hierachy
+        std::vector<UnicodeString> classHierarchy = tagSearch.GetParentClasses();
+        std::vector<UnicodeString> traits = tagSearch.GetTraits();
+        classHierarchy.insert(classHierarchy.end(), traits.begin(), traits.end());
+        classHierarchy.push_back(QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName()));
+        for (size_t i = 0; i < classHierarchy.size(); ++i) {
+            UnicodeString key = classHierarchy[i] + UNICODE_STRING_SIMPLE("::") + tagSearch.GetMethodName();
+            Match(key, false, MemberTypes(), false, MATCH_LIMIT, rows);
+        }
+    } else if (t4p::TagSearchClass::NAMESPACE_NAME == tagSearch.GetResourceType()) {
+        UnicodeString key = QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName());
+        Match(key, false, NonMemberTypes(), false, MATCH_LIMIT, rows);
+    } else if (!tagSearch.GetClassName().isEmpty()) {
+        Match(tagSearch.GetClassName(), false, NonMemberTypes(), false, MATCH_LIMIT, rows);
+    } else {
+        Match(tagSearch.GetFileName(), false, NonMemberTypes(), false, MATCH_LIMIT, rows);
+    }
+    AppendMatches(rows, MATCH_LIMIT, matches);
+}
+
+void t4p::NativeTagImageClass::NearMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) const {
+    if (!IsOpen()) {
+        return;
+    }
+    std::vector<int> rows;
+    if (t4p::TagSearchClass::CLASS_NAME_METHOD_NAME == tagSearch.GetResourceType() && !tagSearch.GetClassName().isEmpty()) {
+        if (tagSearch.GetFileItemId()) {
+            // the search is restricted to a single file, native
+            // tags are not in any file
+            return;
+        }
+
+        // check the entire class hierachy
+        std::vector<UnicodeString> classHierarchy = tagSearch.GetParentClasses();
+        if (tagSearch.GetNamespaceName().isEmpty()) {
+            classHierarchy.push_back(tagSearch.GetClassName());
+        } else {
+            classHierarchy.push_back(QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName()));
+        }
+        std::vector<UnicodeString> traits = tagSearch.GetTraits();
+        classHierarchy.insert(classHierarchy.end(), traits.begin(), traits.end());
+        for (size_t i = 0; i < classHierarchy.size(); ++i) {
+            UnicodeString key = classHierarchy[i] + UNICODE_STRING_SIMPLE("::") + tagSearch.GetMethodName();
+            Match(key, true, MemberTypes(), false, MATCH_LIMIT, rows);
+        }
+    } else if (t4p::TagSearchClass::CLASS_NAME_METHOD_NAME == tagSearch.GetResourceType()) {
+        // make sure to NOT get fully qualified  matches (key=identifier)
+        Match(tagSearch.GetMethodName(), true, MemberTypes(), true, MATCH_LIMIT, rows);
+    } else if (t4p::TagSearchClass::NAMESPACE_NAME == tagSearch.GetResourceType()) {
+        // needle identifier contains a namespace operator; but it may be
+        // a namespace or a fully qualified name
+        std::vector<int> types = NonMemberTypes();
+        types.push_back(t4p::PhpTagClass::NAMESPACE);
+        UnicodeString key = QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName());
+        Match(key, true, types, false, MATCH_LIMIT, rows);
+    } else if (!tagSearch.GetClassName().isEmpty()) {
+        // if query does not have a namespace then get the non-namespaced tags
+        UnicodeString key;
+        if (tagSearch.GetNamespaceName().isEmpty()) {
+            key = tagSearch.GetClassName();
+        } else {
+            key = QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName());
+        }
+        Match(key, true, NonMemberTypes(), false, MATCH_LIMIT, rows);
+    } else {
+        Match(tagSearch.GetFileName(), true, NonMemberTypes(), false, MATCH_LIMIT, rows);
+    }
+    AppendMatches(rows, MATCH_LIMIT, matches);
+}
+
+bool t4p::NativeTagImageClass::ParentClassName(const UnicodeString& className, UnicodeString& parentClassName) const {
+    parentClassName.remove();
+    if (!IsOpen()) {
+        return false;
+    }
+    std::vector<int> types;
+    types.push_back(t4p::PhpTagClass::CLASS);
+    std::vector<int> rows;
+    Match(className, false, types, false, 1, rows);
+    if (rows.empty()) {
+        return false;
+    }
+    const int32_t* tag = Tags + rows[0] * TAG_COLUMNS;
+    parentClassName = t4p::ClassGraphClass::ParentClassFromSignature(StringAt(tag[COLUMN_SIGNATURE]));
+    return true;
+}
+
+void t4p::NativeTagImageClass::ClassTraits(const UnicodeString& className, std::vector<UnicodeString>& traits) const {
+    if (!IsOpen()) {
+        return;
+    }
+    std::vector<int> rows;
+    MatchTraits(className, rows);
+    std::vector<UnicodeString> classTraits;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        t4p::TraitTagClass trait = TraitAt(rows[i]);
+        UnicodeString fullyQualifiedTrait = QualifyName(trait.TraitNamespaceName, trait.TraitClassName);
+
+        // trait is used unless there is an explicit insteadof
+        bool match = true;
+        for (size_t j = 0; j < trait.InsteadOfs.size(); ++j) {
+            if (trait.InsteadOfs[j].caseCompare(fullyQualifiedTrait, 0) == 0) {
+                match = false;
+                break;
+            }
+        }
+        if (match) {
+            classTraits.push_back(trait.TraitClassName);
+        }
+    }
+    std::sort(classTraits.begin(), classTraits.end());
+    classTraits.erase(std::unique(classTraits.begin(), classTraits.end()), classTraits.end());
+    traits.insert(traits.end(), classTraits.begin(), classTraits.end());
+}
+
+void t4p::NativeTagImageClass::TraitAliases(const std::vector<UnicodeString>& classNames, const UnicodeString& memberName,
+        bool exactMatch, std::vector<t4p::PhpTagClass>& matches) const {
+    if (!IsOpen()) {
+        return;
+    }
+    std::vector<int> rows;
+    for (size_t i = 0; i < classNames.size(); ++i) {
+        MatchTraits(classNames[i], rows);
+    }
+    UnicodeString lowerMemberName(memberName);
+    lowerMemberName.toLower();
+    for (size_t i = 0; i < rows.size(); ++i) {
+        t4p::TraitTagClass trait = TraitAt(rows[i]);
+        for (size_t a = 0; a < trait.Aliased.size(); ++a) {
+            UnicodeString lowerAlias(trait.Aliased[a]);
+            lowerAlias.toLower();
+            bool useAlias = false;
+            if (exactMatch) {
+                useAlias = lowerMemberName.caseCompare(lowerAlias, 0) == 0;
+            } else {
+                useAlias = memberName.isEmpty() || lowerMemberName.indexOf(lowerAlias) == 0;
+            }
+            if (useAlias) {
+                t4p::PhpTagClass tag;
+                tag.ClassName = trait.TraitClassName;
+                tag.Identifier = trait.Aliased[a];
+                matches.push_back(tag);
+            }
+        }
+    }
+}
+
+void t4p::NativeTagImageClass::Match(const UnicodeString& key, bool isPrefix, const std::vector<int>& types,
+                                     bool identifierIsKey, size_t limit, std::vector<int>& rows) const {
+    UnicodeString foldedKey = FoldKey(key);
+    int keyCount = Header[HEADER_KEY_COUNT];
+    int first = 0;
+    int last = 0;
+    if (!isPrefix) {
+        first = FindKey(foldedKey);
+        if (first < 0) {
+            return;
+        }
+        last = first + 1;
+    } else {
+        // keys are sorted; find the first key that is not less
+        // than the prefix
+        int low = 0;
+        int high = keyCount;
+        while (low < high) {
+            int middle = low + (high - low) / 2;
+            if (StringAt(KeyStrings[middle]) < foldedKey) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        first = low;
+        last = low;
+        while (last < keyCount && StringAt(KeyStrings[last]).startsWith(foldedKey)) {
+            last++;
+        }
+    }
+    size_t found = 0;
+    for (int row = KeyStarts[first]; row < KeyStarts[last]; ++row) {
+        const int32_t* tag = Tags + row * TAG_COLUMNS;
+        if (std::find(types.begin(), types.end(), tag[COLUMN_TYPE]) == types.end()) {
+            continue;
+        }
+        if (identifierIsKey && StringAt(tag[COLUMN_IDENTIFIER]).caseCompare(StringAt(tag[COLUMN_KEY]), U_FOLD_CASE_DEFAULT) != 0) {
+            continue;
+        }
+        rows.push_back(row);
+        found++;
+        if (limit > 0 && found >= limit) {
+            break;
+        }
+    }
+}
+
+int t4p::NativeTagImageClass::FindKey(const UnicodeString& foldedKey) const {
+    if (Header[HEADER_KEY_COUNT] == 0) {
+        return -1;
+    }
+    uint32_t bucket = HashKey(foldedKey, 0) % static_cast<uint32_t>(Header[HEADER_BUCKET_COUNT]);
+    uint32_t displacement = static_cast<uint32_t>(Displacements[bucket]);
+    if (displacement == 0) {
+        return -1;
+    }
+    uint32_t slot = HashKey(foldedKey, displacement) % static_cast<uint32_t>(Header[HEADER_SLOT_COUNT]);
+    int keyIndex = Slots[slot];
+
+    // a key that is not in the image may still hash to a used slot
+    if (keyIndex < 0 || StringAt(KeyStrings[keyIndex]) != foldedKey) {
+        return -1;
+    }
+    return keyIndex;
+}
+
+void t4p::NativeTagImageClass::MatchTraits(const UnicodeString& className, std::vector<int>& rows) const {
+    UnicodeString foldedKey = FoldKey(className);
+
+    // trait records are sorted by key; find the first record that is not
+    // less than the key
+    int low = 0;
+    int high = Header[HEADER_TRAIT_COUNT];
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (StringAt(Traits[middle * TRAIT_COLUMNS + TRAIT_COLUMN_KEY]) < foldedKey) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (int row = low; row < Header[HEADER_TRAIT_COUNT]; ++row) {
+        if (StringAt(Traits[row * TRAIT_COLUMNS + TRAIT_COLUMN_KEY]) != foldedKey) {
+            break;
+        }
+        rows.push_back(row);
+    }
+}
+
+t4p::TraitTagClass t4p::NativeTagImageClass::TraitAt(int row) const {
+    const int32_t* columns = Traits + row * TRAIT_COLUMNS;
+    t4p::TraitTagClass trait;
+    trait.TraitClassName = StringAt(columns[TRAIT_COLUMN_TRAIT_NAME]);
+    trait.TraitNamespaceName = StringAt(columns[TRAIT_COLUMN_TRAIT_NAMESPACE_NAME]);
+    trait.Aliased = SplitList(StringAt(columns[TRAIT_COLUMN_ALIASES]));
+    trait.InsteadOfs = SplitList(StringAt(columns[TRAIT_COLUMN_INSTEAD_OFS]));
+    return trait;
+}
+
+void t4p::NativeTagImageClass::AppendMatches(std::vector<int>& rows, size_t limit, std::vector<t4p::PhpTagClass>& matches) const {
+    // tags are stored in key order; when looking in a class hierarchy,
+    // matches from all classes are sorted together
+    std::stable_sort(rows.begin(), rows.end());
+    for (size_t i = 0; i < rows.size() && (limit == 0 || i < limit); ++i) {
+        matches.push_back(TagAt(rows[i]));
+    }
+}
+
+UnicodeString t4p::NativeTagImageClass::StringAt(int stringId) const {
+    int32_t offset = StringOffsets[stringId];
+    return UnicodeString(false, Pool + offset, StringOffsets[stringId + 1] - offset);
+}
+
+t4p::PhpTagClass t4p::NativeTagImageClass::TagAt(int row) const {
+    const int32_t* columns = Tags + row * TAG_COLUMNS;
+
+    // note that assigning the strings copies them out of the mapped memory
+    t4p::PhpTagClass tag;
+    tag.Id = columns[COLUMN_ID];
+    tag.FileTagId = columns[COLUMN_FILE_TAG_ID];
+    tag.SourceId = columns[COLUMN_SOURCE_ID];
+    tag.Key = StringAt(columns[COLUMN_KEY]);
+    tag.Identifier = StringAt(columns[COLUMN_IDENTIFIER]);
+    tag.ClassName = StringAt(columns[COLUMN_CLASS_NAME]);
+    tag.Type = (t4p::PhpTagClass::Types)columns[COLUMN_TYPE];
+    tag.NamespaceName = StringAt(columns[COLUMN_NAMESPACE_NAME]);
+    tag.Signature = StringAt(columns[COLUMN_SIGNATURE]);
+    tag.ReturnType = StringAt(columns[COLUMN_RETURN_TYPE]);
+    tag.Comment = StringAt(columns[COLUMN_COMMENT]);
+    tag.IsProtected = (columns[COLUMN_FLAGS] & FLAG_PROTECTED) != 0;
+    tag.IsPrivate = (columns[COLUMN_FLAGS] & FLAG_PRIVATE) != 0;
+    tag.IsStatic = (columns[COLUMN_FLAGS] & FLAG_STATIC) != 0;
+    tag.IsDynamic = (columns[COLUMN_FLAGS] & FLAG_DYNAMIC) != 0;
+    tag.IsNative = (columns[COLUMN_FLAGS] & FLAG_NATIVE) != 0;
+    tag.HasVariableArgs = (columns[COLUMN_FLAGS] & FLAG_VARIABLE_ARGS) != 0;
+
+    // native tags are not in any file; same as the LEFT JOIN in the
+    // TagResultClass queries
+    tag.FileIsNew = true;
+    return tag;
+}
+
+/**
+ * the image shared by all threads; opened on first use
+ */
+static wxMutex SharedNativeTagImageMutex;
+static t4p::NativeTagImageClass SharedNativeTagImage;
+static bool IsSharedNativeTagImageChecked = false;
+
+const t4p::NativeTagImageClass* t4p::NativeTagImage() {
+    wxMutexLocker locker(SharedNativeTagImageMutex);
+    if (!IsSharedNativeTagImageChecked) {
+        IsSharedNativeTagImageChecked = true;
+        wxFileName imageFileName = t4p::NativeTagImageAsset();
+        wxFileName dbFileName = t4p::NativeFunctionsAsset();
+
+        // an image older than the db would give out stale tags
+        if (imageFileName.FileExists() && dbFileName.FileExists()
+                && !dbFileName.GetModificationTime().IsLaterThan(imageFileName.GetModificationTime())) {
+            SharedNativeTagImage.Open(imageFileName);
+        }
+    }
+    return SharedNativeTagImage.IsOpen() ? &SharedNativeTagImage : NULL;
+}
@@ -0,0 +1,235 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_NATIVETAGIMAGECLASS_H_
+#define SRC_LANGUAGE_PHP_NATIVETAGIMAGECLASS_H_
+
+#include <soci/soci.h>
+#include <unicode/unistr.h>
+#include <wx/filename.h>
+#include <wx/string.h>
+#include <vector>
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/PhpTagClass.h"
+
+namespace t4p {
+/**
+ * The native tag image is a binary, read-only copy of the native functions
+ * tag db (see NativeFunctionsAsset()). The image is generated at build time
+ * (see the native_tag_image project) and is memory-mapped when it is opened;
+ * lookups are done directly on the mapped memory without going to SQLite.
+ *
+ * The image contains:
+ * - the tags, one fixed-size record per tag, sorted by case folded key
+ * - the distinct case folded keys, along with the range of tags that have
+ *   each key
+ * - a perfect hash of the keys, so that an exact lookup is a hash, a
+ *   displacement and a single key comparison
+ * - the traits used by each class, sorted by case folded key
+ * - the string pool (UTF-16), every string is stored only once
+ *
+ * The image has everything that the TagFinderListClass looks up in the
+ * native functions db (tags, class parents, traits); when the image
+ * exists the native functions db does not need to be opened.
+ *
+ * The image is written in the byte order of the machine that built it; an
+ * image with a different byte order or version is rejected by Open().
+ *
+ * Since the image is never modified after it is opened, a single image can
+ * be used by any number of threads (see NativeTagImage()).
+ */
+class NativeTagImageClass {
+ public:
+    NativeTagImageClass();
+
+    ~NativeTagImageClass();
+
+    /**
+     * Writes all of the tags of the given db into a new image.
+     *
+     * @param session the connection to read the tags from; must be a tag db
+     * @param imageFileName the file to write to, it is overwritten
+     * @param error will be filled with a message when the image could not
+     *        be written
+     * @return bool TRUE if the image was written
+     */
+    static bool Write(soci::session& session, const wxFileName& imageFileName, wxString& error);
+
+    /**
+     * Maps the given image file into memory. Any previously opened image is
+     * closed.
+     *
+     * @param imageFileName the image file; it must have been generated by Write()
+     * @return bool TRUE if the image was opened and is valid
+     */
+    bool Open(const wxFileName& imageFileName);
+
+    /**
+     * Unmaps the image file.
+     */
+    void Close();
+
+    /**
+     * @return bool TRUE if an image was successfully opened
+     */
+    bool IsOpen() const;
+
+    /**
+     * @return the number of tags in the image
+     */
+    size_t Count() const;
+
+    /**
+     * Finds the tags that match the given search exactly. This is the same
+     * as executing the result of TagSearchClass::CreateExactResults() against
+     * the native db. Any matches are appended to the given vector.
+     */
+    void ExactMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) const;
+
+    /**
+     * Finds the tags that begin with the given search. This is the same
+     * as executing the result of TagSearchClass::CreateNearMatchResults() against
+     * the native db. Any matches are appended to the given vector.
+     */
+    void NearMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) const;
+
+    /**
+     * Finds the parent of a class. This is the same as
+     * ParsedTagFinderClass::ParentClassName() against the native db.
+     *
+     * @param className the fully qualified class to look for, case does not matter
+     * @param parentClassName will be set to the parent class, empty
+     *        if the class does not have a parent
+     * @return bool TRUE if the class is in the image
+     */
+    bool ParentClassName(const UnicodeString& className, UnicodeString& parentClassName) const;
+
+    /**
+     * Finds the traits used by a class. This is the same as
+     * ParsedTagFinderClass::GetResourceTraits() against the native db.
+     * Any traits are appended to the given vector.
+     *
+     * @param className the class to look for, case does not matter
+     * @param traits the vector to append to
+     */
+    void ClassTraits(const UnicodeString& className, std::vector<UnicodeString>& traits) const;
+
+    /**
+     * Finds the trait methods that the given classes alias. This is the same as
+     * TraitTagResultClass::MatchesAsTags() against the native db.
+     * Any aliases are appended to the given vector.
+     *
+     * @param classNames the classes to look for, case does not matter
+     * @param memberName the alias to look for
+     * @param exactMatch if TRUE, the alias must be equal to memberName; otherwise
+     *        the alias must begin with memberName
+     * @param matches the vector to append to
+     */
+    void TraitAliases(const std::vector<UnicodeString>& classNames, const UnicodeString& memberName, bool exactMatch,
+                      std::vector<t4p::PhpTagClass>& matches) const;
+
+ private:
+    /**
+     * adds the positions of the tags whose key is equal to key (or begins with key
+     * if isPrefix is TRUE) to rows.
+     *
+     * @param key the key to look for, case does not matter
+     * @param isPrefix if TRUE, tags that begin with key will be matched
+     * @param types only tags of these types will be matched
+     * @param identifierIsKey if TRUE, only tags whose identifier is the same
+     *        as the key will be matched
+     * @param limit the maximum number of positions to add, 0 for no limit
+     * @param rows the vector to append to
+     */
+    void Match(const UnicodeString& key, bool isPrefix, const std::vector<int>& types,
+               bool identifierIsKey, size_t limit, std::vector<int>& rows) const;
+
+    /**
+     * @return the position of the given folded key in the key list, or -1 if
+     *         no tag has the key
+     */
+    int FindKey(const UnicodeString& foldedKey) const;
+
+    /**
+     * @return the trait used by the trait record at the given position
+     */
+    t4p::TraitTagClass TraitAt(int row) const;
+
+    /**
+     * adds the positions of the trait records of the given class to rows.
+     *
+     * @param className the class to look for, case does not matter
+     * @param rows the vector to append to
+     */
+    void MatchTraits(const UnicodeString& className, std::vector<int>& rows) const;
+
+    /**
+     * sorts the given positions by key and appends the tags at those
+     * positions to matches.
+     */
+    void AppendMatches(std::vector<int>& rows, size_t limit, std::vector<t4p::PhpTagClass>& matches) const;
+
+    /**
+     * @return the string with the given ID, the returned string is a
+     *         read-only alias to the mapped memory
+     */
+    UnicodeString StringAt(int stringId) const;
+
+    /**
+     * @return the tag at the given position
+     */
+    t4p::PhpTagClass TagAt(int row) const;
+
+    /**
+     * the mapped image file
+     */
+    char* Data;
+    size_t Size;
+
+    /**
+     * pointers to each of the sections of the image; see Write() for
+     * the layout
+     */
+    const int32_t* Header;
+    const int32_t* Tags;
+    const int32_t* Traits;
+    const int32_t* KeyStrings;
+    const int32_t* KeyStarts;
+    const int32_t* Displacements;
+    const int32_t* Slots;
+    const int32_t* StringOffsets;
+    const UChar* Pool;
+};
+
+/**
+ * @return the image of the native functions tag db. The image is opened
+ *         the first time that this function is called, and it is shared
+ *         by all threads. NULL if the image does not exist or is older than the
+ *         native functions db; in this case the native functions db should be
+ *         used instead.
+ */
+const t4p::NativeTagImageClass* NativeTagImage();
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_NATIVETAGIMAGECLASS_H_
@@ -35,6 +35,7 @@
 #include <vector>
 #include "globals/Errors.h"
 #include "globals/String.h"
+#include "language_php/ClassGraphClass.h"
 #include "language_php/FileTags.h"
 #include "search/FinderClass.h"
 
@@ -153,18 +154,20 @@ class AllTagsResultClass : public TagResultClass {
 };
 
 /**
- * queries for tags by their primary key
+ * queries for tags by their source and primary key; the ids of the tags are
+ * only unique within a source (see TagShardsClass)
  */
 class TagByIdResultClass : public TagResultClass {
  public:
     TagByIdResultClass();
 
-    void Set(int id);
+    void Set(int sourceId, int id);
 
  protected:
     bool DoPrepare(soci::statement& stmt, bool doLimit);
 
  private:
+    int SourceId;
     int Id;
 };
 
@@ -212,7 +215,7 @@ bool t4p::ExactMemberTagResultClass::DoPrepare(soci::statement& stmt,  bool doLi
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s ON (s.source_id = r.source_id) WHERE ";
 
     sql += "key IN (?";
@@ -274,7 +277,7 @@ bool t4p::AllMembersTagResultClass::DoPrepare(soci::statement& stmt,  bool doLim
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s ON(s.source_id = r.source_id) WHERE ";
 
     // not using LIKE operator here, there are way too many situations where it wont use the index
@@ -347,7 +350,7 @@ bool t4p::NearMatchMemberTagResultClass::DoPrepare(soci::statement& stmt,  bool
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s  ON(s.source_id = r.source_id) WHERE ";
 
     // not using LIKE operator here, there are way too many situations where it wont use the index
@@ -425,7 +428,7 @@ bool t4p::ExactNonMemberTagResultClass::DoPrepare(soci::statement& stmt, bool do
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s ON(s.source_id = r.source_id) WHERE ";
     sql += "key = ? AND type IN(?";
     for (size_t i = 1; i < TagTypes.size(); i++) {
@@ -484,7 +487,7 @@ bool t4p::NearMatchNonMemberTagResultClass::DoPrepare(soci::statement& stmt, boo
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s ON(s.source_id = r.source_id) WHERE";
 
     // not using LIKE operator here, there are way too many situations where it wont use the index
@@ -561,7 +564,7 @@ bool t4p::ExactMemberOnlyTagResultClass::DoPrepare(soci::statement& stmt,  bool
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s ON(s.source_id = r.source_id) WHERE ";
 
     // make sure to use the key because it is indexed
@@ -617,7 +620,7 @@ bool t4p::NearMatchMemberOnlyTagResultClass::DoPrepare(soci::statement& stmt, bo
     // case sensitive issues are taken care of by SQLite collation capabilities (so that pdo = PDO)
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) LEFT JOIN sources s ON(s.source_id = r.source_id) WHERE ";
 
     // not using LIKE operator here, there are way too many situations where it wont use the index
@@ -670,7 +673,7 @@ bool t4p::TopLevelTagInFileResultClass::DoPrepare(soci::statement& stmt, bool do
     // tags that don't begin with backslash
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON(r.file_item_id = f.file_item_id) WHERE ";
     sql += "f.full_path = ? AND Type IN(?, ?, ?) AND key NOT LIKE '\\%' ORDER BY key ";
 
@@ -689,7 +692,7 @@ t4p::AllTagsResultClass::AllTagsResultClass()
 bool t4p::AllTagsResultClass::DoPrepare(soci::statement& stmt, bool doLimit) {
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON (f.file_item_id = r.file_item_id)";
 
     stmt.prepare(sql);
@@ -698,22 +701,25 @@ bool t4p::AllTagsResultClass::DoPrepare(soci::statement& stmt, bool doLimit) {
 
 t4p::TagByIdResultClass::TagByIdResultClass()
     : TagResultClass()
+    , SourceId(0)
     , Id(0) {
 }
 
-void t4p::TagByIdResultClass::Set(int id) {
+void t4p::TagByIdResultClass::Set(int sourceId, int id) {
+    SourceId = sourceId;
     Id = id;
 }
 
 bool t4p::TagByIdResultClass::DoPrepare(soci::statement& stmt, bool doLimit) {
     std::string sql;
     sql += "SELECT r.id, r.file_item_id, r.source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, f.full_path, ";
-    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, is_new, r.line_number ";
     sql += "FROM resources r LEFT JOIN file_items f ON (f.file_item_id = r.file_item_id) ";
-    sql += "WHERE r.id = ?";
+    sql += "WHERE r.id = ? AND r.source_id = ?";
 
     stmt.prepare(sql);
     stmt.exchange(soci::use(Id));
+    stmt.exchange(soci::use(SourceId));
     return true;
 }
 
@@ -1393,7 +1399,8 @@ bool t4p::MethodSignatureLookupClass::Found() {
 }
 
 t4p::TagSearchClass::TagSearchClass(UnicodeString resourceQuery)
-    : FileName()
+    : Query(resourceQuery)
+    , FileName()
     , ClassName()
     , MethodName()
     , NamespaceName()
@@ -1543,6 +1550,10 @@ t4p::TagSearchClass::ResourceTypes t4p::TagSearchClass::GetResourceType() const
     return ResourceType;
 }
 
+UnicodeString t4p::TagSearchClass::GetQuery() const {
+    return Query;
+}
+
 UnicodeString t4p::TagSearchClass::GetNamespaceName() const {
     return NamespaceName;
 }
@@ -1702,6 +1713,7 @@ t4p::TagResultClass::TagResultClass()
     , IsNative(false)
     , HasVariableArgs(false)
     , FileIsNew(false)
+    , LineNumber(0)
     , FileTagIdIndicator()
     , FullPathIndicator()
     , FileIsNewIndicator() {
@@ -1729,6 +1741,7 @@ void t4p::TagResultClass::DoBind(soci::statement& stmt) {
         stmt.exchange(soci::into(IsNative));
         stmt.exchange(soci::into(HasVariableArgs));
         stmt.exchange(soci::into(FileIsNew, FileIsNewIndicator));
+        stmt.exchange(soci::into(LineNumber));
     } catch (std::exception& e) {
         error = t4p::CharToWx(e.what());
         wxASSERT_MSG(false, error);
@@ -1763,6 +1776,12 @@ void t4p::TagResultClass::Next() {
     } else {
         Tag.FileIsNew = true;
     }
+    Tag.LineNumber = LineNumber;
+    Fetch();
+}
+
+void t4p::TagResultClass::Next(t4p::CompactTagListClass& tags) {
+    tags.Append(*this);
     Fetch();
 }
 
@@ -1775,12 +1794,28 @@ std::vector<t4p::PhpTagClass> t4p::TagResultClass::Matches() {
     return matches;
 }
 
-bool t4p::ParsedTagFinderClass::GetResourceMatchPosition(const t4p::PhpTagClass& tag, const UnicodeString& text, int32_t& pos,
-        int32_t& length) {
-    size_t start = 0;
-    t4p::FinderClass finder;
-    finder.Mode = FinderClass::REGULAR_EXPRESSION;
+/**
+ * the number of lines before and after a tag's line number to search
+ * in; the line number is that of the token that the parser was on when the
+ * tag was found, a declaration may span more than 1 line
+ */
+static const int DECLARATION_LINE_WINDOW = 2;
 
+/**
+ * @return the regular expression that matches the given class' declaration
+ */
+static UnicodeString ClassHeaderExpression(const UnicodeString& className) {
+    UnicodeString escaped(className);
+    t4p::FinderClass::EscapeRegEx(escaped);
+    return UNICODE_STRING_SIMPLE("\\sclass\\s+") + escaped + UNICODE_STRING_SIMPLE("\\s");
+}
+
+/**
+ * @return the regular expression that matches the given tag's declaration. Note
+ *         that for class members, the expression does not match the class
+ *         so it may match a member of another class.
+ */
+static UnicodeString DeclarationExpression(const t4p::PhpTagClass& tag) {
     UnicodeString className,
                   methodName;
     if (!tag.ClassName.isEmpty()) {
@@ -1793,51 +1828,125 @@ bool t4p::ParsedTagFinderClass::GetResourceMatchPosition(const t4p::PhpTagClass&
         className = tag.Identifier;
         t4p::FinderClass::EscapeRegEx(className);
     }
+    UnicodeString expression;
     switch (tag.Type) {
     case t4p::PhpTagClass::CLASS:
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sclass\\s+") + className + UNICODE_STRING_SIMPLE("\\s");
+        expression = UNICODE_STRING_SIMPLE("\\sclass\\s+") + className + UNICODE_STRING_SIMPLE("\\s");
         break;
     case t4p::PhpTagClass::METHOD:
-        // advance past the class header so that if  a function with the same name exists we will skip it
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sclass\\s+") + className + UNICODE_STRING_SIMPLE("\\s");
-        if (finder.Prepare() && finder.FindNext(text, start)) {
-            finder.GetLastMatch(pos, length);
-        }
-        start = pos + length;
-
         // method may return a reference (&)
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sfunction\\s*(&\\s*)?") + methodName + UNICODE_STRING_SIMPLE("\\s*\\(");
+        expression = UNICODE_STRING_SIMPLE("\\sfunction\\s*(&\\s*)?") + methodName + UNICODE_STRING_SIMPLE("\\s*\\(");
         break;
     case t4p::PhpTagClass::FUNCTION:
 
         // function may return a reference (&)
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sfunction\\s*(&\\s*)?") + className + UNICODE_STRING_SIMPLE("\\s*\\(");
+        expression = UNICODE_STRING_SIMPLE("\\sfunction\\s*(&\\s*)?") + className + UNICODE_STRING_SIMPLE("\\s*\\(");
         break;
     case t4p::PhpTagClass::MEMBER:
-        // advance past the class header so that if  a variable with the same
-        // name exists we will skip it
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sclass\\s+") + className + UNICODE_STRING_SIMPLE("\\s");
-        if (finder.Prepare() && finder.FindNext(text, start)) {
-            finder.GetLastMatch(pos, length);
-        }
-        start = pos + length;
-        finder.Expression = UNICODE_STRING_SIMPLE("\\s((var)|(public)|(protected)|(private)).+") + methodName + UNICODE_STRING_SIMPLE(".*;");
+        expression = UNICODE_STRING_SIMPLE("\\s((var)|(public)|(protected)|(private)).+") + methodName + UNICODE_STRING_SIMPLE(".*;");
         break;
     case t4p::PhpTagClass::DEFINE:
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sdefine\\(\\s*('|\")") + className + UNICODE_STRING_SIMPLE("('|\")");
+        expression = UNICODE_STRING_SIMPLE("\\sdefine\\(\\s*('|\")") + className + UNICODE_STRING_SIMPLE("('|\")");
         break;
     case t4p::PhpTagClass::CLASS_CONSTANT:
-        // advance past the class header so that if  a variable with the
-        // same name exists we will skip it
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sclass\\s+") + className + UNICODE_STRING_SIMPLE("\\s");
+        expression = UNICODE_STRING_SIMPLE("\\sconst\\s+") + methodName + UNICODE_STRING_SIMPLE("\\s*=");
+        break;
+    default:
+        break;
+    }
+    return expression;
+}
+
+/**
+ * searches for the given tag only in the lines around the tag's line number.
+ *
+ * @return bool TRUE if the tag's declaration was found near its line
+ */
+static bool FindDeclarationNearLine(const t4p::PhpTagClass& tag, const UnicodeString& text, int32_t& pos, int32_t& length) {
+    UnicodeString expression = DeclarationExpression(tag);
+    if (expression.isEmpty()) {
+        return false;
+    }
+
+    // find the start of the first line in the window and the end of the last
+    // line in the window. windowStart is the newline before the first line,
+    // since the expressions start by matching a space
+    int firstLine = tag.LineNumber - DECLARATION_LINE_WINDOW;
+    int lastLine = tag.LineNumber + DECLARATION_LINE_WINDOW;
+    int line = 1;
+    int32_t windowStart = 0;
+    int32_t windowEnd = text.length();
+    for (int32_t i = 0; i < text.length(); ++i) {
+        if (text.charAt(i) == '\n') {
+            line++;
+            if (line == firstLine) {
+                windowStart = i;
+            } else if (line > lastLine) {
+                windowEnd = i;
+                break;
+            }
+        }
+    }
+    if (line < firstLine) {
+        // the file is now shorter than when it was parsed
+        return false;
+    }
+    UnicodeString window(text, windowStart, windowEnd - windowStart);
+    t4p::FinderClass finder;
+    finder.Mode = t4p::FinderClass::REGULAR_EXPRESSION;
+    int32_t start = 0;
+    switch (tag.Type) {
+    case t4p::PhpTagClass::METHOD:
+    case t4p::PhpTagClass::MEMBER:
+    case t4p::PhpTagClass::CLASS_CONSTANT:
+        // same as the full text search; when the class header is in the
+        // window advance past it so that a function or variable with the
+        // same name that is before the class is skipped
+        finder.Expression = ClassHeaderExpression(tag.ClassName);
+        if (finder.Prepare() && finder.FindNext(window, 0) && finder.GetLastMatch(pos, length)) {
+            start = pos + length;
+        }
+        break;
+    default:
+        break;
+    }
+    finder.Expression = expression;
+    if (finder.Prepare() && finder.FindNext(window, start) && finder.GetLastMatch(pos, length)) {
+        pos += windowStart;
+        ++pos;  // eat the first space
+        --length;
+        return true;
+    }
+    return false;
+}
+
+bool t4p::ParsedTagFinderClass::GetResourceMatchPosition(const t4p::PhpTagClass& tag, const UnicodeString& text, int32_t& pos,
+        int32_t& length) {
+    // the line number is stored when the file is parsed; if the text has
+    // changed since then the tag may have moved, in which case we
+    // search the entire text
+    if (tag.LineNumber > 0 && FindDeclarationNearLine(tag, text, pos, length)) {
+        return true;
+    }
+    size_t start = 0;
+    t4p::FinderClass finder;
+    finder.Mode = FinderClass::REGULAR_EXPRESSION;
+    switch (tag.Type) {
+    case t4p::PhpTagClass::METHOD:
+    case t4p::PhpTagClass::MEMBER:
+    case t4p::PhpTagClass::CLASS_CONSTANT:
+        // advance past the class header so that if  a function or variable with
+        // the same name exists we will skip it
+        finder.Expression = ClassHeaderExpression(tag.ClassName);
         if (finder.Prepare() && finder.FindNext(text, start)) {
             finder.GetLastMatch(pos, length);
         }
         start = pos + length;
-        finder.Expression = UNICODE_STRING_SIMPLE("\\sconst\\s+") + methodName + UNICODE_STRING_SIMPLE("\\s*=");
+        break;
     default:
         break;
     }
+    finder.Expression = DeclarationExpression(tag);
     if (finder.Prepare() && finder.FindNext(text, start) && finder.GetLastMatch(pos, length)) {
         ++pos;  // eat the first space
         --length;
@@ -2007,30 +2116,7 @@ std::vector<UnicodeString> t4p::ParsedTagFinderClass::GetResourceTraits(const Un
 }
 
 UnicodeString t4p::ParsedTagFinderClass::ExtractParentClassFromSignature(const UnicodeString& signature) const {
-    // look for the parent class. tokenize the signature and get the
-    // class name after the 'extends' keyword note that since the signature is re-constructed by the parser
-    // the parent class is always fully qualified
-    UnicodeString parentClassName;
-    UChar* saveState = NULL;
-    const UChar* delims =  UNICODE_STRING_SIMPLE(" ").getTerminatedBuffer();
-    UChar* sig = new UChar[signature.length() + 1];
-    u_strncpy(sig, signature.getBuffer(), signature.length());
-    sig[signature.length()] = '\0';
-    UChar* next = u_strtok_r(sig, delims, &saveState);
-    if (next) {
-        do {
-            UnicodeString token(next);
-            if (token.caseCompare(UNICODE_STRING_SIMPLE("extends"), 0) == 0) {
-                next = u_strtok_r(NULL, delims, &saveState);
-                if (next) {
-                    parentClassName.setTo(next, u_strlen(next));
-                }
-            }
-            next = u_strtok_r(NULL, delims, &saveState);
-        } while (next != NULL);
-    }
-    delete[] sig;
-    return parentClassName;
+    return t4p::ClassGraphClass::ParentClassFromSignature(signature);
 }
 
 std::vector<t4p::PhpTagClass> t4p::ParsedTagFinderClass::ExactClassOrFile(const t4p::TagSearchClass& tagSearch) {
@@ -2231,6 +2317,23 @@ t4p::ParsedTagFinderClass::ParsedTagFinderClass(soci::session& session)
     : SqliteFinderClass(session) {
 }
 
+bool t4p::ParsedTagFinderClass::InitNativeDb() {
+    // the native db is generated from the PHP docs, it does not have
+    // the columns that only the tag parser writes. temp tables and views
+    // take precedence over the tables of the main db
+    try {
+        Session.once << "CREATE TEMP VIEW IF NOT EXISTS resources AS SELECT *, 0 AS line_number FROM main.resources";
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
 std::vector<t4p::PhpTagClass> t4p::ParsedTagFinderClass::ClassesFunctionsDefines(const wxString& fullPath) {
     std::vector<t4p::PhpTagClass> tags;
     t4p::TopLevelTagInFileResultClass result;
@@ -2251,9 +2354,9 @@ void t4p::ParsedTagFinderClass::Print() {
     }
 }
 
-bool t4p::ParsedTagFinderClass::FindById(int id, t4p::PhpTagClass& tag) {
+bool t4p::ParsedTagFinderClass::FindById(int sourceId, int id, t4p::PhpTagClass& tag) {
     t4p::TagByIdResultClass result;
-    result.Set(id);
+    result.Set(sourceId, id);
     bool found = Exec(&result);
     if (found) {
         result.Next();
@@ -33,6 +33,7 @@
 #include "globals/Sqlite.h"
 #include "globals/SqliteFinderClass.h"
 #include "globals/SqliteResultClass.h"
+#include "language_php/CompactTagListClass.h"
 #include "language_php/PhpTagClass.h"
 
 namespace t4p {
@@ -245,7 +246,21 @@ class TagSearchClass {
      */
     TagSearchClass::ResourceTypes GetResourceType() const;
 
+    /**
+     * Returns the tag string that this search was created with
+     *
+     * @return UnicodeString
+     */
+    UnicodeString GetQuery() const;
+
  private:
+    /**
+     * the tag string given to the constructor
+     *
+     * @var UnicodeString
+     */
+    UnicodeString Query;
+
     /**
      * the file name parsed from tag string
      *
@@ -332,7 +347,21 @@ class TagResultClass : public t4p::SqliteResultClass {
      */
     void Next();
 
+    /**
+     * advance to the next row, appending the row to the given list. The Tag member
+     * variable is NOT set. This is faster than Next() when there are many
+     * rows, since the strings that are repeated across rows are converted only once.
+     *
+     * @param tags the list to append to
+     */
+    void Next(t4p::CompactTagListClass& tags);
+
  protected:
+    /**
+     * the list reads the bound columns directly
+     */
+    friend class t4p::CompactTagListClass;
+
     /**
      * bind the sql columns to the instance variables
      */
@@ -358,6 +387,7 @@ class TagResultClass : public t4p::SqliteResultClass {
     int IsNative;
     int HasVariableArgs;
     int FileIsNew;
+    int LineNumber;
     soci::indicator FileTagIdIndicator,
          FullPathIndicator,
          FileIsNewIndicator;
@@ -1022,6 +1052,16 @@ class ParsedTagFinderClass : public t4p::SqliteFinderClass {
  public:
     ParsedTagFinderClass(soci::session& session);
 
+    /**
+     * Prepares the session for querying the native functions db. The
+     * native functions db does not have all of the columns of the tag
+     * db (line numbers); this creates a temp view that fills them in
+     * with defaults. Must be called once, after the session is opened.
+     *
+     * @return bool TRUE if the view was created
+     */
+    bool InitNativeDb();
+
     /**
      * Gets all classes, functions, and constants (defines) that were parsed from
      * the given file.
@@ -1155,6 +1195,9 @@ class ParsedTagFinderClass : public t4p::SqliteFinderClass {
      * Searches the given text for the position of the given tag.  For example, if the tag matched 3 items
      * and this method is called with index=2, then text will be searched for tag 2 and will return the
      * position of tag 2 in text
+     * When the tag has a line number, only the lines around the line number
+     * are searched; the entire text is searched only when the tag is
+     * not found there (the text changed since the tag was parsed).
      *
      * @param tag the tag match to look for
      * @param UnicodeString text the text to look in
@@ -1167,11 +1210,12 @@ class ParsedTagFinderClass : public t4p::SqliteFinderClass {
     /**
      * retrieves a tag by its ID
      *
+     * @param sourceId the source of the tag, tag IDs are only unique within a source
      * @param id the ID to query for
      * @param tag out parameter, will be filled in with the tag data
      * @return bool TRUE if the ID was found
      */
-    bool FindById(int id, t4p::PhpTagClass& tag);
+    bool FindById(int sourceId, int id, t4p::PhpTagClass& tag);
 
     /**
      * @param int fileTagId file to search for
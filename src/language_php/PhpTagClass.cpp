@@ -43,7 +43,8 @@ t4p::PhpTagClass::PhpTagClass()
     , Key()
     , FullPath()
     , FileTagId(-1)
-    , SourceId(-1) {
+    , SourceId(-1)
+    , LineNumber(0) {
 }
 
 t4p::PhpTagClass::PhpTagClass(const t4p::PhpTagClass& src)
@@ -65,7 +66,8 @@ t4p::PhpTagClass::PhpTagClass(const t4p::PhpTagClass& src)
     , Key()
     , FullPath()
     , FileTagId(-1)
-    , SourceId(-1) {
+    , SourceId(-1)
+    , LineNumber(0) {
     Copy(src);
 }
 
@@ -88,6 +90,7 @@ void t4p::PhpTagClass::Copy(const t4p::PhpTagClass& src) {
     Id = src.Id;
     FileTagId = src.FileTagId;
     SourceId = src.SourceId;
+    LineNumber = src.LineNumber;
     IsProtected = src.IsProtected;
     IsPrivate = src.IsPrivate;
     IsStatic = src.IsStatic;
@@ -120,6 +123,7 @@ void t4p::PhpTagClass::Clear() {
     Type = CLASS;
     FileTagId = -1;
     SourceId = -1;
+    LineNumber = 0;
     FullPath = wxT("");
     Key.remove();
     IsProtected = false;
@@ -180,6 +184,8 @@ t4p::FileTagClass::FileTagClass()
     , DateTime()
     , FileId(0)
     , SourceId(0)
+    , FileSize(0)
+    , ContentHash()
     , IsParsed(false)
     , IsNew(true) {
 }
@@ -204,6 +210,8 @@ void t4p::FileTagClass::MakeNew(const wxFileName& fileName, wxDateTime modTime,
     FullPath = fileName.GetFullPath();
     DateTime = modTime;
     FileId = 0;
+    FileSize = 0;
+    ContentHash = wxT("");
     IsParsed = isParsed;
     IsNew = false;
 }
@@ -169,6 +169,12 @@ class PhpTagClass {
      */
     int SourceId;
 
+    /**
+     * The line (1-based) where this tag was declared, as of the time the
+     * file was parsed. 0 if the line is not known (ie. native or dynamic tags).
+     */
+    int LineNumber;
+
     PhpTagClass();
     PhpTagClass(const t4p::PhpTagClass& src);
 
@@ -312,6 +318,19 @@ class FileTagClass {
      */
     int SourceId;
 
+    /**
+     * the size of the file, in bytes, at the time that it was looked at
+     */
+    long long FileSize;
+
+    /**
+     * hash of the file contents at the time that it was parsed; used
+     * to skip parsing files that were touched but not changed.
+     * Empty when not known.
+     * @see t4p::FileTagContentHash
+     */
+    wxString ContentHash;
+
     /**
      * whether or not file has been parsed, could be false if we only looked for files
      */
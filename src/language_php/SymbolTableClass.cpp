@@ -53,27 +53,27 @@ static UnicodeString VariableName(const pelet::VariableClass& var) {
  * @param isParentCall if TRUE, then tag is visible if the tag is protected, or public
  * @return bool true if tag is visible
  */
-static bool IsResourceVisible(const t4p::PhpTagClass& tag, const pelet::VariableClass& originalParsedVariable,
+static bool IsResourceVisible(const t4p::PhpTagViewClass& tag, const pelet::VariableClass& originalParsedVariable,
                               const pelet::ScopeClass& scope,
                               bool isStaticCall, bool isThisCall, bool isParentCall) {
     bool passesStaticCheck = true;
     if (isStaticCall) {
         // only static methods can be accessed with the '::' operator
-        passesStaticCheck = t4p::PhpTagClass::CLASS_CONSTANT == tag.Type || tag.IsStatic;
+        passesStaticCheck = t4p::PhpTagClass::CLASS_CONSTANT == tag.Type() || tag.IsStatic();
     } else {
         // static methods can be accessed via the -> operator
-        passesStaticCheck = t4p::PhpTagClass::CLASS_CONSTANT != tag.Type;
+        passesStaticCheck = t4p::PhpTagClass::CLASS_CONSTANT != tag.Type();
     }
 
     // $this => can access this tag's private, parent's protected/public, other public
     // parent => can access parent's protected/public
     // neither => can only access public
-    bool passesVisibilityCheck = !tag.IsPrivate && !tag.IsProtected;
+    bool passesVisibilityCheck = !tag.IsPrivate() && !tag.IsProtected();
     if (!passesVisibilityCheck && isParentCall) {
         // this check assumes that the tag finder has traversed the inheritance chain
         // properly. then, by a process of elimination, if the tag class is not
         // the symbol then we only show protected/public resources
-        passesVisibilityCheck = tag.IsProtected;
+        passesVisibilityCheck = tag.IsProtected();
     } else if (!passesVisibilityCheck) {
         // not checking isThisCalled
         passesVisibilityCheck = isThisCall;
@@ -85,7 +85,7 @@ static bool IsResourceVisible(const t4p::PhpTagClass& tag, const pelet::Variable
     bool passesNamespaceCheck = true;
     UnicodeString name = VariableName(originalParsedVariable);
     if (!name.startsWith(UNICODE_STRING_SIMPLE("$")) && !name.startsWith(UNICODE_STRING_SIMPLE("\\"))
-            && t4p::PhpTagClass::CLASS == tag.Type) {
+            && t4p::PhpTagClass::CLASS == tag.Type()) {
         // if the tag is a global class and the current namespace is NOT the global namespace,
         // then the class cannot be accessed
         // this assumes that tag finder was successful
@@ -196,14 +196,14 @@ static UnicodeString ResolveVariableType(const pelet::ScopeClass& variableScope,
                 pelet::VariableClass parsedVariable(peletScope);
 
                 parsedVariable.ChainList = symbol.ChainList;
-                std::vector<t4p::PhpTagClass> resourceMatches;
+                t4p::CompactTagListClass resourceMatches;
                 symbolTable.ResourceMatches(parsedVariable, variableScope, sourceDirs,
                                             tagFinderList, resourceMatches, doDuckTyping, false, error);
-                if (!resourceMatches.empty()) {
-                    if (t4p::PhpTagClass::CLASS == resourceMatches[0].Type) {
-                        type = resourceMatches[0].ClassName;
+                if (!resourceMatches.Empty()) {
+                    if (t4p::PhpTagClass::CLASS == resourceMatches.Type(0)) {
+                        type = resourceMatches.ClassName(0);
                     } else {
-                        type =  resourceMatches[0].ReturnType;
+                        type =  resourceMatches.ReturnType(0);
                     }
                 }
             }
@@ -304,6 +304,65 @@ static UnicodeString ScopeStringAnonymousFunction(const UnicodeString& methodNam
     return functionName;
 }
 
+/**
+ * finds the edited range between 2 revisions of code by skipping the common
+ * prefix and suffix of both revisions. this is much cheaper than parsing
+ *
+ * @param previousCode the previous revision
+ * @param code the new revision
+ * @param prefix will be filled with the length of the common prefix
+ * @param suffix will be filled with the length of the common suffix; the suffix
+ *        never overlaps the prefix
+ */
+static void EditedRange(const UnicodeString& previousCode, const UnicodeString& code,
+                        int32_t& prefix, int32_t& suffix) {
+    int32_t previousLength = previousCode.length();
+    int32_t length = code.length();
+    int32_t commonLength = std::min(previousLength, length);
+    const UChar* previousBuffer = previousCode.getBuffer();
+    const UChar* buffer = code.getBuffer();
+    prefix = 0;
+    while (prefix < commonLength && previousBuffer[prefix] == buffer[prefix]) {
+        prefix++;
+    }
+    suffix = 0;
+    while (suffix < (commonLength - prefix)
+            && previousBuffer[previousLength - 1 - suffix] == buffer[length - 1 - suffix]) {
+        suffix++;
+    }
+}
+
+/**
+ * @return TRUE if the given text may change the function structure of
+ *         the code it was inserted into / removed from; ie. it opens or closes
+ *         a block, declares a function, or starts a string or comment that could
+ *         swallow a closing brace.
+ */
+static bool ChangesScopeStructure(const UnicodeString& text) {
+    if (text.indexOf('{') >= 0 || text.indexOf('}') >= 0
+            || text.indexOf('\'') >= 0 || text.indexOf('"') >= 0
+            || text.indexOf('#') >= 0 || text.indexOf('/') >= 0
+            || text.indexOf('*') >= 0 || text.indexOf('?') >= 0
+            || text.indexOf('<') >= 0) {
+        return true;
+    }
+    UnicodeString folded(text);
+    folded.foldCase();
+    return folded.indexOf(UNICODE_STRING_SIMPLE("function")) >= 0;
+}
+
+static bool IsBeforeScope(int pos, const t4p::ScopePositionClass& scope) {
+    return pos < scope.StartingPos;
+}
+
+static bool IsScopeStartLess(const t4p::ScopePositionClass& a, const t4p::ScopePositionClass& b) {
+    return a.StartingPos < b.StartingPos;
+}
+
+static bool IsNamespaceStartLess(const t4p::NamespacePositionClass& a, const t4p::NamespacePositionClass& b) {
+    return a.StartingPos < b.StartingPos;
+}
+
 t4p::SymbolTableMatchErrorClass::SymbolTableMatchErrorClass()
     : ErrorLexeme()
     , ErrorClass()
@@ -363,11 +422,95 @@ void t4p::SymbolTableMatchErrorClass::ToUnknownResource(const pelet::VariableCla
     }
 }
 
+namespace t4p {
+/**
+ * the symbols of a SymbolScopeClass, shared among the copies of the scope
+ */
+class SymbolScopeDataClass : public t4p::SharedDataClass {
+ public:
+    std::vector<t4p::SymbolClass> Symbols;
+
+    SymbolScopeDataClass()
+        : SharedDataClass()
+        , Symbols() {
+    }
+
+    /**
+     * copies the symbols of src, the new data is not shared
+     */
+    explicit SymbolScopeDataClass(const t4p::SymbolScopeDataClass& src)
+        : SharedDataClass()
+        , Symbols(src.Symbols) {
+    }
+
+ private:
+    // not assignable
+    void operator=(const t4p::SymbolScopeDataClass&);
+};
+
+/**
+ * the data of a SymbolTableClass, shared among the copies of the table
+ */
+class SymbolTableDataClass : public t4p::SharedDataClass {
+ public:
+    /**
+     * Holds all variables for the currently parsed piece of code. Each item will represent its own scope.
+     * The key will be the scope name.  The scope name is a combination of the class, method name.
+     * The scope string is that which is returned by ScopeString() method.
+     * The value is the parsed Symbols.
+     */
+    std::map<UnicodeString, t4p::SymbolScopeClass, UnicodeStringComparatorClass> Variables;
+
+    /**
+     * The positions of all functions and methods found in the last parsed code, in the
+     * order that the parser found them.
+     */
+    std::vector<t4p::ScopePositionClass> ScopePositions;
+
+    /**
+     * The positions of all namespace declarations and "use" statements found
+     * in the last parsed code, in the order that the parser found them.
+     */
+    std::vector<t4p::NamespacePositionClass> NamespacePositions;
+
+    /**
+     * The code that the symbols were built from. This is only set when the code
+     * was valid (no syntax errors); it is used by UpdateSymbols() to find out
+     * what changed between revisions.
+     */
+    UnicodeString Code;
+
+    SymbolTableDataClass()
+        : SharedDataClass()
+        , Variables()
+        , ScopePositions()
+        , NamespacePositions()
+        , Code() {
+    }
+
+    /**
+     * copies the table of src, the new data is not shared. The scopes
+     * are still shared with src, they are copied when they are modified.
+     */
+    explicit SymbolTableDataClass(const t4p::SymbolTableDataClass& src)
+        : SharedDataClass()
+        , Variables(src.Variables)
+        , ScopePositions(src.ScopePositions)
+        , NamespacePositions(src.NamespacePositions)
+        , Code(src.Code) {
+    }
+
+ private:
+    // not assignable
+    void operator=(const t4p::SymbolTableDataClass&);
+};
+}  // namespace t4p
+
 t4p::SymbolTableClass::SymbolTableClass()
     : AnyExpressionObserverClass()
     , Parser()
     , Lexer()
-    , Variables() {
+    , Data(new t4p::SymbolTableDataClass()) {
     Parser.SetClassObserver(this);
     Parser.SetClassMemberObserver(this);
     Parser.SetFunctionObserver(this);
@@ -375,8 +518,15 @@ t4p::SymbolTableClass::SymbolTableClass()
     Parser.SetExpressionObserver(this);
 }
 
+t4p::SymbolTableClass::~SymbolTableClass() {
+}
+
 void t4p::SymbolTableClass::Copy(const t4p::SymbolTableClass& src) {
-    Variables = src.Variables;
+    Data = src.Data;
+}
+
+void t4p::SymbolTableClass::Reset() {
+    Data.Reset(new t4p::SymbolTableDataClass());
 }
 
 void t4p::SymbolTableClass::DefineDeclarationFound(const UnicodeString& namespaceName, const UnicodeString& variableName,
@@ -537,20 +687,173 @@ void t4p::SymbolTableClass::OnAnyExpression(pelet::ExpressionClass* expr) {
 }
 
 bool t4p::SymbolTableClass::CreateSymbols(const UnicodeString& code, const t4p::SymbolTableClass& previousSymbolTable) {
-    Variables.clear();
+    Reset();
 
     // if the given code has a syntax error, use a naive algorithm as fallback
     // that way we show results to the user if at all possible
     pelet::LintResultsClass results;
     bool good = Parser.ScanString(code, results);
-    if (!good && Lexer.OpenString(code)) {
+    if (good) {
+        Data->Code = code;
+    } else if (Lexer.OpenString(code)) {
         CreateSymbolsFromTokens(previousSymbolTable);
     }
     return good;
 }
 
+bool t4p::SymbolTableClass::UpdateSymbols(const UnicodeString& code, const t4p::SymbolTableClass& previousSymbolTable) {
+    if (!previousSymbolTable.Data->Code.isEmpty() && previousSymbolTable.Data->Code == code) {
+        Copy(previousSymbolTable);
+        return true;
+    }
+    UnicodeString skeleton;
+    UnicodeString editedScope;
+    std::vector<UnicodeString> skippedScopes;
+    if (!SkeletonCode(code, previousSymbolTable, skeleton, editedScope, skippedScopes)) {
+        return CreateSymbols(code, previousSymbolTable);
+    }
+    Reset();
+
+    // the skeleton contains everything except the bodies of the functions
+    // that were not edited. if it has a syntax error we let CreateSymbols
+    // figure out the proper fallback
+    pelet::LintResultsClass results;
+    if (!Parser.ScanString(skeleton, results)) {
+        return CreateSymbols(code, previousSymbolTable);
+    }
+
+    // splice the new symbols into the previous ones:
+    // the skipped functions keep their previous symbols, since the
+    // skeleton only has their $this/predefined variables.
+    // the edited function (and its closures) get the new symbols; the closures
+    // are removed first in case the edit deleted one of them.
+    // the previous scopes are shared with the previous table, not copied
+    std::map<UnicodeString, t4p::SymbolScopeClass, UnicodeStringComparatorClass> parsedVariables;
+    parsedVariables.swap(Data->Variables);
+    Data->Variables = previousSymbolTable.Data->Variables;
+
+    UnicodeString closurePrefix = editedScope + UNICODE_STRING_SIMPLE("@@");
+    std::map<UnicodeString, t4p::SymbolScopeClass, UnicodeStringComparatorClass>::iterator it = Data->Variables.begin();
+    while (it != Data->Variables.end()) {
+        if (it->first == editedScope || it->first.startsWith(closurePrefix)) {
+            Data->Variables.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    UnicodeString globalScope = ScopeString(UNICODE_STRING_SIMPLE(""), UNICODE_STRING_SIMPLE(""));
+    for (it = parsedVariables.begin(); it != parsedVariables.end(); ++it) {
+        if (std::find(skippedScopes.begin(), skippedScopes.end(), it->first) != skippedScopes.end()) {
+            continue;
+        }
+        if (it->first == globalScope) {
+            // global code was not edited, but the edited function may
+            // have defined new constants. only copy the global scope
+            // when there is a new constant
+            t4p::SymbolScopeClass& globals = Data->Variables[globalScope];
+            const std::vector<t4p::SymbolClass>& parsedGlobals = it->second.GetSymbols();
+            for (size_t i = 0; i < parsedGlobals.size(); ++i) {
+                const std::vector<t4p::SymbolClass>& globalSymbols = globals.GetSymbols();
+                bool found = false;
+                for (size_t j = 0; j < globalSymbols.size() && !found; ++j) {
+                    found = globalSymbols[j].Variable == parsedGlobals[i].Variable;
+                }
+                if (!found) {
+                    globals.EditSymbols().push_back(parsedGlobals[i]);
+                }
+            }
+        } else {
+            Data->Variables[it->first] = it->second;
+        }
+    }
+    Data->Code = code;
+    return true;
+}
+
+bool t4p::SymbolTableClass::SkeletonCode(const UnicodeString& code, const t4p::SymbolTableClass& previousSymbolTable,
+        UnicodeString& skeleton, UnicodeString& editedScope, std::vector<UnicodeString>& skippedScopes) const {
+    const UnicodeString& previousCode = previousSymbolTable.Data->Code;
+    if (previousCode.isEmpty() || code.isEmpty() || previousSymbolTable.Data->ScopePositions.empty()) {
+        return false;
+    }
+    int32_t previousLength = previousCode.length();
+    int32_t length = code.length();
+    int32_t prefix = 0;
+    int32_t suffix = 0;
+    EditedRange(previousCode, code, prefix, suffix);
+    int32_t previousEditEnd = previousLength - suffix;
+    int32_t delta = length - previousLength;
+
+    // the edited function is the outermost function that contains
+    // the entire edited range
+    const std::vector<t4p::ScopePositionClass>& positions = previousSymbolTable.Data->ScopePositions;
+    int edited = -1;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (positions[i].StartingPos < prefix && previousEditEnd <= positions[i].EndingPos
+                && (edited < 0 || positions[i].StartingPos < positions[edited].StartingPos)) {
+            edited = i;
+        }
+    }
+    if (edited < 0) {
+        return false;
+    }
+    editedScope = ScopeString(positions[edited].ClassName, positions[edited].MethodName);
+
+    skeleton = code;
+    int32_t skeletonLength = skeleton.length();
+    UChar* skeletonBuffer = skeleton.getBuffer(skeletonLength);
+    bool isolated = true;
+    for (size_t i = 0; i < positions.size() && isolated; ++i) {
+        int32_t start = positions[i].StartingPos;
+        int32_t end = positions[i].EndingPos;
+        if (start >= positions[edited].StartingPos && end <= positions[edited].EndingPos) {
+            // the edited function or a function nested inside it
+            continue;
+        }
+        if (start >= previousEditEnd) {
+            start += delta;
+            end += delta;
+        } else if (end >= prefix) {
+            // overlaps the edit but does not contain it
+            isolated = false;
+            break;
+        }
+        UnicodeString scopeString = ScopeString(positions[i].ClassName, positions[i].MethodName);
+        if (scopeString == editedScope) {
+            // 2 functions with the same name (conditional declarations);
+            // their symbols are stored together so we cannot splice them
+            isolated = false;
+            break;
+        }
+
+        // blank out the text between the braces of the body; keep new lines
+        // so that line numbers stay intact
+        int32_t openBrace = start;
+        while (openBrace < end && skeletonBuffer[openBrace] != '{') {
+            openBrace++;
+        }
+        int32_t closeBrace = end;
+        if (closeBrace >= skeletonLength || skeletonBuffer[closeBrace] != '}') {
+            closeBrace--;
+        }
+        if (openBrace >= closeBrace || closeBrace >= skeletonLength || skeletonBuffer[closeBrace] != '}') {
+            // abstract method; nothing to skip
+            continue;
+        }
+        for (int32_t j = openBrace + 1; j < closeBrace; ++j) {
+            if (skeletonBuffer[j] != '\n' && skeletonBuffer[j] != '\r') {
+                skeletonBuffer[j] = ' ';
+            }
+        }
+        skippedScopes.push_back(scopeString);
+    }
+    skeleton.releaseBuffer(skeletonLength);
+    return isolated;
+}
+
 bool t4p::SymbolTableClass::CreateSymbolsFromFile(const wxString& fileName, const t4p::SymbolTableClass& previousSymbolTable) {
-    Variables.clear();
+    Reset();
 
     // for now ignore parse errors
     pelet::LintResultsClass results;
@@ -572,8 +875,10 @@ bool t4p::SymbolTableClass::CreateSymbolsFromFile(const wxString& fileName, cons
 }
 
 void t4p::SymbolTableClass::CreateSymbolsFromTokens(const t4p::SymbolTableClass& previousSymbolTable) {
-    Variables.clear();
-    Variables = previousSymbolTable.Variables;
+    // the previous scopes are shared; only the scopes that get new
+    // variables are copied
+    Data.Detach();
+    Data->Variables = previousSymbolTable.Data->Variables;
 
     UnicodeString currentClass;
     UnicodeString currentMethod;
@@ -642,11 +947,27 @@ void t4p::SymbolTableClass::ExpressionCompletionMatches(pelet::VariableClass par
         std::vector<t4p::PhpTagClass>& autoCompleteResourceList,
         bool doDuckTyping,
         t4p::SymbolTableMatchErrorClass& error) const {
+    t4p::CompactTagListClass resourceList;
+    ExpressionCompletionMatches(parsedVariable, variableScope, sourceDirs, tagFinderList,
+                                autoCompleteVariableList, resourceList, doDuckTyping, error);
+    for (size_t i = 0; i < resourceList.Size(); ++i) {
+        autoCompleteResourceList.push_back(resourceList.Tag(i));
+    }
+}
+
+void t4p::SymbolTableClass::ExpressionCompletionMatches(pelet::VariableClass parsedVariable,
+        const pelet::ScopeClass& variableScope,
+        const std::vector<wxFileName>& sourceDirs,
+        t4p::TagFinderListClass& tagFinderList,
+        std::vector<UnicodeString>& autoCompleteVariableList,
+        t4p::CompactTagListClass& autoCompleteResourceList,
+        bool doDuckTyping,
+        t4p::SymbolTableMatchErrorClass& error) const {
     if (parsedVariable.ChainList.size() == 1 && VariableName(parsedVariable).startsWith(UNICODE_STRING_SIMPLE("$"))) {
         // if expression does not have more than one chained called AND it starts with a '$' then we want to match (local)
         // variables. This is just a SymbolTable search.
-        std::vector<t4p::SymbolClass> scopeSymbols;
-        std::map<UnicodeString, std::vector<t4p::SymbolClass>, t4p::UnicodeStringComparatorClass>::const_iterator it;
+        t4p::SymbolScopeClass scope;
+        std::map<UnicodeString, t4p::SymbolScopeClass, t4p::UnicodeStringComparatorClass>::const_iterator it;
 
         // if the scope that we are looking for is an anonymous function, take that into account
         UnicodeString scopeString;
@@ -655,10 +976,11 @@ void t4p::SymbolTableClass::ExpressionCompletionMatches(pelet::VariableClass par
             functionName = ScopeStringAnonymousFunction(variableScope.MethodName, variableScope.GetAnonymousFunctionCount());
         }
         scopeString = ScopeString(variableScope.ClassName, functionName);
-        it = Variables.find(scopeString);
-        if (it != Variables.end()) {
-            scopeSymbols = it->second;
+        it = Data->Variables.find(scopeString);
+        if (it != Data->Variables.end()) {
+            scope = it->second;
         }
+        const std::vector<t4p::SymbolClass>& scopeSymbols = scope.GetSymbols();
         for (size_t i = 0; i < scopeSymbols.size(); ++i) {
             if (scopeSymbols[i].Variable.startsWith(VariableName(parsedVariable))) {
                 autoCompleteVariableList.push_back(scopeSymbols[i].Variable);
@@ -678,7 +1000,22 @@ void t4p::SymbolTableClass::ResourceMatches(pelet::VariableClass parsedVariable,
         std::vector<t4p::PhpTagClass>& resourceMatches,
         bool doDuckTyping, bool doFullyQualifiedMatchOnly,
         t4p::SymbolTableMatchErrorClass& error) const {
-    std::vector<t4p::SymbolClass> scopeSymbols;
+    t4p::CompactTagListClass matches;
+    ResourceMatches(parsedVariable, variableScope, sourceDirs, tagFinderList,
+                    matches, doDuckTyping, doFullyQualifiedMatchOnly, error);
+    for (size_t i = 0; i < matches.Size(); ++i) {
+        resourceMatches.push_back(matches.Tag(i));
+    }
+}
+
+void t4p::SymbolTableClass::ResourceMatches(pelet::VariableClass parsedVariable,
+        const pelet::ScopeClass& variableScope,
+        const std::vector<wxFileName>& sourceDirs,
+        t4p::TagFinderListClass& tagFinderList,
+        t4p::CompactTagListClass& resourceMatches,
+        bool doDuckTyping, bool doFullyQualifiedMatchOnly,
+        t4p::SymbolTableMatchErrorClass& error) const {
+    t4p::SymbolScopeClass scope;
 
     // if the scope that we are looking for is an anonymous function, take that into account
     UnicodeString scopeString;
@@ -688,11 +1025,12 @@ void t4p::SymbolTableClass::ResourceMatches(pelet::VariableClass parsedVariable,
     }
     scopeString = ScopeString(variableScope.ClassName, functionName);
 
-    std::map<UnicodeString, std::vector<t4p::SymbolClass>, UnicodeStringComparatorClass>::const_iterator it =
-        Variables.find(scopeString);
-    if (it != Variables.end()) {
-        scopeSymbols = it->second;
+    std::map<UnicodeString, t4p::SymbolScopeClass, UnicodeStringComparatorClass>::const_iterator it =
+        Data->Variables.find(scopeString);
+    if (it != Data->Variables.end()) {
+        scope = it->second;
     }
+    const std::vector<t4p::SymbolClass>& scopeSymbols = scope.GetSymbols();
 
     // take care of the 'use' namespace importing
     pelet::VariableClass originalVariable = parsedVariable;
@@ -751,7 +1089,9 @@ void t4p::SymbolTableClass::ResourceMatches(pelet::VariableClass parsedVariable,
         tagSearch.SetTraits(tagFinderList.ClassUsedTraits(tagSearch.GetClassName(), tagSearch.GetParentClasses(), tagSearch.GetMethodName(), sourceDirs));
 
         // only do duck typing if needed. otherwise, make sure that we have a type match first.
-        std::vector<t4p::PhpTagClass> matches;
+        // the matches are read straight into a compact list, near matches can be
+        // thousands of tags
+        t4p::CompactTagListClass matches;
         if (doDuckTyping || !typeToLookup.isEmpty()) {
             if (doFullyQualifiedMatchOnly) {
                 tagFinderList.ExactMatchesFromAll(tagSearch, matches, sourceDirs);
@@ -760,17 +1100,20 @@ void t4p::SymbolTableClass::ResourceMatches(pelet::VariableClass parsedVariable,
                 tagFinderList.NearMatchesFromAll(tagSearch, matches, sourceDirs);
                 tagFinderList.NearMatchTraitAliasesFromAll(tagSearch, matches);
             }
-            std::sort(matches.begin(), matches.end());
+            matches.Sort();
         }
 
         // now we loop through the possbile matches and remove stuff that does not
         // make sense because of visibility rules
-        for (size_t i = 0; i < matches.size(); ++i) {
-            t4p::PhpTagClass tag = matches[i];
+        for (size_t i = 0; i < matches.Size(); ++i) {
+            t4p::PhpTagViewClass tag = matches.View(i);
             bool isVisible = IsResourceVisible(tag, originalVariable, variableScope, isStaticCall, isThisCall, isParentCall);
             if (isVisible) {
-                UnresolveNamespaceAlias(originalVariable, variableScope, tag);
-                resourceMatches.push_back(tag);
+                resourceMatches.Append(matches, i);
+                UnicodeString identifier = UnresolveNamespaceAlias(originalVariable, variableScope, tag.Identifier());
+                if (identifier != tag.Identifier()) {
+                    resourceMatches.SetIdentifier(resourceMatches.Size() - 1, identifier);
+                }
             } else if (!isVisible) {
                 visibilityError = true;
             }
@@ -778,27 +1121,29 @@ void t4p::SymbolTableClass::ResourceMatches(pelet::VariableClass parsedVariable,
     }
 
     // don't overwrite a previous error (PRIMITIVE_ERROR, etc...)
-    if (!error.HasError() && visibilityError && resourceMatches.empty()) {
+    if (!error.HasError() && visibilityError && resourceMatches.Empty()) {
         error.ToVisibility(parsedVariable, typeToLookup);
-    } else if (!error.HasError() && resourceMatches.empty()) {
+    } else if (!error.HasError() && resourceMatches.Empty()) {
         error.ToUnknownResource(parsedVariable, typeToLookup);
     }
 }
 
 std::vector<t4p::SymbolClass>& t4p::SymbolTableClass::GetScope(const UnicodeString& className,
         const UnicodeString& methodName) {
+    Data.Detach();
     UnicodeString scopeString = ScopeString(className , methodName);
-    if (Variables[scopeString].empty()) {
-        CreatePredefinedVariables(Variables[scopeString]);
+    std::vector<t4p::SymbolClass>& symbols = Data->Variables[scopeString].EditSymbols();
+    if (symbols.empty()) {
+        CreatePredefinedVariables(symbols);
     }
-    return Variables[scopeString];
+    return symbols;
 }
 
 void t4p::SymbolTableClass::Print() const {
     UFILE *out = u_finit(stdout, NULL, NULL);
-    std::map<UnicodeString, std::vector<t4p::SymbolClass>, UnicodeStringComparatorClass>::const_iterator it;
-    for (it = Variables.begin(); it != Variables.end(); ++it) {
-        std::vector<t4p::SymbolClass> scopedSymbols = it->second;
+    std::map<UnicodeString, t4p::SymbolScopeClass, UnicodeStringComparatorClass>::const_iterator it;
+    for (it = Data->Variables.begin(); it != Data->Variables.end(); ++it) {
+        const std::vector<t4p::SymbolClass>& scopedSymbols = it->second.GetSymbols();
         UnicodeString s = it->first;
         u_fprintf(out, "Symbol Table For %S\n", s.getTerminatedBuffer());
         for (size_t j = 0; j < scopedSymbols.size(); ++j) {
@@ -872,8 +1217,9 @@ void t4p::SymbolTableClass::ResolveNamespaceAlias(pelet::VariableClass& parsedVa
     }
 }
 
-void t4p::SymbolTableClass::UnresolveNamespaceAlias(const pelet::VariableClass& originalVariable, const pelet::ScopeClass& scope, t4p::PhpTagClass& tag) const {
-    UnicodeString name = tag.Identifier;
+UnicodeString t4p::SymbolTableClass::UnresolveNamespaceAlias(const pelet::VariableClass& originalVariable, const pelet::ScopeClass& scope,
+        const UnicodeString& identifier) const {
+    UnicodeString name = identifier;
 
     // leave variables and fully qualified names alone
     UnicodeString originalName = VariableName(originalVariable);
@@ -892,11 +1238,67 @@ void t4p::SymbolTableClass::UnresolveNamespaceAlias(const pelet::VariableClass&
             if (name.startsWith(qualified)) {
                 UnicodeString afterQualified(name, it->second.length());
                 name = it->first + afterQualified;
-                tag.Identifier = name;
                 break;
             }
         }
     }
+    return name;
+}
+
+void t4p::SymbolTableClass::MethodScope(const UnicodeString& namespaceName, const UnicodeString& className,
+        const UnicodeString& methodName, int startingPos, int endingPos) {
+    t4p::ScopePositionClass position;
+    position.NamespaceName = namespaceName;
+    position.ClassName = className;
+    position.MethodName = methodName;
+    position.StartingPos = startingPos;
+    position.EndingPos = endingPos;
+    Data.Detach();
+    Data->ScopePositions.push_back(position);
+}
+
+void t4p::SymbolTableClass::FunctionScope(const UnicodeString& namespaceName, const UnicodeString& functionName,
+        int startingPos, int endingPos) {
+    t4p::ScopePositionClass position;
+    position.NamespaceName = namespaceName;
+    position.MethodName = functionName;
+    position.StartingPos = startingPos;
+    position.EndingPos = endingPos;
+    Data.Detach();
+    Data->ScopePositions.push_back(position);
+}
+
+void t4p::SymbolTableClass::NamespaceDeclarationFound(const UnicodeString& namespaceName, int startingPos) {
+    t4p::NamespacePositionClass position;
+    position.NamespaceName = namespaceName;
+    position.StartingPos = startingPos;
+    position.IsDeclaration = true;
+    Data.Detach();
+    Data->NamespacePositions.push_back(position);
+}
+
+void t4p::SymbolTableClass::NamespaceUseFound(const UnicodeString& namespaceName, const UnicodeString& alias,
+        int lineNumber, int startingPos) {
+    t4p::NamespacePositionClass position;
+    position.NamespaceName = namespaceName;
+    position.Alias = alias;
+    position.StartingPos = startingPos;
+    position.IsDeclaration = false;
+    Data.Detach();
+    Data->NamespacePositions.push_back(position);
+}
+
+void t4p::SymbolTableClass::BuildScopeMap(t4p::ScopeMapClass& scopeMap) const {
+    // closures are stored in the variables map as "class::method@@anonymousFunction_1"
+    std::vector<UnicodeString> closureScopes;
+    std::map<UnicodeString, t4p::SymbolScopeClass, UnicodeStringComparatorClass>::const_iterator it;
+    for (it = Data->Variables.begin(); it != Data->Variables.end(); ++it) {
+        int32_t index = it->first.indexOf(UNICODE_STRING_SIMPLE("@@"));
+        if (index >= 0) {
+            closureScopes.push_back(UnicodeString(it->first, 0, index));
+        }
+    }
+    scopeMap.Build(Data->Code, Data->ScopePositions, Data->NamespacePositions, closureScopes);
 }
 
 void t4p::SymbolTableClass::SetVersion(pelet::Versions version) {
@@ -994,3 +1396,182 @@ t4p::SymbolClass::SymbolClass(const UnicodeString& variable, t4p::SymbolClass::T
     , ArrayKeys()
     , Type(type) {
 }
+
+t4p::SymbolScopeClass::SymbolScopeClass()
+    : Data(new t4p::SymbolScopeDataClass()) {
+}
+
+t4p::SymbolScopeClass::SymbolScopeClass(const t4p::SymbolScopeClass& src)
+    : Data(src.Data) {
+}
+
+t4p::SymbolScopeClass::~SymbolScopeClass() {
+}
+
+t4p::SymbolScopeClass& t4p::SymbolScopeClass::operator=(const t4p::SymbolScopeClass& src) {
+    Data = src.Data;
+    return *this;
+}
+
+const std::vector<t4p::SymbolClass>& t4p::SymbolScopeClass::GetSymbols() const {
+    return Data->Symbols;
+}
+
+std::vector<t4p::SymbolClass>& t4p::SymbolScopeClass::EditSymbols() {
+    Data.Detach();
+    return Data->Symbols;
+}
+
+t4p::ScopePositionClass::ScopePositionClass()
+    : NamespaceName()
+    , ClassName()
+    , MethodName()
+    , StartingPos(0)
+    , EndingPos(0)
+    , HasInnerScopes(false) {
+}
+
+t4p::NamespacePositionClass::NamespacePositionClass()
+    : NamespaceName()
+    , Alias()
+    , StartingPos(0)
+    , IsDeclaration(false) {
+}
+
+t4p::ScopeMapClass::ScopeMapClass()
+    : Code()
+    , Scopes()
+    , Namespaces()
+    , GlobalHasClosures(false) {
+}
+
+void t4p::ScopeMapClass::Clear() {
+    Code.remove();
+    Scopes.clear();
+    Namespaces.clear();
+    GlobalHasClosures = false;
+}
+
+void t4p::ScopeMapClass::Build(const UnicodeString& code, const std::vector<t4p::ScopePositionClass>& scopes,
+                               const std::vector<t4p::NamespacePositionClass>& namespaces,
+                               const std::vector<UnicodeString>& closureScopes) {
+    Clear();
+    if (code.isEmpty()) {
+        return;
+    }
+    Code = code;
+
+    // only keep the outermost ranges so that ranges never overlap and
+    // can be binary searched
+    std::vector<t4p::ScopePositionClass> sorted(scopes);
+    std::stable_sort(sorted.begin(), sorted.end(), IsScopeStartLess);
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (!Scopes.empty() && sorted[i].StartingPos <= Scopes.back().EndingPos) {
+            Scopes.back().HasInnerScopes = true;
+            continue;
+        }
+        UnicodeString scopeString = ScopeString(sorted[i].ClassName, sorted[i].MethodName);
+        sorted[i].HasInnerScopes = std::find(closureScopes.begin(), closureScopes.end(), scopeString) != closureScopes.end();
+        Scopes.push_back(sorted[i]);
+    }
+    UnicodeString globalScope = ScopeString(UNICODE_STRING_SIMPLE(""), UNICODE_STRING_SIMPLE(""));
+    GlobalHasClosures = std::find(closureScopes.begin(), closureScopes.end(), globalScope) != closureScopes.end();
+
+    Namespaces = namespaces;
+    std::stable_sort(Namespaces.begin(), Namespaces.end(), IsNamespaceStartLess);
+}
+
+int t4p::ScopeMapClass::FindScope(int pos) const {
+    std::vector<t4p::ScopePositionClass>::const_iterator it =
+        std::upper_bound(Scopes.begin(), Scopes.end(), pos, IsBeforeScope);
+    if (it == Scopes.begin()) {
+        return -1;
+    }
+    --it;
+    if (pos > it->EndingPos) {
+        return -1;
+    }
+    return it - Scopes.begin();
+}
+
+bool t4p::ScopeMapClass::IsInsideBody(const t4p::ScopePositionClass& scope, int start, int end) const {
+    int32_t length = Code.length();
+    int32_t openBrace = Code.indexOf('{', scope.StartingPos);
+    int32_t closeBrace = std::min(scope.EndingPos, length - 1);
+    if (closeBrace >= 0 && Code.charAt(closeBrace) != '}') {
+        closeBrace--;
+    }
+    if (openBrace < 0 || closeBrace < 0 || openBrace >= closeBrace || Code.charAt(closeBrace) != '}') {
+        // abstract method
+        return false;
+    }
+    return openBrace < start && end <= closeBrace;
+}
+
+bool t4p::ScopeMapClass::GetScope(const UnicodeString& code, int pos, pelet::ScopeClass& scope) const {
+    if (Code.isEmpty() || pos < 0 || pos > code.length()) {
+        return false;
+    }
+
+    // map the position to a position in the mapped revision. positions
+    // before the edit are the same; the scope of a position depends only
+    // on the code that comes before it
+    int mappedPos = pos;
+    if (Code != code) {
+        int32_t prefix = 0;
+        int32_t suffix = 0;
+        EditedRange(Code, code, prefix, suffix);
+        if (pos > prefix) {
+            // the edit must be inside a single function body and must not
+            // contain anything that could end the function or start
+            // another one
+            int32_t previousEditEnd = Code.length() - suffix;
+            int32_t editEnd = code.length() - suffix;
+            int edited = FindScope(prefix);
+            if (edited < 0 || !IsInsideBody(Scopes[edited], prefix, previousEditEnd)) {
+                return false;
+            }
+            UnicodeString removed(Code, prefix, previousEditEnd - prefix);
+            UnicodeString inserted(code, prefix, editEnd - prefix);
+            if (ChangesScopeStructure(removed) || ChangesScopeStructure(inserted)) {
+                return false;
+            }
+            if (pos <= editEnd) {
+                mappedPos = prefix;
+            } else {
+                mappedPos = pos - (code.length() - Code.length());
+            }
+        }
+    }
+
+    int index = FindScope(mappedPos);
+    if (index >= 0 && Scopes[index].HasInnerScopes) {
+        return false;
+    }
+    if (index < 0 && GlobalHasClosures) {
+        return false;
+    }
+
+    // same as ScopeFinderClass: only the namespaces and aliases declared
+    // before the position are in effect
+    scope.Clear();
+    for (size_t i = 0; i < Namespaces.size() && Namespaces[i].StartingPos < mappedPos; ++i) {
+        const t4p::NamespacePositionClass& namespacePosition = Namespaces[i];
+        if (!namespacePosition.IsDeclaration) {
+            scope.AddNamespaceAlias(namespacePosition.NamespaceName, namespacePosition.Alias);
+            continue;
+        }
+        scope.NamespaceName = namespacePosition.NamespaceName;
+
+        // add support for the namespace static operator
+        if (namespacePosition.NamespaceName != UNICODE_STRING_SIMPLE("\\")) {
+            scope.AddNamespaceAlias(namespacePosition.NamespaceName, UNICODE_STRING_SIMPLE("namespace"));
+        }
+    }
+    if (index >= 0) {
+        scope.NamespaceName = Scopes[index].NamespaceName;
+        scope.ClassName = Scopes[index].ClassName;
+        scope.MethodName = Scopes[index].MethodName;
+    }
+    return true;
+}
@@ -30,12 +30,19 @@
 #include <unicode/unistr.h>
 #include <map>
 #include <vector>
+#include "globals/SharedDataClass.h"
 #include "globals/String.h"
+#include "language_php/CompactTagListClass.h"
 #include "language_php/PhpTagClass.h"
 
 namespace t4p {
 // forward declaration
 class TagFinderListClass;
+class ScopeMapClass;
+
+// forward declaration, the symbol table data is private
+class SymbolScopeDataClass;
+class SymbolTableDataClass;
 
 /**
  * A small class that will tell the outside world why the symbol table failed
@@ -252,6 +259,118 @@ class SymbolClass {
     SymbolClass(const UnicodeString& variable, Types type = UNKNOWN);
 };
 
+/**
+ * The symbols of a single scope (a function, a method, a closure, or the
+ * global code). Copies of a scope share the same symbols (the symbols are
+ * reference counted); changing a scope that is shared with another copy
+ * will first make a private copy of the symbols (copy-on-write).
+ *
+ * Symbol tables of consecutive revisions of the same code share the scopes
+ * that were not edited.
+ */
+class SymbolScopeClass {
+ public:
+    SymbolScopeClass();
+
+    /**
+     * the new scope shares the symbols of src; this is not a deep copy
+     */
+    SymbolScopeClass(const t4p::SymbolScopeClass& src);
+
+    ~SymbolScopeClass();
+
+    /**
+     * this scope will share the symbols of src; this is not a deep copy
+     */
+    t4p::SymbolScopeClass& operator=(const t4p::SymbolScopeClass& src);
+
+    /**
+     * @return the symbols of this scope
+     */
+    const std::vector<t4p::SymbolClass>& GetSymbols() const;
+
+    /**
+     * @return the symbols of this scope, for modification. If the symbols are
+     *         shared with another scope they will be copied first.
+     */
+    std::vector<t4p::SymbolClass>& EditSymbols();
+
+ private:
+    /**
+     * shared among copies of this scope. Detach() before modifying it
+     */
+    t4p::SharedDataPtrClass<t4p::SymbolScopeDataClass> Data;
+};
+
+/**
+ * The location of a function or method body in the code that a symbol table
+ * was built from. The symbol table keeps these so that an edit can be
+ * mapped back to the single function or method that it touched.
+ */
+class ScopePositionClass {
+ public:
+    /**
+     * the namespace that the function or method was declared in
+     */
+    UnicodeString NamespaceName;
+
+    /**
+     * the class that the method belongs to; empty for functions
+     */
+    UnicodeString ClassName;
+
+    /**
+     * the function or method name
+     */
+    UnicodeString MethodName;
+
+    /**
+     * character positions (as given by the parser) of the start and end
+     * of the function or method
+     */
+    int StartingPos;
+    int EndingPos;
+
+    /**
+     * TRUE if the function or method contains closures or other
+     * functions. Only set by ScopeMapClass; positions inside such
+     * functions cannot be resolved without parsing.
+     */
+    bool HasInnerScopes;
+
+    ScopePositionClass();
+};
+
+/**
+ * The location of a namespace declaration or a namespace "use" statement
+ * in the code that a symbol table was built from.
+ */
+class NamespacePositionClass {
+ public:
+    /**
+     * the declared or imported namespace
+     */
+    UnicodeString NamespaceName;
+
+    /**
+     * the alias of the imported namespace; empty for namespace declarations
+     */
+    UnicodeString Alias;
+
+    /**
+     * character position (as given by the parser) of the declaration
+     */
+    int StartingPos;
+
+    /**
+     * TRUE if this is a namespace declaration, FALSE if this is a
+     * "use" statement
+     */
+    bool IsDeclaration;
+
+    NamespacePositionClass();
+};
+
 /**
  * A Symbol table is the data structure that will hold all of the variables in the code along with their type information.
  * The symbol table is responsible for figuring out a variable's type as well as resolve any functions, methods,
@@ -274,9 +393,14 @@ class SymbolTableClass :
  public:
     SymbolTableClass();
 
+    ~SymbolTableClass();
+
     /**
      * copies src's variables into this table
-     * Copy is a deep copy
+     * Copy is not a deep copy; both tables share the same variables
+     * until one of them is re-built, and then only the scopes that
+     * changed are copied. Copying a table is cheap and can be done
+     * on the UI thread.
      */
     void Copy(const t4p::SymbolTableClass& src);
 
@@ -311,6 +435,23 @@ class SymbolTableClass :
      */
     bool CreateSymbolsFromFile(const wxString& fileName, const t4p::SymbolTableClass& previousSymbolTable);
 
+    /**
+     * Builds symbols for the given source code, re-using the previous symbol table's
+     * symbols as much as possible. The given code is compared against the code that
+     * previousSymbolTable was built from; when all of the changes lie inside a single
+     * function or method, only that function or method is re-parsed (the bodies
+     * of all other functions and methods are skipped) and its symbols are spliced into a
+     * copy of the previous table's symbols.
+     * When the change cannot be isolated (code outside of any function was touched,
+     * the previous table was not built from valid code, the new code has a syntax error)
+     * this method does the same as CreateSymbols().
+     *
+     * @param code the code to analyze
+     * @param previousSymbolTable the table built from the previous revision of code
+     * @return bool TRUE if the code is valid PHP (no syntax errors)
+     */
+    bool UpdateSymbols(const UnicodeString& code, const t4p::SymbolTableClass& previousSymbolTable);
+
     /**
      * This is the entry point into the code completion functionality; it will take a parsed expression (symbol)
      * and will look up the each of the symbol's chain list items; resolve them against the given tag
@@ -357,6 +498,20 @@ class SymbolTableClass :
                                      bool doDuckTyping,
                                      SymbolTableMatchErrorClass& error) const;
 
+    /**
+     * same as above, but the resource matches are put in a compact list; the
+     * tags are not copied into PhpTagClass objects. The other overload
+     * copies the matches, use this one when the matches may be many.
+     */
+    void ExpressionCompletionMatches(pelet::VariableClass parsedVariable,
+                                     const pelet::ScopeClass& variableScope,
+                                     const std::vector<wxFileName>& sourceDirs,
+                                     t4p::TagFinderListClass& tagFinderList,
+                                     std::vector<UnicodeString>& autoCompleteVariableList,
+                                     t4p::CompactTagListClass& autoCompleteResourceList,
+                                     bool doDuckTyping,
+                                     SymbolTableMatchErrorClass& error) const;
+
     /**
      * This method will resolve the given parsed expression and will figure out the type of a tag. It will resolve
      * each item in the parsed expression's chain list just like ExpressionCompletionMatches(), but this method will return
@@ -393,6 +548,25 @@ class SymbolTableClass :
                          bool doDuckTyping, bool doFullyQualifiedMatchOnly,
                          SymbolTableMatchErrorClass& error) const;
 
+    /**
+     * same as above, but the tag matches are put in a compact list; the
+     * tags are not copied into PhpTagClass objects.
+     */
+    void ResourceMatches(pelet::VariableClass parsedVariable,
+                         const pelet::ScopeClass& variableScope,
+                         const std::vector<wxFileName>& sourceDirs,
+                         t4p::TagFinderListClass& tagFinderList,
+                         t4p::CompactTagListClass& resourceMatches,
+                         bool doDuckTyping, bool doFullyQualifiedMatchOnly,
+                         SymbolTableMatchErrorClass& error) const;
+
+    /**
+     * fills the given scope map with the function, method, and namespace
+     * positions of the code that this table was built from. The
+     * scope map will be empty if the code had a syntax error.
+     */
+    void BuildScopeMap(t4p::ScopeMapClass& scopeMap) const;
+
     /**
      * outout to stdout
      */
@@ -414,6 +588,15 @@ class SymbolTableClass :
 
     void OnAnyExpression(pelet::ExpressionClass* expr);
 
+    void MethodScope(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& methodName,
+                     int startingPos, int endingPos);
+
+    void FunctionScope(const UnicodeString& namespaceName, const UnicodeString& functionName, int startingPos, int endingPos);
+
+    void NamespaceDeclarationFound(const UnicodeString& namespaceName, int startingPos);
+
+    void NamespaceUseFound(const UnicodeString& namespaceName, const UnicodeString& alias, int lineNumber, int startingPos);
+
     /**
      * Set the version that the PHP parser should use.
      */
@@ -422,7 +605,7 @@ class SymbolTableClass :
  private:
     /**
      * Get the vector of variables for the given scope. If scope does not exist it will
-     * be created.
+     * be created. If the scope is shared with another table it will be copied first.
      *
      * @return std::vector<t4p::SymbolClass>&
      */
@@ -444,15 +627,17 @@ class SymbolTableClass :
     void ResolveNamespaceAlias(pelet::VariableClass& parsedVariable, const pelet::ScopeClass& scope) const;
 
     /**
-     * Modifies the tag; unresolving namespaces alias to their aliased equivalents. We need to
+     * Unresolves namespaces alias to their aliased equivalents. We need to
      * do this because the TagFinder class only deals with fully qualified namespaces, it knows nothing
      * about the aliases
      *
      * @param the original variable to resolve
      * @param scope the scope that containts the aliases to resolve against
-     * @param tag a matched tag; will get modified an any namespace will be 'unresolved'
+     * @param identifier the identifier of a matched tag
+     * @return the identifier with any namespace 'unresolved'
      */
-    void UnresolveNamespaceAlias(const pelet::VariableClass& originalVariable, const pelet::ScopeClass& scope, t4p::PhpTagClass& tag) const;
+    UnicodeString UnresolveNamespaceAlias(const pelet::VariableClass& originalVariable, const pelet::ScopeClass& scope,
+                                          const UnicodeString& identifier) const;
 
     /**
      * Tokenizes the code (using the Lexer instance) and accumulates all variables from the final scope. This function
@@ -466,6 +651,22 @@ class SymbolTableClass :
      */
     void CreateSymbolsFromTokens(const t4p::SymbolTableClass& previousSymbolTable);
 
+    /**
+     * Finds the single function or method of the previous table that encloses all of the changes
+     * between previousSymbolTable's code and the given code, and creates a copy of code
+     * where the bodies of all other functions and methods are blanked out. Blanking keeps
+     * the code length (and line numbers) intact, so positions do not need to be adjusted.
+     *
+     * @param code the new code
+     * @param previousSymbolTable the table built from the previous revision of code
+     * @param skeleton will be filled with the code to parse
+     * @param editedScope will be filled with the scope string of the function that was edited
+     * @param skippedScopes will be filled with the scope strings of the functions that were blanked out
+     * @return bool TRUE if the changes could be isolated to a single function or method
+     */
+    bool SkeletonCode(const UnicodeString& code, const t4p::SymbolTableClass& previousSymbolTable,
+                      UnicodeString& skeleton, UnicodeString& editedScope, std::vector<UnicodeString>& skippedScopes) const;
+
     /**
      * The parser.
      *
@@ -480,13 +681,21 @@ class SymbolTableClass :
     pelet::LexicalAnalyzerClass Lexer;
 
     /**
-     * Holds all variables for the currently parsed piece of code. Each vector will represent its own scope.
-     * The key will be the scope name.  The scope name is a combination of the class, method name.
-     * The scope string is that which is returned by ScopeString() method.
-     * The value is the parsed Symbol.
-     * @var std::map<UnicodeString, vector<t4p::SymbolClass>>
+     * removes all variables and positions from this table. The data of
+     * other tables that share it is left alone.
      */
-    std::map<UnicodeString, std::vector<t4p::SymbolClass>, UnicodeStringComparatorClass> Variables;
+    void Reset();
+
+    /**
+     * The variables, scope positions and code of this table; shared among the
+     * copies of this table. Detach() before modifying it; the scopes themselves
+     * are not copied, they are copied only when they are modified.
+     */
+    t4p::SharedDataPtrClass<t4p::SymbolTableDataClass> Data;
+
+    // not copyable, use Copy() instead
+    SymbolTableClass(const t4p::SymbolTableClass&);
+    void operator=(const t4p::SymbolTableClass&);
 };
 
 /**
@@ -563,6 +772,86 @@ class ScopeFinderClass :
      */
     int PosToCheck;
 };
+
+/**
+ * The scope map holds the function, method, and namespace ranges of a
+ * revision of a file that had valid syntax.  It answers the same
+ * question as ScopeFinderClass, but without parsing: the ranges are
+ * kept sorted and searched with a binary search.
+ * The map can answer scope queries for later revisions of the same file as
+ * long as the changes since the mapped revision do not alter the
+ * function / namespace structure; ranges after the change are shifted by the
+ * number of characters that were added or removed.
+ */
+class ScopeMapClass {
+ public:
+    ScopeMapClass();
+
+    /**
+     * @param code the code that the positions were found in
+     * @param scopes the function and method ranges
+     * @param namespaces the namespace declarations and "use" statements
+     * @param closureScopes the scope strings of the functions that contain
+     *        closures
+     */
+    void Build(const UnicodeString& code, const std::vector<t4p::ScopePositionClass>& scopes,
+               const std::vector<t4p::NamespacePositionClass>& namespaces,
+               const std::vector<UnicodeString>& closureScopes);
+
+    /**
+     * Finds the scope at the given position; the result is the same as
+     * ScopeFinderClass::GetScopeString()
+     *
+     * @param code the file's most up-to-date source code. This may be a
+     *        later revision of the code that the map was built from.
+     * @param pos index into code
+     * @param scope instance to put the function, declared namespace, and aliases
+     *        that the position lies in.
+     * @return bool FALSE if the scope cannot be determined without parsing
+     *         the code: the map is empty, the code was changed in a way that
+     *         may have added or removed a function, or the position is in a
+     *         function that contains closures.
+     */
+    bool GetScope(const UnicodeString& code, int pos, pelet::ScopeClass& scope) const;
+
+    /**
+     * removes all ranges
+     */
+    void Clear();
+
+ private:
+    /**
+     * @return the index of the range that contains pos, -1 if pos
+     *         is not inside of any function or method
+     */
+    int FindScope(int pos) const;
+
+    /**
+     * @return TRUE if the range [start, end) of Code lies inside the
+     *         braces of the body of the given function
+     */
+    bool IsInsideBody(const t4p::ScopePositionClass& scope, int start, int end) const;
+
+    /**
+     * the code that the ranges were found in
+     */
+    UnicodeString Code;
+
+    /**
+     * the outermost function and method ranges, sorted by starting position
+     */
+    std::vector<t4p::ScopePositionClass> Scopes;
+
+    /**
+     * the namespace declarations and "use" statements, sorted by position
+     */
+    std::vector<t4p::NamespacePositionClass> Namespaces;
+
+    /**
+     * TRUE if the code outside of any function contains closures
+     */
+    bool GlobalHasClosures;
+};
 }  // namespace t4p
 
 #endif  // SRC_LANGUAGE_PHP_SYMBOLTABLECLASS_H_
@@ -32,6 +32,7 @@
 #include "globals/GlobalsClass.h"
 #include "globals/Sqlite.h"
 #include "language_php/DetectedTagFinderResultClass.h"
+#include "language_php/NativeTagImageClass.h"
 #include "language_php/TagFinderList.h"
 
 /**
@@ -144,9 +145,11 @@ wxEvent* t4p::TagFinderListCompleteEventClass::Clone() const {
 
 const wxEventType t4p::EVENT_WORKING_CACHE_COMPLETE = wxNewEventType();
 const wxEventType t4p::EVENT_TAG_FINDER_LIST_COMPLETE = wxNewEventType();
+const wxEventType t4p::EVENT_TAG_INDEX_STALE = wxNewEventType();
 
 t4p::WorkingCacheClass::WorkingCacheClass()
     : SymbolTable()
+    , ScopeMap()
     , FileName()
     , IsNew(true) {
 }
@@ -158,10 +161,11 @@ bool t4p::WorkingCacheClass::Update(const UnicodeString& code, const t4p::Symbol
     // on newly created files
     bool ret = false;
     if (!code.isEmpty()) {
-        ret = SymbolTable.CreateSymbols(code, previousSymbolTable);
+        ret = SymbolTable.UpdateSymbols(code, previousSymbolTable);
     } else if (code.isEmpty()) {
         ret = true;
     }
+    SymbolTable.BuildScopeMap(ScopeMap);
     return ret;
 }
 
@@ -180,7 +184,9 @@ void t4p::WorkingCacheClass::Init(const wxString& fileName,
 
 t4p::TagCacheClass::TagCacheClass()
     : TagFinderList(NULL)
-    , WorkingCaches() {
+    , WorkingCaches()
+    , TagIndexHandler(NULL)
+    , IsTagIndexLoadPending(false) {
 }
 
 t4p::TagCacheClass::~TagCacheClass() {
@@ -224,6 +230,35 @@ void t4p::TagCacheClass::RegisterGlobal(t4p::TagFinderListClass* cache) {
     TagFinderList = cache;
 }
 
+void t4p::TagCacheClass::SetTagIndexHandler(wxEvtHandler* handler) {
+    TagIndexHandler = handler;
+}
+
+void t4p::TagCacheClass::SwapGlobalTagIndex(t4p::TagIndexClass* tagIndex) {
+    IsTagIndexLoadPending = false;
+    if (TagFinderList && tagIndex) {
+        TagFinderList->TagIndex.Swap(*tagIndex);
+
+        // the loaded tags may already be behind the tag db
+        TagFinderList->RefreshTagIndexChanges();
+    }
+}
+
+void t4p::TagCacheClass::RefreshGlobalTagIndex() {
+    if (!TagFinderList) {
+        return;
+    }
+    if (!TagIndexHandler) {
+        TagFinderList->RefreshTagIndex();
+        return;
+    }
+    if (!TagFinderList->RefreshTagIndexChanges() && !IsTagIndexLoadPending) {
+        IsTagIndexLoadPending = true;
+        wxCommandEvent evt(t4p::EVENT_TAG_INDEX_STALE);
+        wxPostEvent(TagIndexHandler, evt);
+    }
+}
+
 void t4p::TagCacheClass::RegisterDefault(t4p::GlobalsClass& globals) {
     t4p::TagFinderListClass* cache = new t4p::TagFinderListClass;
     cache->InitGlobalTag(globals.TagCacheDbFileName, globals.FileTypes.GetPhpFileExtensions(), globals.FileTypes.GetMiscFileExtensions(),
@@ -244,7 +279,9 @@ t4p::TagResultClass* t4p::TagCacheClass::ExactTags(const UnicodeString& search,
 t4p::TagResultClass* t4p::TagCacheClass::ExactNativeTags(const UnicodeString& search) {
     t4p::TagSearchClass tagSearch(search);
     t4p::TagResultClass* result = tagSearch.CreateExactResults();
-    TagFinderList->NativeTagFinder.Exec(result);
+    if (TagFinderList->OpenNativeTagFinder()) {
+        TagFinderList->NativeTagFinder.Exec(result);
+    }
     return result;
 }
 
@@ -284,7 +321,9 @@ t4p::TagResultClass* t4p::TagCacheClass::NearMatchNativeTags(const UnicodeString
     t4p::TagSearchClass tagSearch(search);
 
     t4p::TagResultClass* result = tagSearch.CreateNearMatchResults();
-    TagFinderList->NativeTagFinder.Exec(result);
+    if (TagFinderList->OpenNativeTagFinder()) {
+        TagFinderList->NativeTagFinder.Exec(result);
+    }
     return result;
 }
 
@@ -435,7 +474,7 @@ bool t4p::TagCacheClass::NativePrepare(t4p::SqliteResultClass& result, bool doLi
     if (!TagFinderList) {
         return false;
     }
-    if (!TagFinderList->IsNativeTagFinderInit) {
+    if (!TagFinderList->OpenNativeTagFinder()) {
         return false;
     }
     return TagFinderList->NativeTagFinder.Prepare(&result, doLimit);
@@ -444,7 +483,7 @@ bool t4p::TagCacheClass::NativePrepare(t4p::SqliteResultClass& result, bool doLi
 std::vector<t4p::ParsedTagFinderClass*> t4p::TagCacheClass::AllFinders() {
     std::vector<t4p::ParsedTagFinderClass*> allTagFinders;
     if (TagFinderList) {
-        if (TagFinderList->IsNativeTagFinderInit) {
+        if (TagFinderList->OpenNativeTagFinder()) {
             allTagFinders.push_back(&TagFinderList->NativeTagFinder);
         }
         if (TagFinderList->IsTagFinderInit) {
@@ -459,7 +498,7 @@ void t4p::TagCacheClass::ExpressionCompletionMatches(const wxString& fileName,
         const pelet::ScopeClass& variableScope,
         const std::vector<wxFileName>& sourceDirs,
         std::vector<UnicodeString>& autoCompleteList,
-        std::vector<t4p::PhpTagClass>& resourceMatches,
+        t4p::CompactTagListClass& resourceMatches,
         bool doDuckTyping,
         t4p::SymbolTableMatchErrorClass& error) {
     std::map<wxString, t4p::WorkingCacheClass*>::const_iterator itWorkingCache = WorkingCaches.find(fileName);
@@ -467,6 +506,7 @@ void t4p::TagCacheClass::ExpressionCompletionMatches(const wxString& fileName,
     if (itWorkingCache != WorkingCaches.end()) {
         foundSymbolTable = true;
         t4p::WorkingCacheClass* cache = itWorkingCache->second;
+        RefreshGlobalTagIndex();
         cache->SymbolTable.ExpressionCompletionMatches(parsedVariable, variableScope, sourceDirs, *TagFinderList,
                 autoCompleteList, resourceMatches, doDuckTyping, error);
     }
@@ -487,6 +527,7 @@ void t4p::TagCacheClass::ResourceMatches(const wxString& fileName,
     if (itWorkingCache != WorkingCaches.end()) {
         foundSymbolTable = true;
         t4p::WorkingCacheClass* cache = itWorkingCache->second;
+        RefreshGlobalTagIndex();
         cache->SymbolTable.ResourceMatches(parsedVariable, variableScope, sourceDirs, *TagFinderList,
                                            matches, doDuckTyping, doFullyQualifiedMatchOnly, error);
     }
@@ -514,8 +555,22 @@ bool t4p::TagCacheClass::IsFileCacheEmpty() {
     return true;
 }
 
+t4p::TagIndexClass* t4p::TagCacheClass::GlobalTagIndex() {
+    if (!TagFinderList) {
+        return NULL;
+    }
+    RefreshGlobalTagIndex();
+    if (TagFinderList->TagIndex.IsLoaded()) {
+        return &TagFinderList->TagIndex;
+    }
+    return NULL;
+}
+
 bool t4p::TagCacheClass::IsResourceCacheEmpty() {
     // if at least one tag finder is not empty, return false
+    if (TagFinderList && TagFinderList->NativeImage && TagFinderList->NativeImage->Count() > 0) {
+        return false;
+    }
     if (TagFinderList && TagFinderList->IsNativeTagFinderInit && !TagFinderList->NativeTagFinder.IsResourceCacheEmpty()) {
         return false;
     }
@@ -550,6 +605,7 @@ void t4p::TagCacheClass::Clear() {
 std::vector<t4p::PhpTagClass> t4p::TagCacheClass::AllMemberTags(const UnicodeString& fullyQualifiedClassName,
         int fileTagId, std::vector<wxFileName>& sourceDirs) {
     std::vector<t4p::PhpTagClass> allMatches;
+    RefreshGlobalTagIndex();
 
     // add the double colon so that we search for all members
     // first search for all members of the given class that is also in the given file
@@ -595,6 +651,7 @@ std::vector<t4p::PhpTagClass> t4p::TagCacheClass::AllClassesFunctionsDefines(con
 }
 
 std::vector<UnicodeString> t4p::TagCacheClass::ParentClassesAndTraits(const UnicodeString& className, const std::vector<wxFileName>& sourceDirs) {
+    RefreshGlobalTagIndex();
     std::vector<UnicodeString> classParents = TagFinderList->ClassParents(className, UNICODE_STRING_SIMPLE(""));
     std::vector<UnicodeString> classTraits = TagFinderList->ClassUsedTraits(className, classParents, UNICODE_STRING_SIMPLE(""), sourceDirs);
 
@@ -608,10 +665,10 @@ std::vector<UnicodeString> t4p::TagCacheClass::ParentClassesAndTraits(const Unic
     return all;
 }
 
-bool t4p::TagCacheClass::FindById(int id, t4p::PhpTagClass& tag) {
+bool t4p::TagCacheClass::FindById(int sourceId, int id, t4p::PhpTagClass& tag) {
     bool found = false;
     if (TagFinderList->IsTagFinderInit) {
-        found = TagFinderList->TagFinder.FindById(id, tag);
+        found = TagFinderList->TagFinder.FindById(sourceId, id, tag);
     }
     return found;
 }
@@ -638,6 +695,16 @@ bool t4p::TagCacheClass::HasDir(const wxString& dir) {
     return found;
 }
 
+bool t4p::TagCacheClass::GetScopeAtPosition(const wxString& fileName, const UnicodeString& code, int pos,
+        pelet::ScopeClass& scope) {
+    bool found = false;
+    std::map<wxString, t4p::WorkingCacheClass*>::const_iterator it = WorkingCaches.find(fileName);
+    if (it != WorkingCaches.end()) {
+        found = it->second->ScopeMap.GetScope(code, pos, scope);
+    }
+    return found;
+}
+
 std::vector<t4p::PhpTagClass> t4p::TagCacheClass::GetTagsAtPosition(
     const wxString& fileName,
     const UnicodeString& code, int posToCheck,
@@ -660,7 +727,9 @@ std::vector<t4p::PhpTagClass> t4p::TagCacheClass::GetTagsAtPosition(
     UnicodeString resourceName;
     bool doDuckTyping = true;
     if (!lastExpression.isEmpty()) {
-        scopeFinder.GetScopeString(codeUntilPos, posToCheck, variableScope);
+        if (!GetScopeAtPosition(fileName, code, posToCheck, variableScope)) {
+            scopeFinder.GetScopeString(codeUntilPos, posToCheck, variableScope);
+        }
         if (lastExpression.indexOf(UNICODE_STRING_SIMPLE("\\")) > 0 &&
                 variableScope.ClassName.isEmpty() &&
                 variableScope.MethodName.isEmpty()) {
@@ -41,6 +41,7 @@ namespace t4p {
 class DetectedTagNearMatchMemberResultClass;
 class DetectedTagExactMemberResultClass;
 class TagFinderListClass;
+class TagIndexClass;
 class TagFinderClass;
 class TagResultClass;
 class FileTagResultClass;
@@ -60,6 +61,13 @@ class WorkingCacheClass {
      */
     t4p::SymbolTableClass SymbolTable;
 
+    /**
+     * The function and namespace ranges of the code that SymbolTable was
+     * built from; used to find the scope at a position without
+     * parsing the code.
+     */
+    t4p::ScopeMapClass ScopeMap;
+
     /**
      * The full path to the file being parsed. This may be the empty string
      * if the file resides completely in memory
@@ -107,6 +115,8 @@ class WorkingCacheClass {
      * In the case the give code has a syntax error this symbol table is built by using the
      * previous table's variables, then tokenizing the given code to add any additional
      * variables not found in the previous table.
+     * When previousSymbolTable was built from an earlier revision of the same code, only
+     * the function or method that was edited is re-parsed.
      *
      * @param code the file's most up-to-date source code (from the user-edited buffer)
      * @param previousSymbolTable used when code has a syntax error.
@@ -195,6 +205,30 @@ class TagCacheClass {
      */
     void RegisterGlobal(t4p::TagFinderListClass* tagFinderList);
 
+    /**
+     * Set the handler that loads the global tag index. Without a handler,
+     * the tag index is re-read in the thread that does the lookup when all of
+     * its tags need to be re-read; this is fine for caches that are used in
+     * background threads. With a handler (the cache used in the UI thread), a
+     * lookup only reads the tags of a few changed files; when all of the tags
+     * need to be re-read an EVENT_TAG_INDEX_STALE is posted to the handler and
+     * the lookups go to the tag db until the handler calls
+     * SwapGlobalTagIndex().
+     *
+     * @param handler the handler to post events to. this class will NOT own the pointer
+     */
+    void SetTagIndexHandler(wxEvtHandler* handler);
+
+    /**
+     * Replaces the tags of the global tag index with the given tags.
+     *
+     * @param tagIndex the tags that were loaded in a background thread, after
+     *        this call it has the old tags. This can be NULL when the tags could
+     *        not be loaded, lookups keep going to the tag db until the next
+     *        EVENT_TAG_INDEX_STALE.
+     */
+    void SwapGlobalTagIndex(t4p::TagIndexClass* tagIndex);
+
     /**
      * Set the global cache using the default settings (from Asset). After a call
      * to this method, the cache is available for use by
@@ -405,7 +439,7 @@ class TagCacheClass {
                                      const pelet::ScopeClass& variableScope,
                                      const std::vector<wxFileName>& sourceDirs,
                                      std::vector<UnicodeString>& autoCompleteList,
-                                     std::vector<t4p::PhpTagClass>& autoCompleteResourceList,
+                                     t4p::CompactTagListClass& autoCompleteResourceList,
                                      bool doDuckTyping,
                                      SymbolTableMatchErrorClass& error);
 
@@ -434,6 +468,22 @@ class TagCacheClass {
                          bool doDuckTyping, bool doFullyQualifiedMatchOnly,
                          SymbolTableMatchErrorClass& error);
 
+    /**
+     * Finds the scope at the given position by using the scope map of the
+     * given file's working cache; this is much faster than ScopeFinderClass
+     * since the code is not parsed.
+     *
+     * @param fileName the scope map of this registered file will be used
+     * @param code the most up-to-date code of the file
+     * @param pos the character position in code to get the scope of
+     * @param [out] scope the function, declared namespace, and aliases that the
+     *        position lies in
+     * @return bool FALSE if the file is not registered or its scope map cannot
+     *         answer; the caller should use ScopeFinderClass in that case
+     */
+    bool GetScopeAtPosition(const wxString& fileName, const UnicodeString& code, int pos,
+                            pelet::ScopeClass& scope);
+
     /**
      * Returns the tags that matched the identifier in the given position
      *
@@ -467,6 +517,19 @@ class TagCacheClass {
      */
     bool IsResourceCacheEmpty();
 
+    /**
+     * The index is refreshed before it is returned
+     * (see SetTagIndexHandler()).
+     *
+     * @return the in-memory index of the global tags, or NULL if the
+     *         tags are not loaded into memory
+     *         (see TagFinderListClass::LoadTagIndex()) or are being
+     *         re-loaded in a background thread. This class
+     *         retains ownership of the pointer, and the pointer is only
+     *         valid until the global cache is replaced.
+     */
+    t4p::TagIndexClass* GlobalTagIndex();
+
     /**
      * Remove all items from all caches and also unregisters any and all files.
      */
@@ -482,11 +545,12 @@ class TagCacheClass {
     /**
      * retrieves a tag by its ID
      *
+     * @param sourceId the source of the tag, tag IDs are only unique within a source
      * @param id the ID to query for
      * @param tag out parameter, will be filled in with the tag data
      * @return bool TRUE if the ID was found
      */
-    bool FindById(int id, t4p::PhpTagClass& tag);
+    bool FindById(int sourceId, int id, t4p::PhpTagClass& tag);
 
     /**
      * @param fullPath filename to delete tags that were found in filename.
@@ -519,6 +583,12 @@ class TagCacheClass {
      */
     std::vector<t4p::ParsedTagFinderClass*> AllFinders();
 
+    /**
+     * brings the global tag index up to date before a group of lookups
+     * (see SetTagIndexHandler())
+     */
+    void RefreshGlobalTagIndex();
+
     /**
      * These are the tag finders from the ALL projects and native functions; it may include stale resources
      * This class will own the pointer and will delete them when appropriate.
@@ -530,6 +600,18 @@ class TagCacheClass {
      * This class will own these pointers and will delete them when appropriate.
      */
     std::map<wxString, t4p::WorkingCacheClass*> WorkingCaches;
+
+    /**
+     * gets EVENT_TAG_INDEX_STALE, may be NULL.
+     * This class will NOT own this pointer.
+     */
+    wxEvtHandler* TagIndexHandler;
+
+    /**
+     * TRUE when EVENT_TAG_INDEX_STALE was posted and the handler has not
+     * yet called SwapGlobalTagIndex(), so that the event is posted only once
+     */
+    bool IsTagIndexLoadPending;
 };
 
 /**
@@ -544,6 +626,14 @@ extern const wxEventType EVENT_WORKING_CACHE_COMPLETE;
  */
 extern const wxEventType EVENT_TAG_FINDER_LIST_COMPLETE;
 
+/**
+ * Event that tells the tag index handler that all of the tags of
+ * the global tag index need to be re-read (see
+ * TagCacheClass::SetTagIndexHandler()). The event is of type
+ * wxCommandEvent.
+ */
+extern const wxEventType EVENT_TAG_INDEX_STALE;
+
 
 class WorkingCacheCompleteEventClass : public wxEvent {
  public:
@@ -0,0 +1,354 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagCollectorClass.h"
+#include <wx/ffile.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "language_php/FileTags.h"
+
+/**
+ * appends name to namespace
+ */
+static UnicodeString QualifyName(const UnicodeString& namespaceName, const UnicodeString& name) {
+    UnicodeString qualifiedName;
+    qualifiedName.append(namespaceName);
+    if (!qualifiedName.endsWith(UNICODE_STRING_SIMPLE("\\"))) {
+        qualifiedName.append(UNICODE_STRING_SIMPLE("\\"));
+    }
+    qualifiedName.append(name);
+    return qualifiedName;
+}
+
+/**
+ * @return the key used in the trait map for the given class and trait
+ */
+static UnicodeString TraitMapKey(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitName) {
+    UnicodeString mapKey;
+    mapKey += namespaceName;
+    mapKey += UNICODE_STRING_SIMPLE("-");
+    mapKey += className;
+    mapKey += UNICODE_STRING_SIMPLE("-");
+    mapKey += traitName;
+    return mapKey;
+}
+
+t4p::ParsedFileTagsClass::ParsedFileTagsClass()
+    : FileTagId(0)
+    , FullPath()
+    , ContentHash()
+    , Tags()
+    , NamespaceNames()
+    , Traits()
+    , IsRead(false) {
+}
+
+void t4p::ParsedFileTagsClass::Clear() {
+    FileTagId = 0;
+    FullPath = wxT("");
+    ContentHash = wxT("");
+    Tags.clear();
+    NamespaceNames.clear();
+    Traits.clear();
+    IsRead = false;
+}
+
+t4p::TagCollectorClass::TagCollectorClass()
+    : Parser()
+    , Current(NULL) {
+    Parser.SetClassObserver(this);
+    Parser.SetClassMemberObserver(this);
+    Parser.SetFunctionObserver(this);
+}
+
+void t4p::TagCollectorClass::SetVersion(pelet::Versions version) {
+    Parser.SetVersion(version);
+}
+
+bool t4p::TagCollectorClass::CollectFile(const wxString& fullPath, int fileTagId, t4p::ParsedFileTagsClass& parsed) {
+    parsed.Clear();
+
+    // deep copy, parsed may be handed to another thread
+    parsed.FullPath = fullPath.c_str();
+    parsed.FileTagId = fileTagId;
+
+    // for now silently ignore files with parser errors
+    pelet::LintResultsClass lintResults;
+    wxFFile file;
+    if (file.Open(fullPath, wxT("rb"))) {
+        // hash the same contents that are parsed, so that the next
+        // time the file is touched we can tell if it really changed
+        if (!t4p::FileTagContentHash(file.fp(), parsed.ContentHash)) {
+            parsed.ContentHash = wxT("");
+        }
+        file.Seek(0);
+        Current = &parsed;
+        Parser.ScanFile(file.fp(), t4p::WxToIcu(fullPath), lintResults);
+        Current = NULL;
+        parsed.IsRead = true;
+    }
+    return parsed.IsRead;
+}
+
+void t4p::TagCollectorClass::CollectString(const wxString& fullPath, int fileTagId, const UnicodeString& code,
+        t4p::ParsedFileTagsClass& parsed) {
+    parsed.Clear();
+    parsed.FullPath = fullPath.c_str();
+    parsed.FileTagId = fileTagId;
+
+    // for now silently ignore parse errors
+    pelet::LintResultsClass results;
+    Current = &parsed;
+    Parser.ScanString(code, results);
+    Current = NULL;
+    parsed.IsRead = true;
+}
+
+void t4p::TagCollectorClass::AddNamespace(const UnicodeString& namespaceName) {
+    std::vector<UnicodeString>::const_iterator found = std::find(
+        Current->NamespaceNames.begin(), Current->NamespaceNames.end(), namespaceName);
+    if (found == Current->NamespaceNames.end()) {
+        Current->NamespaceNames.push_back(namespaceName);
+    }
+}
+
+void t4p::TagCollectorClass::ClassFound(const UnicodeString& namespaceName, const UnicodeString& className,
+                                        const UnicodeString& signature,
+                                        const UnicodeString& baseClassName,
+                                        const UnicodeString& implementsList,
+                                        const UnicodeString& comment, const int lineNumber) {
+    t4p::PhpTagClass classItem;
+    classItem.Identifier = className;
+    classItem.ClassName = className;
+    classItem.NamespaceName = namespaceName;
+    classItem.Key = className;
+    classItem.Type = t4p::PhpTagClass::CLASS;
+    classItem.Signature = signature;
+    classItem.ReturnType = UNICODE_STRING_SIMPLE("");
+    classItem.Comment = comment;
+    classItem.IsNative = false;
+    classItem.LineNumber = lineNumber;
+    Current->Tags.push_back(classItem);
+
+    AddNamespace(namespaceName);
+
+    classItem.Identifier = QualifyName(namespaceName, className);
+    classItem.Key = QualifyName(namespaceName, className);
+    Current->Tags.push_back(classItem);
+}
+
+void t4p::TagCollectorClass::TraitAliasFound(const UnicodeString& namespaceName, const UnicodeString& className,
+        const UnicodeString& traitUsedClassName, const UnicodeString& traitMethodName, const UnicodeString& alias,
+        pelet::TokenClass::TokenIds visibility) {
+    // the trait has already been put in the cache; we just need to update it
+    // this code assumes that TraitUseFound() is called before TraitAliasFound()
+    UnicodeString mapKey = TraitMapKey(namespaceName, className, traitUsedClassName);
+    std::map<UnicodeString, std::vector<t4p::TraitTagClass>, UnicodeStringComparatorClass>::iterator it;
+    it = Current->Traits.find(mapKey);
+    if (it != Current->Traits.end() && !it->second.empty()) {
+        it->second.front().Aliased.push_back(alias);
+        it->second.back().Aliased.push_back(alias);
+    }
+}
+
+void t4p::TagCollectorClass::TraitInsteadOfFound(const UnicodeString& namespaceName, const UnicodeString& className,
+        const UnicodeString& traitUsedClassName, const UnicodeString& traitMethodName,
+        const std::vector<UnicodeString>& insteadOfList) {
+    // the trait has already been put in the cache; we just need to update it
+    // this code assumes that TraitUseFound() is called before TraitInsteadOfFound()
+    UnicodeString mapKey = TraitMapKey(namespaceName, className, traitUsedClassName);
+    std::map<UnicodeString, std::vector<t4p::TraitTagClass>, UnicodeStringComparatorClass>::iterator it;
+    it = Current->Traits.find(mapKey);
+    if (it != Current->Traits.end() && !it->second.empty()) {
+        it->second.front().InsteadOfs.insert(it->second.front().InsteadOfs.end(), insteadOfList.begin(), insteadOfList.end());
+        it->second.back().InsteadOfs.insert(it->second.back().InsteadOfs.end(), insteadOfList.begin(), insteadOfList.end());
+    }
+}
+
+void t4p::TagCollectorClass::TraitUseFound(const UnicodeString& namespaceName, const UnicodeString& className,
+        const UnicodeString& fullyQualifiedTraitName) {
+    t4p::TraitTagClass newTraitTag;
+    newTraitTag.ClassName = className;
+    newTraitTag.NamespaceName = namespaceName;
+
+    int32_t pos = fullyQualifiedTraitName.lastIndexOf(UNICODE_STRING_SIMPLE("\\"));
+    if (pos > 0) {
+        newTraitTag.TraitClassName.setTo(fullyQualifiedTraitName, 0, pos);
+        newTraitTag.TraitNamespaceName.setTo(fullyQualifiedTraitName, pos + 1);
+    } else if (0 == pos) {
+        // root namespace
+        newTraitTag.TraitClassName.setTo(fullyQualifiedTraitName, 1);
+        newTraitTag.TraitNamespaceName.setTo(UNICODE_STRING_SIMPLE("\\"));
+    } else {
+        // this should never get here as the parser will always give us
+        // fully qualified trait names
+        newTraitTag.TraitClassName = fullyQualifiedTraitName;
+        newTraitTag.TraitNamespaceName = UNICODE_STRING_SIMPLE("\\");
+    }
+
+    // only add if not already there
+    // key is a concatenation of fully qualified class and fully qualified trait
+    // this will make the alias and instead easier to update
+    UnicodeString mapKey = TraitMapKey(namespaceName, className, fullyQualifiedTraitName);
+    int count = Current->Traits.count(mapKey);
+    if (count <= 0) {
+        newTraitTag.Key = QualifyName(namespaceName, className);
+        Current->Traits[mapKey].push_back(newTraitTag);
+
+        // put a non-qualified version too, sometimes the query will not contain a fully qualified name
+        newTraitTag.Key = className;
+        Current->Traits[mapKey].push_back(newTraitTag);
+    }
+}
+
+void t4p::TagCollectorClass::DefineDeclarationFound(const UnicodeString& namespaceName, const UnicodeString& variableName,
+        const UnicodeString& variableValue, const UnicodeString& comment, const int lineNumber) {
+    t4p::PhpTagClass defineItem;
+    defineItem.Identifier = variableName;
+    defineItem.Key = variableName;
+    defineItem.Type = t4p::PhpTagClass::DEFINE;
+    defineItem.Signature = variableValue;
+    defineItem.ReturnType = UNICODE_STRING_SIMPLE("");
+    defineItem.Comment = comment;
+    defineItem.IsNative = false;
+    defineItem.LineNumber = lineNumber;
+    Current->Tags.push_back(defineItem);
+
+    defineItem.Identifier = QualifyName(namespaceName, variableName);
+    defineItem.Key = QualifyName(namespaceName, variableName);
+    Current->Tags.push_back(defineItem);
+}
+
+void t4p::TagCollectorClass::MethodFound(const UnicodeString& namespaceName, const UnicodeString& className,
+        const UnicodeString& methodName, const UnicodeString& signature, const UnicodeString& returnType,
+        const UnicodeString& comment, pelet::TokenClass::TokenIds visibility, bool isStatic, const int lineNumber,
+        bool hasVariableArguments) {
+    t4p::PhpTagClass item;
+    item.Identifier = methodName;
+    item.ClassName = className;
+    item.NamespaceName = namespaceName;
+    item.Key = methodName;
+    item.Type = t4p::PhpTagClass::METHOD;
+    if (!returnType.isEmpty()) {
+        item.Signature = returnType + UNICODE_STRING_SIMPLE(" ");
+    }
+
+    item.Signature += signature;
+    item.ReturnType = returnType;
+    item.Comment = comment;
+    switch (visibility) {
+    case pelet::TokenClass::PROTECTED:
+        item.IsProtected = true;
+        break;
+    case pelet::TokenClass::PRIVATE:
+        item.IsPrivate = true;
+        break;
+    default:
+        break;
+    }
+    item.IsStatic = isStatic;
+    item.IsNative = false;
+    item.LineNumber = lineNumber;
+    item.HasVariableArgs = hasVariableArguments;
+    Current->Tags.push_back(item);
+
+    // insert a complete name so that we can quickly lookup all methods for a single class
+    item.Key = className + UNICODE_STRING_SIMPLE("::") + methodName;
+    Current->Tags.push_back(item);
+
+    // insert a fully qualified name and method so that we can quickly lookup all methods
+    // for a namespaced class
+    item.Key = QualifyName(namespaceName, className) + UNICODE_STRING_SIMPLE("::") + methodName;
+    Current->Tags.push_back(item);
+}
+
+void t4p::TagCollectorClass::PropertyFound(const UnicodeString& namespaceName, const UnicodeString& className,
+        const UnicodeString& propertyName, const UnicodeString& propertyType, const UnicodeString& comment,
+        pelet::TokenClass::TokenIds visibility, bool isConst, bool isStatic, const int lineNumber) {
+    UnicodeString filteredProperty(propertyName);
+    if (!isStatic) {
+        // remove the siguil from the property name when the variable is not static;
+        // because when using non-static access ("->") the siguil is not used
+        // this affects the code completion functionality
+        filteredProperty.findAndReplace(UNICODE_STRING_SIMPLE("$"), UNICODE_STRING_SIMPLE(""));
+    }
+    t4p::PhpTagClass item;
+    item.Identifier = filteredProperty;
+    item.ClassName = className;
+    item.NamespaceName = namespaceName;
+    item.Key = filteredProperty;
+    item.Type = isConst ? t4p::PhpTagClass::CLASS_CONSTANT : t4p::PhpTagClass::MEMBER;
+    item.Signature =  className + UNICODE_STRING_SIMPLE("::") + filteredProperty;
+    item.ReturnType = propertyType;
+    item.Comment = comment;
+    switch (visibility) {
+    case pelet::TokenClass::PROTECTED:
+        item.IsProtected = true;
+        break;
+    case pelet::TokenClass::PRIVATE:
+        item.IsPrivate = true;
+        break;
+    default:
+        break;
+    }
+    item.IsStatic = isStatic;
+    item.IsNative = false;
+    item.LineNumber = lineNumber;
+    item.HasVariableArgs = false;
+    Current->Tags.push_back(item);
+
+    // insert a complete name so that we can quickly lookup all methods for a single class
+    item.Key = className + UNICODE_STRING_SIMPLE("::") + filteredProperty;
+    Current->Tags.push_back(item);
+
+    // insert a fully qualified name and method so that we can quickly lookup all methods
+    // for a namespaced class
+    item.Key = QualifyName(namespaceName, className) + UNICODE_STRING_SIMPLE("::") + filteredProperty;
+    Current->Tags.push_back(item);
+}
+
+void t4p::TagCollectorClass::FunctionFound(const UnicodeString& namespaceName, const UnicodeString& functionName,
+        const UnicodeString& signature, const UnicodeString& returnType, const UnicodeString& comment, const int lineNumber,
+        bool hasVariableArguments) {
+    t4p::PhpTagClass item;
+    item.Identifier = functionName;
+    item.NamespaceName = namespaceName;
+    item.Key = functionName;
+    item.Type = t4p::PhpTagClass::FUNCTION;
+    item.Signature = signature;
+    item.ReturnType = returnType;
+    item.Comment = comment;
+    item.IsNative = false;
+    item.LineNumber = lineNumber;
+    item.HasVariableArgs = hasVariableArguments;
+    Current->Tags.push_back(item);
+
+    AddNamespace(namespaceName);
+
+    // put in the namespace cache so that qualified name lookups work too
+    item.Identifier = QualifyName(namespaceName, functionName);
+    item.Key = QualifyName(namespaceName, functionName);
+    Current->Tags.push_back(item);
+}
@@ -0,0 +1,193 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGCOLLECTORCLASS_H_
+#define SRC_LANGUAGE_PHP_TAGCOLLECTORCLASS_H_
+
+#include <pelet/ParserClass.h>
+#include <unicode/unistr.h>
+#include <wx/string.h>
+#include <map>
+#include <vector>
+#include "globals/String.h"
+#include "language_php/PhpTagClass.h"
+
+namespace t4p {
+/**
+ * The tags that were parsed out of a single file. Parsed file tags are
+ * created by a TagCollectorClass and given to the TagParserClass, which
+ * is the only one that writes them to the tag database.
+ * Because the parsing and the writing may be done in different threads,
+ * this class holds only deep copies of strings.
+ */
+class ParsedFileTagsClass {
+ public:
+    /**
+     * the file_item_id of the file that was parsed
+     */
+    int FileTagId;
+
+    /**
+     * the full path of the file that was parsed; may be the name of a
+     * file that is not yet saved to disk
+     */
+    wxString FullPath;
+
+    /**
+     * the hash of the contents that were parsed; empty when the
+     * tags were parsed from a string
+     * @see t4p::FileTagContentHash
+     */
+    wxString ContentHash;
+
+    /**
+     * all classes, methods, functions, properties, defines that were found in
+     * the file; in the order that they were found. these do NOT include the
+     * namespace tags
+     */
+    std::vector<t4p::PhpTagClass> Tags;
+
+    /**
+     * the namespaces of any classes or functions that were found in
+     * the file. Each namespace will be listed once. The writer decides
+     * whether a namespace tag needs to be created, since a namespace
+     * may already be in the database.
+     */
+    std::vector<UnicodeString> NamespaceNames;
+
+    /**
+     * trait info for each class that uses a trait. The key to this map is
+     * the namespace + class name + trait name being parsed
+     * the value will always be a 2 item vector: item 0 is the fully qualified key and
+     * item 1 is the class only key
+     */
+    std::map<UnicodeString, std::vector<t4p::TraitTagClass>, t4p::UnicodeStringComparatorClass> Traits;
+
+    /**
+     * TRUE if the file could be opened and read. Files with parse errors
+     * are still considered parsed; we store whatever tags were found up to
+     * the error.
+     */
+    bool IsRead;
+
+    ParsedFileTagsClass();
+
+    /**
+     * remove all tags, so that this object can be re-used for another file
+     */
+    void Clear();
+};
+
+/**
+ * The tag collector is a pelet observer that turns the classes, functions,
+ * methods and properties found by the parser into PhpTagClass instances.
+ * The tag collector does not touch the database; the collected tags are
+ * written by the TagParserClass. This separation allows many collectors
+ * to parse files at the same time (each collector has its own parser)
+ * while a single thread does all of the writes.
+ */
+class TagCollectorClass : public pelet::ClassObserverClass,
+    public pelet::ClassMemberObserverClass,
+    public pelet::FunctionObserverClass {
+ public:
+    TagCollectorClass();
+
+    /**
+     * set the PHP version to handle
+     */
+    void SetVersion(pelet::Versions version);
+
+    /**
+     * Parses the given file and puts all of its tags in the given
+     * parsed object. Any previous contents of parsed are removed.
+     *
+     * @param fullPath the file to parse
+     * @param fileTagId the file_item_id of the file
+     * @param parsed the tags will be put here
+     * @return bool TRUE if the file could be opened
+     */
+    bool CollectFile(const wxString& fullPath, int fileTagId, t4p::ParsedFileTagsClass& parsed);
+
+    /**
+     * Parses the given code and puts all of its tags in the given
+     * parsed object. Any previous contents of parsed are removed.
+     *
+     * @param fullPath the name of the file that code belongs to
+     * @param fileTagId the file_item_id of the file
+     * @param code the PHP source code
+     * @param parsed the tags will be put here
+     */
+    void CollectString(const wxString& fullPath, int fileTagId, const UnicodeString& code, t4p::ParsedFileTagsClass& parsed);
+
+    void ClassFound(const UnicodeString& namespaceName, const UnicodeString& className,
+                    const UnicodeString& signature,
+                    const UnicodeString& baseClassName,
+                    const UnicodeString& implementsList,
+                    const UnicodeString& comment, const int lineNumber);
+
+    void DefineDeclarationFound(const UnicodeString& namespaceName, const UnicodeString& variableName, const UnicodeString& variableValue,
+                                const UnicodeString& comment, const int lineNumber);
+
+    void TraitAliasFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitUsedClassName,
+                         const UnicodeString& traitMethodName, const UnicodeString& alias, pelet::TokenClass::TokenIds visibility);
+
+    void TraitInsteadOfFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitUsedClassName,
+                             const UnicodeString& traitMethodName, const std::vector<UnicodeString>& insteadOfList);
+
+    void TraitUseFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& fullyQualifiedTraitName);
+
+    void MethodFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& methodName,
+                     const UnicodeString& signature, const UnicodeString& returnType, const UnicodeString& comment,
+                     pelet::TokenClass::TokenIds visibility, bool isStatic, const int lineNumber, bool hasVariableArguments);
+
+    void PropertyFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& propertyName,
+                       const UnicodeString& propertyType, const UnicodeString& comment,
+                       pelet::TokenClass::TokenIds visibility, bool isConst, bool isStatic, const int lineNumber);
+
+    void FunctionFound(const UnicodeString& namespaceName, const UnicodeString& methodName,
+                       const UnicodeString& signature, const UnicodeString& returnType, const UnicodeString& comment, const int lineNumber,
+                       bool hasVariableArguments);
+
+ private:
+    /**
+     * Used to parse through code for classes & methods
+     */
+    pelet::ParserClass Parser;
+
+    /**
+     * the object where found tags are put into. This class
+     * will not own this pointer; it is only valid while a Collect*
+     * method is running
+     */
+    t4p::ParsedFileTagsClass* Current;
+
+    /**
+     * adds the namespace to the current namespace list if it is not
+     * already there
+     */
+    void AddNamespace(const UnicodeString& namespaceName);
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGCOLLECTORCLASS_H_
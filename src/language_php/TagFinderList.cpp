@@ -24,9 +24,12 @@
  */
 #include "language_php/TagFinderList.h"
 #include <soci/sqlite3/soci-sqlite3.h>
+#include <map>
+#include <set>
 #include <vector>
 #include "globals/Assets.h"
 #include "language_php/DetectedTagFinderResultClass.h"
+#include "language_php/NativeTagImageClass.h"
 #include "language_php/ParsedTagFinderClass.h"
 
 t4p::TagFinderListClass::TagFinderListClass()
@@ -35,11 +38,19 @@ t4p::TagFinderListClass::TagFinderListClass()
     , DetectedTagDbSession()
     , TagParser()
     , TagFinder(TagDbSession)
+    , TagIndex()
+    , TagShards()
     , NativeTagFinder(NativeDbSession)
+    , NativeImage(NULL)
     , DetectedTagFinder(DetectedTagDbSession)
+    , TagService()
     , IsNativeTagFinderInit(false)
     , IsTagFinderInit(false)
-    , IsDetectedTagFinderInit(false) {
+    , IsDetectedTagFinderInit(false)
+    , ParentsMemo()
+    , TraitsMemo()
+    , MemoGeneration(-1)
+    , IsTagIndexUsed(false) {
 }
 
 t4p::TagFinderListClass::~TagFinderListClass() {
@@ -62,8 +73,11 @@ void t4p::TagFinderListClass::InitGlobalTag(const wxFileName& tagDbFileName,
     t4p::DeepCopy(TagParser.MiscFileExtensions, miscFileExtensions);
     IsTagFinderInit = t4p::SqliteOpen(TagDbSession, tagDbFileName.GetFullPath());
     if (IsTagFinderInit) {
+        t4p::SqliteSetStorageProfile(TagDbSession);
+        TagShards.Init(&TagDbSession, tagDbFileName);
         TagParser.SetVersion(version);
         TagParser.Init(&TagDbSession);
+        TagParser.SetTagShards(&TagShards);
     }
 }
 
@@ -90,6 +104,9 @@ void t4p::TagFinderListClass::CreateGlobalTag(const std::vector<wxString>& phpFi
 void t4p::TagFinderListClass::InitDetectorTag(const wxFileName& detectorDbFileName) {
     wxASSERT_MSG(!IsDetectedTagFinderInit, wxT("tag finder can only be initialized once"));
     IsDetectedTagFinderInit = t4p::SqliteOpen(DetectedTagDbSession, detectorDbFileName.GetFullPath());
+    if (IsDetectedTagFinderInit) {
+        t4p::SqliteSetStorageProfile(DetectedTagDbSession);
+    }
 }
 
 void t4p::TagFinderListClass::CreateDetectorTag() {
@@ -102,8 +119,74 @@ void t4p::TagFinderListClass::CreateDetectorTag() {
 }
 
 void t4p::TagFinderListClass::InitNativeTag(const wxFileName& nativeDbFileName) {
-    wxASSERT_MSG(!IsNativeTagFinderInit, wxT("native tag finder can only be initialized once"));
-    IsNativeTagFinderInit = t4p::SqliteOpen(NativeDbSession, nativeDbFileName.GetFullPath());
+    wxASSERT_MSG(!IsNativeTagFinderInit && !NativeImage, wxT("native tag finder can only be initialized once"));
+    NativeDbFileName = nativeDbFileName;
+
+    // the image is only generated for the db that is shipped
+    // with the app. the image has all of the native tags, we only need
+    // to open the db when the image is missing
+    if (nativeDbFileName == t4p::NativeFunctionsAsset()) {
+        NativeImage = t4p::NativeTagImage();
+    }
+    if (!NativeImage) {
+        OpenNativeTagFinder();
+    }
+
+    // the memoized parents may be missing the native classes
+    ParentsMemo.clear();
+    TraitsMemo.clear();
+}
+
+bool t4p::TagFinderListClass::OpenNativeTagFinder() {
+    if (IsNativeTagFinderInit || !NativeDbFileName.IsOk()) {
+        return IsNativeTagFinderInit;
+    }
+    IsNativeTagFinderInit = t4p::SqliteOpen(NativeDbSession, NativeDbFileName.GetFullPath());
+    if (IsNativeTagFinderInit) {
+        // the native db is part of the assets; it may be in a read-only location
+        t4p::SqliteSetStorageProfile(NativeDbSession, false);
+        IsNativeTagFinderInit = NativeTagFinder.InitNativeDb();
+    }
+    return IsNativeTagFinderInit;
+}
+
+bool t4p::TagFinderListClass::LoadTagIndex() {
+    if (!IsTagFinderInit) {
+        return false;
+    }
+    IsTagIndexUsed = true;
+    return TagIndex.Load(TagDbSession);
+}
+
+void t4p::TagFinderListClass::UseTagIndex() {
+    IsTagIndexUsed = IsTagFinderInit;
+}
+
+void t4p::TagFinderListClass::RefreshTagIndex() {
+    if (!IsTagFinderInit) {
+        return;
+    }
+
+    // the tags of a source that another connection created may be in
+    // a shard that is not yet attached
+    TagShards.Refresh();
+    if (IsTagIndexUsed) {
+        TagIndex.Refresh(TagDbSession);
+    }
+}
+
+bool t4p::TagFinderListClass::RefreshTagIndexChanges() {
+    if (!IsTagFinderInit) {
+        return true;
+    }
+    TagShards.Refresh();
+    if (!IsTagIndexUsed || TagIndex.RefreshChanges(TagDbSession)) {
+        return true;
+    }
+
+    // an out of date index gives wrong answers, the tag db does not
+    TagIndex.Clear();
+    return false;
 }
 
 void t4p::TagFinderListClass::Walk(t4p::DirectorySearchClass& search) {
@@ -111,31 +194,44 @@ void t4p::TagFinderListClass::Walk(t4p::DirectorySearchClass& search) {
 }
 
 std::vector<UnicodeString> t4p::TagFinderListClass::ClassParents(UnicodeString className, UnicodeString methodName) {
+    bool canMemoize = IsHierarchyMemoCurrent();
+    UnicodeString memoKey(className);
+    memoKey.foldCase();
+    if (canMemoize) {
+        std::map<UnicodeString, std::vector<UnicodeString>, t4p::UnicodeStringComparatorClass>::const_iterator it;
+        it = ParentsMemo.find(memoKey);
+        if (it != ParentsMemo.end()) {
+            return it->second;
+        }
+    }
     std::vector<UnicodeString> parents;
-    bool found = false;
     UnicodeString classToLookup = className;
-    do {
-        // each parent class may be located in any of the finders. in practice this code is not as slow
-        // as it looks; class hierarchies are usually not very deep (1-4 parents)
-        found = false;
-        UnicodeString parentClass;
-        if (IsTagFinderInit) {
-            parentClass = TagFinder.ParentClassName(classToLookup, 0);
-            if (!parentClass.isEmpty()) {
-                found = true;
-                parents.push_back(parentClass);
-                classToLookup = parentClass;
-            }
+    while (true) {
+        // each parent class may be located in any of the finders; when the
+        // project tags are in memory each level is a class graph lookup
+        UnicodeString parentClass = ParentClassName(classToLookup, 0);
+        if (parentClass.isEmpty() || parentClass.caseCompare(className, 0) == 0) {
+            break;
         }
-        if (IsNativeTagFinderInit) {
-            parentClass = NativeTagFinder.ParentClassName(classToLookup, 0);
-            if (!parentClass.isEmpty()) {
-                found = true;
-                parents.push_back(parentClass);
-                classToLookup = parentClass;
+
+        // guard against circular hierarchies (a class that extends one of its
+        // children); PHP does not allow them but the code may not be valid yet
+        bool isCycle = false;
+        for (size_t i = 0; i < parents.size(); ++i) {
+            if (parents[i].caseCompare(parentClass, 0) == 0) {
+                isCycle = true;
+                break;
             }
         }
-    } while (found);
+        if (isCycle) {
+            break;
+        }
+        parents.push_back(parentClass);
+        classToLookup = parentClass;
+    }
+    if (canMemoize) {
+        ParentsMemo[memoKey] = parents;
+    }
     return parents;
 }
 
@@ -143,27 +239,61 @@ std::vector<UnicodeString> t4p::TagFinderListClass::ClassUsedTraits(const Unicod
         const std::vector<UnicodeString>& parentClassNames,
         const UnicodeString& methodName,
         const std::vector<wxFileName>& sourceDirs) {
+    // the traits depend on the class, its parents and the sources
+    bool canMemoize = IsHierarchyMemoCurrent();
+    UnicodeString memoKey(className);
+    for (size_t i = 0; i < parentClassNames.size(); ++i) {
+        memoKey += UNICODE_STRING_SIMPLE(" ") + parentClassNames[i];
+    }
+    for (size_t i = 0; i < sourceDirs.size(); ++i) {
+        memoKey += UNICODE_STRING_SIMPLE("|") + t4p::WxToIcu(sourceDirs[i].GetPathWithSep());
+    }
+    memoKey.foldCase();
+    if (canMemoize) {
+        std::map<UnicodeString, std::vector<UnicodeString>, t4p::UnicodeStringComparatorClass>::const_iterator it;
+        it = TraitsMemo.find(memoKey);
+        if (it != TraitsMemo.end()) {
+            return it->second;
+        }
+    }
+
     // trait support; a class can use multiple traits; hence the different logic
     std::vector<UnicodeString> classesToLookup;
     classesToLookup.push_back(className);
     classesToLookup.insert(classesToLookup.end(), parentClassNames.begin(), parentClassNames.end());
     std::vector<UnicodeString> usedTraits;
+    std::set<UnicodeString, t4p::UnicodeStringComparatorClass> lookedUp;
     bool found = false;
     do {
         found = false;
         std::vector<UnicodeString> nextTraitsToLookup;
         for (std::vector<UnicodeString>::iterator it = classesToLookup.begin(); it != classesToLookup.end(); ++it) {
-            UnicodeString parentClass;
+            // guard against traits that use each other
+            UnicodeString folded(*it);
+            folded.foldCase();
+            if (!lookedUp.insert(folded).second) {
+                continue;
+            }
             if (IsTagFinderInit) {
-                std::vector<UnicodeString> traits = TagFinder.GetResourceTraits(*it, methodName, sourceDirs);
+                std::vector<UnicodeString> traits;
+                if (TagIndex.IsLoaded()) {
+                    TagIndex.ClassTraits(*it, sourceDirs, traits);
+                } else {
+                    traits = TagFinder.GetResourceTraits(*it, methodName, sourceDirs);
+                }
                 if (!traits.empty()) {
                     found = true;
                     nextTraitsToLookup.insert(nextTraitsToLookup.end(), traits.begin(), traits.end());
                     usedTraits.insert(usedTraits.end(), traits.begin(), traits.end());
                 }
             }
-            if (IsNativeTagFinderInit) {
-                std::vector<UnicodeString> traits = NativeTagFinder.GetResourceTraits(*it, methodName, sourceDirs);
+            if (NativeImage || IsNativeTagFinderInit) {
+                std::vector<UnicodeString> traits;
+                if (NativeImage) {
+                    NativeImage->ClassTraits(*it, traits);
+                } else {
+                    traits = NativeTagFinder.GetResourceTraits(*it, methodName, sourceDirs);
+                }
                 if (!traits.empty()) {
                     found = true;
                     nextTraitsToLookup.insert(nextTraitsToLookup.end(), traits.begin(), traits.end());
@@ -176,9 +306,29 @@ std::vector<UnicodeString> t4p::TagFinderListClass::ClassUsedTraits(const Unicod
         classesToLookup = nextTraitsToLookup;
     } while (found);
 
+    if (canMemoize) {
+        TraitsMemo[memoKey] = usedTraits;
+    }
     return usedTraits;
 }
 
+bool t4p::TagFinderListClass::IsHierarchyMemoCurrent() {
+    // when the project tags are not in memory we cannot know when
+    // they change
+    if (IsTagFinderInit && !TagIndex.IsLoaded()) {
+        ParentsMemo.clear();
+        TraitsMemo.clear();
+        return false;
+    }
+    int generation = IsTagFinderInit ? TagIndex.Generation() : 0;
+    if (generation != MemoGeneration) {
+        ParentsMemo.clear();
+        TraitsMemo.clear();
+        MemoGeneration = generation;
+    }
+    return true;
+}
+
 
 UnicodeString t4p::TagFinderListClass::ResolveResourceType(UnicodeString resourceToLookup, const std::vector<wxFileName>& sourceDirs) {
     UnicodeString type;
@@ -197,83 +347,145 @@ UnicodeString t4p::TagFinderListClass::ResolveResourceType(UnicodeString resourc
         }
     }
     if (type.isEmpty() && IsTagFinderInit) {
-        t4p::TagResultClass* tagResults = tagSearch.CreateExactResults();
-        if (TagFinder.Exec(tagResults)) {
-            // since we are doing fully qualified matches, all matches are from the inheritance chain; ie. all methods
-            // should have the same signature (return type)
-            tagResults->Next();
-
+        // since we are doing fully qualified matches, all matches are from the inheritance chain; ie. all methods
+        // should have the same signature (return type)
+        t4p::PhpTagClass tag;
+        bool found = false;
+        if (TagIndex.IsLoaded()) {
+            std::vector<t4p::PhpTagClass> indexMatches;
+            TagIndex.ExactMatches(tagSearch, indexMatches);
+            if (!indexMatches.empty()) {
+                tag = indexMatches[0];
+                found = true;
+            }
+        } else {
+            t4p::TagResultClass* tagResults = tagSearch.CreateExactResults();
+            if (TagFinder.Exec(tagResults)) {
+                tagResults->Next();
+                tag = tagResults->Tag;
+                found = true;
+            }
+            delete tagResults;
+        }
+        if (found) {
             UnicodeString fullyQualifiedClass;
-            if (tagResults->Tag.NamespaceName == UNICODE_STRING_SIMPLE("\\")) {
-                fullyQualifiedClass = tagResults->Tag.NamespaceName + tagResults->Tag.ClassName;
-            } else if (!tagResults->Tag.NamespaceName.isEmpty()) {
-                fullyQualifiedClass = tagResults->Tag.NamespaceName + UNICODE_STRING_SIMPLE("\\") + tagResults->Tag.ClassName;
+            if (tag.NamespaceName == UNICODE_STRING_SIMPLE("\\")) {
+                fullyQualifiedClass = tag.NamespaceName + tag.ClassName;
+            } else if (!tag.NamespaceName.isEmpty()) {
+                fullyQualifiedClass = tag.NamespaceName + UNICODE_STRING_SIMPLE("\\") + tag.ClassName;
             } else {
-                fullyQualifiedClass = tagResults->Tag.ClassName;
+                fullyQualifiedClass = tag.ClassName;
             }
 
             // if the given string was a class name, return the class name
             // if the given string was a method, return the method's return type
-            if (t4p::PhpTagClass::CLASS == tagResults->Tag.Type) {
+            if (t4p::PhpTagClass::CLASS == tag.Type) {
                 type = fullyQualifiedClass;
             } else {
                 // the parser will always return fully qualified class name for return type that is
                 // based on the namespace aliases
-                type = tagResults->Tag.ReturnType;
+                type = tag.ReturnType;
             }
         }
-        delete tagResults;
     }
-    if (type.isEmpty() && IsNativeTagFinderInit) {
+    if (type.isEmpty() && (NativeImage || IsNativeTagFinderInit)) {
         // tags in the native db file do not have a source_id
         // when we query do not use source_id
         std::vector<wxFileName> emptySourceDirs;
         tagSearch.SetSourceDirs(emptySourceDirs);
-        t4p::TagResultClass* tagResults = tagSearch.CreateExactResults();
-        if (NativeTagFinder.Exec(tagResults)) {
-            tagResults->Next();
-            type =  t4p::PhpTagClass::CLASS == tagResults->Tag.Type ? tagResults->Tag.ClassName : tagResults->Tag.ReturnType;
+        if (NativeImage) {
+            std::vector<t4p::PhpTagClass> nativeMatches;
+            NativeImage->ExactMatches(tagSearch, nativeMatches);
+            if (!nativeMatches.empty()) {
+                t4p::PhpTagClass tag = nativeMatches[0];
+                type =  t4p::PhpTagClass::CLASS == tag.Type ? tag.ClassName : tag.ReturnType;
+            }
+        } else {
+            t4p::TagResultClass* tagResults = tagSearch.CreateExactResults();
+            if (NativeTagFinder.Exec(tagResults)) {
+                tagResults->Next();
+                type =  t4p::PhpTagClass::CLASS == tagResults->Tag.Type ? tagResults->Tag.ClassName : tagResults->Tag.ReturnType;
+            }
+            delete tagResults;
         }
-        delete tagResults;
     }
     return type;
 }
 
 UnicodeString t4p::TagFinderListClass::ParentClassName(UnicodeString className, int fileTagId) {
     UnicodeString parent;
-    if (IsTagFinderInit) {
+    if (IsTagFinderInit && TagIndex.IsLoaded()) {
+        TagIndex.ParentClassName(className, parent);
+    } else if (IsTagFinderInit) {
         parent = TagFinder.ParentClassName(className, 0);
     }
-    if (parent.isEmpty() && IsNativeTagFinderInit) {
+    if (parent.isEmpty() && NativeImage) {
+        NativeImage->ParentClassName(className, parent);
+    } else if (parent.isEmpty() && IsNativeTagFinderInit) {
         parent = NativeTagFinder.ParentClassName(className, 0);
     }
     return parent;
 }
 
-void t4p::TagFinderListClass::ExactMatchesFromAll(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches,
+void t4p::TagFinderListClass::ExactProjectMatches(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches,
         const std::vector<wxFileName>& sourceDirs) {
     tagSearch.SetSourceDirs(sourceDirs);
-    t4p::TagResultClass* result = tagSearch.CreateExactResults();
-    if (IsTagFinderInit && TagFinder.Exec(result)) {
-        while (result->More()) {
-            result->Next();
-            matches.push_back(result->Tag);
+    if (IsTagFinderInit && TagIndex.IsLoaded()) {
+        TagIndex.ExactMatches(tagSearch, matches);
+    } else {
+        t4p::TagResultClass* result = tagSearch.CreateExactResults();
+        if (IsTagFinderInit && TagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next();
+                matches.push_back(result->Tag);
+            }
         }
+        delete result;
     }
-    delete result;
+}
+
+void t4p::TagFinderListClass::NearProjectMatches(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches,
+        const std::vector<wxFileName>& sourceDirs) {
+    tagSearch.SetSourceDirs(sourceDirs);
+    if (IsTagFinderInit && TagIndex.IsLoaded()) {
+        TagIndex.NearMatches(tagSearch, matches);
+    } else {
+        t4p::TagResultClass* result = tagSearch.CreateNearMatchResults();
+        if (IsTagFinderInit && TagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next();
+                matches.push_back(result->Tag);
+            }
+        }
+        delete result;
+    }
+}
+
+void t4p::TagFinderListClass::ExactMatchesFromAll(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches,
+        const std::vector<wxFileName>& sourceDirs) {
+    // the service only has the project tags
+    bool isServiceAnswered = TagService.IsOk() && TagService.ExactMatches(tagSearch, sourceDirs, matches);
+    if (!isServiceAnswered) {
+        ExactProjectMatches(tagSearch, matches, sourceDirs);
+    }
+    t4p::TagResultClass* result = NULL;
 
     // tags in the native db file do not have a source_id
     // when we query do not use source_id
     std::vector<wxFileName> emptyVector;
     tagSearch.SetSourceDirs(emptyVector);
-    result = tagSearch.CreateExactResults();
-    if (IsNativeTagFinderInit && NativeTagFinder.Exec(result)) {
-        while (result->More()) {
-            result->Next();
-            matches.push_back(result->Tag);
+    if (NativeImage) {
+        NativeImage->ExactMatches(tagSearch, matches);
+    } else {
+        result = tagSearch.CreateExactResults();
+        if (IsNativeTagFinderInit && NativeTagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next();
+                matches.push_back(result->Tag);
+            }
         }
+        delete result;
     }
-    delete result;
 
     tagSearch.SetSourceDirs(sourceDirs);
     if (IsDetectedTagFinderInit && !tagSearch.GetClassName().isEmpty()) {
@@ -294,28 +506,139 @@ void t4p::TagFinderListClass::NearMatchesFromAll(t4p::TagSearchClass& tagSearch,
         // empty query, do not attempt as we dont want to query for all tagsd
         return;
     }
+    // the service only has the project tags
+    bool isServiceAnswered = TagService.IsOk() && TagService.NearMatches(tagSearch, sourceDirs, matches);
+    if (!isServiceAnswered) {
+        NearProjectMatches(tagSearch, matches, sourceDirs);
+    }
+    t4p::TagResultClass* result = NULL;
+
+    // tags in the native db file do not have a source_id
+    // when we query do not use source_id
+    std::vector<wxFileName> emptyVector;
+    tagSearch.SetSourceDirs(emptyVector);
+    if (NativeImage) {
+        NativeImage->NearMatches(tagSearch, matches);
+    } else {
+        result = tagSearch.CreateNearMatchResults();
+        if (IsNativeTagFinderInit && NativeTagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next();
+                matches.push_back(result->Tag);
+            }
+        }
+        delete result;
+    }
+
     tagSearch.SetSourceDirs(sourceDirs);
-    t4p::TagResultClass* result = tagSearch.CreateNearMatchResults();
-    if (IsTagFinderInit && TagFinder.Exec(result)) {
-        while (result->More()) {
-            result->Next();
-            matches.push_back(result->Tag);
+    if (IsDetectedTagFinderInit && !tagSearch.GetClassName().isEmpty()) {
+        t4p::DetectedTagNearMatchMemberResultClass detectedResult;
+        detectedResult.Set(tagSearch.GetClassHierarchy(), tagSearch.GetMethodName(), tagSearch.GetSourceDirs());
+        if (DetectedTagFinder.Exec(&detectedResult)) {
+            while (detectedResult.More()) {
+                detectedResult.Next();
+                matches.push_back(detectedResult.Tag);
+            }
         }
     }
-    delete result;
+}
+
+void t4p::TagFinderListClass::ExactMatchesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches,
+        const std::vector<wxFileName>& sourceDirs) {
+    // the service and the native image have PhpTagClass objects
+    std::vector<t4p::PhpTagClass> tags;
+    tagSearch.SetSourceDirs(sourceDirs);
+    t4p::TagResultClass* result = NULL;
+
+    // the service only has the project tags
+    bool isServiceAnswered = TagService.IsOk() && TagService.ExactMatches(tagSearch, sourceDirs, tags);
+    if (isServiceAnswered) {
+        // native and detected tags are still queried below
+    } else if (IsTagFinderInit && TagIndex.IsLoaded()) {
+        TagIndex.ExactMatches(tagSearch, matches);
+    } else {
+        result = tagSearch.CreateExactResults();
+        if (IsTagFinderInit && TagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next(matches);
+            }
+        }
+        delete result;
+    }
 
     // tags in the native db file do not have a source_id
     // when we query do not use source_id
     std::vector<wxFileName> emptyVector;
     tagSearch.SetSourceDirs(emptyVector);
-    result = tagSearch.CreateNearMatchResults();
-    if (IsNativeTagFinderInit && NativeTagFinder.Exec(result)) {
-        while (result->More()) {
-            result->Next();
-            matches.push_back(result->Tag);
+    if (NativeImage) {
+        NativeImage->ExactMatches(tagSearch, tags);
+    } else {
+        result = tagSearch.CreateExactResults();
+        if (IsNativeTagFinderInit && NativeTagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next(matches);
+            }
         }
+        delete result;
+    }
+
+    tagSearch.SetSourceDirs(sourceDirs);
+    if (IsDetectedTagFinderInit && !tagSearch.GetClassName().isEmpty()) {
+        t4p::DetectedTagExactMemberResultClass detectedResult;
+        detectedResult.Set(tagSearch.GetClassHierarchy(), tagSearch.GetMethodName(), tagSearch.GetSourceDirs());
+        if (DetectedTagFinder.Exec(&detectedResult)) {
+            while (detectedResult.More()) {
+                detectedResult.Next();
+                tags.push_back(detectedResult.Tag);
+            }
+        }
+    }
+    matches.Append(tags);
+}
+
+void t4p::TagFinderListClass::NearMatchesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches,
+        const std::vector<wxFileName>& sourceDirs) {
+    if (tagSearch.GetClassName().isEmpty() && tagSearch.GetMethodName().isEmpty() && tagSearch.GetNamespaceName().length() <= 1) {
+        // empty query, do not attempt as we dont want to query for all tagsd
+        return;
+    }
+
+    // the service and the native image have PhpTagClass objects
+    std::vector<t4p::PhpTagClass> tags;
+    tagSearch.SetSourceDirs(sourceDirs);
+    t4p::TagResultClass* result = NULL;
+
+    // the service only has the project tags
+    bool isServiceAnswered = TagService.IsOk() && TagService.NearMatches(tagSearch, sourceDirs, tags);
+    if (isServiceAnswered) {
+        // native and detected tags are still queried below
+    } else if (IsTagFinderInit && TagIndex.IsLoaded()) {
+        TagIndex.NearMatches(tagSearch, matches);
+    } else {
+        result = tagSearch.CreateNearMatchResults();
+        if (IsTagFinderInit && TagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next(matches);
+            }
+        }
+        delete result;
+    }
+
+    // tags in the native db file do not have a source_id
+    // when we query do not use source_id
+    std::vector<wxFileName> emptyVector;
+    tagSearch.SetSourceDirs(emptyVector);
+    if (NativeImage) {
+        NativeImage->NearMatches(tagSearch, tags);
+    } else {
+        result = tagSearch.CreateNearMatchResults();
+        if (IsNativeTagFinderInit && NativeTagFinder.Exec(result)) {
+            while (result->More()) {
+                result->Next(matches);
+            }
+        }
+        delete result;
     }
-    delete result;
 
     tagSearch.SetSourceDirs(sourceDirs);
     if (IsDetectedTagFinderInit && !tagSearch.GetClassName().isEmpty()) {
@@ -324,10 +647,11 @@ void t4p::TagFinderListClass::NearMatchesFromAll(t4p::TagSearchClass& tagSearch,
         if (DetectedTagFinder.Exec(&detectedResult)) {
             while (detectedResult.More()) {
                 detectedResult.Next();
-                matches.push_back(detectedResult.Tag);
+                tags.push_back(detectedResult.Tag);
             }
         }
     }
+    matches.Append(tags);
 }
 
 void t4p::TagFinderListClass::ExactTraitAliasesFromAll(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) {
@@ -343,7 +667,9 @@ void t4p::TagFinderListClass::ExactTraitAliasesFromAll(t4p::TagSearchClass& tagS
             matches.push_back(traitAliases[i]);
         }
     }
-    if (IsNativeTagFinderInit && NativeTagFinder.Exec(&traitResult)) {
+    if (NativeImage) {
+        NativeImage->TraitAliases(tagSearch.GetClassHierarchy(), tagSearch.GetMethodName(), true, matches);
+    } else if (IsNativeTagFinderInit && NativeTagFinder.Exec(&traitResult)) {
         std::vector<t4p::PhpTagClass> traitAliases = traitResult.MatchesAsTags();
         for (size_t i = 0; i < traitAliases.size(); ++i) {
             matches.push_back(traitAliases[i]);
@@ -364,10 +690,24 @@ void t4p::TagFinderListClass::NearMatchTraitAliasesFromAll(t4p::TagSearchClass&
             matches.push_back(traitAliases[i]);
         }
     }
-    if (IsNativeTagFinderInit && NativeTagFinder.Exec(&traitResult)) {
+    if (NativeImage) {
+        NativeImage->TraitAliases(tagSearch.GetClassHierarchy(), tagSearch.GetMethodName(), false, matches);
+    } else if (IsNativeTagFinderInit && NativeTagFinder.Exec(&traitResult)) {
         std::vector<t4p::PhpTagClass> traitAliases = traitResult.MatchesAsTags();
         for (size_t i = 0; i < traitAliases.size(); ++i) {
             matches.push_back(traitAliases[i]);
         }
     }
 }
+
+void t4p::TagFinderListClass::ExactTraitAliasesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches) {
+    std::vector<t4p::PhpTagClass> traitAliases;
+    ExactTraitAliasesFromAll(tagSearch, traitAliases);
+    matches.Append(traitAliases);
+}
+
+void t4p::TagFinderListClass::NearMatchTraitAliasesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches) {
+    std::vector<t4p::PhpTagClass> traitAliases;
+    NearMatchTraitAliasesFromAll(tagSearch, traitAliases);
+    matches.Append(traitAliases);
+}
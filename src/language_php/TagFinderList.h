@@ -27,11 +27,18 @@
 
 #include <unicode/unistr.h>
 #include <wx/filename.h>
+#include <map>
 #include <vector>
 #include "language_php/ParsedTagFinderClass.h"
+#include "language_php/TagIndexClass.h"
 #include "language_php/TagParserClass.h"
+#include "language_php/TagServiceClass.h"
+#include "language_php/TagShardsClass.h"
 
 namespace t4p {
+// forward declaration, defined in another file
+class NativeTagImageClass;
+
 /**
  * A tag list contains all 3 tags db files used by Triumph.  All projects' tags
  * are stored in a SQLite file that persisted and then loaded when Triumph starts; this way
@@ -39,6 +46,12 @@ namespace t4p {
  * entire project. The tag list also contains tags db files for the
  * native functions (str_*, array_*) and any detected tags from the
  * TagDetectors database. This class is given to the TagCacheClass.
+ *
+ * Project tags can also be loaded into memory (see LoadTagIndex()); once
+ * loaded, project tag lookups are done in memory. The in-memory index is brought
+ * up to date with RefreshTagIndex(), which callers do once before a group of
+ * lookups. Likewise, native tags are looked up in the memory-mapped native
+ * tag image when it exists.
  */
 class TagFinderListClass {
  public:
@@ -62,18 +75,53 @@ class TagFinderListClass {
      */
     t4p::ParsedTagFinderClass TagFinder;
 
+    /**
+     * The in-memory copy of the project tags. It is used instead of
+     * TagFinder for exact / near matches when it is loaded.
+     */
+    t4p::TagIndexClass TagIndex;
+
+    /**
+     * The per-source shards of the tag db, attached to TagDbSession
+     */
+    t4p::TagShardsClass TagShards;
+
     /**
      * The object that will be used to lookup php native function tags
      */
     t4p::ParsedTagFinderClass NativeTagFinder;
 
+    /**
+     * The memory-mapped image of the native functions db. When it is
+     * available, it is used instead of NativeTagFinder for all lookups
+     * and the native db is not opened until OpenNativeTagFinder() is
+     * called. This class does NOT own this pointer; the image is shared
+     * by all threads.
+     */
+    const t4p::NativeTagImageClass* NativeImage;
+
+    /**
+     * The native functions db given to InitNativeTag()
+     */
+    wxFileName NativeDbFileName;
+
     /**
      * The object that will be used to lookup tags
      */
     t4p::SqliteFinderClass DetectedTagFinder;
 
     /**
-     * TRUE if NativeTagFinder has an opened and valid connection
+     * The connection to the tag service of the tag db, when one is running.
+     * It is not connected until TagService.Init() is called. While
+     * the service answers, ExactMatchesFromAll() and NearMatchesFromAll()
+     * are answered by the service instead of the finders of this list.
+     */
+    t4p::TagServiceClientClass TagService;
+
+    /**
+     * TRUE if NativeTagFinder has an opened and valid connection. When
+     * the native tag image is used, this is FALSE until
+     * OpenNativeTagFinder() is called.
      */
     bool IsNativeTagFinderInit;
 
@@ -131,12 +179,67 @@ class TagFinderListClass {
     void CreateDetectorTag();
 
     /**
-     * Opens the native functions SQLite file.
+     * Opens the native functions SQLite file. When the file is the
+     * native functions asset and its tag image is available, the image
+     * is used and the SQLite file is not opened.
      * @param nativeFunctionsDbFileName the full path to the SQLite native functions database.
      *        This full path MUST exist; it will never be created.
      */
     void InitNativeTag(const wxFileName& nativeFunctionsDbFileName);
 
+    /**
+     * Opens the native functions SQLite file given to InitNativeTag(), if
+     * it is not yet open. Only callers that need to query NativeTagFinder
+     * directly need to call this.
+     * @return bool TRUE if NativeTagFinder has an opened and valid connection
+     */
+    bool OpenNativeTagFinder();
+
+    /**
+     * Reads all of the project tags into memory. From then on, project tag
+     * lookups are done in memory; RefreshTagIndex() re-reads the tags that
+     * were written since then, by this list's TagParser or by another
+     * connection.
+     *
+     * This method should be called after InitGlobalTag() or CreateGlobalTag().
+     * Loading a large tag db takes some time, this should be called
+     * from a background thread.
+     *
+     * @return bool TRUE if the tags were loaded
+     */
+    bool LoadTagIndex();
+
+    /**
+     * Marks the project tags as being in memory without reading them; lookups
+     * go to the tag db until an index that was loaded in a background thread
+     * is swapped in (see RefreshTagIndexChanges()).
+     *
+     * This method should be called after InitGlobalTag() or CreateGlobalTag().
+     */
+    void UseTagIndex();
+
+    /**
+     * Re-reads the project tags that were written since the tag index was
+     * loaded or last refreshed, and attaches the tag shards that other
+     * connections created (see TagShardsClass::Refresh()). The tag index is
+     * not read if LoadTagIndex() was not called.
+     * This is a query to the tag db; call it once before a group of lookups
+     * (ie. once per code completion request) and not before each lookup.
+     */
+    void RefreshTagIndex();
+
+    /**
+     * Same as RefreshTagIndex(), except that the tag index is never
+     * completely re-read; this is quick enough to be called from the UI
+     * thread. When all of the tags need to be re-read the index is cleared,
+     * lookups then go to the tag db until the caller swaps in an index that
+     * was loaded in a background thread (see TagIndexClass::Swap()).
+     *
+     * @return bool FALSE if the tag index is used and all of its tags need
+     *         to be re-read
+     */
+    bool RefreshTagIndexChanges();
+
     /**
      * Will update the tag finder by calling Walk(); meaning that the next file
      * given by the directorySearch will be parsed and its resources will be stored
@@ -153,7 +256,8 @@ class TagFinderListClass {
     void SetVersion(pelet::Versions version);
 
     /**
-     *
+     * The result is memoized while the project tags are in memory (see
+     * LoadTagIndex()) and have not changed.
      *
      * @return vector of all of the classes that are parent classes of the given
      *         class. this method will search across all tag finders
@@ -162,6 +266,8 @@ class TagFinderListClass {
 
 
     /**
+     * The result is memoized in the same way as ClassParents().
+     *
      * @return vector of all of the traits that are used by any of the given class or parent classes.
      *         This method will search across all tag finders
      */
@@ -185,15 +291,33 @@ class TagFinderListClass {
      */
     UnicodeString ParentClassName(UnicodeString className, int fileTagId);
 
+    /**
+     * queries the project tags (the tag index, or the tag db when the index is not
+     * loaded) for resources that match tagSearch exactly. Any matched tags are
+     * appended to the matches vector. This is what the tag service answers with.
+     */
+    void ExactProjectMatches(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches, const std::vector<wxFileName>& sourceDirs);
+
+    /**
+     * queries the project tags for resources that nearly match tagSearch (begin with).
+     * Any matched tags are appended to the matches vector. This is what the tag
+     * service answers with.
+     */
+    void NearProjectMatches(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches, const std::vector<wxFileName>& sourceDirs);
+
     /**
      * queries all tag finders for resources that match tagSearch exactly. Any matched tags are
-     * appended to the matches vector.
+     * appended to the matches vector. When the tag service is connected, the
+     * service is queried for the project tags instead of the tag db; native
+     * and detected tags are always queried in-process.
      */
     void ExactMatchesFromAll(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches, const std::vector<wxFileName>& sourceDirs);
 
     /**
      * queries all tag finders for resources that nearly match tagSearch (begin with). Any matched tags are
-     * appended to the matches vector.
+     * appended to the matches vector. When the tag service is connected, the
+     * service is queried for the project tags instead of the tag db; native
+     * and detected tags are always queried in-process.
      */
     void NearMatchesFromAll(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches, const std::vector<wxFileName>& sourceDirs);
 
@@ -209,7 +333,55 @@ class TagFinderListClass {
      */
     void NearMatchTraitAliasesFromAll(t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches);
 
+    /**
+     * same as ExactMatchesFromAll() but the rows of the tag dbs are appended
+     * to the list as they are read, without building a PhpTagClass for each.
+     */
+    void ExactMatchesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches, const std::vector<wxFileName>& sourceDirs);
+
+    /**
+     * same as NearMatchesFromAll() but the rows of the tag dbs are appended
+     * to the list as they are read, without building a PhpTagClass for each.
+     */
+    void NearMatchesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches, const std::vector<wxFileName>& sourceDirs);
+
+    /**
+     * same as ExactTraitAliasesFromAll(), the aliases are appended to the list
+     */
+    void ExactTraitAliasesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches);
+
+    /**
+     * same as NearMatchTraitAliasesFromAll(), the aliases are appended to the list
+     */
+    void NearMatchTraitAliasesFromAll(t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches);
+
  private:
+    /**
+     * clears the memoized parents and traits if the project tags
+     * have changed since they were computed.
+     *
+     * @return bool TRUE if results can be memoized; FALSE when the project
+     *         tags are not in memory since then we cannot know when they change
+     */
+    bool IsHierarchyMemoCurrent();
+
+    /**
+     * the memoized results of ClassParents() and ClassUsedTraits(), keyed
+     * by the case folded arguments
+     */
+    std::map<UnicodeString, std::vector<UnicodeString>, t4p::UnicodeStringComparatorClass> ParentsMemo;
+    std::map<UnicodeString, std::vector<UnicodeString>, t4p::UnicodeStringComparatorClass> TraitsMemo;
+
+    /**
+     * the TagIndex generation that the memoized results were computed from
+     */
+    int MemoGeneration;
+
+    /**
+     * TRUE if LoadTagIndex() was called, then RefreshTagIndex() keeps
+     * the index up to date
+     */
+    bool IsTagIndexUsed;
 };
 }  // namespace t4p
 
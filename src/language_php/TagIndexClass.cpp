@@ -0,0 +1,1039 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagIndexClass.h"
+#include <unicode/uchar.h>
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/String.h"
+
+/**
+ * the maximum amount of tags returned by a single query; same as the
+ * LIMIT used by the TagResultClass queries
+ */
+static const size_t MATCH_LIMIT = 100;
+
+/**
+ * when more than this many files changed since the last refresh, it is
+ * faster to read all tags than to remove and re-read each file
+ */
+static const size_t REFRESH_FILE_LIMIT = 2000;
+
+/**
+ * bits of the Flags column
+ */
+static const int FLAG_PROTECTED = 1;
+static const int FLAG_PRIVATE = 2;
+static const int FLAG_STATIC = 4;
+static const int FLAG_DYNAMIC = 8;
+static const int FLAG_NATIVE = 16;
+static const int FLAG_VARIABLE_ARGS = 32;
+
+/**
+ * @return the key folded one character at a time; the
+ * same folding is done to the keys being looked up
+ */
+static UnicodeString FoldKey(const UnicodeString& key) {
+    UnicodeString folded(key);
+    for (int32_t i = 0; i < folded.length(); ++i) {
+        folded.setCharAt(i, static_cast<UChar>(u_foldCase(folded.charAt(i), U_FOLD_CASE_DEFAULT)));
+    }
+    return folded;
+}
+
+/**
+ * compares a folded key to a key that has not been folded, folding each
+ * character of the key as needed.
+ *
+ * @return negative, zero, or positive if folded is less than, equal to, or
+ *         greater than key
+ */
+static int CompareFolded(const UnicodeString& folded, const UnicodeString& key) {
+    int32_t length = folded.length() < key.length() ? folded.length() : key.length();
+    for (int32_t i = 0; i < length; ++i) {
+        UChar a = folded.charAt(i);
+        UChar b = static_cast<UChar>(u_foldCase(key.charAt(i), U_FOLD_CASE_DEFAULT));
+        if (a != b) {
+            return a < b ? -1 : 1;
+        }
+    }
+    return folded.length() - key.length();
+}
+
+/**
+ * @return TRUE if folded starts with key; ignoring case
+ */
+static bool StartsWithFolded(const UnicodeString& folded, const UnicodeString& key) {
+    if (folded.length() < key.length()) {
+        return false;
+    }
+    for (int32_t i = 0; i < key.length(); ++i) {
+        if (folded.charAt(i) != static_cast<UChar>(u_foldCase(key.charAt(i), U_FOLD_CASE_DEFAULT))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace t4p {
+/**
+ * compares tag positions by their folded key. Also compares
+ * a tag position against a key, so that it can be used
+ * in binary searches.
+ */
+class TagIndexKeyComparatorClass {
+ public:
+    TagIndexKeyComparatorClass(const std::vector<UnicodeString>& strings, const std::vector<int>& foldedKeys)
+        : Strings(strings)
+        , FoldedKeys(foldedKeys) {
+    }
+
+    bool operator()(int a, int b) const {
+        return Strings[FoldedKeys[a]] < Strings[FoldedKeys[b]];
+    }
+
+    bool operator()(int a, const UnicodeString& key) const {
+        return CompareFolded(Strings[FoldedKeys[a]], key) < 0;
+    }
+
+    bool operator()(const UnicodeString& key, int a) const {
+        return CompareFolded(Strings[FoldedKeys[a]], key) > 0;
+    }
+
+ private:
+    const std::vector<UnicodeString>& Strings;
+    const std::vector<int>& FoldedKeys;
+};
+}  // namespace t4p
+
+/**
+ * appends name to namespace
+ */
+static UnicodeString QualifyName(const UnicodeString& namespaceName, const UnicodeString& name) {
+    UnicodeString qualifiedName;
+    qualifiedName.append(namespaceName);
+    if (!qualifiedName.endsWith(UNICODE_STRING_SIMPLE("\\"))) {
+        qualifiedName.append(UNICODE_STRING_SIMPLE("\\"));
+    }
+    qualifiedName.append(name);
+    return qualifiedName;
+}
+
+/**
+ * removes the items of column that are not kept; newPositions[i] is the
+ * new position of the ith item or -1 if the item is to be removed
+ */
+static void CompactColumn(std::vector<int>& column, const std::vector<int>& newPositions) {
+    size_t kept = 0;
+    for (size_t i = 0; i < newPositions.size(); ++i) {
+        if (newPositions[i] >= 0) {
+            column[newPositions[i]] = column[i];
+            kept++;
+        }
+    }
+    column.resize(kept);
+}
+
+static std::vector<int> NonMemberTypes() {
+    std::vector<int> types;
+    types.push_back(t4p::PhpTagClass::DEFINE);
+    types.push_back(t4p::PhpTagClass::CLASS);
+    types.push_back(t4p::PhpTagClass::FUNCTION);
+    return types;
+}
+
+static std::vector<int> MemberTypes() {
+    std::vector<int> types;
+    types.push_back(t4p::PhpTagClass::CLASS_CONSTANT);
+    types.push_back(t4p::PhpTagClass::MEMBER);
+    types.push_back(t4p::PhpTagClass::METHOD);
+    return types;
+}
+
+static int TypeMask(const std::vector<int>& types) {
+    int mask = 0;
+    for (size_t i = 0; i < types.size(); ++i) {
+        mask |= 1 << types[i];
+    }
+    return mask;
+}
+
+t4p::TagIndexClass::TagIndexClass()
+    : Strings()
+    , StringIds()
+    , Ids()
+    , FileTagIds()
+    , SourceIds()
+    , Keys()
+    , FoldedKeys()
+    , Identifiers()
+    , ClassNames()
+    , NamespaceNames()
+    , Signatures()
+    , ReturnTypes()
+    , Comments()
+    , Types()
+    , Flags()
+    , LineNumbers()
+    , KeyOrder()
+    , Trie()
+    , IsTrieBuilt(false)
+    , Fuzzy()
+    , IsFuzzyBuilt(false)
+    , Graph()
+    , Files()
+    , Sources()
+    , LastChangeId(0)
+    , GenerationCount(0)
+    , Loaded(false) {
+}
+
+bool t4p::TagIndexClass::Load(soci::session& session) {
+    Clear();
+
+    // get the last change before reading, so that any files written
+    // while we read are read again on the next refresh
+    int minChangeId = 0;
+    int maxChangeId = 0;
+    if (!ReadChangeRange(session, minChangeId, maxChangeId)) {
+        return false;
+    }
+    std::vector<int> allFiles;
+    std::string sql;
+    sql += "SELECT id, file_item_id, source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, ";
+    sql += "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, line_number ";
+    sql += "FROM resources";
+    if (!ReadSources(session) || !ReadFiles(session, allFiles) || !ReadTags(session, sql)
+            || !ReadTraits(session, allFiles)) {
+        Clear();
+        return false;
+    }
+    MergeKeyOrder(0);
+    BuildTrie();
+    BuildFuzzy();
+    LastChangeId = maxChangeId;
+    GenerationCount++;
+    Loaded = true;
+    return true;
+}
+
+bool t4p::TagIndexClass::Refresh(soci::session& session) {
+    if (RefreshChanges(session)) {
+        return true;
+    }
+    return Load(session);
+}
+
+bool t4p::TagIndexClass::RefreshChanges(soci::session& session) {
+    if (!Loaded) {
+        return false;
+    }
+    int minChangeId = 0;
+    int maxChangeId = 0;
+    if (!ReadChangeRange(session, minChangeId, maxChangeId)) {
+        return Loaded;
+    }
+    if (maxChangeId == LastChangeId) {
+        return true;
+    }
+    if (maxChangeId < LastChangeId || minChangeId > (LastChangeId + 1)) {
+        // the db was re-created or the changes we have not seen
+        // were pruned
+        return false;
+    }
+    std::set<int> changedFileTagIds;
+    bool reloadAll = false;
+    try {
+        int fileTagId = 0;
+        soci::statement stmt = (session.prepare <<
+                                "SELECT file_item_id FROM tag_changes WHERE tag_change_id > ? AND tag_change_id <= ?",
+                                soci::use(LastChangeId), soci::use(maxChangeId), soci::into(fileTagId));
+        if (stmt.execute(true)) {
+            do {
+                // zero means that too many files changed to list
+                reloadAll = fileTagId == 0;
+                changedFileTagIds.insert(fileTagId);
+            } while (!reloadAll && stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return Loaded;
+    }
+    if (reloadAll || changedFileTagIds.size() > REFRESH_FILE_LIMIT) {
+        return false;
+    }
+    std::vector<int> fileTagIds(changedFileTagIds.begin(), changedFileTagIds.end());
+    LoadFileTags(session, fileTagIds);
+    if (Loaded) {
+        LastChangeId = maxChangeId;
+    }
+    return Loaded;
+}
+
+void t4p::TagIndexClass::Swap(t4p::TagIndexClass& other) {
+    Strings.swap(other.Strings);
+    StringIds.swap(other.StringIds);
+    Ids.swap(other.Ids);
+    FileTagIds.swap(other.FileTagIds);
+    SourceIds.swap(other.SourceIds);
+    Keys.swap(other.Keys);
+    FoldedKeys.swap(other.FoldedKeys);
+    Identifiers.swap(other.Identifiers);
+    ClassNames.swap(other.ClassNames);
+    NamespaceNames.swap(other.NamespaceNames);
+    Signatures.swap(other.Signatures);
+    ReturnTypes.swap(other.ReturnTypes);
+    Comments.swap(other.Comments);
+    Types.swap(other.Types);
+    Flags.swap(other.Flags);
+    LineNumbers.swap(other.LineNumbers);
+    KeyOrder.swap(other.KeyOrder);
+    Trie.Swap(other.Trie);
+    std::swap(IsTrieBuilt, other.IsTrieBuilt);
+    Fuzzy.Swap(other.Fuzzy);
+    std::swap(IsFuzzyBuilt, other.IsFuzzyBuilt);
+    Graph.Swap(other.Graph);
+    Files.swap(other.Files);
+    Sources.swap(other.Sources);
+    std::swap(LastChangeId, other.LastChangeId);
+    std::swap(Loaded, other.Loaded);
+
+    // the generations are not swapped; results computed from
+    // either index are out of date
+    GenerationCount++;
+    other.GenerationCount++;
+}
+
+void t4p::TagIndexClass::LoadFileTags(soci::session& session, const std::vector<int>& fileTagIds) {
+    if (!Loaded || fileTagIds.empty()) {
+        return;
+    }
+    RemoveFileTags(fileTagIds);
+
+    std::ostringstream stream;
+    stream << "SELECT id, file_item_id, source_id, key, identifier, class_name, type, namespace_name, signature, return_type, comment, ";
+    stream << "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, line_number ";
+    stream << "FROM resources WHERE file_item_id IN (";
+    for (size_t i = 0; i < fileTagIds.size(); ++i) {
+        stream << fileTagIds[i];
+        if (i < (fileTagIds.size() - 1)) {
+            stream << ",";
+        }
+    }
+    stream << ")";
+
+    // the files may be from a new source
+    size_t start = Ids.size();
+    if (!ReadSources(session) || !ReadFiles(session, fileTagIds) || !ReadTags(session, stream.str())
+            || !ReadTraits(session, fileTagIds)) {
+        // cannot trust the index anymore
+        Clear();
+        return;
+    }
+    MergeKeyOrder(start);
+    GenerationCount++;
+}
+
+void t4p::TagIndexClass::RemoveFileTags(const std::vector<int>& fileTagIds) {
+    if (fileTagIds.empty()) {
+        return;
+    }
+    std::set<int> toRemove(fileTagIds.begin(), fileTagIds.end());
+    std::vector<int> newPositions(Ids.size(), -1);
+    int kept = 0;
+    for (size_t i = 0; i < Ids.size(); ++i) {
+        if (toRemove.count(FileTagIds[i]) == 0) {
+            newPositions[i] = kept;
+            kept++;
+        }
+    }
+    if (static_cast<size_t>(kept) != Ids.size()) {
+        CompactColumn(Ids, newPositions);
+        CompactColumn(FileTagIds, newPositions);
+        CompactColumn(SourceIds, newPositions);
+        CompactColumn(Keys, newPositions);
+        CompactColumn(FoldedKeys, newPositions);
+        CompactColumn(Identifiers, newPositions);
+        CompactColumn(ClassNames, newPositions);
+        CompactColumn(NamespaceNames, newPositions);
+        CompactColumn(Signatures, newPositions);
+        CompactColumn(ReturnTypes, newPositions);
+        CompactColumn(Comments, newPositions);
+        CompactColumn(Types, newPositions);
+        CompactColumn(Flags, newPositions);
+        CompactColumn(LineNumbers, newPositions);
+
+        // removing items does not change the order of the remaining
+        // items, only their position
+        std::vector<int> keyOrder;
+        keyOrder.reserve(kept);
+        for (size_t i = 0; i < KeyOrder.size(); ++i) {
+            if (newPositions[KeyOrder[i]] >= 0) {
+                keyOrder.push_back(newPositions[KeyOrder[i]]);
+            }
+        }
+        KeyOrder.swap(keyOrder);
+        IsTrieBuilt = false;
+    }
+    for (std::set<int>::const_iterator it = toRemove.begin(); it != toRemove.end(); ++it) {
+        Files.erase(*it);
+    }
+    Graph.RemoveFiles(fileTagIds);
+    IsFuzzyBuilt = false;
+    GenerationCount++;
+
+    // note that strings are not removed from the string pool, they
+    // will be re-used when the file is re-parsed; the pool is
+    // compacted on the next Load()
+}
+
+void t4p::TagIndexClass::Clear() {
+    Strings.clear();
+    StringIds.clear();
+    Ids.clear();
+    FileTagIds.clear();
+    SourceIds.clear();
+    Keys.clear();
+    FoldedKeys.clear();
+    Identifiers.clear();
+    ClassNames.clear();
+    NamespaceNames.clear();
+    Signatures.clear();
+    ReturnTypes.clear();
+    Comments.clear();
+    Types.clear();
+    Flags.clear();
+    LineNumbers.clear();
+    KeyOrder.clear();
+    Trie.Clear();
+    IsTrieBuilt = false;
+    Fuzzy.Clear();
+    IsFuzzyBuilt = false;
+    Graph.Clear();
+    Files.clear();
+    Sources.clear();
+    LastChangeId = 0;
+    GenerationCount++;
+    Loaded = false;
+}
+
+bool t4p::TagIndexClass::IsLoaded() const {
+    return Loaded;
+}
+
+size_t t4p::TagIndexClass::Count() const {
+    return Ids.size();
+}
+
+int t4p::TagIndexClass::Generation() const {
+    return GenerationCount;
+}
+
+void t4p::TagIndexClass::ExactMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) {
+    std::vector<int> rows;
+    ExactMatchRows(tagSearch, rows);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::NearMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches) {
+    std::vector<int> rows;
+    NearMatchRows(tagSearch, rows);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::ExactMatches(const t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches) {
+    std::vector<int> rows;
+    ExactMatchRows(tagSearch, rows);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::NearMatches(const t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches) {
+    std::vector<int> rows;
+    NearMatchRows(tagSearch, rows);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::ExactMatchRows(const t4p::TagSearchClass& tagSearch, std::vector<int>& rows) {
+    std::vector<int> sourceIds;
+    if (!SourceIdsForDirs(tagSearch.GetSourceDirs(), sourceIds)) {
+        return;
+    }
+    BuildTrie();
+    if (t4p::TagSearchClass::CLASS_NAME_METHOD_NAME == tagSearch.GetResourceType()) {
+        // check the entire class hierachy
+        std::vector<UnicodeString> classHierarchy = tagSearch.GetParentClasses();
+        std::vector<UnicodeString> traits = tagSearch.GetTraits();
+        classHierarchy.insert(classHierarchy.end(), traits.begin(), traits.end());
+        classHierarchy.push_back(QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName()));
+        for (size_t i = 0; i < classHierarchy.size(); ++i) {
+            UnicodeString key = classHierarchy[i] + UNICODE_STRING_SIMPLE("::") + tagSearch.GetMethodName();
+            Match(key, false, MemberTypes(), sourceIds, 0, false, MATCH_LIMIT, rows);
+        }
+    } else if (t4p::TagSearchClass::NAMESPACE_NAME == tagSearch.GetResourceType()) {
+        UnicodeString key = QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName());
+        Match(key, false, NonMemberTypes(), sourceIds, 0, false, MATCH_LIMIT, rows);
+    } else if (!tagSearch.GetClassName().isEmpty()) {
+        Match(tagSearch.GetClassName(), false, NonMemberTypes(), sourceIds, 0, false, MATCH_LIMIT, rows);
+    } else {
+        Match(tagSearch.GetFileName(), false, NonMemberTypes(), sourceIds, 0, false, MATCH_LIMIT, rows);
+    }
+    SortRows(rows, MATCH_LIMIT);
+}
+
+void t4p::TagIndexClass::NearMatchRows(const t4p::TagSearchClass& tagSearch, std::vector<int>& rows) {
+    if (t4p::TagSearchClass::CLASS_NAME_METHOD_NAME == tagSearch.GetResourceType() && !tagSearch.GetClassName().isEmpty()) {
+        std::vector<int> sourceIds;
+        if (!SourceIdsForDirs(tagSearch.GetSourceDirs(), sourceIds)) {
+            return;
+        }
+        BuildTrie();
+
+        // check the entire class hierachy
+        std::vector<UnicodeString> classHierarchy = tagSearch.GetParentClasses();
+        if (tagSearch.GetNamespaceName().isEmpty()) {
+            classHierarchy.push_back(tagSearch.GetClassName());
+        } else {
+            classHierarchy.push_back(QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName()));
+        }
+        std::vector<UnicodeString> traits = tagSearch.GetTraits();
+        classHierarchy.insert(classHierarchy.end(), traits.begin(), traits.end());
+        for (size_t i = 0; i < classHierarchy.size(); ++i) {
+            UnicodeString key = classHierarchy[i] + UNICODE_STRING_SIMPLE("::") + tagSearch.GetMethodName();
+            Match(key, true, MemberTypes(), sourceIds, tagSearch.GetFileItemId(), false, MATCH_LIMIT, rows);
+        }
+        SortRows(rows, MATCH_LIMIT);
+    } else if (t4p::TagSearchClass::CLASS_NAME_METHOD_NAME == tagSearch.GetResourceType()) {
+        NearMatchMemberOnlyRows(tagSearch.GetMethodName(), tagSearch.GetSourceDirs(), rows);
+    } else if (t4p::TagSearchClass::NAMESPACE_NAME == tagSearch.GetResourceType()) {
+        // needle identifier contains a namespace operator; but it may be
+        // a namespace or a fully qualified name
+        std::vector<int> types = NonMemberTypes();
+        types.push_back(t4p::PhpTagClass::NAMESPACE);
+        UnicodeString key = QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName());
+        NearMatchNonMemberRows(key, types, tagSearch.GetSourceDirs(), rows);
+    } else if (!tagSearch.GetClassName().isEmpty()) {
+        // if query does not have a namespace then get the non-namespaced tags
+        UnicodeString key;
+        if (tagSearch.GetNamespaceName().isEmpty()) {
+            key = tagSearch.GetClassName();
+        } else {
+            key = QualifyName(tagSearch.GetNamespaceName(), tagSearch.GetClassName());
+        }
+        NearMatchNonMemberRows(key, NonMemberTypes(), tagSearch.GetSourceDirs(), rows);
+    } else {
+        NearMatchNonMemberRows(tagSearch.GetFileName(), NonMemberTypes(), tagSearch.GetSourceDirs(), rows);
+    }
+}
+
+void t4p::TagIndexClass::NearMatchNonMembers(const UnicodeString& key, const std::vector<int>& types,
+        const std::vector<wxFileName>& sourceDirs, std::vector<t4p::PhpTagClass>& matches) {
+    std::vector<int> rows;
+    NearMatchNonMemberRows(key, types, sourceDirs, rows);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::NearMatchNonMemberRows(const UnicodeString& key, const std::vector<int>& types,
+        const std::vector<wxFileName>& sourceDirs, std::vector<int>& rows) {
+    std::vector<int> sourceIds;
+    if (!SourceIdsForDirs(sourceDirs, sourceIds)) {
+        return;
+    }
+    BuildTrie();
+    Match(key, true, types, sourceIds, 0, false, MATCH_LIMIT, rows);
+    SortRows(rows, MATCH_LIMIT);
+}
+
+void t4p::TagIndexClass::NearMatchMembersOnly(const UnicodeString& memberName, const std::vector<wxFileName>& sourceDirs,
+        std::vector<t4p::PhpTagClass>& matches) {
+    std::vector<int> rows;
+    NearMatchMemberOnlyRows(memberName, sourceDirs, rows);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::NearMatchMemberOnlyRows(const UnicodeString& memberName, const std::vector<wxFileName>& sourceDirs,
+        std::vector<int>& rows) {
+    std::vector<int> sourceIds;
+    if (!SourceIdsForDirs(sourceDirs, sourceIds)) {
+        return;
+    }
+    BuildTrie();
+
+    // make sure to NOT get fully qualified  matches (key=identifier)
+    Match(memberName, true, MemberTypes(), sourceIds, 0, true, MATCH_LIMIT, rows);
+    SortRows(rows, MATCH_LIMIT);
+}
+
+void t4p::TagIndexClass::AllMembers(const std::vector<UnicodeString>& classNames, const std::vector<wxFileName>& sourceDirs,
+                                    std::vector<t4p::PhpTagClass>& matches) {
+    std::vector<int> sourceIds;
+    if (!SourceIdsForDirs(sourceDirs, sourceIds)) {
+        return;
+    }
+    BuildTrie();
+    std::vector<int> rows;
+    for (size_t i = 0; i < classNames.size(); ++i) {
+        UnicodeString key = classNames[i] + UNICODE_STRING_SIMPLE("::");
+        Match(key, true, MemberTypes(), sourceIds, 0, false, 0, rows);
+    }
+    SortRows(rows, 0);
+    AppendMatches(rows, matches);
+}
+
+void t4p::TagIndexClass::FuzzyMatches(const UnicodeString& query, const std::vector<wxFileName>& sourceDirs, size_t limit,
+                                      std::vector<t4p::FuzzyMatchClass>& matches) {
+    matches.clear();
+    std::vector<int> sourceIds;
+    if (!SourceIdsForDirs(sourceDirs, sourceIds)) {
+        return;
+    }
+    BuildFuzzy();
+    Fuzzy.Match(query, sourceIds, limit, matches);
+}
+
+t4p::PhpTagClass t4p::TagIndexClass::FuzzyMatchTag(const t4p::FuzzyMatchClass& match) const {
+    return TagAt(match.Payload);
+}
+
+t4p::FileTagClass t4p::TagIndexClass::FuzzyMatchFile(const t4p::FuzzyMatchClass& match) const {
+    t4p::FileTagClass fileTag;
+    std::map<int, t4p::FileTagClass>::const_iterator file = Files.find(match.Payload);
+    if (file != Files.end()) {
+        fileTag = file->second;
+    }
+    return fileTag;
+}
+
+bool t4p::TagIndexClass::ParentClassName(const UnicodeString& className, UnicodeString& parentClassName) const {
+    return Graph.ParentClassName(className, parentClassName);
+}
+
+void t4p::TagIndexClass::ClassTraits(const UnicodeString& className, const std::vector<wxFileName>& sourceDirs,
+                                     std::vector<UnicodeString>& traits) const {
+    std::vector<int> sourceIds;
+    if (!SourceIdsForDirs(sourceDirs, sourceIds)) {
+        return;
+    }
+    Graph.Traits(className, sourceIds, traits);
+}
+
+int t4p::TagIndexClass::Intern(const UnicodeString& str) {
+    std::map<UnicodeString, int, t4p::UnicodeStringComparatorClass>::const_iterator it = StringIds.find(str);
+    if (it != StringIds.end()) {
+        return it->second;
+    }
+    int id = static_cast<int>(Strings.size());
+    Strings.push_back(str);
+    StringIds[str] = id;
+    return id;
+}
+
+bool t4p::TagIndexClass::ReadTags(soci::session& session, const std::string& sql) {
+    int id;
+    int fileTagId;
+    int sourceId;
+    std::string key;
+    std::string identifier;
+    std::string className;
+    int type;
+    std::string namespaceName;
+    std::string signature;
+    std::string returnType;
+    std::string comment;
+    int isProtected;
+    int isPrivate;
+    int isStatic;
+    int isDynamic;
+    int isNative;
+    int hasVariableArgs;
+    int lineNumber;
+    soci::indicator fileTagIdIndicator;
+    try {
+        soci::statement stmt = (session.prepare << sql,
+                                soci::into(id), soci::into(fileTagId, fileTagIdIndicator), soci::into(sourceId),
+                                soci::into(key), soci::into(identifier), soci::into(className),
+                                soci::into(type), soci::into(namespaceName), soci::into(signature),
+                                soci::into(returnType), soci::into(comment),
+                                soci::into(isProtected), soci::into(isPrivate),
+                                soci::into(isStatic), soci::into(isDynamic), soci::into(isNative), soci::into(hasVariableArgs),
+                                soci::into(lineNumber));
+        if (stmt.execute(true)) {
+            do {
+                UnicodeString uniKey = t4p::CharToIcu(key.c_str());
+                UnicodeString foldedKey = FoldKey(uniKey);
+
+                Ids.push_back(id);
+                FileTagIds.push_back(soci::i_ok == fileTagIdIndicator ? fileTagId : -1);
+                SourceIds.push_back(sourceId);
+                Keys.push_back(Intern(uniKey));
+                FoldedKeys.push_back(Intern(foldedKey));
+                Identifiers.push_back(Intern(t4p::CharToIcu(identifier.c_str())));
+                ClassNames.push_back(Intern(t4p::CharToIcu(className.c_str())));
+                NamespaceNames.push_back(Intern(t4p::CharToIcu(namespaceName.c_str())));
+                Signatures.push_back(Intern(t4p::CharToIcu(signature.c_str())));
+                ReturnTypes.push_back(Intern(t4p::CharToIcu(returnType.c_str())));
+                Comments.push_back(Intern(t4p::CharToIcu(comment.c_str())));
+                Types.push_back(type);
+                if (t4p::PhpTagClass::CLASS == type) {
+                    Graph.AddClass(FileTagIds.back(), uniKey, t4p::CharToIcu(signature.c_str()));
+                }
+
+                int flags = 0;
+                flags |= isProtected ? FLAG_PROTECTED : 0;
+                flags |= isPrivate ? FLAG_PRIVATE : 0;
+                flags |= isStatic ? FLAG_STATIC : 0;
+                flags |= isDynamic ? FLAG_DYNAMIC : 0;
+                flags |= isNative ? FLAG_NATIVE : 0;
+                flags |= hasVariableArgs ? FLAG_VARIABLE_ARGS : 0;
+                Flags.push_back(flags);
+                LineNumbers.push_back(lineNumber);
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
+bool t4p::TagIndexClass::ReadTraits(soci::session& session, const std::vector<int>& fileTagIds) {
+    std::ostringstream stream;
+    stream << "SELECT key, file_item_id, source_id, trait_name, trait_namespace_name, instead_ofs FROM trait_resources";
+    if (!fileTagIds.empty()) {
+        stream << " WHERE file_item_id IN (";
+        for (size_t i = 0; i < fileTagIds.size(); ++i) {
+            stream << fileTagIds[i];
+            if (i < (fileTagIds.size() - 1)) {
+                stream << ",";
+            }
+        }
+        stream << ")";
+    }
+    std::string key;
+    int fileTagId;
+    int sourceId;
+    std::string traitName;
+    std::string traitNamespaceName;
+    std::string insteadOfs;
+    try {
+        soci::statement stmt = (session.prepare << stream.str(),
+                                soci::into(key), soci::into(fileTagId), soci::into(sourceId),
+                                soci::into(traitName), soci::into(traitNamespaceName), soci::into(insteadOfs));
+        if (stmt.execute(true)) {
+            do {
+                UnicodeString traitClassName = t4p::CharToIcu(traitName.c_str());
+                UnicodeString fullyQualifiedTrait = QualifyName(t4p::CharToIcu(traitNamespaceName.c_str()), traitClassName);
+
+                // same as ParsedTagFinderClass::GetResourceTraits(); the trait is
+                // used unless there is an explicit insteadof
+                bool match = true;
+                std::istringstream insteadOfStream(insteadOfs);
+                std::string insteadOf;
+                while (match && std::getline(insteadOfStream, insteadOf, ',')) {
+                    match = t4p::CharToIcu(insteadOf.c_str()).caseCompare(fullyQualifiedTrait, 0) != 0;
+                }
+                if (match) {
+                    Graph.AddTrait(fileTagId, sourceId, t4p::CharToIcu(key.c_str()), traitClassName);
+                }
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
+bool t4p::TagIndexClass::ReadFiles(soci::session& session, const std::vector<int>& fileTagIds) {
+    std::ostringstream stream;
+    stream << "SELECT file_item_id, source_id, full_path, last_modified, is_new FROM file_items";
+    if (!fileTagIds.empty()) {
+        stream << " WHERE file_item_id IN (";
+        for (size_t i = 0; i < fileTagIds.size(); ++i) {
+            stream << fileTagIds[i];
+            if (i < (fileTagIds.size() - 1)) {
+                stream << ",";
+            }
+        }
+        stream << ")";
+    }
+    int fileTagId;
+    int sourceId;
+    std::string fullPath;
+    std::tm lastModified;
+    int isNew;
+    try {
+        soci::statement stmt = (session.prepare << stream.str(),
+                                soci::into(fileTagId), soci::into(sourceId), soci::into(fullPath),
+                                soci::into(lastModified), soci::into(isNew));
+        if (stmt.execute(true)) {
+            do {
+                t4p::FileTagClass fileTag;
+                fileTag.FileId = fileTagId;
+                fileTag.SourceId = sourceId;
+                fileTag.FullPath = t4p::CharToWx(fullPath.c_str());
+                fileTag.DateTime.Set(lastModified);
+                fileTag.IsNew = isNew != 0;
+                Files[fileTagId] = fileTag;
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
+bool t4p::TagIndexClass::ReadSources(soci::session& session) {
+    int sourceId;
+    std::string directory;
+    try {
+        soci::statement stmt = (session.prepare << "SELECT source_id, directory FROM sources",
+                                soci::into(sourceId), soci::into(directory));
+        Sources.clear();
+        if (stmt.execute(true)) {
+            do {
+                Sources[sourceId] = t4p::CharToWx(directory.c_str());
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
+bool t4p::TagIndexClass::ReadChangeRange(soci::session& session, int& minChangeId, int& maxChangeId) {
+    try {
+        session << "SELECT COALESCE(MIN(tag_change_id), 0), COALESCE(MAX(tag_change_id), 0) FROM tag_changes",
+                soci::into(minChangeId), soci::into(maxChangeId);
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
+void t4p::TagIndexClass::MergeKeyOrder(size_t start) {
+    size_t middle = KeyOrder.size();
+    for (size_t i = start; i < Ids.size(); ++i) {
+        KeyOrder.push_back(static_cast<int>(i));
+    }
+    t4p::TagIndexKeyComparatorClass comparator(Strings, FoldedKeys);
+    std::sort(KeyOrder.begin() + middle, KeyOrder.end(), comparator);
+    std::inplace_merge(KeyOrder.begin(), KeyOrder.begin() + middle, KeyOrder.end(), comparator);
+    IsTrieBuilt = false;
+    IsFuzzyBuilt = false;
+}
+
+void t4p::TagIndexClass::BuildTrie() {
+    if (!IsTrieBuilt) {
+        Trie.Build(Strings, FoldedKeys, Types, KeyOrder);
+        IsTrieBuilt = true;
+    }
+}
+
+void t4p::TagIndexClass::BuildFuzzy() {
+    if (IsFuzzyBuilt) {
+        return;
+    }
+    Fuzzy.Clear();
+    std::map<int, t4p::FileTagClass>::const_iterator file;
+    for (file = Files.begin(); file != Files.end(); ++file) {
+        wxFileName fileName(file->second.FullPath);
+        long long modified = file->second.DateTime.IsValid() ? file->second.DateTime.GetTicks() : 0;
+        Fuzzy.Add(t4p::WxToIcu(fileName.GetFullName()), t4p::WxToIcu(file->second.FullPath),
+                  FUZZY_FILE, file->second.SourceId, file->first, modified);
+    }
+    for (size_t row = 0; row < Ids.size(); ++row) {
+        // each tag is stored under many keys (ie. "Class::method" and
+        // "\Namespace\Class::method"), only the entry keyed by the
+        // tag's own name is a candidate so that each tag matches only once
+        int type = Types[row];
+        if (Keys[row] != Identifiers[row] || (Flags[row] & FLAG_NATIVE)) {
+            continue;
+        }
+        UnicodeString name;
+        if (t4p::PhpTagClass::CLASS == type || t4p::PhpTagClass::FUNCTION == type) {
+            name = Strings[Identifiers[row]];
+        } else if (t4p::PhpTagClass::METHOD == type) {
+            name = Strings[ClassNames[row]] + UNICODE_STRING_SIMPLE("::") + Strings[Identifiers[row]];
+        } else {
+            continue;
+        }
+        UnicodeString path;
+        long long modified = 0;
+        file = Files.find(FileTagIds[row]);
+        if (file != Files.end()) {
+            path = t4p::WxToIcu(file->second.FullPath);
+            modified = file->second.DateTime.IsValid() ? file->second.DateTime.GetTicks() : 0;
+        }
+        Fuzzy.Add(name, path, FUZZY_TAG, SourceIds[row], static_cast<int>(row), modified);
+    }
+    IsFuzzyBuilt = true;
+}
+
+void t4p::TagIndexClass::Match(const UnicodeString& key, bool isPrefix, const std::vector<int>& types,
+                               const std::vector<int>& sourceIds, int fileTagId, bool identifierIsKey,
+                               size_t limit, std::vector<int>& rows) const {
+    size_t begin = 0;
+    size_t end = 0;
+    if (!Trie.Find(key, TypeMask(types), begin, end)) {
+        return;
+    }
+
+    // the trie is only a few characters deep; the rest of the
+    // key is found with a binary search on the trie node's range
+    t4p::TagIndexKeyComparatorClass comparator(Strings, FoldedKeys);
+    std::vector<int>::const_iterator it = std::lower_bound(KeyOrder.begin() + begin, KeyOrder.begin() + end, key, comparator);
+    std::vector<int>::const_iterator last = KeyOrder.begin() + end;
+    size_t found = 0;
+    for (; it != last; ++it) {
+        int row = *it;
+        const UnicodeString& rowKey = Strings[FoldedKeys[row]];
+        if (!StartsWithFolded(rowKey, key) || (!isPrefix && rowKey.length() != key.length())) {
+            // keys are sorted, no more matches
+            break;
+        }
+        if (std::find(types.begin(), types.end(), Types[row]) == types.end()) {
+            continue;
+        }
+        if (!sourceIds.empty() && !std::binary_search(sourceIds.begin(), sourceIds.end(), SourceIds[row])) {
+            continue;
+        }
+        if (fileTagId && FileTagIds[row] != fileTagId) {
+            continue;
+        }
+        if (identifierIsKey && Strings[Identifiers[row]].caseCompare(Strings[Keys[row]], U_FOLD_CASE_DEFAULT) != 0) {
+            continue;
+        }
+        rows.push_back(row);
+        found++;
+        if (limit > 0 && found >= limit) {
+            break;
+        }
+    }
+}
+
+void t4p::TagIndexClass::SortRows(std::vector<int>& rows, size_t limit) const {
+    // when looking in a class hierarchy, matches from all classes
+    // are sorted together
+    t4p::TagIndexKeyComparatorClass comparator(Strings, FoldedKeys);
+    std::stable_sort(rows.begin(), rows.end(), comparator);
+    if (limit > 0 && rows.size() > limit) {
+        rows.resize(limit);
+    }
+}
+
+void t4p::TagIndexClass::AppendMatches(const std::vector<int>& rows, std::vector<t4p::PhpTagClass>& matches) const {
+    for (size_t i = 0; i < rows.size(); ++i) {
+        matches.push_back(TagAt(rows[i]));
+    }
+}
+
+void t4p::TagIndexClass::AppendMatches(const std::vector<int>& rows, t4p::CompactTagListClass& matches) const {
+    for (size_t i = 0; i < rows.size(); ++i) {
+        matches.Append(*this, rows[i]);
+    }
+}
+
+bool t4p::TagIndexClass::SourceIdsForDirs(const std::vector<wxFileName>& sourceDirs, std::vector<int>& sourceIds) const {
+    if (sourceDirs.empty()) {
+        return true;
+    }
+
+    // source directories are stored with a trailing separator
+    for (size_t i = 0; i < sourceDirs.size(); ++i) {
+        wxString dir = sourceDirs[i].GetPathWithSep();
+        std::map<int, wxString>::const_iterator it;
+        for (it = Sources.begin(); it != Sources.end(); ++it) {
+            if (it->second == dir) {
+                sourceIds.push_back(it->first);
+            }
+        }
+    }
+    std::sort(sourceIds.begin(), sourceIds.end());
+
+    // none of the given sources have been indexed
+    return !sourceIds.empty();
+}
+
+t4p::PhpTagClass t4p::TagIndexClass::TagAt(size_t row) const {
+    t4p::PhpTagClass tag;
+    tag.Id = Ids[row];
+    tag.FileTagId = FileTagIds[row];
+    tag.SourceId = SourceIds[row];
+    tag.Key = Strings[Keys[row]];
+    tag.Identifier = Strings[Identifiers[row]];
+    tag.ClassName = Strings[ClassNames[row]];
+    tag.Type = (t4p::PhpTagClass::Types)Types[row];
+    tag.NamespaceName = Strings[NamespaceNames[row]];
+    tag.Signature = Strings[Signatures[row]];
+    tag.ReturnType = Strings[ReturnTypes[row]];
+    tag.Comment = Strings[Comments[row]];
+    tag.IsProtected = (Flags[row] & FLAG_PROTECTED) != 0;
+    tag.IsPrivate = (Flags[row] & FLAG_PRIVATE) != 0;
+    tag.IsStatic = (Flags[row] & FLAG_STATIC) != 0;
+    tag.IsDynamic = (Flags[row] & FLAG_DYNAMIC) != 0;
+    tag.IsNative = (Flags[row] & FLAG_NATIVE) != 0;
+    tag.HasVariableArgs = (Flags[row] & FLAG_VARIABLE_ARGS) != 0;
+    tag.LineNumber = LineNumbers[row];
+
+    // same as the LEFT JOIN in the TagResultClass queries; a tag
+    // without a file is considered new
+    std::map<int, t4p::FileTagClass>::const_iterator file = Files.find(FileTagIds[row]);
+    if (file != Files.end()) {
+        tag.SetFullPath(file->second.FullPath);
+        tag.FileIsNew = file->second.IsNew;
+    } else {
+        tag.FileIsNew = true;
+    }
+    return tag;
+}
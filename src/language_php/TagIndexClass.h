@@ -0,0 +1,483 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGINDEXCLASS_H_
+#define SRC_LANGUAGE_PHP_TAGINDEXCLASS_H_
+
+#include <soci/soci.h>
+#include <unicode/unistr.h>
+#include <wx/filename.h>
+#include <wx/string.h>
+#include <map>
+#include <vector>
+#include "globals/String.h"
+#include "language_php/ClassGraphClass.h"
+#include "language_php/CompactTagListClass.h"
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/PhpTagClass.h"
+#include "language_php/TagKeyTrieClass.h"
+#include "search/FuzzyMatcherClass.h"
+
+namespace t4p {
+/**
+ * The tag index is an in-memory copy of the resources table of a tag db. It
+ * answers the same exact and near match queries that the TagResultClass
+ * queries answer, but without going to SQLite; this makes code completion
+ * fast even on projects that have hundreds of thousands of tags.
+ *
+ * To keep memory usage down, every string is stored only once (interned) and
+ * each tag column is stored in its own array (tag N is the Nth item of every
+ * column). Tag keys are kept in a case-insensitive sorted order, and a
+ * prefix trie over the sorted keys (see TagKeyTrieClass) finds the tags
+ * that begin with a key without having to compare strings.
+ *
+ * The index is a snapshot of the db. Every writer logs the files that
+ * it changed in the tag_changes table (see TagParserClass), Refresh() re-reads
+ * the files that were changed since the index was loaded, no matter
+ * which connection changed them.
+ *
+ * The index also keeps the class hierarchy and the traits used by each
+ * class (see ClassGraphClass), so that the ancestors of a class can be
+ * found without going to SQLite.
+ *
+ * The index can also do fuzzy matching on the names of classes, functions,
+ * methods and files (see FuzzyMatches()); this is what powers Total Search.
+ *
+ * This class is not thread-safe.
+ */
+class TagIndexClass {
+ public:
+    /**
+     * the kinds of fuzzy matches; see FuzzyMatches()
+     */
+    enum FuzzyKinds {
+        FUZZY_TAG,
+        FUZZY_FILE
+    };
+
+    TagIndexClass();
+
+    /**
+     * Reads all of the tags from the given db, any previously loaded tags are
+     * removed.
+     *
+     * @param session the connection to read from; must be a tag db
+     * @return bool TRUE if tags were read successfully
+     */
+    bool Load(soci::session& session);
+
+    /**
+     * Re-reads all of the tags of the given files. Any tags of the given files
+     * that were previously loaded are replaced.
+     *
+     * @param session the connection to read from; must be a tag db
+     * @param fileTagIds the files to read
+     */
+    void LoadFileTags(soci::session& session, const std::vector<int>& fileTagIds);
+
+    /**
+     * Removes all of the tags that belong to the given files.
+     *
+     * @param fileTagIds the files to remove
+     */
+    void RemoveFileTags(const std::vector<int>& fileTagIds);
+
+    /**
+     * Removes all tags from the index. The index will be marked as not loaded.
+     */
+    void Clear();
+
+    /**
+     * @return bool TRUE if Load() was called and succeeded
+     */
+    bool IsLoaded() const;
+
+    /**
+     * Brings the index up to date with the db: the tags of the files that
+     * were changed since the index was loaded (or last refreshed) are re-read.
+     * If many files were changed, or the changes are no longer known (the
+     * change log was pruned or the db was re-created) then all tags are
+     * re-read. If the index is not loaded, all tags are read.
+     *
+     * This is a single query when nothing changed; it should be called
+     * once before a group of lookups rather than before each lookup.
+     *
+     * @param session the connection to read from; must be a tag db
+     * @return bool TRUE if the index is loaded after the refresh
+     */
+    bool Refresh(soci::session& session);
+
+    /**
+     * Same as Refresh(), except that it never re-reads all of the tags;
+     * only the tags of a few changed files are read. This is quick enough
+     * to call from the UI thread; when all of the tags need to be re-read
+     * the caller should Load() another index in a background thread and
+     * Swap() it in.
+     *
+     * @param session the connection to read from; must be a tag db
+     * @return bool TRUE if the index is loaded and up to date. FALSE if all
+     *         of the tags need to be re-read; the index may be out of date
+     *         or not loaded
+     */
+    bool RefreshChanges(soci::session& session);
+
+    /**
+     * Exchanges the tags of this index with the tags of the given index.
+     * The generation of both indexes changes.
+     *
+     * @param other the index to exchange tags with
+     */
+    void Swap(TagIndexClass& other);
+
+    /**
+     * @return the number of tags in the index
+     */
+    size_t Count() const;
+
+    /**
+     * @return a number that changes every time that tags are added or
+     *         removed from the index. Callers can use this to know when
+     *         results computed from the index are out of date.
+     */
+    int Generation() const;
+
+    /**
+     * Finds the tags that match the given search exactly. This is the same
+     * as executing the result of TagSearchClass::CreateExactResults().
+     * Any matches are appended to the given vector.
+     */
+    void ExactMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * Finds the tags that begin with the given search. This is the same
+     * as executing the result of TagSearchClass::CreateNearMatchResults().
+     * Any matches are appended to the given vector.
+     */
+    void NearMatches(const t4p::TagSearchClass& tagSearch, std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * Same as ExactMatches() above, but the matches are appended straight
+     * from the index columns; no PhpTagClass is built.
+     */
+    void ExactMatches(const t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches);
+
+    /**
+     * Same as NearMatches() above, but the matches are appended straight
+     * from the index columns; no PhpTagClass is built.
+     */
+    void NearMatches(const t4p::TagSearchClass& tagSearch, t4p::CompactTagListClass& matches);
+
+    /**
+     * Finds the classes, functions, defines (or any of the given types) that begin
+     * with the given key. This is the same as executing a NearMatchNonMemberTagResultClass.
+     * Any matches are appended to the given vector.
+     *
+     * @param key the key to look for, case does not matter
+     * @param types the tag types to look for
+     * @param sourceDirs only tags from these sources are matched, if empty
+     *        tags from all sources are matched
+     * @param matches the vector to append to
+     */
+    void NearMatchNonMembers(const UnicodeString& key, const std::vector<int>& types,
+                             const std::vector<wxFileName>& sourceDirs, std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * Finds the methods, properties, and constants of any class that begin
+     * with the given name. This is the same as executing a NearMatchMemberOnlyTagResultClass.
+     * Any matches are appended to the given vector.
+     *
+     * @param memberName the name to look for, case does not matter
+     * @param sourceDirs only tags from these sources are matched, if empty
+     *        tags from all sources are matched
+     * @param matches the vector to append to
+     */
+    void NearMatchMembersOnly(const UnicodeString& memberName, const std::vector<wxFileName>& sourceDirs,
+                              std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * Finds all of the methods, properties, and constants of the given classes.
+     * This is the same as executing an AllMembersTagResultClass; like
+     * that class, the matches are not limited since a class may
+     * have more than 100 members.
+     * Any matches are appended to the given vector.
+     *
+     * @param classNames the fully qualified classes to get the members of
+     * @param sourceDirs only tags from these sources are matched, if empty
+     *        tags from all sources are matched
+     * @param matches the vector to append to
+     */
+    void AllMembers(const std::vector<UnicodeString>& classNames, const std::vector<wxFileName>& sourceDirs,
+                    std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * Finds the classes, functions, methods and files whose name fuzzy matches
+     * the given query; see FuzzyMatcherClass for the matching rules. Methods
+     * are matched by their class name and method name (ie "Class::method"), files by
+     * their file name.
+     *
+     * Repeated calls with a query that grows one character at a time (as the
+     * user types) are faster than unrelated queries.
+     *
+     * @param query the string to look for, case does not matter
+     * @param sourceDirs only tags and files from these sources are matched, if empty
+     *        tags from all sources are matched
+     * @param limit the maximum number of matches
+     * @param matches will be filled with the best matches, best match first. Use
+     *        FuzzyMatchTag() or FuzzyMatchFile() to get the tag of each match,
+     *        depending on the match's Kind (one of FuzzyKinds).
+     */
+    void FuzzyMatches(const UnicodeString& query, const std::vector<wxFileName>& sourceDirs, size_t limit,
+                      std::vector<t4p::FuzzyMatchClass>& matches);
+
+    /**
+     * @param match a FUZZY_TAG match returned by the last call to FuzzyMatches()
+     * @return the matched tag
+     */
+    t4p::PhpTagClass FuzzyMatchTag(const t4p::FuzzyMatchClass& match) const;
+
+    /**
+     * @param match a FUZZY_FILE match returned by the last call to FuzzyMatches()
+     * @return the matched file
+     */
+    t4p::FileTagClass FuzzyMatchFile(const t4p::FuzzyMatchClass& match) const;
+
+    /**
+     * Finds the parent of a class. This is the same as
+     * ParsedTagFinderClass::ParentClassName() (with a fileTagId of zero).
+     *
+     * @param className the fully qualified class to look for, case does not matter
+     * @param parentClassName will be set to the parent class, empty
+     *        if the class does not have a parent
+     * @return bool TRUE if the class is in the index
+     */
+    bool ParentClassName(const UnicodeString& className, UnicodeString& parentClassName) const;
+
+    /**
+     * Finds the traits used by a class. This is the same as
+     * ParsedTagFinderClass::GetResourceTraits().
+     * Any traits are appended to the given vector.
+     *
+     * @param className the fully qualified class to look for, case does not matter
+     * @param sourceDirs only traits from these sources are matched, if empty
+     *        traits from all sources are matched
+     * @param traits the vector to append to
+     */
+    void ClassTraits(const UnicodeString& className, const std::vector<wxFileName>& sourceDirs,
+                     std::vector<UnicodeString>& traits) const;
+
+ private:
+    // reads the columns of a tag without building a PhpTagClass
+    friend class t4p::CompactTagListClass;
+
+    /**
+     * @return the ID of the given string, the string is added to the
+     *         string pool if needed
+     */
+    int Intern(const UnicodeString& str);
+
+    /**
+     * reads the tags from the given query into the column arrays.
+     * Rows are appended; the key order is NOT updated
+     */
+    bool ReadTags(soci::session& session, const std::string& sql);
+
+    /**
+     * reads the traits of the given files into the class graph,
+     * or the traits of all files if fileTagIds is empty
+     */
+    bool ReadTraits(soci::session& session, const std::vector<int>& fileTagIds);
+
+    /**
+     * reads the given files' paths, or all files if fileTagIds is empty
+     */
+    bool ReadFiles(soci::session& session, const std::vector<int>& fileTagIds);
+
+    /**
+     * reads all of the source directories
+     */
+    bool ReadSources(soci::session& session);
+
+    /**
+     * reads the lowest and highest IDs in the tag_changes table, both
+     * will be zero when the table is empty
+     */
+    bool ReadChangeRange(soci::session& session, int& minChangeId, int& maxChangeId);
+
+    /**
+     * sorts the tags at positions [start, Count()) and merges them into
+     * the key order
+     */
+    void MergeKeyOrder(size_t start);
+
+    /**
+     * builds the trie if tags were added or removed since it was last built
+     */
+    void BuildTrie();
+
+    /**
+     * builds the fuzzy matcher if tags or files were added or removed since it
+     * was last built
+     */
+    void BuildFuzzy();
+
+    /**
+     * adds the positions of the tags whose key is equal to key (or begins with key
+     * if isPrefix is TRUE) to rows.
+     *
+     * @param key the key to look for, case does not matter
+     * @param isPrefix if TRUE, tags that begin with key will be matched
+     * @param types only tags of these types will be matched
+     * @param sourceIds only tags in these sources will be matched; if empty
+     *        tags in all sources are matched
+     * @param fileTagId if non-zero, only tags from this file will be matched
+     * @param identifierIsKey if TRUE, only tags whose identifier is the same
+     *        as the key will be matched
+     * @param limit the maximum number of positions to add, 0 for no limit
+     * @param rows the vector to append to
+     */
+    void Match(const UnicodeString& key, bool isPrefix, const std::vector<int>& types,
+               const std::vector<int>& sourceIds, int fileTagId, bool identifierIsKey,
+               size_t limit, std::vector<int>& rows) const;
+
+    /**
+     * the positions of the tags that match the given search; see ExactMatches()
+     * and NearMatches(). The positions are sorted by key.
+     */
+    void ExactMatchRows(const t4p::TagSearchClass& tagSearch, std::vector<int>& rows);
+    void NearMatchRows(const t4p::TagSearchClass& tagSearch, std::vector<int>& rows);
+
+    /**
+     * the positions of the tags that match; see NearMatchNonMembers() and
+     * NearMatchMembersOnly(). The positions are sorted by key.
+     */
+    void NearMatchNonMemberRows(const UnicodeString& key, const std::vector<int>& types,
+                                const std::vector<wxFileName>& sourceDirs, std::vector<int>& rows);
+    void NearMatchMemberOnlyRows(const UnicodeString& memberName, const std::vector<wxFileName>& sourceDirs,
+                                 std::vector<int>& rows);
+
+    /**
+     * sorts the given positions by key and removes the positions
+     * past the limit.
+     *
+     * @param limit the maximum number of positions to keep, 0 for no limit
+     */
+    void SortRows(std::vector<int>& rows, size_t limit) const;
+
+    /**
+     * appends the tags at the given positions to matches.
+     */
+    void AppendMatches(const std::vector<int>& rows, std::vector<t4p::PhpTagClass>& matches) const;
+    void AppendMatches(const std::vector<int>& rows, t4p::CompactTagListClass& matches) const;
+
+    /**
+     * @param sourceDirs the directories to get the source IDs of
+     * @param sourceIds will be filled with the IDs of the sources that are
+     *        in the given dirs
+     * @return bool FALSE if sourceDirs is not empty but none of the
+     *         directories are sources in the index; ie. nothing will match
+     */
+    bool SourceIdsForDirs(const std::vector<wxFileName>& sourceDirs, std::vector<int>& sourceIds) const;
+
+    /**
+     * @return the tag at the given position
+     */
+    t4p::PhpTagClass TagAt(size_t row) const;
+
+    /**
+     * The string pool; every key, class name, signature, etc... is
+     * stored only once
+     */
+    std::vector<UnicodeString> Strings;
+    std::map<UnicodeString, int, t4p::UnicodeStringComparatorClass> StringIds;
+
+    /**
+     * The tag columns; the Nth item of each vector belongs to the Nth tag.
+     * Strings columns hold IDs into the string pool.
+     */
+    std::vector<int> Ids;
+    std::vector<int> FileTagIds;
+    std::vector<int> SourceIds;
+    std::vector<int> Keys;
+    std::vector<int> FoldedKeys;
+    std::vector<int> Identifiers;
+    std::vector<int> ClassNames;
+    std::vector<int> NamespaceNames;
+    std::vector<int> Signatures;
+    std::vector<int> ReturnTypes;
+    std::vector<int> Comments;
+    std::vector<int> Types;
+    std::vector<int> Flags;
+    std::vector<int> LineNumbers;
+
+    /**
+     * positions of the tags, sorted by case folded key
+     */
+    std::vector<int> KeyOrder;
+
+    /**
+     * the prefix trie over KeyOrder; it is re-built lazily since
+     * the TagParser may add tags many times during a walk
+     */
+    t4p::TagKeyTrieClass Trie;
+    bool IsTrieBuilt;
+
+    /**
+     * the names of the classes, functions, methods, and files; like
+     * the trie, it is re-built lazily
+     */
+    t4p::FuzzyMatcherClass Fuzzy;
+    bool IsFuzzyBuilt;
+
+    /**
+     * the class hierarchy and used traits of the classes in the index
+     */
+    t4p::ClassGraphClass Graph;
+
+    /**
+     * the full path, modified time and new flag of each file, keyed by file_item_id
+     */
+    std::map<int, t4p::FileTagClass> Files;
+
+    /**
+     * the source directories, keyed by source_id
+     */
+    std::map<int, wxString> Sources;
+
+    /**
+     * the last row of the tag_changes table that the index has; changes
+     * after this one are read by Refresh()
+     */
+    int LastChangeId;
+
+    /**
+     * incremented every time that tags are added or removed; it is
+     * not reset when the index is cleared
+     */
+    int GenerationCount;
+
+    bool Loaded;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGINDEXCLASS_H_
@@ -0,0 +1,154 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagKeyTrieClass.h"
+#include <unicode/uchar.h>
+#include <vector>
+
+/**
+ * the maximum depth of the trie; a deeper trie would use a lot more
+ * memory but lookups would barely be faster since by then the
+ * ranges are small
+ */
+static const int MAX_DEPTH = 6;
+
+t4p::TagKeyTrieClass::TagKeyTrieClass()
+    : Chars()
+    , Depths()
+    , FirstChildren()
+    , ChildCounts()
+    , RangeBegins()
+    , RangeEnds()
+    , TypeMasks() {
+}
+
+void t4p::TagKeyTrieClass::Build(const std::vector<UnicodeString>& strings, const std::vector<int>& foldedKeys,
+                                 const std::vector<int>& types, const std::vector<int>& keyOrder) {
+    Clear();
+    int rootMask = 0;
+    for (size_t i = 0; i < keyOrder.size(); ++i) {
+        rootMask |= 1 << types[keyOrder[i]];
+    }
+    AddNode(0, 0, 0, static_cast<int>(keyOrder.size()), rootMask);
+
+    // nodes are added breadth-first, so that children of a node
+    // are next to each other
+    for (size_t node = 0; node < Chars.size(); ++node) {
+        int depth = Depths[node];
+        FirstChildren[node] = static_cast<int>(Chars.size());
+        if (depth >= MAX_DEPTH) {
+            continue;
+        }
+
+        // the keys in the range all start with the same prefix and are
+        // sorted; keys that end at this node are first, then keys are
+        // grouped by their next character
+        int i = RangeBegins[node];
+        int end = RangeEnds[node];
+        while (i < end && strings[foldedKeys[keyOrder[i]]].length() <= depth) {
+            i++;
+        }
+        while (i < end) {
+            UChar ch = strings[foldedKeys[keyOrder[i]]].charAt(depth);
+            int start = i;
+            int typeMask = 0;
+            while (i < end) {
+                const UnicodeString& key = strings[foldedKeys[keyOrder[i]]];
+                if (key.length() <= depth || key.charAt(depth) != ch) {
+                    break;
+                }
+                typeMask |= 1 << types[keyOrder[i]];
+                i++;
+            }
+            AddNode(ch, depth + 1, start, i, typeMask);
+        }
+        ChildCounts[node] = static_cast<int>(Chars.size()) - FirstChildren[node];
+    }
+}
+
+bool t4p::TagKeyTrieClass::Find(const UnicodeString& prefix, int typeMask, size_t& begin, size_t& end) const {
+    if (Chars.empty()) {
+        return false;
+    }
+    int node = 0;
+    for (int32_t i = 0; i < prefix.length() && Depths[node] < MAX_DEPTH; ++i) {
+        UChar ch = static_cast<UChar>(u_foldCase(prefix.charAt(i), U_FOLD_CASE_DEFAULT));
+
+        // binary search the children, they are sorted
+        int low = FirstChildren[node];
+        int high = low + ChildCounts[node];
+        while (low < high) {
+            int mid = low + (high - low) / 2;
+            if (Chars[mid] < ch) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+        if (low >= FirstChildren[node] + ChildCounts[node] || Chars[low] != ch) {
+            return false;
+        }
+        node = low;
+        if ((TypeMasks[node] & typeMask) == 0) {
+            return false;
+        }
+    }
+    begin = RangeBegins[node];
+    end = RangeEnds[node];
+    return (TypeMasks[node] & typeMask) != 0;
+}
+
+void t4p::TagKeyTrieClass::Clear() {
+    Chars.clear();
+    Depths.clear();
+    FirstChildren.clear();
+    ChildCounts.clear();
+    RangeBegins.clear();
+    RangeEnds.clear();
+    TypeMasks.clear();
+}
+
+void t4p::TagKeyTrieClass::Swap(t4p::TagKeyTrieClass& other) {
+    Chars.swap(other.Chars);
+    Depths.swap(other.Depths);
+    FirstChildren.swap(other.FirstChildren);
+    ChildCounts.swap(other.ChildCounts);
+    RangeBegins.swap(other.RangeBegins);
+    RangeEnds.swap(other.RangeEnds);
+    TypeMasks.swap(other.TypeMasks);
+}
+
+size_t t4p::TagKeyTrieClass::Count() const {
+    return Chars.size();
+}
+
+void t4p::TagKeyTrieClass::AddNode(UChar ch, int depth, int rangeBegin, int rangeEnd, int typeMask) {
+    Chars.push_back(ch);
+    Depths.push_back(depth);
+    FirstChildren.push_back(0);
+    ChildCounts.push_back(0);
+    RangeBegins.push_back(rangeBegin);
+    RangeEnds.push_back(rangeEnd);
+    TypeMasks.push_back(typeMask);
+}
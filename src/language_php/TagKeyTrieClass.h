@@ -0,0 +1,107 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGKEYTRIECLASS_H_
+#define SRC_LANGUAGE_PHP_TAGKEYTRIECLASS_H_
+
+#include <unicode/unistr.h>
+#include <vector>
+
+namespace t4p {
+/**
+ * A prefix trie over the (case folded) keys of a TagIndexClass. The trie
+ * does not store any keys; each node is a range of the index's sorted key
+ * order, the range of all keys that start with the node's prefix. Each
+ * node also has a mask of the tag types in its range, so that a lookup for
+ * a type that has no tags with the prefix stops early.
+ *
+ * The trie is only a few characters deep; a prefix that is longer
+ * than the trie gives the range of the first few characters, the caller
+ * narrows it down (the range is sorted).
+ *
+ * The lookups are case-insensitive; the prefix being looked up is folded
+ * one character at a time while walking the trie.
+ */
+class TagKeyTrieClass {
+ public:
+    TagKeyTrieClass();
+
+    /**
+     * builds the trie.
+     *
+     * @param strings the string pool of the index
+     * @param foldedKeys the case folded key of each tag, ID into the strings vector
+     * @param types the type of each tag
+     * @param keyOrder the tag positions sorted by folded key
+     */
+    void Build(const std::vector<UnicodeString>& strings, const std::vector<int>& foldedKeys,
+               const std::vector<int>& types, const std::vector<int>& keyOrder);
+
+    /**
+     * finds the keys that start with the given prefix.
+     *
+     * @param prefix the prefix to look up, case does not matter.
+     * @param typeMask the tag types to look for; bit N is set when
+     *        type N should be found
+     * @param begin will be set to the start of the range
+     * @param end will be set to the end of the range (exclusive)
+     * @return bool FALSE if there are no keys with the prefix that
+     *         have the given types
+     */
+    bool Find(const UnicodeString& prefix, int typeMask, size_t& begin, size_t& end) const;
+
+    void Clear();
+
+    /**
+     * exchanges the nodes of this trie with the nodes of the given trie
+     */
+    void Swap(TagKeyTrieClass& other);
+
+    /**
+     * @return the number of nodes in the trie
+     */
+    size_t Count() const;
+
+ private:
+    /**
+     * add a node, the node will not have any children
+     */
+    void AddNode(UChar ch, int depth, int rangeBegin, int rangeEnd, int typeMask);
+
+    /**
+     * the node columns; the Nth item of each vector belongs
+     * to the Nth node. the root node is node zero. children of a node
+     * are stored next to each other, sorted by their character.
+     */
+    std::vector<UChar> Chars;
+    std::vector<int> Depths;
+    std::vector<int> FirstChildren;
+    std::vector<int> ChildCounts;
+    std::vector<int> RangeBegins;
+    std::vector<int> RangeEnds;
+    std::vector<int> TypeMasks;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGKEYTRIECLASS_H_
@@ -39,19 +39,123 @@
 #include "globals/Sqlite.h"
 #include "globals/String.h"
 #include "language_php/FileTags.h"
+#include "language_php/TagShardsClass.h"
 #include "search/FinderClass.h"
 
 /**
- * appends name to namespace
+ * the max number of parsed files that can be waiting to be written
+ * per parser thread
  */
-static UnicodeString QualifyName(const UnicodeString& namespaceName, const UnicodeString& name) {
-    UnicodeString qualifiedName;
-    qualifiedName.append(namespaceName);
-    if (!qualifiedName.endsWith(UNICODE_STRING_SIMPLE("\\"))) {
-        qualifiedName.append(UNICODE_STRING_SIMPLE("\\"));
-    }
-    qualifiedName.append(name);
-    return qualifiedName;
+static const size_t MAX_PARSED_FILES_PER_THREAD = 8;
+
+/**
+ * number of files to commit at once when files are being parsed in
+ * parallel. Since the writer only writes, we can afford larger transactions.
+ */
+static const int PARALLEL_FILES_PER_COMMIT = 1000;
+
+/**
+ * number of files to commit at once when files are parsed in the same
+ * thread that writes.
+ */
+static const int FILES_PER_COMMIT = 200;
+
+/**
+ * number of files to commit at once during a bulk load. syncs are
+ * off so a commit is cheap, but nobody reads the tags until the
+ * load is done anyway.
+ */
+static const int BULK_FILES_PER_COMMIT = 5000;
+
+/**
+ * number of rows to keep in the tag_changes table. A tag index that is
+ * further behind re-reads all of the tags anyway.
+ */
+static const int MAX_TAG_CHANGES = 20000;
+
+/**
+ * the indexes that are dropped during a bulk load; these must be the
+ * same as the indexes in resources.sql and tag_shard.sql. The file_item_id index is
+ * kept, the tags of re-parsed files are deleted by file_item_id.
+ */
+static const char* BULK_INDEX_NAMES[] = {
+    "idxResourceKey",
+    "idxResourceSource"
+};
+static const char* BULK_INDEX_COLUMNS[] = {
+    "resources(key, type)",
+    "resources(source_id)"
+};
+
+/**
+ * the version of the tag bundle format, bundles with another version are
+ * not imported. This needs to change when the bundle tables change.
+ */
+static const int TAG_BUNDLE_VERSION = 1;
+
+/**
+ * the tables of a tag bundle (see TagParserClass::ExportBundle). The bundle
+ * is attached as "bundle". The file_item_id of the bundle is only used to
+ * join the tags to the files of the bundle.
+ */
+static const char* TAG_BUNDLE_SQL[] = {
+    "CREATE TABLE bundle.bundle_info(format_version INTEGER NOT NULL)",
+    "CREATE TABLE bundle.file_items(file_item_id INTEGER NOT NULL PRIMARY KEY, relative_path TEXT NOT NULL, "
+    "name TEXT NOT NULL, file_size INTEGER NOT NULL, content_hash TEXT NOT NULL)",
+    "CREATE TABLE bundle.resources(file_item_id INTEGER NOT NULL, key TEXT NOT NULL, identifier TEXT NOT NULL, "
+    "class_name TEXT NOT NULL, type INTEGER NOT NULL, namespace_name TEXT NOT NULL, signature TEXT NOT NULL, "
+    "comment TEXT NOT NULL, return_type TEXT NOT NULL, is_protected INTEGER NOT NULL, is_private INTEGER NOT NULL, "
+    "is_static INTEGER NOT NULL, is_dynamic INTEGER NOT NULL, is_native INTEGER NOT NULL, "
+    "has_variable_args INTEGER NOT NULL, line_number INTEGER NOT NULL)",
+    "CREATE TABLE bundle.trait_resources(file_item_id INTEGER NOT NULL, key TEXT NOT NULL, class_name TEXT NOT NULL, "
+    "namespace_name TEXT NOT NULL, trait_name TEXT NOT NULL, trait_namespace_name TEXT NOT NULL, "
+    "aliases TEXT NOT NULL, instead_ofs TEXT NOT NULL)",
+    "CREATE INDEX bundle.idxBundleResourceFileItem ON resources(file_item_id)",
+    "CREATE INDEX bundle.idxBundleTraitFileItem ON trait_resources(file_item_id)"
+};
+
+/**
+ * the tag columns that are copied to / from a bundle
+ */
+static const char* TAG_BUNDLE_RESOURCE_COLUMNS =
+    "key, identifier, class_name, type, namespace_name, signature, comment, return_type, "
+    "is_protected, is_private, is_static, is_dynamic, is_native, has_variable_args, line_number";
+static const char* TAG_BUNDLE_TRAIT_COLUMNS =
+    "key, class_name, namespace_name, trait_name, trait_namespace_name, aliases, instead_ofs";
+
+/**
+ * number of resources to insert with a single statement execution
+ */
+static const size_t RESOURCES_PER_INSERT = 500;
+
+/**
+ * resolves a relative path from a tag bundle against the source directory.
+ * Bundles come from other machines, so the path is not trusted: absolute
+ * paths, ".." components, and paths that do not end up inside the source
+ * directory are rejected.
+ *
+ * @param relativePath the path as stored in the bundle, always uses '/'
+ * @param sourceDir the directory that the bundle is being imported into
+ * @param fileName will be set to the full path of the file
+ * @return bool TRUE if the path is inside the source directory
+ */
+static bool BundleFileName(const std::string& relativePath, const wxFileName& sourceDir, wxFileName& fileName) {
+    wxFileName relativeName(t4p::CharToWx(relativePath.c_str()), wxPATH_UNIX);
+    if (relativeName.GetFullName().IsEmpty() || relativeName.IsAbsolute(wxPATH_UNIX)
+            || relativeName.HasVolume() || relativeName.GetDirs().Index(wxT("..")) != wxNOT_FOUND) {
+        return false;
+    }
+
+    wxFileName dirName(sourceDir);
+    dirName.Normalize(wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE);
+    wxString dir = dirName.GetPathWithSep();
+
+    // re-parse in the native format, on MSW a backslash in a name is a
+    // separator
+    fileName.Assign(dir + relativeName.GetFullPath(wxPATH_NATIVE));
+    fileName.Normalize(wxPATH_NORM_DOTS | wxPATH_NORM_ABSOLUTE);
+    wxString fullPath = fileName.GetFullPath();
+    return fullPath.StartsWith(dir) && fullPath.Length() > dir.Length();
 }
 
 std::vector<t4p::PhpTagClass> AllResources(soci::session& session) {
@@ -137,17 +241,62 @@ t4p::TagParserClass::TagParserClass()
     : PhpFileExtensions()
     , MiscFileExtensions()
     , NamespaceCache()
-    , TraitCache()
-    , Parser()
+    , IsBulkLoading(false)
+    , FileTagCache()
+    , IsFileTagCacheLoaded(false)
+    , IsFileTagCachePartial(false)
+    , Collector()
+    , Parsed()
+    , Version(pelet::PHP_53)
+    , ParserThreads(1)
+    , ParseQueue(NULL)
+    , Workers()
     , Session(NULL)
     , Transaction(NULL)
     , InsertStmt(NULL)
+    , FileTagIds()
+    , SourceIds()
+    , Keys()
+    , Identifiers()
+    , ClassNames()
+    , Types()
+    , NamespaceNames()
+    , Signatures()
+    , ReturnTypes()
+    , Comments()
+    , IsProtecteds()
+    , IsPrivates()
+    , IsStatics()
+    , IsDynamics()
+    , IsNatives()
+    , HasVariableArgs()
+    , LineNumbers()
+    , ResourcesPerInsert(RESOURCES_PER_INSERT)
+    , TraitInsertStmt(NULL)
+    , TraitKey()
+    , TraitFileTagId(0)
+    , TraitSourceId(0)
+    , TraitClassName()
+    , TraitNamespaceName()
+    , TraitName()
+    , TraitNamespace()
+    , TraitAliases()
+    , TraitInsteadOfs()
+    , NamespaceCountStmt(NULL)
+    , NamespaceKey()
+    , NamespaceType(t4p::PhpTagClass::NAMESPACE)
+    , NamespaceCount(0)
+    , DeleteResourcesStmt(NULL)
+    , DeleteTraitsStmt(NULL)
+    , DeleteFileItemStmt(NULL)
+    , DeleteFileTagId(0)
+    , FileTagInsert()
+    , ChangedFileTagIds()
+    , TagShards(NULL)
+    , CurrentFileTagId(0)
     , CurrentSourceId(0)
     , FilesParsed(0)
     , IsCacheInitialized(false) {
-    Parser.SetClassObserver(this);
-    Parser.SetClassMemberObserver(this);
-    Parser.SetFunctionObserver(this);
 }
 
 t4p::TagParserClass::~TagParserClass() {
@@ -155,7 +304,127 @@ t4p::TagParserClass::~TagParserClass() {
 }
 
 void t4p::TagParserClass::SetVersion(pelet::Versions version) {
-    Parser.SetVersion(version);
+    Version = version;
+    Collector.SetVersion(version);
+}
+
+void t4p::TagParserClass::SetParserThreads(int count) {
+    wxASSERT_MSG(!ParseQueue, wxT("parser threads cannot be changed while a search is running"));
+    if (count <= 0) {
+        count = wxThread::GetCPUCount();
+    }
+    ParserThreads = count > 0 ? count : 1;
+}
+
+void t4p::TagParserClass::BeginBulkLoad() {
+    if (!IsCacheInitialized || IsBulkLoading) {
+        return;
+    }
+    NamespaceCache.clear();
+    try {
+        Session->once << "PRAGMA synchronous = OFF";
+        std::vector<std::string> schemas = TagSchemas();
+        for (size_t i = 0; i < schemas.size(); ++i) {
+            DropIndexes(schemas[i]);
+        }
+
+        // without the key index, looking up a namespace means scanning the entire
+        // table. read them once now, from then on only the cache is used.
+        std::string key;
+        int fileTagId = 0;
+        soci::indicator fileTagIdIndicator;
+        int type = t4p::PhpTagClass::NAMESPACE;
+        soci::statement stmt = (Session->prepare << "SELECT key, file_item_id FROM resources WHERE type = ?",
+                                soci::use(type), soci::into(key), soci::into(fileTagId, fileTagIdIndicator));
+        if (stmt.execute(true)) {
+            do {
+                NamespaceCache[t4p::CharToIcu(key.c_str())] = soci::i_ok == fileTagIdIndicator ? fileTagId : 0;
+            } while (stmt.fetch());
+        }
+        IsBulkLoading = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+
+        // put back whatever was dropped
+        NamespaceCache.clear();
+        CreateIndexes();
+    }
+}
+
+void t4p::TagParserClass::EndBulkLoad() {
+    if (!IsBulkLoading) {
+        return;
+    }
+    IsBulkLoading = false;
+    NamespaceCache.clear();
+    CreateIndexes();
+    try {
+        Session->once << "ANALYZE";
+        Session->once << "PRAGMA synchronous = NORMAL";
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+    }
+}
+
+void t4p::TagParserClass::CreateIndexes() {
+    if (!IsCacheInitialized) {
+        return;
+    }
+    std::vector<std::string> schemas = TagSchemas();
+    for (size_t i = 0; i < schemas.size(); ++i) {
+        CreateIndexes(schemas[i]);
+    }
+}
+
+void t4p::TagParserClass::CreateIndexes(const std::string& schema) {
+    try {
+        for (size_t i = 0; i < sizeof(BULK_INDEX_NAMES) / sizeof(BULK_INDEX_NAMES[0]); ++i) {
+            Session->once << "CREATE INDEX IF NOT EXISTS " << schema << "." << BULK_INDEX_NAMES[i]
+                          << " ON " << BULK_INDEX_COLUMNS[i];
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+    }
+}
+
+void t4p::TagParserClass::DropIndexes(const std::string& schema) {
+    for (size_t i = 0; i < sizeof(BULK_INDEX_NAMES) / sizeof(BULK_INDEX_NAMES[0]); ++i) {
+        Session->once << "DROP INDEX IF EXISTS " << schema << "." << BULK_INDEX_NAMES[i];
+    }
+}
+
+void t4p::TagParserClass::SetResourcesPerInsert(size_t count) {
+    FlushResources();
+    ResourcesPerInsert = count > 0 ? count : 1;
+}
+
+void t4p::TagParserClass::SetTagShards(t4p::TagShardsClass* tagShards) {
+    TagShards = tagShards;
+}
+
+std::string t4p::TagParserClass::TagSchema() const {
+    return TagShards ? TagShards->Schema(CurrentSourceId) : "main";
+}
+
+std::vector<std::string> t4p::TagParserClass::TagSchemas() const {
+    if (TagShards) {
+        return TagShards->Schemas();
+    }
+    std::vector<std::string> schemas;
+    schemas.push_back("main");
+    return schemas;
 }
 
 void t4p::TagParserClass::Init(soci::session* session) {
@@ -164,23 +433,50 @@ void t4p::TagParserClass::Init(soci::session* session) {
 }
 
 void t4p::TagParserClass::Close() {
+    StopWorkers();
+    ClearFileTagCache();
     Session = NULL;
+    CloseStatements();
+    ChangedFileTagIds.clear();
     if (Transaction) {
         Transaction->rollback();
         delete Transaction;
         Transaction = NULL;
     }
-    if (InsertStmt) {
-        delete InsertStmt;
-        InsertStmt = NULL;
-    }
 }
 
 void t4p::TagParserClass::BeginSearch(const wxString& fullPath) {
     // get (or create) the source ID
     try {
         CurrentSourceId = PersistSource(fullPath);
+
+        // the files may be in nested sources whose shards another
+        // connection created; shards cannot be attached in the transaction
+        if (TagShards) {
+            TagShards->Refresh();
+        }
+        LoadFileTagCache(fullPath);
         BeginTransaction();
+        StartWorkers();
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        e.what();
+    }
+}
+
+void t4p::TagParserClass::BeginSearch(const wxString& fullPath, const std::vector<wxString>& fullPaths) {
+    try {
+        CurrentSourceId = PersistSource(fullPath);
+
+        // the files may be in nested sources whose shards another
+        // connection created; shards cannot be attached in the transaction
+        if (TagShards) {
+            TagShards->Refresh();
+        }
+        LoadFileTagCache(fullPaths);
+        BeginTransaction();
+        StartWorkers();
     } catch (std::exception& e) {
         // ATTN: at some point bubble these exceptions up?
         // to avoid unreferenced local variable warnings in MSVC
@@ -200,12 +496,27 @@ int t4p::TagParserClass::PersistSource(const wxString& sourceDir) {
                                 "SELECT source_id FROM sources WHERE directory = ?",
                                 soci::into(sourceId), soci::use(stdFullPath));
         if (!stmt.execute(true)) {
-            // didn't find the source, create a new row
+            // didn't find the source, create a new row. the shard is created
+            // before the row is committed, so that other connections never see
+            // the new source without its shard
+            soci::transaction transaction(*Session);
             soci::statement stmt = (Session->prepare <<
                                     "INSERT INTO sources(directory) VALUES(?)",
                                     soci::use(stdFullPath));
             stmt.execute(true);
             sourceId = t4p::SqliteInsertId(stmt);
+            if (TagShards) {
+                TagShards->Create(sourceId);
+            }
+            transaction.commit();
+        }
+        if (TagShards && TagShards->Attach(sourceId)) {
+            // new shards are created with all indexes
+            if (IsBulkLoading) {
+                DropIndexes(TagShards->Schema(sourceId));
+            } else {
+                CreateIndexes(TagShards->Schema(sourceId));
+            }
         }
     }
     catch (std::exception& e) {
@@ -217,48 +528,100 @@ int t4p::TagParserClass::PersistSource(const wxString& sourceDir) {
 }
 
 void t4p::TagParserClass::BeginTransaction() {
-    NamespaceCache.clear();
-    TraitCache.clear();
+    // while bulk loading the cache has all namespaces in the db
+    if (!IsBulkLoading) {
+        NamespaceCache.clear();
+    }
 
     // start a transaction here
     FilesParsed = 0;
     try {
         Transaction = new soci::transaction(*Session);
 
+        // the tables are schema-qualified; when the tags are sharded the
+        // unqualified names are read-only views
+        std::string schema = TagSchema();
         std::string sql;
-        sql += "INSERT OR IGNORE INTO resources (";
+        sql += "INSERT OR IGNORE INTO " + schema + ".resources (";
         sql += "file_item_id, source_id, key, identifier, class_name, ";
         sql += "type, namespace_name, signature, ";
         sql += "return_type, comment, is_protected, is_private, ";
-        sql += "is_static, is_dynamic, is_native, has_variable_args";
+        sql += "is_static, is_dynamic, is_native, has_variable_args, line_number";
         sql += ") VALUES(";
         sql += "?, ?, ?, ?, ?, ";
         sql += "?, ?, ?, ";
         sql += "?, ?, ?, ?, ";
-        sql += "?, ?, ?, ?";
+        sql += "?, ?, ?, ?, ?";
         sql += ");";
 
         wxASSERT_MSG(!InsertStmt, wxT("statement should be cleaned up"));
         InsertStmt = new soci::statement(*Session);
         *InsertStmt = (Session->prepare << sql,
-                       soci::use(FileTagId), soci::use(CurrentSourceId), soci::use(Key), soci::use(Identifier), soci::use(ClassName),
-                       soci::use(Type), soci::use(NamespaceName), soci::use(Signature),
-                       soci::use(ReturnType), soci::use(Comment), soci::use(IsProtected), soci::use(IsPrivate),
-                       soci::use(IsStatic), soci::use(IsDynamic), soci::use(IsNative), soci::use(HasVariableArgs));
+                       soci::use(FileTagIds), soci::use(SourceIds), soci::use(Keys), soci::use(Identifiers), soci::use(ClassNames),
+                       soci::use(Types), soci::use(NamespaceNames), soci::use(Signatures),
+                       soci::use(ReturnTypes), soci::use(Comments), soci::use(IsProtecteds), soci::use(IsPrivates),
+                       soci::use(IsStatics), soci::use(IsDynamics), soci::use(IsNatives), soci::use(HasVariableArgs),
+                       soci::use(LineNumbers));
+
+        sql = "";
+        sql += "INSERT OR IGNORE INTO " + schema + ".trait_resources(";
+        sql += "key, file_item_id, source_id, class_name, namespace_name, trait_name, ";
+        sql += "trait_namespace_name, aliases, instead_ofs) VALUES (";
+        sql += "?, ?, ?, ?, ?, ?, ";
+        sql += "?, ?, ?)";
+        TraitInsertStmt = new soci::statement(*Session);
+        *TraitInsertStmt = (Session->prepare << sql,
+                            soci::use(TraitKey), soci::use(TraitFileTagId), soci::use(TraitSourceId),
+                            soci::use(TraitClassName), soci::use(TraitNamespaceName), soci::use(TraitName),
+                            soci::use(TraitNamespace), soci::use(TraitAliases), soci::use(TraitInsteadOfs));
+
+        NamespaceCountStmt = new soci::statement(*Session);
+        *NamespaceCountStmt = (Session->prepare << "SELECT COUNT(*) FROM resources WHERE key = ? AND type = ?",
+                               soci::use(NamespaceKey), soci::use(NamespaceType), soci::into(NamespaceCount));
+
+        DeleteResourcesStmt = new soci::statement(*Session);
+        *DeleteResourcesStmt = (Session->prepare << "DELETE FROM " + schema + ".resources WHERE file_item_id = ?",
+                                soci::use(DeleteFileTagId));
+        DeleteTraitsStmt = new soci::statement(*Session);
+        *DeleteTraitsStmt = (Session->prepare << "DELETE FROM " + schema + ".trait_resources WHERE file_item_id = ?",
+                             soci::use(DeleteFileTagId));
+        DeleteFileItemStmt = new soci::statement(*Session);
+        *DeleteFileItemStmt = (Session->prepare << "DELETE FROM file_items WHERE file_item_id = ?",
+                               soci::use(DeleteFileTagId));
+
+        FileTagInsert.Init(*Session);
     } catch (std::exception& e) {
         // ATTN: at some point bubble these exceptions up?
         // to avoid unreferenced local variable warnings in MSVC
         wxString msg = t4p::CharToWx(e.what());
         wxUnusedVar(msg);
         wxASSERT_MSG(false, msg);
-        if (InsertStmt) {
-            delete InsertStmt;
-            InsertStmt = NULL;
-        }
+        CloseStatements();
     }
 }
 
+void t4p::TagParserClass::CloseStatements() {
+    ClearQueuedResources();
+
+    delete InsertStmt;
+    InsertStmt = NULL;
+    delete TraitInsertStmt;
+    TraitInsertStmt = NULL;
+    delete NamespaceCountStmt;
+    NamespaceCountStmt = NULL;
+    delete DeleteResourcesStmt;
+    DeleteResourcesStmt = NULL;
+    delete DeleteTraitsStmt;
+    DeleteTraitsStmt = NULL;
+    delete DeleteFileItemStmt;
+    DeleteFileItemStmt = NULL;
+    FileTagInsert.Close();
+}
+
 void t4p::TagParserClass::EndSearch() {
+    StopWorkers();
+    FlushResources();
+    LogChanges();
     try {
         Transaction->commit();
     } catch (std::exception& e) {
@@ -271,11 +634,61 @@ void t4p::TagParserClass::EndSearch() {
     delete Transaction;
     Transaction = NULL;
 
-    delete InsertStmt;
-    InsertStmt = NULL;
+    CloseStatements();
 
-    NamespaceCache.clear();
-    TraitCache.clear();
+    if (!IsBulkLoading) {
+        NamespaceCache.clear();
+    }
+    ClearFileTagCache();
+}
+
+void t4p::TagParserClass::StartWorkers() {
+    if (ParserThreads <= 1 || ParseQueue) {
+        return;
+    }
+    ParseQueue = new t4p::TagParseQueueClass(MAX_PARSED_FILES_PER_THREAD * ParserThreads);
+    for (int i = 0; i < ParserThreads; ++i) {
+        t4p::TagParserWorkerClass* worker = new t4p::TagParserWorkerClass(*ParseQueue, Version);
+        if (worker->Create() == wxTHREAD_NO_ERROR && worker->Run() == wxTHREAD_NO_ERROR) {
+            Workers.push_back(worker);
+        } else {
+            delete worker;
+        }
+    }
+    if (Workers.empty()) {
+        // could not start any threads, parse in this thread
+        delete ParseQueue;
+        ParseQueue = NULL;
+    }
+}
+
+void t4p::TagParserClass::StopWorkers() {
+    if (!ParseQueue) {
+        return;
+    }
+    ParseQueue->Finish();
+
+    // write everything that is still queued; workers may be blocked
+    // waiting for us to take results out of the queue
+    PersistParseQueue(true);
+    for (size_t i = 0; i < Workers.size(); ++i) {
+        Workers[i]->Wait();
+        delete Workers[i];
+    }
+    Workers.clear();
+    delete ParseQueue;
+    ParseQueue = NULL;
+}
+
+void t4p::TagParserClass::PersistParseQueue(bool wait) {
+    t4p::ParsedFileTagsClass* parsed = ParseQueue->NextResult(wait);
+    while (parsed) {
+        if (parsed->IsRead) {
+            PersistParsedFile(*parsed);
+        }
+        delete parsed;
+        parsed = ParseQueue->NextResult(wait);
+    }
 }
 
 bool t4p::TagParserClass::Walk(const wxString& fileName) {
@@ -319,20 +732,27 @@ bool t4p::TagParserClass::Walk(const wxString& fileName) {
 }
 
 void t4p::TagParserClass::BuildResourceCacheForFile(const wxString& sourceDir, const wxString& fullPath, const UnicodeString& code, bool isNew) {
-    BeginTransaction();
     CurrentSourceId = PersistSource(sourceDir);
-
-    // remove all previous cached resources
     t4p::FileTagClass fileTag;
     bool foundFile = FindFileTagByFullPathExact(fullPath, fileTag);
+    if (foundFile) {
+        // we want the new tags to have the file's proper source ID. the
+        // source shard must be attached before the transaction starts, since
+        // the statements are prepared for the current source
+        CurrentSourceId = fileTag.SourceId;
+        if (TagShards) {
+            TagShards->Attach(CurrentSourceId);
+        }
+    }
+    BeginTransaction();
+
+    // remove all previous cached resources
     if (foundFile) {
         std::vector<int> fileTagIdsToRemove;
         fileTagIdsToRemove.push_back(fileTag.FileId);
 
         // dont remove file tag, since we set source ID for the file
-        // we also want the new tags to have the file's proper source ID
-        CurrentSourceId = fileTag.SourceId;
-        RemovePersistedResources(fileTagIdsToRemove, false);
+        RemovePersistedResources(fileTagIdsToRemove, fileTag.SourceId, false);
     } else {
         // if caller just calls this method without calling Walk(); then file cache will be empty
         // need to add an entry so that GetResourceMatchFullPathFromResource works correctly
@@ -344,11 +764,8 @@ void t4p::TagParserClass::BuildResourceCacheForFile(const wxString& sourceDir, c
     }
     CurrentFileTagId = fileTag.FileId;
 
-    // for now silently ignore parse errors
-    pelet::LintResultsClass results;
-    Parser.ScanString(code, results);
-
-    PersistTraits(TraitCache, fileTag.FileId);
+    Collector.CollectString(fullPath, fileTag.FileId, code, Parsed);
+    PersistParsedFile(Parsed);
     EndSearch();
 }
 
@@ -369,9 +786,13 @@ void t4p::TagParserClass::BuildResourceCache(const wxString& fullPath, bool pars
     bool foundFile = FindFileTagByFullPathExact(fullPath, fileTag);
     if (foundFile) {
         bool needsToBeParsed = fileTag.NeedsToBeParsed(fileLastModifiedDateTime);
+        if (parseClasses && fileTag.IsParsed && !fileTag.IsNew) {
+            needsToBeParsed = IsFileChanged(fileTag, fileName, fileLastModifiedDateTime, needsToBeParsed);
+        }
         cached = !needsToBeParsed;
     } else {
         fileTag.MakeNew(fileName, fileLastModifiedDateTime, parseClasses);
+        fileTag.FileSize = FileSize(fileName);
         PersistFileTag(fileTag);
     }
     if (parseClasses) {
@@ -381,293 +802,157 @@ void t4p::TagParserClass::BuildResourceCache(const wxString& fullPath, bool pars
             if (foundFile) {
                 std::vector<int> fileTagIdsToRemove;
                 fileTagIdsToRemove.push_back(fileTag.FileId);
-                RemovePersistedResources(fileTagIdsToRemove, true);
+                RemovePersistedResources(fileTagIdsToRemove, fileTag.SourceId, true);
 
                 // the previous line deleted the file from file_items
                 // we need to re-add it
                 fileTag.MakeNew(fileName, fileLastModifiedDateTime, parseClasses);
+                fileTag.FileSize = FileSize(fileName);
                 PersistFileTag(fileTag);
             }
 
-            // for now silently ignore files with parser errors
-            pelet::LintResultsClass lintResults;
-            wxFFile file;
-            if (file.Open(fullPath, wxT("rb"))) {
-                CurrentFileTagId = fileTag.FileId;
-                Parser.ScanFile(file.fp(), t4p::WxToIcu(fullPath), lintResults);
-
-                PersistTraits(TraitCache, fileTag.FileId);
-            }
-
-            FilesParsed++;
-
-            // commit files as we are parsing
-            // this is so that the db is no locked up the entire time
-            // we want tag searches to be able to pass through
-            // even while the projects are being parsed
-            if (FilesParsed % 200 == 0) {
-                try {
-                    Transaction->commit();
-                } catch (std::exception& e) {
-                    // ATTN: at some point bubble these exceptions up?
-                    // to avoid unreferenced local variable warnings in MSVC
-                    wxString msg = t4p::CharToWx(e.what());
-                    wxUnusedVar(msg);
-                    wxASSERT_MSG(false, msg);
+            CurrentFileTagId = fileTag.FileId;
+            if (ParseQueue) {
+                // the parser threads will parse the file; write whatever
+                // they have parsed so far. if the writer is too far behind, wait
+                // for the parsers so that the queues do not grow unbounded
+                ParseQueue->AddJob(t4p::TagParseJobClass(fullPath, fileTag.FileId));
+                PersistParseQueue(false);
+                while (ParseQueue->Pending() > MAX_PARSED_FILES_PER_THREAD * Workers.size()) {
+                    t4p::ParsedFileTagsClass* parsed = ParseQueue->NextResult(true);
+                    if (parsed && parsed->IsRead) {
+                        PersistParsedFile(*parsed);
+                    }
+                    delete parsed;
                 }
-                delete Transaction;
-                Transaction = new soci::transaction(*Session);
+            } else if (Collector.CollectFile(fullPath, fileTag.FileId, Parsed)) {
+                PersistParsedFile(Parsed);
             }
         }
     }
 }
 
-void t4p::TagParserClass::ClassFound(const UnicodeString& namespaceName, const UnicodeString& className,
-                                     const UnicodeString& signature,
-                                     const UnicodeString& baseClassName,
-                                     const UnicodeString& implementsList,
-                                     const UnicodeString& comment, const int lineNumber) {
-    t4p::PhpTagClass classItem;
-    classItem.Identifier = className;
-    classItem.ClassName = className;
-    classItem.NamespaceName = namespaceName;
-    classItem.Key = className;
-    classItem.Type = t4p::PhpTagClass::CLASS;
-    classItem.Signature = signature;
-    classItem.ReturnType = UNICODE_STRING_SIMPLE("");
-    classItem.Comment = comment;
-    classItem.IsNative = false;
-    PersistResources(classItem, CurrentFileTagId);
-
-    if (IsNewNamespace(namespaceName)) {
-        // a tag for the namespace itself
-        t4p::PhpTagClass namespaceItem = t4p::PhpTagClass::MakeNamespace(namespaceName);
-        PersistResources(namespaceItem, CurrentFileTagId);
-    }
-
-    classItem.Identifier = QualifyName(namespaceName, className);
-    classItem.Key = QualifyName(namespaceName, className);
-    PersistResources(classItem, CurrentFileTagId);
-}
-
-void t4p::TagParserClass::TraitAliasFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitUsedClassName,
-        const UnicodeString& traitMethodName, const UnicodeString& alias, pelet::TokenClass::TokenIds visibility) {
-    // the trait has already been put in the cache; we just need to update it
-    UnicodeString mapKey;
-    mapKey += namespaceName;
-    mapKey += UNICODE_STRING_SIMPLE("-");
-    mapKey += className;
-    mapKey += UNICODE_STRING_SIMPLE("-");
-    mapKey += traitUsedClassName;
-
-    // this code assumes that TraitUseFound() is called before TraitAliasFound()
-    std::map<UnicodeString, std::vector<t4p::TraitTagClass>, UnicodeStringComparatorClass>::iterator it;
-    it = TraitCache.find(mapKey);
-    if (!it->second.empty()) {
-        it->second.front().Aliased.push_back(alias);
-        it->second.back().Aliased.push_back(alias);
+bool t4p::TagParserClass::IsFileChanged(t4p::FileTagClass& fileTag, const wxFileName& fileName,
+        const wxDateTime& fileLastModifiedDateTime, bool isModifiedLater) {
+    if (FileSize(fileName) != fileTag.FileSize) {
+        // the contents changed, even if the file was modified in the same
+        // second that it was last parsed
+        return true;
     }
-}
-
-void t4p::TagParserClass::TraitInsteadOfFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitUsedClassName,
-        const UnicodeString& traitMethodName, const std::vector<UnicodeString>& insteadOfList) {
-    // the trait has already been put in the cache; we just need to update it
-    UnicodeString mapKey;
-
-    mapKey += namespaceName;
-    mapKey += UNICODE_STRING_SIMPLE("-");
-    mapKey += className;
-    mapKey += UNICODE_STRING_SIMPLE("-");
-    mapKey += traitUsedClassName;
-
-    // this code assumes that TraitUseFound() is called before TraitAliasFound()
-    std::map<UnicodeString, std::vector<t4p::TraitTagClass>, UnicodeStringComparatorClass>::iterator it;
-    it = TraitCache.find(mapKey);
-    if (!it->second.empty()) {
-        it->second.front().InsteadOfs.insert(it->second.front().InsteadOfs.end(), insteadOfList.begin(), insteadOfList.end());
-        it->second.back().InsteadOfs.insert(it->second.back().InsteadOfs.end(), insteadOfList.begin(), insteadOfList.end());
+    if (!isModifiedLater) {
+        return false;
     }
-}
-
-void t4p::TagParserClass::TraitUseFound(const UnicodeString& namespaceName, const UnicodeString& className,
-                                        const UnicodeString& fullyQualifiedTraitName) {
-    t4p::TraitTagClass newTraitTag;
-    newTraitTag.ClassName = className;
-    newTraitTag.NamespaceName = namespaceName;
-
-    int32_t pos = fullyQualifiedTraitName.lastIndexOf(UNICODE_STRING_SIMPLE("\\"));
-    if (pos > 0) {
-        newTraitTag.TraitClassName.setTo(fullyQualifiedTraitName, 0, pos);
-        newTraitTag.TraitNamespaceName.setTo(fullyQualifiedTraitName, pos + 1);
-    } else if (0 == pos) {
-        // root namespace
-        newTraitTag.TraitClassName.setTo(fullyQualifiedTraitName, 1);
-        newTraitTag.TraitNamespaceName.setTo(UNICODE_STRING_SIMPLE("\\"));
-    } else {
-        // this should never get here as the parser will always give us
-        // fully qualified trait names
-        newTraitTag.TraitClassName = fullyQualifiedTraitName;
-        newTraitTag.TraitNamespaceName = UNICODE_STRING_SIMPLE("\\");
-    }
-
-    // only add if not already there
-    // key is a concatenation of file item id, fully qualified class and fully qualified trait
-    // this will make the alias and instead easier to update
-    UnicodeString mapKey;
-    mapKey += namespaceName;
-    mapKey += UNICODE_STRING_SIMPLE("-");
-    mapKey += className;
-    mapKey += UNICODE_STRING_SIMPLE("-");
-    mapKey += fullyQualifiedTraitName;
-
-    int count = TraitCache.count(mapKey);
-    if (count <= 0) {
-        newTraitTag.Key = QualifyName(namespaceName, className);
-        TraitCache[mapKey].push_back(newTraitTag);
 
-        // put a non-qualified version too, sometimes the query will not contain a fully qualified name
-        newTraitTag.Key = className;
-        TraitCache[mapKey].push_back(newTraitTag);
+    // the modified time changed but the size did not. this is the common
+    // case when switching branches or touching files; only parse
+    // when the contents are really different
+    wxString contentHash;
+    if (fileTag.ContentHash.IsEmpty()
+            || !t4p::FileTagContentHash(fileName.GetFullPath(), contentHash)
+            || contentHash != fileTag.ContentHash) {
+        return true;
     }
-}
 
-void t4p::TagParserClass::DefineDeclarationFound(const UnicodeString& namespaceName, const UnicodeString& variableName,
-        const UnicodeString& variableValue, const UnicodeString& comment, const int lineNumber) {
-    t4p::PhpTagClass defineItem;
-    defineItem.Identifier = variableName;
-    defineItem.Key = variableName;
-    defineItem.Type = t4p::PhpTagClass::DEFINE;
-    defineItem.Signature = variableValue;
-    defineItem.ReturnType = UNICODE_STRING_SIMPLE("");
-    defineItem.Comment = comment;
-    defineItem.IsNative = false;
-    PersistResources(defineItem, CurrentFileTagId);
-
-    defineItem.Identifier = QualifyName(namespaceName, variableName);
-    defineItem.Key = QualifyName(namespaceName, variableName);
-    PersistResources(defineItem, CurrentFileTagId);
-}
-
-void t4p::TagParserClass::MethodFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& methodName,
-                                      const UnicodeString& signature, const UnicodeString& returnType, const UnicodeString& comment,
-                                      pelet::TokenClass::TokenIds visibility, bool isStatic, const int lineNumber, bool hasVariableArguments) {
-    t4p::PhpTagClass item;
-    item.Identifier = methodName;
-    item.ClassName = className;
-    item.NamespaceName = namespaceName;
-    item.Key = methodName;
-    item.Type = t4p::PhpTagClass::METHOD;
-    if (!returnType.isEmpty()) {
-        item.Signature = returnType + UNICODE_STRING_SIMPLE(" ");
-    }
-
-    item.Signature += signature;
-    item.ReturnType = returnType;
-    item.Comment = comment;
-    switch (visibility) {
-    case pelet::TokenClass::PROTECTED:
-        item.IsProtected = true;
-        break;
-    case pelet::TokenClass::PRIVATE:
-        item.IsPrivate = true;
-        break;
-    default:
-        break;
-    }
-    item.IsStatic = isStatic;
-    item.IsNative = false;
-    item.HasVariableArgs = hasVariableArguments;
-    PersistResources(item, CurrentFileTagId);
-
-    // insert a complete name so that we can quickly lookup all methods for a single class
-    item.Key = className + UNICODE_STRING_SIMPLE("::") + methodName;
-    PersistResources(item, CurrentFileTagId);
-
-    // insert a fully qualified name and method so that we can quickly lookup all methods
-    // for a namespaced class
-    item.Key = QualifyName(namespaceName, className) + UNICODE_STRING_SIMPLE("::") + methodName;
-    PersistResources(item, CurrentFileTagId);
+    // store the new time so that the next check is the cheap one
+    fileTag.DateTime = fileLastModifiedDateTime;
+    bool persisted = InsertStmt ? FileTagInsert.PersistModified(fileTag) : t4p::FileTagPersistModified(*Session, fileTag);
+    if (persisted && IsFileTagCacheLoaded) {
+        FileTagCache[fileTag.FullPath] = fileTag;
+    }
+    return false;
 }
 
-void t4p::TagParserClass::PropertyFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& propertyName,
-                                        const UnicodeString& propertyType, const UnicodeString& comment,
-                                        pelet::TokenClass::TokenIds visibility, bool isConst, bool isStatic,
-                                        const int lineNumber) {
-    UnicodeString filteredProperty(propertyName);
-    if (!isStatic) {
-        // remove the siguil from the property name when the variable is not static;
-        // because when using non-static access ("->") the siguil is not used
-        // this affects the code completion functionality
-        filteredProperty.findAndReplace(UNICODE_STRING_SIMPLE("$"), UNICODE_STRING_SIMPLE(""));
-    }
-    t4p::PhpTagClass item;
-    item.Identifier = filteredProperty;
-    item.ClassName = className;
-    item.NamespaceName = namespaceName;
-    item.Key = filteredProperty;
-    item.Type = isConst ? t4p::PhpTagClass::CLASS_CONSTANT : t4p::PhpTagClass::MEMBER;
-    item.Signature =  className + UNICODE_STRING_SIMPLE("::") + filteredProperty;
-    item.ReturnType = propertyType;
-    item.Comment = comment;
-    switch (visibility) {
-    case pelet::TokenClass::PROTECTED:
-        item.IsProtected = true;
-        break;
-    case pelet::TokenClass::PRIVATE:
-        item.IsPrivate = true;
-        break;
-    default:
-        break;
-    }
-    item.IsStatic = isStatic;
-    item.IsNative = false;
-    item.HasVariableArgs = false;
-    PersistResources(item, CurrentFileTagId);
-
-    // insert a complete name so that we can quickly lookup all methods for a single class
-    item.Key = className + UNICODE_STRING_SIMPLE("::") + filteredProperty;
-    PersistResources(item, CurrentFileTagId);
-
-    // insert a fully qualified name and method so that we can quickly lookup all methods
-    // for a namespaced class
-    item.Key = QualifyName(namespaceName, className) + UNICODE_STRING_SIMPLE("::") + filteredProperty;
-    PersistResources(item, CurrentFileTagId);
+long long t4p::TagParserClass::FileSize(const wxFileName& fileName) {
+    wxULongLong size = fileName.GetSize();
+    if (size == wxInvalidSize) {
+        return -1;
+    }
+    return static_cast<long long>(size.GetValue());
 }
 
-void t4p::TagParserClass::FunctionFound(const UnicodeString& namespaceName, const UnicodeString& functionName, const UnicodeString& signature,
-                                        const UnicodeString& returnType, const UnicodeString& comment, const int lineNumber, bool hasVariableArguments) {
-    t4p::PhpTagClass item;
-    item.Identifier = functionName;
-    item.NamespaceName = namespaceName;
-    item.Key = functionName;
-    item.Type = t4p::PhpTagClass::FUNCTION;
-    item.Signature = signature;
-    item.ReturnType = returnType;
-    item.Comment = comment;
-    item.IsNative = false;
-    item.HasVariableArgs = hasVariableArguments;
-    PersistResources(item, CurrentFileTagId);
-
-    if (IsNewNamespace(namespaceName)) {
-        t4p::PhpTagClass namespaceItem = t4p::PhpTagClass::MakeNamespace(namespaceName);
-        PersistResources(namespaceItem, CurrentFileTagId);
-    }
-
-    // put in the namespace cache so that qualified name lookups work too
-    item.Identifier = QualifyName(namespaceName, functionName);
-    item.Key = QualifyName(namespaceName, functionName);
-    PersistResources(item, CurrentFileTagId);
+void t4p::TagParserClass::PersistParsedFile(const t4p::ParsedFileTagsClass& parsed) {
+    bool persisted = !parsed.ContentHash.IsEmpty() && (InsertStmt
+                     ? FileTagInsert.PersistContentHash(parsed.FileTagId, parsed.ContentHash)
+                     : t4p::FileTagPersistContentHash(*Session, parsed.FileTagId, parsed.ContentHash));
+    if (persisted) {
+        std::map<wxString, t4p::FileTagClass>::iterator it = FileTagCache.find(parsed.FullPath);
+        if (it != FileTagCache.end()) {
+            it->second.ContentHash = parsed.ContentHash;
+        }
+    }
+    ChangedFileTagIds.insert(parsed.FileTagId);
+    std::vector<t4p::PhpTagClass>::const_iterator tag;
+    for (tag = parsed.Tags.begin(); tag != parsed.Tags.end(); ++tag) {
+        PersistResources(*tag, parsed.FileTagId);
+    }
+    std::vector<UnicodeString>::const_iterator namespaceName;
+    for (namespaceName = parsed.NamespaceNames.begin(); namespaceName != parsed.NamespaceNames.end(); ++namespaceName) {
+        if (IsNewNamespace(*namespaceName)) {
+            // a tag for the namespace itself
+            t4p::PhpTagClass namespaceItem = t4p::PhpTagClass::MakeNamespace(*namespaceName);
+            PersistResources(namespaceItem, parsed.FileTagId);
+            if (IsBulkLoading) {
+                // so that the namespace is forgotten when this file is re-parsed
+                NamespaceCache[*namespaceName] = parsed.FileTagId;
+            }
+        }
+    }
+    PersistTraits(parsed.Traits, parsed.FileTagId);
+
+    FilesParsed++;
+
+    // commit files as we are parsing
+    // the tag db is in WAL mode, readers are not blocked by this transaction
+    // but they only see the tags that have been committed; we want tag
+    // searches to find new tags while the projects are being parsed.
+    // this also keeps the write ahead log from growing too big
+    int filesPerCommit = ParseQueue ? PARALLEL_FILES_PER_COMMIT : FILES_PER_COMMIT;
+    if (IsBulkLoading) {
+        filesPerCommit = BULK_FILES_PER_COMMIT;
+    }
+    if (Transaction && FilesParsed % filesPerCommit == 0) {
+        FlushResources();
+        LogChanges();
+        try {
+            Transaction->commit();
+        } catch (std::exception& e) {
+            // ATTN: at some point bubble these exceptions up?
+            // to avoid unreferenced local variable warnings in MSVC
+            wxString msg = t4p::CharToWx(e.what());
+            wxUnusedVar(msg);
+            wxASSERT_MSG(false, msg);
+        }
+        delete Transaction;
+        Transaction = new soci::transaction(*Session);
+    }
 }
 
 bool t4p::TagParserClass::IsNewNamespace(const UnicodeString& namespaceName) {
-    std::string sql = "SELECT COUNT(*) FROM resources WHERE key = ? AND type = ?";
-    std::string nm = t4p::IcuToChar(namespaceName);
-    int type = t4p::PhpTagClass::NAMESPACE;
+    // look in the namespace cache first, a namespace is usually declared
+    // in many files
+    if (NamespaceCache.count(namespaceName) > 0) {
+        return false;
+    }
+    if (IsBulkLoading) {
+        // the cache has all of the namespaces in the db
+        NamespaceCache[namespaceName] = 0;
+        return true;
+    }
     int count = 0;
     bool isNew = false;
     try {
-        soci::statement stmt = (Session->prepare << sql, soci::use(nm), soci::use(type), soci::into(count));
-        stmt.execute(true);
+        if (NamespaceCountStmt) {
+            NamespaceKey = t4p::IcuToChar(namespaceName);
+            NamespaceCount = 0;
+            NamespaceCountStmt->execute(true);
+            count = NamespaceCount;
+        } else {
+            std::string sql = "SELECT COUNT(*) FROM resources WHERE key = ? AND type = ?";
+            std::string nm = t4p::IcuToChar(namespaceName);
+            int type = t4p::PhpTagClass::NAMESPACE;
+            soci::statement stmt = (Session->prepare << sql, soci::use(nm), soci::use(type), soci::into(count));
+            stmt.execute(true);
+        }
         if (count <= 0) {
             // look in the current namespace cache, stuff that has not yet been added to the database
             if (NamespaceCache.count(namespaceName) <= 0) {
@@ -683,10 +968,55 @@ bool t4p::TagParserClass::IsNewNamespace(const UnicodeString& namespaceName) {
     return isNew;
 }
 
-void t4p::TagParserClass::RemovePersistedResources(const std::vector<int>& fileTagIds, bool removeFileTag) {
+void t4p::TagParserClass::RemovePersistedResources(const std::vector<int>& fileTagIds, int sourceId, bool removeFileTag) {
     if (!IsCacheInitialized || fileTagIds.empty()) {
         return;
     }
+
+    // the queued resources may belong to the files being removed
+    FlushResources();
+    ChangedFileTagIds.insert(fileTagIds.begin(), fileTagIds.end());
+    if (IsBulkLoading) {
+        // the namespace tags of the files are about to be deleted
+        std::map<UnicodeString, int, UnicodeStringComparatorClass>::iterator it = NamespaceCache.begin();
+        while (it != NamespaceCache.end()) {
+            if (std::find(fileTagIds.begin(), fileTagIds.end(), it->second) != fileTagIds.end()) {
+                NamespaceCache.erase(it++);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // the files may be from a source that another connection created. inside
+    // a transaction the shards were refreshed by BeginSearch()
+    if (TagShards && !Transaction) {
+        TagShards->Refresh();
+    }
+
+    // the tags are in the shard of the files' source, which is not the
+    // current source when the files are in a source nested in the
+    // current source
+    std::string schema = TagShards ? TagShards->Schema(sourceId) : "main";
+    if (DeleteResourcesStmt && schema == TagSchema()) {
+        try {
+            for (size_t i = 0; i < fileTagIds.size(); ++i) {
+                DeleteFileTagId = fileTagIds[i];
+                DeleteResourcesStmt->execute(true);
+                DeleteTraitsStmt->execute(true);
+                if (removeFileTag) {
+                    DeleteFileItemStmt->execute(true);
+                }
+            }
+        } catch (std::exception& e) {
+            // ATTN: at some point bubble these exceptions up?
+            // to avoid unreferenced local variable warnings in MSVC
+            e.what();
+        }
+
+        // the changes are logged when the transaction is committed
+        return;
+    }
     std::ostringstream stream;
     stream << "WHERE file_item_id IN (";
     for (size_t i = 0; i < fileTagIds.size(); ++i) {
@@ -697,11 +1027,9 @@ void t4p::TagParserClass::RemovePersistedResources(const std::vector<int>& fileT
     }
     stream << ")";
     try {
-        std::string deleteResourceSql = "DELETE FROM resources " + stream.str();
+        Session->once << "DELETE FROM " << schema << ".resources " << stream.str();
+        Session->once << "DELETE FROM " << schema << ".trait_resources " << stream.str();
         std::string deleteFileItemSql = "DELETE FROM file_items " + stream.str();
-
-        // TODO(roberto): remove trait_resources
-        Session->once << deleteResourceSql;
         if (removeFileTag) {
             Session->once << deleteFileItemSql;
         }
@@ -710,6 +1038,9 @@ void t4p::TagParserClass::RemovePersistedResources(const std::vector<int>& fileT
         // to avoid unreferenced local variable warnings in MSVC
         e.what();
     }
+    if (!Transaction) {
+        LogChanges();
+    }
 }
 
 void t4p::TagParserClass::Print() {
@@ -749,23 +1080,6 @@ void t4p::TagParserClass::Print() {
             break;
         }
     }
-    std::map<UnicodeString, std::vector<t4p::TraitTagClass>, UnicodeStringComparatorClass>::const_iterator it;
-    for (it = TraitCache.begin(); it != TraitCache.end(); ++it) {
-        u_fprintf(out, "TRAITS USED BY: %.*S\n",
-                  it->first.length(), it->first.getBuffer());
-        std::vector<t4p::TraitTagClass> traits =  it->second;
-        for (size_t j = 0; j < traits.size(); ++j) {
-            t4p::TraitTagClass trait = traits[j];
-            u_fprintf(out, "\tTRAIT NAME=%.*S\n",
-                      trait.TraitClassName.length(), trait.TraitClassName.getBuffer());
-            for (size_t k = 0; k < trait.Aliased.size(); k++) {
-                u_fprintf(out, "\tALIASES METHOD=%S\n", trait.Aliased[k].getTerminatedBuffer());
-            }
-            for (size_t k = 0; k < trait.InsteadOfs.size(); k++) {
-                u_fprintf(out, "\tINSTEADOF METHOD=%S\n", trait.InsteadOfs[k].getTerminatedBuffer());
-            }
-        }
-    }
     u_fclose(out);
 }
 
@@ -775,31 +1089,53 @@ void t4p::TagParserClass::PersistFileTag(t4p::FileTagClass& fileTag) {
         return;
     }
     fileTag.SourceId = CurrentSourceId;
-    t4p::FileTagPersist(*Session, fileTag);
+    bool persisted = InsertStmt ? FileTagInsert.Persist(fileTag) : t4p::FileTagPersist(*Session, fileTag);
+    if (persisted) {
+        // new files are listed by the tag index even if they have no tags
+        ChangedFileTagIds.insert(fileTag.FileId);
+    }
+    if (persisted && IsFileTagCacheLoaded) {
+        FileTagCache[fileTag.FullPath] = fileTag;
+    }
 }
 
 bool t4p::TagParserClass::FindFileTagByFullPathExact(const wxString& fullPath, t4p::FileTagClass& fileTag) {
     if (!IsCacheInitialized) {
         return false;
     }
+    if (IsFileTagCacheLoaded) {
+        std::map<wxString, t4p::FileTagClass>::const_iterator it = FileTagCache.find(fullPath);
+        if (it != FileTagCache.end()) {
+            fileTag = it->second;
+            return true;
+        }
+        if (!IsFileTagCachePartial) {
+            return false;
+        }
+    }
     int fileTagId;
     int sourceId;
     std::tm lastModified;
     int isParsed;
     int isNew;
+    long long fileSize;
+    std::string contentHash;
     bool foundFile = false;
 
     std::string query = t4p::WxToChar(fullPath);
-    std::string sql = "SELECT file_item_id, source_id, last_modified, is_parsed, is_new FROM file_items WHERE full_path = ?";
+    std::string sql = "SELECT file_item_id, source_id, last_modified, is_parsed, is_new, file_size, content_hash FROM file_items WHERE full_path = ?";
     try {
         soci::statement stmt = (Session->prepare << sql, soci::use(query),
-                                soci::into(fileTagId), soci::into(sourceId), soci::into(lastModified), soci::into(isParsed), soci::into(isNew));
+                                soci::into(fileTagId), soci::into(sourceId), soci::into(lastModified), soci::into(isParsed), soci::into(isNew),
+                                soci::into(fileSize), soci::into(contentHash));
         foundFile = stmt.execute(true);
         if (foundFile) {
             fileTag.DateTime.Set(lastModified);
             fileTag.FileId = fileTagId;
             fileTag.SourceId = sourceId;
             fileTag.FullPath = fullPath;
+            fileTag.FileSize = fileSize;
+            fileTag.ContentHash = t4p::CharToWx(contentHash.c_str());
             fileTag.IsNew = isNew != 0;
             fileTag.IsParsed = isParsed != 0;
         }
@@ -811,29 +1147,143 @@ bool t4p::TagParserClass::FindFileTagByFullPathExact(const wxString& fullPath, t
     return foundFile;
 }
 
+void t4p::TagParserClass::LoadFileTagCache(const wxString& sourceDir) {
+    ClearFileTagCache();
+    if (!IsCacheInitialized) {
+        return;
+    }
+    wxFileName dir;
+    dir.AssignDir(sourceDir);
+    std::string stdFullPathLike = t4p::SqliteSqlLikeEscape(t4p::WxToChar(dir.GetPathWithSep()), '^') + "%";
+
+    int fileTagId;
+    int sourceId;
+    std::string fullPath;
+    std::tm lastModified;
+    int isParsed;
+    int isNew;
+    long long fileSize;
+    std::string contentHash;
+    std::string sql = "SELECT file_item_id, source_id, full_path, last_modified, is_parsed, is_new, file_size, content_hash ";
+    sql += "FROM file_items WHERE full_path LIKE ? ESCAPE '^'";
+    try {
+        soci::statement stmt = (Session->prepare << sql, soci::use(stdFullPathLike),
+                                soci::into(fileTagId), soci::into(sourceId), soci::into(fullPath),
+                                soci::into(lastModified), soci::into(isParsed), soci::into(isNew),
+                                soci::into(fileSize), soci::into(contentHash));
+        if (stmt.execute(true)) {
+            do {
+                t4p::FileTagClass fileTag;
+                fileTag.DateTime.Set(lastModified);
+                fileTag.FileId = fileTagId;
+                fileTag.SourceId = sourceId;
+                fileTag.FullPath = t4p::CharToWx(fullPath.c_str());
+                fileTag.FileSize = fileSize;
+                fileTag.ContentHash = t4p::CharToWx(contentHash.c_str());
+                fileTag.IsNew = isNew != 0;
+                fileTag.IsParsed = isParsed != 0;
+                FileTagCache[fileTag.FullPath] = fileTag;
+            } while (stmt.fetch());
+        }
+        IsFileTagCacheLoaded = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        // lookups will go to the database
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        FileTagCache.clear();
+    }
+}
+
+void t4p::TagParserClass::LoadFileTagCache(const std::vector<wxString>& fullPaths) {
+    ClearFileTagCache();
+    if (!IsCacheInitialized) {
+        return;
+    }
+    std::string fullPath;
+    int fileTagId;
+    int sourceId;
+    std::tm lastModified;
+    int isParsed;
+    int isNew;
+    long long fileSize;
+    std::string contentHash;
+    std::string sql = "SELECT file_item_id, source_id, last_modified, is_parsed, is_new, file_size, content_hash ";
+    sql += "FROM file_items WHERE full_path = ?";
+    try {
+        soci::statement stmt = (Session->prepare << sql, soci::use(fullPath),
+                                soci::into(fileTagId), soci::into(sourceId),
+                                soci::into(lastModified), soci::into(isParsed), soci::into(isNew),
+                                soci::into(fileSize), soci::into(contentHash));
+        for (size_t i = 0; i < fullPaths.size(); ++i) {
+            fullPath = t4p::WxToChar(fullPaths[i]);
+            if (stmt.execute(true)) {
+                t4p::FileTagClass fileTag;
+                fileTag.DateTime.Set(lastModified);
+                fileTag.FileId = fileTagId;
+                fileTag.SourceId = sourceId;
+                fileTag.FullPath = fullPaths[i];
+                fileTag.FileSize = fileSize;
+                fileTag.ContentHash = t4p::CharToWx(contentHash.c_str());
+                fileTag.IsNew = isNew != 0;
+                fileTag.IsParsed = isParsed != 0;
+                FileTagCache[fileTag.FullPath] = fileTag;
+            }
+        }
+        IsFileTagCacheLoaded = true;
+        IsFileTagCachePartial = true;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        // lookups will go to the database
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        FileTagCache.clear();
+    }
+}
+
+void t4p::TagParserClass::ClearFileTagCache() {
+    FileTagCache.clear();
+    IsFileTagCacheLoaded = false;
+    IsFileTagCachePartial = false;
+}
+
 void t4p::TagParserClass::WipeAll() {
     NamespaceCache.clear();
-    TraitCache.clear();
+    ClearFileTagCache();
 
     if (IsCacheInitialized) {
         try {
             Session->once << "DELETE FROM file_items;";
-            Session->once << "DELETE FROM resources;";
-            Session->once << "DELETE FROM trait_resources;";
+            Session->once << "DELETE FROM main.resources;";
+            Session->once << "DELETE FROM main.trait_resources;";
             Session->once << "DELETE FROM sources;";
         } catch (std::exception& e) {
             // ATTN: at some point bubble these exceptions up?
             // to avoid unreferenced local variable warnings in MSVC
             e.what();
         }
+        if (TagShards) {
+            TagShards->RemoveAll();
+        }
+
+        // the db is empty, the VACUUM is quick. the tag indexes are
+        // re-read in full since all files changed
+        t4p::SqliteSetIncrementalAutoVacuum(*Session);
+        ChangedFileTagIds.insert(0);
+        LogChanges();
     }
 }
 
 void t4p::TagParserClass::DeleteSource(const wxFileName& sourceDir) {
     NamespaceCache.clear();
-    TraitCache.clear();
+    ClearFileTagCache();
 
     if (IsCacheInitialized) {
+        int deletedSourceId = 0;
         try {
             wxString errorMsg;
 
@@ -845,10 +1295,12 @@ void t4p::TagParserClass::DeleteSource(const wxFileName& sourceDir) {
             soci::statement stmt = (Session->prepare << sql, soci::into(sourceId), soci::use(stdSourceDir));
 
             if (stmt.execute(true)) {
-                sql = "DELETE FROM resources WHERE source_id = ?";
+                // the tags of a sharded source are deleted along with
+                // the shard file
+                sql = "DELETE FROM main.resources WHERE source_id = ?";
                 Session->once << sql, soci::use(sourceId);
 
-                sql = "DELETE FROM trait_resources WHERE source_id = ?";
+                sql = "DELETE FROM main.trait_resources WHERE source_id = ?";
                 Session->once << sql, soci::use(sourceId);
 
                 sql = "DELETE FROM file_items WHERE source_id = ?";
@@ -856,18 +1308,269 @@ void t4p::TagParserClass::DeleteSource(const wxFileName& sourceDir) {
 
                 sql = "DELETE FROM sources WHERE source_id = ?";
                 Session->once << sql, soci::use(sourceId);
+                deletedSourceId = sourceId;
             }
         } catch (std::exception& e) {
             // ATTN: at some point bubble these exceptions up?
             // to avoid unreferenced local variable warnings in MSVC
             e.what();
         }
+
+        // detach after the statements are done with the db
+        if (TagShards && deletedSourceId > 0) {
+            TagShards->Remove(deletedSourceId);
+        }
+
+        // the tag indexes would need to find all of the files of the source
+        if (deletedSourceId > 0) {
+            ChangedFileTagIds.insert(0);
+            LogChanges();
+        }
+    }
+}
+
+bool t4p::TagParserClass::ExportBundle(const wxFileName& sourceDir, const wxFileName& bundleFileName) {
+    if (!IsCacheInitialized) {
+        return false;
+    }
+    int sourceId = 0;
+    bool ret = false;
+    try {
+        std::string stdSourceDir = t4p::WxToChar(sourceDir.GetPathWithSep());
+        soci::statement stmt = (Session->prepare << "SELECT source_id FROM sources WHERE directory = ?",
+                                soci::into(sourceId), soci::use(stdSourceDir));
+        if (!stmt.execute(true)) {
+            return false;
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    if (bundleFileName.FileExists() && !wxRemoveFile(bundleFileName.GetFullPath())) {
+        return false;
+    }
+    if (TagShards) {
+        TagShards->Attach(sourceId);
+    }
+    try {
+        std::string stdBundleFile = t4p::WxToChar(bundleFileName.GetFullPath());
+        Session->once << "ATTACH DATABASE ? AS bundle", soci::use(stdBundleFile);
+        try {
+            soci::transaction transaction(*Session);
+            for (size_t i = 0; i < sizeof(TAG_BUNDLE_SQL) / sizeof(TAG_BUNDLE_SQL[0]); ++i) {
+                Session->once << TAG_BUNDLE_SQL[i];
+            }
+            int version = TAG_BUNDLE_VERSION;
+            Session->once << "INSERT INTO bundle.bundle_info(format_version) VALUES(?)", soci::use(version);
+
+            // only the files that we know the tags are up-to-date for
+            std::vector<int> fileTagIds;
+            std::vector<std::string> fullPaths;
+            std::vector<std::string> names;
+            std::vector<long long> fileSizes;
+            std::vector<std::string> contentHashes;
+            int fileTagId = 0;
+            std::string fullPath;
+            std::string name;
+            long long fileSize = 0;
+            std::string contentHash;
+            soci::statement stmt = (Session->prepare <<
+                                    "SELECT file_item_id, full_path, name, file_size, content_hash FROM file_items "
+                                    "WHERE source_id = ? AND is_parsed = 1 AND is_new = 0 AND content_hash != ''",
+                                    soci::use(sourceId), soci::into(fileTagId), soci::into(fullPath), soci::into(name),
+                                    soci::into(fileSize), soci::into(contentHash));
+            if (stmt.execute(true)) {
+                do {
+                    fileTagIds.push_back(fileTagId);
+                    fullPaths.push_back(fullPath);
+                    names.push_back(name);
+                    fileSizes.push_back(fileSize);
+                    contentHashes.push_back(contentHash);
+                } while (stmt.fetch());
+            }
+
+            // the relative paths always use the unix separator, so that
+            // bundles can be used in any OS
+            std::string relativePath;
+            soci::statement insertStmt = (Session->prepare <<
+                                          "INSERT INTO bundle.file_items(file_item_id, relative_path, name, file_size, content_hash) "
+                                          "VALUES(?, ?, ?, ?, ?)",
+                                          soci::use(fileTagId), soci::use(relativePath), soci::use(name),
+                                          soci::use(fileSize), soci::use(contentHash));
+            for (size_t i = 0; i < fileTagIds.size(); ++i) {
+                wxFileName fileName(t4p::CharToWx(fullPaths[i].c_str()));
+                if (!fileName.MakeRelativeTo(sourceDir.GetPath())) {
+                    continue;
+                }
+                fileTagId = fileTagIds[i];
+                relativePath = t4p::WxToChar(fileName.GetFullPath(wxPATH_UNIX));
+                name = names[i];
+                fileSize = fileSizes[i];
+                contentHash = contentHashes[i];
+                insertStmt.execute(true);
+            }
+
+            std::string sql;
+            sql += "INSERT INTO bundle.resources(file_item_id, ";
+            sql += TAG_BUNDLE_RESOURCE_COLUMNS;
+            sql += ") SELECT file_item_id, ";
+            sql += TAG_BUNDLE_RESOURCE_COLUMNS;
+            sql += " FROM resources WHERE source_id = ? AND file_item_id IN(SELECT file_item_id FROM bundle.file_items)";
+            Session->once << sql, soci::use(sourceId);
+
+            sql = "";
+            sql += "INSERT INTO bundle.trait_resources(file_item_id, ";
+            sql += TAG_BUNDLE_TRAIT_COLUMNS;
+            sql += ") SELECT file_item_id, ";
+            sql += TAG_BUNDLE_TRAIT_COLUMNS;
+            sql += " FROM trait_resources WHERE source_id = ? AND file_item_id IN(SELECT file_item_id FROM bundle.file_items)";
+            Session->once << sql, soci::use(sourceId);
+            transaction.commit();
+            ret = true;
+        } catch (std::exception& e) {
+            // ATTN: at some point bubble these exceptions up?
+            // to avoid unreferenced local variable warnings in MSVC
+            wxString msg = t4p::CharToWx(e.what());
+            wxUnusedVar(msg);
+            wxASSERT_MSG(false, msg);
+        }
+        Session->once << "DETACH DATABASE bundle";
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        ret = false;
+    }
+    return ret;
+}
+
+int t4p::TagParserClass::ImportBundle(const wxFileName& bundleFileName, const wxFileName& sourceDir) {
+    if (!IsCacheInitialized || !bundleFileName.FileExists()) {
+        return 0;
+    }
+
+    // get (or create) the source ID, this also attaches the source shard
+    // and it needs to be done outside of the transaction
+    CurrentSourceId = PersistSource(sourceDir.GetPath());
+    NamespaceCache.clear();
+    LoadFileTagCache(sourceDir.GetPath());
+    std::vector<int> importedFileTagIds;
+    try {
+        std::string stdBundleFile = t4p::WxToChar(bundleFileName.GetFullPath());
+        Session->once << "ATTACH DATABASE ? AS bundle", soci::use(stdBundleFile);
+        try {
+            int version = 0;
+            Session->once << "SELECT format_version FROM bundle.bundle_info", soci::into(version);
+            if (TAG_BUNDLE_VERSION == version) {
+                // read the files first, so that the bundle is not being read
+                // while we write
+                std::vector<int> bundleFileTagIds;
+                std::vector<std::string> relativePaths;
+                std::vector<long long> fileSizes;
+                std::vector<std::string> contentHashes;
+                int bundleFileTagId = 0;
+                std::string relativePath;
+                long long fileSize = 0;
+                std::string contentHash;
+                soci::statement stmt = (Session->prepare <<
+                                        "SELECT file_item_id, relative_path, file_size, content_hash FROM bundle.file_items",
+                                        soci::into(bundleFileTagId), soci::into(relativePath), soci::into(fileSize),
+                                        soci::into(contentHash));
+                if (stmt.execute(true)) {
+                    do {
+                        bundleFileTagIds.push_back(bundleFileTagId);
+                        relativePaths.push_back(relativePath);
+                        fileSizes.push_back(fileSize);
+                        contentHashes.push_back(contentHash);
+                    } while (stmt.fetch());
+                }
+
+                soci::transaction transaction(*Session);
+                Session->once << "CREATE TEMP TABLE IF NOT EXISTS bundle_files(bundle_file_item_id INTEGER NOT NULL, file_item_id INTEGER NOT NULL)";
+                Session->once << "DELETE FROM temp.bundle_files";
+                int fileTagId = 0;
+                soci::statement mapStmt = (Session->prepare <<
+                                           "INSERT INTO temp.bundle_files(bundle_file_item_id, file_item_id) VALUES(?, ?)",
+                                           soci::use(bundleFileTagId), soci::use(fileTagId));
+                for (size_t i = 0; i < bundleFileTagIds.size(); ++i) {
+                    wxFileName fileName;
+                    if (!BundleFileName(relativePaths[i], sourceDir, fileName)) {
+                        continue;
+                    }
+                    t4p::FileTagClass fileTag;
+                    if (FindFileTagByFullPathExact(fileName.GetFullPath(), fileTag) || !fileName.FileExists()
+                            || FileSize(fileName) != fileSizes[i]) {
+                        continue;
+                    }
+                    wxString localContentHash;
+                    if (!t4p::FileTagContentHash(fileName.GetFullPath(), localContentHash)
+                            || t4p::WxToChar(localContentHash) != contentHashes[i]) {
+                        continue;
+                    }
+                    fileTag.MakeNew(fileName, fileName.GetModificationTime(), true);
+                    fileTag.FileSize = fileSizes[i];
+                    fileTag.ContentHash = localContentHash;
+                    PersistFileTag(fileTag);
+                    bundleFileTagId = bundleFileTagIds[i];
+                    fileTagId = fileTag.FileId;
+                    mapStmt.execute(true);
+                    importedFileTagIds.push_back(fileTag.FileId);
+                }
+
+                // a namespace tag is only added once for all files, skip the
+                // namespaces that we already have
+                int sourceId = CurrentSourceId;
+                int namespaceType = t4p::PhpTagClass::NAMESPACE;
+                std::string schema = TagSchema();
+                std::string sql;
+                sql += "INSERT INTO " + schema + ".resources(file_item_id, source_id, ";
+                sql += TAG_BUNDLE_RESOURCE_COLUMNS;
+                sql += ") SELECT m.file_item_id, ?, ";
+                sql += TAG_BUNDLE_RESOURCE_COLUMNS;
+                sql += " FROM bundle.resources b JOIN temp.bundle_files m ON(m.bundle_file_item_id = b.file_item_id) ";
+                sql += "WHERE NOT (b.type = ? AND EXISTS(SELECT 1 FROM resources r WHERE r.key = b.key AND r.type = b.type))";
+                Session->once << sql, soci::use(sourceId), soci::use(namespaceType);
+
+                sql = "";
+                sql += "INSERT INTO " + schema + ".trait_resources(file_item_id, source_id, ";
+                sql += TAG_BUNDLE_TRAIT_COLUMNS;
+                sql += ") SELECT m.file_item_id, ?, ";
+                sql += TAG_BUNDLE_TRAIT_COLUMNS;
+                sql += " FROM bundle.trait_resources b JOIN temp.bundle_files m ON(m.bundle_file_item_id = b.file_item_id)";
+                Session->once << sql, soci::use(sourceId);
+                Session->once << "DROP TABLE temp.bundle_files";
+                LogChanges();
+                transaction.commit();
+            }
+        } catch (std::exception& e) {
+            // ATTN: at some point bubble these exceptions up?
+            // to avoid unreferenced local variable warnings in MSVC
+            wxString msg = t4p::CharToWx(e.what());
+            wxUnusedVar(msg);
+            wxASSERT_MSG(false, msg);
+            importedFileTagIds.clear();
+        }
+        Session->once << "DETACH DATABASE bundle";
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
     }
+    ClearFileTagCache();
+    return importedFileTagIds.size();
 }
 
 void t4p::TagParserClass::DeleteDirectories(const std::vector<wxFileName>& dirs) {
     NamespaceCache.clear();
-    TraitCache.clear();
+    ClearFileTagCache();
 
     if (IsCacheInitialized) {
         try {
@@ -886,14 +1589,19 @@ void t4p::TagParserClass::DeleteDirectories(const std::vector<wxFileName>& dirs)
                 }
                 stream << ")";
 
-                std::string sql = "DELETE FROM resources WHERE " + stream.str();
-                Session->once << sql;
-
-                sql = "DELETE FROM trait_resources WHERE " + stream.str();
-                Session->once << sql;
+                if (TagShards) {
+                    TagShards->Refresh();
+                }
+                std::vector<std::string> schemas = TagSchemas();
+                for (size_t i = 0; i < schemas.size(); ++i) {
+                    Session->once << "DELETE FROM " << schemas[i] << ".resources WHERE " << stream.str();
+                    Session->once << "DELETE FROM " << schemas[i] << ".trait_resources WHERE " << stream.str();
+                }
 
-                sql = "DELETE FROM file_items WHERE " + stream.str();
+                std::string sql = "DELETE FROM file_items WHERE " + stream.str();
                 Session->once << sql;
+                ChangedFileTagIds.insert(fileTagIds.begin(), fileTagIds.end());
+                LogChanges();
             }
         } catch (std::exception& e) {
             // ATTN: at some point bubble these exceptions up?
@@ -908,7 +1616,8 @@ void t4p::TagParserClass::DeleteFromFile(const wxString& fullPath) {
     if (FindFileTagByFullPathExact(fullPath, fileTag)) {
         std::vector<int> fileTagIdsToRemove;
         fileTagIdsToRemove.push_back(fileTag.FileId);
-        RemovePersistedResources(fileTagIdsToRemove, true);
+        RemovePersistedResources(fileTagIdsToRemove, fileTag.SourceId, true);
+        FileTagCache.erase(fullPath);
     }
 }
 
@@ -919,29 +1628,81 @@ void t4p::TagParserClass::PersistResources(const t4p::PhpTagClass& resource, int
     if (!InsertStmt) {
         return;
     }
+    FileTagIds.push_back(fileTagId);
+    SourceIds.push_back(CurrentSourceId);
+    Keys.push_back(t4p::IcuToChar(resource.Key));
+    Identifiers.push_back(t4p::IcuToChar(resource.Identifier));
+    ClassNames.push_back(t4p::IcuToChar(resource.ClassName));
+    Types.push_back(resource.Type);
+    NamespaceNames.push_back(t4p::IcuToChar(resource.NamespaceName));
+    Signatures.push_back(t4p::IcuToChar(resource.Signature));
+    ReturnTypes.push_back(t4p::IcuToChar(resource.ReturnType));
+    Comments.push_back(t4p::IcuToChar(resource.Comment));
+    IsProtecteds.push_back(resource.IsProtected);
+    IsPrivates.push_back(resource.IsPrivate);
+    IsStatics.push_back(resource.IsStatic);
+    IsDynamics.push_back(resource.IsDynamic);
+    IsNatives.push_back(resource.IsNative);
+    HasVariableArgs.push_back(resource.HasVariableArgs);
+    LineNumbers.push_back(resource.LineNumber);
+    if (FileTagIds.size() >= ResourcesPerInsert) {
+        FlushResources();
+    }
+}
+
+void t4p::TagParserClass::FlushResources() {
+    if (!InsertStmt || FileTagIds.empty()) {
+        return;
+    }
     try {
-        FileTagId = fileTagId;
-
-        Key = t4p::IcuToChar(resource.Key);
-        Identifier = t4p::IcuToChar(resource.Identifier);
-        ClassName = t4p::IcuToChar(resource.ClassName);
-        Type = resource.Type;
-        NamespaceName = t4p::IcuToChar(resource.NamespaceName);
-        Signature = t4p::IcuToChar(resource.Signature);
-        ReturnType = t4p::IcuToChar(resource.ReturnType);
-        Comment = t4p::IcuToChar(resource.Comment);
-        IsProtected = resource.IsProtected;
-        IsPrivate = resource.IsPrivate;
-        IsStatic = resource.IsStatic;
-        IsDynamic = resource.IsDynamic;
-        IsNative = resource.IsNative;
-        HasVariableArgs = resource.HasVariableArgs;
+        // soci does not allow executing with empty vectors, which is
+        // why we check for empty above
         InsertStmt->execute(true);
     } catch (std::exception& e) {
         // ATTN: at some point bubble these exceptions up?
         // to avoid unreferenced local variable warnings in MSVC
         e.what();
     }
+    ClearQueuedResources();
+}
+
+void t4p::TagParserClass::ClearQueuedResources() {
+    FileTagIds.clear();
+    SourceIds.clear();
+    Keys.clear();
+    Identifiers.clear();
+    ClassNames.clear();
+    Types.clear();
+    NamespaceNames.clear();
+    Signatures.clear();
+    ReturnTypes.clear();
+    Comments.clear();
+    IsProtecteds.clear();
+    IsPrivates.clear();
+    IsStatics.clear();
+    IsDynamics.clear();
+    IsNatives.clear();
+    HasVariableArgs.clear();
+    LineNumbers.clear();
+}
+
+void t4p::TagParserClass::LogChanges() {
+    if (!IsCacheInitialized || !Session || ChangedFileTagIds.empty()) {
+        return;
+    }
+    std::vector<int> fileTagIds(ChangedFileTagIds.begin(), ChangedFileTagIds.end());
+    ChangedFileTagIds.clear();
+    try {
+        Session->once << "INSERT INTO tag_changes(file_item_id) VALUES(?)", soci::use(fileTagIds);
+        Session->once << "DELETE FROM tag_changes WHERE tag_change_id <= "
+                      << "(SELECT MAX(tag_change_id) FROM tag_changes) - " << MAX_TAG_CHANGES;
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+    }
 }
 
 void t4p::TagParserClass::PersistTraits(
@@ -950,51 +1711,38 @@ void t4p::TagParserClass::PersistTraits(
     if (!IsCacheInitialized) {
         return;
     }
-    std::string sql;
-    sql += "INSERT OR IGNORE INTO trait_resources(";
-    sql += "key, file_item_id, source_id, class_name, namespace_name, trait_name, ";
-    sql += "trait_namespace_name, aliases, instead_ofs) VALUES (";
-    sql += "?, ?, ?, ?, ?, ?, ";
-    sql += "?, ?, ?)";
-    std::string key;
-    std::string className;
-    std::string namespaceName;
-    std::string traitClassName;
-    std::string traitNamespaceName;
-    std::string aliases;
-    std::string insteadOfs;
-
+    if (!TraitInsertStmt) {
+        return;
+    }
     try {
-        soci::statement stmt = (Session->prepare << sql,
-                                soci::use(key), soci::use(fileTagId), soci::use(CurrentSourceId),
-                                soci::use(className), soci::use(namespaceName), soci::use(traitClassName),
-                                soci::use(traitNamespaceName), soci::use(aliases), soci::use(insteadOfs));
         std::map<UnicodeString, std::vector<t4p::TraitTagClass>, UnicodeStringComparatorClass>::const_iterator it;
         for (it = traitMap.begin(); it != traitMap.end(); ++it) {
             std::vector<t4p::TraitTagClass>::const_iterator trait;
             for (trait = it->second.begin(); trait != it->second.end(); ++trait) {
-                key = t4p::IcuToChar(trait->Key);
-                className = t4p::IcuToChar(trait->ClassName);
-                namespaceName = t4p::IcuToChar(trait->NamespaceName);
-                traitClassName = t4p::IcuToChar(trait->TraitClassName);
-                traitNamespaceName = t4p::IcuToChar(trait->TraitNamespaceName);
-                aliases = "";
+                TraitKey = t4p::IcuToChar(trait->Key);
+                TraitFileTagId = fileTagId;
+                TraitSourceId = CurrentSourceId;
+                TraitClassName = t4p::IcuToChar(trait->ClassName);
+                TraitNamespaceName = t4p::IcuToChar(trait->NamespaceName);
+                TraitName = t4p::IcuToChar(trait->TraitClassName);
+                TraitNamespace = t4p::IcuToChar(trait->TraitNamespaceName);
+                TraitAliases = "";
                 for (std::vector<UnicodeString>::const_iterator alias = trait->Aliased.begin(); alias != trait->Aliased.end(); ++alias) {
-                    aliases += t4p::IcuToChar(*alias);
-                    aliases += ",";
+                    TraitAliases += t4p::IcuToChar(*alias);
+                    TraitAliases += ",";
                 }
-                if (!aliases.empty()) {
-                    aliases.erase(aliases.end() - 1);
+                if (!TraitAliases.empty()) {
+                    TraitAliases.erase(TraitAliases.end() - 1);
                 }
-                insteadOfs = "";
+                TraitInsteadOfs = "";
                 for (std::vector<UnicodeString>::const_iterator instead = trait->InsteadOfs.begin(); instead != trait->InsteadOfs.end(); ++instead) {
-                    insteadOfs += t4p::IcuToChar(*instead);
-                    insteadOfs += ",";
+                    TraitInsteadOfs += t4p::IcuToChar(*instead);
+                    TraitInsteadOfs += ",";
                 }
-                if (!insteadOfs.empty()) {
-                    insteadOfs.erase(insteadOfs.end() - 1);
+                if (!TraitInsteadOfs.empty()) {
+                    TraitInsteadOfs.erase(TraitInsteadOfs.end() - 1);
                 }
-                stmt.execute(true);
+                TraitInsertStmt->execute(true);
             }
         }
     } catch (std::exception& e) {
@@ -1072,6 +1820,7 @@ std::vector<t4p::TraitTagClass> t4p::TagParserClass::FindTraitsByClassName(const
 }
 
 void t4p::TagParserClass::RenameFile(const wxFileName& oldFile, const wxFileName& newFile) {
+    ClearFileTagCache();
     try {
         std::string stdOldPath = t4p::WxToChar(oldFile.GetFullPath());
         std::string stdNewPath = t4p::WxToChar(newFile.GetFullPath());
@@ -1085,9 +1834,17 @@ void t4p::TagParserClass::RenameFile(const wxFileName& oldFile, const wxFileName
         // to avoid unreferenced local variable warnings in MSVC
         wxASSERT_MSG(false, wxString(e.what()));
     }
+
+    // the tags keep their file ID, only the file path changed
+    t4p::FileTagClass fileTag;
+    if (FindFileTagByFullPathExact(newFile.GetFullPath(), fileTag)) {
+        ChangedFileTagIds.insert(fileTag.FileId);
+        LogChanges();
+    }
 }
 
 void t4p::TagParserClass::RenameDir(const wxFileName& oldDir, const wxFileName& newDir) {
+    ClearFileTagCache();
     try {
         std::string stdOldPath = t4p::WxToChar(oldDir.GetPathWithSep());
         std::string stdOldPathLike = stdOldPath + "%";
@@ -1101,4 +1858,6 @@ void t4p::TagParserClass::RenameDir(const wxFileName& oldDir, const wxFileName&
         // to avoid unreferenced local variable warnings in MSVC
         wxASSERT_MSG(false, wxString(e.what()));
     }
+    ChangedFileTagIds.insert(0);
+    LogChanges();
 }
@@ -32,12 +32,19 @@
 #include <wx/filename.h>
 #include <wx/string.h>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
+#include "language_php/FileTags.h"
 #include "language_php/PhpTagClass.h"
+#include "language_php/TagCollectorClass.h"
+#include "language_php/TagParserWorkerClass.h"
 #include "search/DirectorySearchClass.h"
 
 namespace t4p {
+// forward declaration
+class TagShardsClass;
+
 /**
  * The TagParser is used to store parsed tags(classes, functions, methods, properties) into a
  * SQLite database. This class is used in conjunction with the DirectorySearchClass; the
@@ -45,17 +52,20 @@ namespace t4p {
  * DirectorySearchClass and parses the source code for tags.
  *
  * The TagParserClass can only handle PHP source code files; it uses the pelet library to
- * do the actual PHP parsing.
+ * do the actual PHP parsing (via the TagCollectorClass).
+ *
+ * Files can be parsed in parallel; see SetParserThreads(). When parsing in parallel,
+ * Walk() only records the file and queues it up; the parsing is done by
+ * TagParserWorkerClass threads and the resulting tags are written by the thread
+ * that calls Walk() and EndSearch(). All database writes are always done
+ * by a single thread (the one that owns the session).
  *
  * The TagParser has an exception-free API, no exceptions will be ever thrown, even though
  * it uses SOCI to execute queries (and SOCI uses exceptions). Instead
  * the return values for methods of this class will be false, empty, or zero. Currently this class does not expose
  * the specific error code from SQLite.
  */
-class TagParserClass : public pelet::ClassObserverClass,
-    public pelet::ClassMemberObserverClass,
-    public pelet::FunctionObserverClass,
-    public t4p::DirectoryWalkerClass {
+class TagParserClass : public t4p::DirectoryWalkerClass {
  public:
     /**
      * The files to be parsed; these are php source code file
@@ -102,11 +112,78 @@ class TagParserClass : public pelet::ClassObserverClass,
      */
     void Close();
 
+    /**
+     * Set the number of threads that will parse files during a
+     * BeginSearch() / Walk() / EndSearch() sequence. A count of 1 (the default)
+     * means that files are parsed in the calling thread.
+     * This method must be called before BeginSearch().
+     *
+     * @param count number of parser threads; if zero then there will be
+     *        as many threads as there are CPUs.
+     */
+    void SetParserThreads(int count);
+
+    /**
+     * set the number of resources that are inserted at once.
+     * By default, resources are inserted in batches of 500.
+     * This is mostly useful for profiling.
+     *
+     * @param count number of resources, 1 means insert each resource on its own
+     */
+    void SetResourcesPerInsert(size_t count);
+
+    /**
+     * Prepares the tag db for writing a large number of tags (ie. re-tagging
+     * entire projects after a wipe). The key and source indexes of the
+     * resources table are dropped and writes are no longer synced to disk;
+     * the rows are written much faster but queries made (by other
+     * connections) while the tags are written will be slow.
+     * Call EndBulkLoad() once all sources have been walked.
+     *
+     * This method must be called before BeginSearch().
+     */
+    void BeginBulkLoad();
+
+    /**
+     * Re-creates the indexes dropped by BeginBulkLoad(), updates the query
+     * planner statistics and restores the sync mode. This method
+     * must be called after EndSearch().
+     */
+    void EndBulkLoad();
+
+    /**
+     * Creates the indexes dropped by BeginBulkLoad() if they do not
+     * exist. The indexes will be missing if the app was closed while
+     * a bulk load was running.
+     */
+    void CreateIndexes();
+
+    /**
+     * Set the shards of the tag db. When set, the tags of each source are
+     * written to the shard of the source, and a new source gets its own
+     * shard (see TagShardsClass).
+     *
+     * @param tagShards the shards attached to the session given in Init(), can be NULL.
+     *        this class will NOT own the pointer
+     */
+    void SetTagShards(t4p::TagShardsClass* tagShards);
+
     /**
      * Implement the DirectoryWalkerClass method; will start a transaction
+     * and start the parser threads (if any)
      */
     void BeginSearch(const wxString& fullPath);
 
+    /**
+     * Same as BeginSearch(), but only the file items of the given files are
+     * read up front. Use this instead of BeginSearch() when only a few files
+     * of a large source will be walked.
+     *
+     * @param fullPath the source directory
+     * @param fullPaths the files that will be walked or deleted
+     */
+    void BeginSearch(const wxString& fullPath, const std::vector<wxString>& fullPaths);
+
     /**
      * Parses the given file for resources. Note that one of the Init() method
      * must have been called before a call to this method is made. Also, BeginSearch() must
@@ -118,7 +195,8 @@ class TagParserClass : public pelet::ClassObserverClass,
     virtual bool Walk(const wxString& fileName);
 
     /**
-     * Implement the DirectoryWalkerClass method; will commit a transaction. If
+     * Implement the DirectoryWalkerClass method; will wait for the parser threads
+     * to finish, write the remaining tags and commit a transaction. If
      * using a DirectorySearchClass, the DirectorySearchClass
      * will take care of calling that method before after all files have been recursed.
      */
@@ -140,50 +218,6 @@ class TagParserClass : public pelet::ClassObserverClass,
      */
     void BuildResourceCacheForFile(const wxString& sourceDir, const wxString& fileName, const UnicodeString& code, bool isNew);
 
-    /**
-     * Implement class observer.  When a class has been parsed, add it to the Resource Cache.
-     */
-    void ClassFound(const UnicodeString& namespaceName, const UnicodeString& className,
-                    const UnicodeString& signature,
-                    const UnicodeString& baseClassName,
-                    const UnicodeString& implementsList,
-                    const UnicodeString& comment, const int lineNumber);
-
-    /**
-     * When a define has been found, add it to the tag cache
-     */
-    void DefineDeclarationFound(const UnicodeString& namespaceName, const UnicodeString& variableName, const UnicodeString& variableValue,
-                                const UnicodeString& comment, const int lineNumber);
-
-    void TraitAliasFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitUsedClassName,
-                         const UnicodeString& traitMethodName, const UnicodeString& alias, pelet::TokenClass::TokenIds visibility);
-
-    void TraitInsteadOfFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& traitUsedClassName,
-                             const UnicodeString& traitMethodName, const std::vector<UnicodeString>& insteadOfList);
-
-    void TraitUseFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& fullyQualifiedTraitName);
-
-    /**
-     * Implement class member observer.  When a class method has been parsed, add it to the Resource Cache.
-     */
-    void MethodFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& methodName,
-                     const UnicodeString& signature, const UnicodeString& returnType, const UnicodeString& comment,
-                     pelet::TokenClass::TokenIds visibility, bool isStatic, const int lineNumber, bool hasVariableArguments);
-
-    /**
-     * Implement class member observer.  When a class property has been parsed, add it to the Resource Cache.
-     */
-    void PropertyFound(const UnicodeString& namespaceName, const UnicodeString& className, const UnicodeString& propertyName,
-                       const UnicodeString& propertyType, const UnicodeString& comment,
-                       pelet::TokenClass::TokenIds visibility, bool isConst, bool isStatic, const int lineNumber);
-
-    /**
-     * Implement function observer.  When a function has been parsed, add it to the Resource Cache.
-     */
-    void FunctionFound(const UnicodeString& namespaceName, const UnicodeString& methodName,
-                       const UnicodeString& signature, const UnicodeString& returnType, const UnicodeString& comment, const int lineNumber,
-                       bool hasVariableArguments);
-
     /**
      * Print the tag cache to stdout.  Useful for debugging only.
      */
@@ -203,6 +237,37 @@ class TagParserClass : public pelet::ClassObserverClass,
      */
     void DeleteSource(const wxFileName& sourceDir);
 
+    /**
+     * Writes the tags of the given source directory to a tag bundle. A tag bundle
+     * is a SQLite file that has the tags and the files of a single source; the file
+     * paths are relative to the source directory so that the bundle can be
+     * imported on another machine, for a source in another location.
+     * Only the files that have been parsed are exported. If the bundle file
+     * already exists, it is overwritten.
+     *
+     * @param sourceDir the source directory to export
+     * @param bundleFileName the bundle file to create
+     * @return bool TRUE if the bundle was written, FALSE if the source does
+     *         not have any tags or the bundle could not be written
+     */
+    bool ExportBundle(const wxFileName& sourceDir, const wxFileName& bundleFileName);
+
+    /**
+     * Imports the tags of a tag bundle (see ExportBundle) into the given
+     * source directory. The tags of a file are imported only when the file
+     * exists and its contents are the same as when the bundle was created (the
+     * content hashes match); the rest of the files are not imported and will be
+     * parsed in the next walk. Files that already have tags in this
+     * tag db are skipped.
+     *
+     * This method cannot be called while walking a directory.
+     *
+     * @param bundleFileName the bundle file to read
+     * @param sourceDir the source directory to import the tags to
+     * @return int the number of files whose tags were imported
+     */
+    int ImportBundle(const wxFileName& bundleFileName, const wxFileName& sourceDir);
+
     /**
      * Deletes tags from the given directories only. Tags from subdirectories will
      * also be deleted. If this finder was initialized with a backing file, the backing database
@@ -250,23 +315,68 @@ class TagParserClass : public pelet::ClassObserverClass,
     std::map<UnicodeString, int, UnicodeStringComparatorClass> NamespaceCache;
 
     /**
-     * trait info for each class that uses a trait. The trait cache will contain the
-     * aliases and naming resolutions (insteadof). Since a single class can use multiple traits
-     * the value is a vector, each item in the result vector represents one trait being used.
-     * the key to this map is the current file item ID + class name + trait name being parsed
-     * key is a concatenation of file item id, fully qualified class and fully qualified trait
-     * this will make the alias and instead easier to update.
-     * the value will always be a 2 item vector: item 0 is the fully qualified key and
-     * item 1 is the class only key
+     * TRUE between BeginBulkLoad() and EndBulkLoad(). While bulk loading, the
+     * NamespaceCache holds all namespaces in the db (the value is the file
+     * that has the namespace tag), since without the key index the
+     * db cannot be queried for them.
      */
-    std::map<UnicodeString, std::vector<TraitTagClass>, UnicodeStringComparatorClass> TraitCache;
+    bool IsBulkLoading;
 
     /**
-     * Used to parse through code for classes & methods
-     *
-     * @var pelet::ParserClass
+     * the file items of the source being walked, keyed by full path. Loaded
+     * once in BeginSearch() so that we don't query file_items for every
+     * file that is walked; the map is kept in sync as files are added
+     * and removed and is cleared in EndSearch().
+     */
+    std::map<wxString, t4p::FileTagClass> FileTagCache;
+
+    /**
+     * TRUE if FileTagCache holds all of the file items of the source
+     * being walked. When FALSE, file items are looked up in the database.
+     */
+    bool IsFileTagCacheLoaded;
+
+    /**
+     * TRUE if FileTagCache holds only the file items of the files given
+     * to BeginSearch(); file items that are not in the cache are
+     * looked up in the database.
+     */
+    bool IsFileTagCachePartial;
+
+    /**
+     * Used to parse through code for classes & methods when parsing
+     * in the calling thread
+     */
+    t4p::TagCollectorClass Collector;
+
+    /**
+     * the tags of the file being parsed in the calling thread. re-used
+     * across files to avoid re-allocations
+     */
+    t4p::ParsedFileTagsClass Parsed;
+
+    /**
+     * the PHP version to parse with; needed so that parser threads
+     * are created with the same version
+     */
+    pelet::Versions Version;
+
+    /**
+     * the number of parser threads to start in BeginSearch()
+     */
+    int ParserThreads;
+
+    /**
+     * the queue that connects the parser threads with this class; will be
+     * NULL when files are parsed in the calling thread.
+     * This class will own the pointer.
      */
-    pelet::ParserClass Parser;
+    t4p::TagParseQueueClass* ParseQueue;
+
+    /**
+     * the running parser threads. This class will own the pointers.
+     */
+    std::vector<t4p::TagParserWorkerClass*> Workers;
 
     /**
      * The connection to the database that backs the tag cache
@@ -284,24 +394,84 @@ class TagParserClass : public pelet::ClassObserverClass,
 
     /**
      * use a prepared statement for inserts.  below are the variables to bind to the
-     * statement.
+     * statement. The statement uses array binding; resources are queued
+     * in the vectors and inserted many at a time.
+     * This class will own the pointer.
      */
     soci::statement* InsertStmt;
-    int FileTagId;
-    std::string Key;
-    std::string Identifier;
-    std::string ClassName;
-    int Type;
-    std::string NamespaceName;
-    std::string Signature;
-    std::string ReturnType;
-    std::string Comment;
-    int IsProtected;
-    int IsPrivate;
-    int IsStatic;
-    int IsDynamic;
-    int IsNative;
-    int HasVariableArgs;
+    std::vector<int> FileTagIds;
+    std::vector<int> SourceIds;
+    std::vector<std::string> Keys;
+    std::vector<std::string> Identifiers;
+    std::vector<std::string> ClassNames;
+    std::vector<int> Types;
+    std::vector<std::string> NamespaceNames;
+    std::vector<std::string> Signatures;
+    std::vector<std::string> ReturnTypes;
+    std::vector<std::string> Comments;
+    std::vector<int> IsProtecteds;
+    std::vector<int> IsPrivates;
+    std::vector<int> IsStatics;
+    std::vector<int> IsDynamics;
+    std::vector<int> IsNatives;
+    std::vector<int> HasVariableArgs;
+    std::vector<int> LineNumbers;
+
+    /**
+     * the max number of resources to queue before they are inserted
+     */
+    size_t ResourcesPerInsert;
+
+    /**
+     * prepared statement for trait inserts, and the variables bound
+     * to it. This class will own the pointer.
+     */
+    soci::statement* TraitInsertStmt;
+    std::string TraitKey;
+    int TraitFileTagId;
+    int TraitSourceId;
+    std::string TraitClassName;
+    std::string TraitNamespaceName;
+    std::string TraitName;
+    std::string TraitNamespace;
+    std::string TraitAliases;
+    std::string TraitInsteadOfs;
+
+    /**
+     * prepared statement that checks for existing namespaces, and
+     * the variables bound to it. This class will own the pointer.
+     */
+    soci::statement* NamespaceCountStmt;
+    std::string NamespaceKey;
+    int NamespaceType;
+    int NamespaceCount;
+
+    /**
+     * prepared statements that delete the tags of a single file,
+     * all bound to DeleteFileTagId. This class will own the pointers.
+     */
+    soci::statement* DeleteResourcesStmt;
+    soci::statement* DeleteTraitsStmt;
+    soci::statement* DeleteFileItemStmt;
+    int DeleteFileTagId;
+
+    /**
+     * prepared statements for file item inserts and updates
+     */
+    t4p::FileTagPersistClass FileTagInsert;
+
+    /**
+     * the files whose tags were written or removed since the last
+     * time that the changes were logged (see LogChanges()).
+     * 0 means that too many files were changed to list them.
+     */
+    std::set<int> ChangedFileTagIds;
+
+    /**
+     * the shards that the tags are written to, may be NULL
+     * this class will NOT own the pointer
+     */
+    t4p::TagShardsClass* TagShards;
 
     /**
      * The current file item being indexed.  We keep a class-wide member when parsing through many files.
@@ -340,9 +510,11 @@ class TagParserClass : public pelet::ClassObserverClass,
      * remove all resources for the given file_item_ids.
      *
      * @param fileTagids the list of file_item_id that will be deleted from the SQLite database.
+     * @param sourceId the source of the files; the resources are deleted from
+     *        the shard of this source
      * @param removeFileTag if true, file_item tags are removed as well.
      */
-    void RemovePersistedResources(const std::vector<int>& fileTagIds, bool removeFileTag);
+    void RemovePersistedResources(const std::vector<int>& fileTagIds, int sourceId, bool removeFileTag);
 
     /**
      * Write the file item into the database. The item's FileId member will be set as well.
@@ -366,6 +538,76 @@ class TagParserClass : public pelet::ClassObserverClass,
      */
     bool FindFileTagByFullPathExact(const wxString& fullPath, t4p::FileTagClass& fileTag);
 
+    /**
+     * reads all of the file items under the given source directory into
+     * FileTagCache
+     *
+     * @param sourceDir the source directory.  must have the ending dir separator
+     */
+    void LoadFileTagCache(const wxString& sourceDir);
+
+    /**
+     * reads the file items of the given files into FileTagCache
+     *
+     * @param fullPaths the full paths of the files to read
+     */
+    void LoadFileTagCache(const std::vector<wxString>& fullPaths);
+
+    /**
+     * empties FileTagCache, after this call file items are looked
+     * up in the database
+     */
+    void ClearFileTagCache();
+
+    /**
+     * write all of the tags of a parsed file into the database; this
+     * includes namespace tags and trait tags. Will also commit the transaction
+     * at regular intervals.
+     *
+     * @param parsed the tags of a single file
+     */
+    void PersistParsedFile(const t4p::ParsedFileTagsClass& parsed);
+
+    /**
+     * checks the size and contents of a file that has already been parsed.
+     * A file is changed when its size is different, or when it has been
+     * modified and its content hash is different. When a file has been
+     * modified but its contents are the same, the new modified time
+     * is written to the file item.
+     *
+     * @param fileTag the file item as stored in the database
+     * @param fileName the file to check
+     * @param fileLastModifiedDateTime the file's current modified time
+     * @param isModifiedLater TRUE if the file has been modified after it was parsed
+     * @return bool TRUE if the file needs to be parsed again
+     */
+    bool IsFileChanged(t4p::FileTagClass& fileTag, const wxFileName& fileName,
+                       const wxDateTime& fileLastModifiedDateTime, bool isModifiedLater);
+
+    /**
+     * @return the size of the file in bytes, -1 if the size could not be read
+     */
+    long long FileSize(const wxFileName& fileName);
+
+    /**
+     * write the tags of the files that the parser threads have parsed.
+     *
+     * @param wait if TRUE, then this method will wait until all queued files
+     *        have been parsed and written
+     */
+    void PersistParseQueue(bool wait);
+
+    /**
+     * start the parser threads, if more than 1 thread was requested
+     */
+    void StartWorkers();
+
+    /**
+     * waits for the parser threads to finish and deletes them. The
+     * tags for all queued files will be written.
+     */
+    void StopWorkers();
+
     /**
      * add all of the given resources into the database.
      * @param resources the list of resources that were parsed out
@@ -396,9 +638,51 @@ class TagParserClass : public pelet::ClassObserverClass,
     bool IsNewNamespace(const UnicodeString& namespaceName);
 
     /**
-     * starts a new transaction and creates the INSERT prepared statement
+     * starts a new transaction and creates the prepared statements
      */
     void BeginTransaction();
+
+    /**
+     * @return the schema that the tags of the current source are written to
+     */
+    std::string TagSchema() const;
+
+    /**
+     * @return all of the schemas that may have tags; tag deletes
+     *         need to be done in all of them
+     */
+    std::vector<std::string> TagSchemas() const;
+
+    /**
+     * drops / creates the indexes that are not needed during a bulk load
+     * in the given schema
+     */
+    void DropIndexes(const std::string& schema);
+    void CreateIndexes(const std::string& schema);
+
+    /**
+     * deletes all of the prepared statements
+     */
+    void CloseStatements();
+
+    /**
+     * insert all of the queued resources into the database
+     */
+    void FlushResources();
+
+    /**
+     * discards all of the queued resources
+     */
+    void ClearQueuedResources();
+
+    /**
+     * writes ChangedFileTagIds to the tag_changes table, so that the
+     * tag indexes of all connections can re-read the changed files
+     * (see TagIndexClass::Refresh()). Old changes are pruned.
+     * When there is a transaction, this should be called right before
+     * it is committed.
+     */
+    void LogChanges();
 };
 }  // namespace t4p
 
@@ -0,0 +1,132 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagParserWorkerClass.h"
+
+t4p::TagParseJobClass::TagParseJobClass()
+    : FullPath()
+    , FileTagId(0) {
+}
+
+t4p::TagParseJobClass::TagParseJobClass(const wxString& fullPath, int fileTagId)
+    : FullPath(fullPath.c_str())
+    , FileTagId(fileTagId) {
+}
+
+t4p::TagParseQueueClass::TagParseQueueClass(size_t maxResults)
+    : Jobs()
+    , Results()
+    , Mutex()
+    , JobAvailable(Mutex)
+    , ResultAvailable(Mutex)
+    , ResultTaken(Mutex)
+    , MaxResults(maxResults)
+    , PendingCount(0)
+    , IsFinished(false) {
+}
+
+t4p::TagParseQueueClass::~TagParseQueueClass() {
+    wxMutexLocker locker(Mutex);
+    while (!Results.empty()) {
+        delete Results.front();
+        Results.pop();
+    }
+}
+
+void t4p::TagParseQueueClass::AddJob(const t4p::TagParseJobClass& job) {
+    wxMutexLocker locker(Mutex);
+
+    // deep copy the path, the job will be read by another thread
+    Jobs.push(t4p::TagParseJobClass(job.FullPath, job.FileTagId));
+    PendingCount++;
+    JobAvailable.Signal();
+}
+
+void t4p::TagParseQueueClass::Finish() {
+    wxMutexLocker locker(Mutex);
+    IsFinished = true;
+    JobAvailable.Broadcast();
+}
+
+bool t4p::TagParseQueueClass::NextJob(t4p::TagParseJobClass& job) {
+    wxMutexLocker locker(Mutex);
+    while (Jobs.empty() && !IsFinished) {
+        JobAvailable.Wait();
+    }
+    if (Jobs.empty()) {
+        return false;
+    }
+    job.FullPath = Jobs.front().FullPath.c_str();
+    job.FileTagId = Jobs.front().FileTagId;
+    Jobs.pop();
+    return true;
+}
+
+void t4p::TagParseQueueClass::AddResult(t4p::ParsedFileTagsClass* result) {
+    wxMutexLocker locker(Mutex);
+    while (Results.size() >= MaxResults) {
+        ResultTaken.Wait();
+    }
+    Results.push(result);
+    ResultAvailable.Signal();
+}
+
+t4p::ParsedFileTagsClass* t4p::TagParseQueueClass::NextResult(bool wait) {
+    wxMutexLocker locker(Mutex);
+    while (wait && Results.empty() && PendingCount > 0) {
+        ResultAvailable.Wait();
+    }
+    t4p::ParsedFileTagsClass* result = NULL;
+    if (!Results.empty()) {
+        result = Results.front();
+        Results.pop();
+        PendingCount--;
+        ResultTaken.Signal();
+    }
+    return result;
+}
+
+size_t t4p::TagParseQueueClass::Pending() {
+    wxMutexLocker locker(Mutex);
+    return PendingCount;
+}
+
+t4p::TagParserWorkerClass::TagParserWorkerClass(t4p::TagParseQueueClass& queue, pelet::Versions version)
+    : wxThread(wxTHREAD_JOINABLE)
+    , Queue(queue)
+    , Collector() {
+    Collector.SetVersion(version);
+}
+
+void* t4p::TagParserWorkerClass::Entry() {
+    t4p::TagParseJobClass job;
+    while (Queue.NextJob(job)) {
+        // always post a result, even when the file could not be read,
+        // the writer keeps track of how many files are pending
+        t4p::ParsedFileTagsClass* parsed = new t4p::ParsedFileTagsClass;
+        Collector.CollectFile(job.FullPath, job.FileTagId, *parsed);
+        Queue.AddResult(parsed);
+    }
+    return 0;
+}
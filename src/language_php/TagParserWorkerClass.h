@@ -0,0 +1,199 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGPARSERWORKERCLASS_H_
+#define SRC_LANGUAGE_PHP_TAGPARSERWORKERCLASS_H_
+
+#include <pelet/ParserClass.h>
+#include <wx/string.h>
+#include <wx/thread.h>
+#include <queue>
+#include "language_php/TagCollectorClass.h"
+
+namespace t4p {
+/**
+ * A file that needs to be parsed by a TagParserWorkerClass
+ */
+class TagParseJobClass {
+ public:
+    /**
+     * full path of the file to parse
+     */
+    wxString FullPath;
+
+    /**
+     * the file_item_id of the file to parse. The file_items row
+     * must already exist in the database.
+     */
+    int FileTagId;
+
+    TagParseJobClass();
+
+    TagParseJobClass(const wxString& fullPath, int fileTagId);
+};
+
+/**
+ * The queues that connect the parser workers with the single tag writer.
+ * The writer (the TagParserClass) adds files to be parsed; the workers
+ * take files, parse them, and put the resulting tags in the result
+ * queue. The result queue is bounded; workers will block when the
+ * writer falls behind so that memory usage stays bounded when parsing
+ * large projects.
+ *
+ * All methods of this class are thread-safe.
+ */
+class TagParseQueueClass {
+ public:
+    /**
+     * @param maxResults the max number of parsed files that can be waiting
+     *        to be written. Workers will block when the result queue is full.
+     */
+    TagParseQueueClass(size_t maxResults);
+
+    ~TagParseQueueClass();
+
+    /**
+     * queue up a file to be parsed
+     */
+    void AddJob(const t4p::TagParseJobClass& job);
+
+    /**
+     * signal that no more jobs will be added; workers will exit once
+     * the job queue is empty.
+     */
+    void Finish();
+
+    /**
+     * get the next file to parse; this method blocks until a job is available
+     * or Finish() has been called.
+     *
+     * @param job the next job will be copied here
+     * @return bool FALSE when there are no more jobs and the worker should exit
+     */
+    bool NextJob(t4p::TagParseJobClass& job);
+
+    /**
+     * put a parsed file in the result queue. this method blocks while the
+     * result queue is full.
+     *
+     * @param result this queue will own the pointer until it is taken out
+     *        via NextResult
+     */
+    void AddResult(t4p::ParsedFileTagsClass* result);
+
+    /**
+     * get the next parsed file.
+     *
+     * @param wait if TRUE, this method will block until a result is available,
+     *        unless there are no jobs pending.
+     * @return the next parsed file, or NULL if no results are ready. The
+     *         caller will own the returned pointer.
+     */
+    t4p::ParsedFileTagsClass* NextResult(bool wait);
+
+    /**
+     * @return the number of jobs that have been added but whose results have
+     *         not yet been taken out via NextResult
+     */
+    size_t Pending();
+
+ private:
+    /**
+     * files waiting to be parsed
+     */
+    std::queue<t4p::TagParseJobClass> Jobs;
+
+    /**
+     * files that have been parsed but not yet written
+     */
+    std::queue<t4p::ParsedFileTagsClass*> Results;
+
+    /**
+     * prevent simultaneous access to the queues
+     */
+    wxMutex Mutex;
+
+    /**
+     * signaled when a job is added or when Finish is called
+     */
+    wxCondition JobAvailable;
+
+    /**
+     * signaled when a result is added
+     */
+    wxCondition ResultAvailable;
+
+    /**
+     * signaled when a result is taken out, so that workers blocked
+     * on a full result queue can continue
+     */
+    wxCondition ResultTaken;
+
+    /**
+     * the max number of parsed files waiting to be written
+     */
+    size_t MaxResults;
+
+    /**
+     * jobs added - results taken
+     */
+    size_t PendingCount;
+
+    /**
+     * TRUE when no more jobs will be added
+     */
+    bool IsFinished;
+};
+
+/**
+ * A thread that parses files for tags. Each worker has its own parser,
+ * so that many files can be parsed at the same time. Workers never
+ * touch the tag database; they only put the parsed tags in the result
+ * queue.
+ */
+class TagParserWorkerClass : public wxThread {
+ public:
+    /**
+     * @param queue the queue to get jobs from and put results into. This
+     *        reference must be alive for as long as this thread is running.
+     * @param version the PHP version to parse with
+     */
+    TagParserWorkerClass(t4p::TagParseQueueClass& queue, pelet::Versions version);
+
+    void* Entry();
+
+ private:
+    /**
+     * the queue to get jobs from and put results into
+     */
+    t4p::TagParseQueueClass& Queue;
+
+    /**
+     * the collector that will do the actual parsing
+     */
+    t4p::TagCollectorClass Collector;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGPARSERWORKERCLASS_H_
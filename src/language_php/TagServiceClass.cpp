@@ -0,0 +1,487 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagServiceClass.h"
+#include <boost/asio.hpp>
+#include <wx/utils.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/String.h"
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/TagFinderList.h"
+#include "language_php/TagServiceSocket.h"
+
+/**
+ * the flags of a tag line
+ */
+static const int FLAG_PROTECTED = 1;
+static const int FLAG_PRIVATE = 2;
+static const int FLAG_STATIC = 4;
+static const int FLAG_DYNAMIC = 8;
+static const int FLAG_NATIVE = 16;
+static const int FLAG_VARIABLE_ARGS = 32;
+static const int FLAG_FILE_IS_NEW = 64;
+
+/**
+ * the number of fields in a tag line, including the line name
+ */
+static const size_t TAG_LINE_FIELDS = 15;
+
+/**
+ * the most time (in milliseconds) that a request to the service can take,
+ * including the connection
+ */
+static const int SEND_TIMEOUT = 1000;
+
+/**
+ * escapes the tabs, newlines and backslashes of a field so that the field
+ * does not break the lines of a message
+ */
+static std::string EscapeField(const std::string& field) {
+    std::string escaped;
+    escaped.reserve(field.length());
+    for (size_t i = 0; i < field.length(); ++i) {
+        char c = field[i];
+        if (c == '\\') {
+            escaped += "\\\\";
+        } else if (c == '\t') {
+            escaped += "\\t";
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else if (c == '\r') {
+            escaped += "\\r";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static std::string UnescapeField(const std::string& field) {
+    std::string unescaped;
+    unescaped.reserve(field.length());
+    for (size_t i = 0; i < field.length(); ++i) {
+        char c = field[i];
+        if (c == '\\' && (i + 1) < field.length()) {
+            ++i;
+            c = field[i];
+            if (c == 't') {
+                c = '\t';
+            } else if (c == 'n') {
+                c = '\n';
+            } else if (c == 'r') {
+                c = '\r';
+            }
+        }
+        unescaped += c;
+    }
+    return unescaped;
+}
+
+static std::string Field(const UnicodeString& value) {
+    return EscapeField(t4p::IcuToChar(value));
+}
+
+static std::string Field(const wxString& value) {
+    return EscapeField(t4p::WxToChar(value));
+}
+
+static std::string Field(int value) {
+    std::ostringstream stream;
+    stream << value;
+    return stream.str();
+}
+
+static int IntField(const std::string& field) {
+    int value = 0;
+    std::istringstream stream(field);
+    stream >> value;
+    return value;
+}
+
+/**
+ * splits a message into its lines, and each line into its unescaped fields
+ */
+static std::vector<std::vector<std::string> > SplitMessage(const std::string& message) {
+    std::vector<std::vector<std::string> > lines;
+    size_t lineStart = 0;
+    while (lineStart <= message.length()) {
+        size_t lineEnd = message.find('\n', lineStart);
+        if (lineEnd == std::string::npos) {
+            lineEnd = message.length();
+        }
+        std::vector<std::string> fields;
+        size_t fieldStart = lineStart;
+        while (fieldStart <= lineEnd) {
+            size_t fieldEnd = message.find('\t', fieldStart);
+            if (fieldEnd == std::string::npos || fieldEnd > lineEnd) {
+                fieldEnd = lineEnd;
+            }
+            fields.push_back(UnescapeField(message.substr(fieldStart, fieldEnd - fieldStart)));
+            fieldStart = fieldEnd + 1;
+        }
+        lines.push_back(fields);
+        lineStart = lineEnd + 1;
+    }
+    return lines;
+}
+
+static std::string TagLine(const t4p::PhpTagClass& tag) {
+    int flags = 0;
+    flags |= tag.IsProtected ? FLAG_PROTECTED : 0;
+    flags |= tag.IsPrivate ? FLAG_PRIVATE : 0;
+    flags |= tag.IsStatic ? FLAG_STATIC : 0;
+    flags |= tag.IsDynamic ? FLAG_DYNAMIC : 0;
+    flags |= tag.IsNative ? FLAG_NATIVE : 0;
+    flags |= tag.HasVariableArgs ? FLAG_VARIABLE_ARGS : 0;
+    flags |= tag.FileIsNew ? FLAG_FILE_IS_NEW : 0;
+
+    std::string line = "tag";
+    line += "\t" + Field(static_cast<int>(tag.Type));
+    line += "\t" + Field(tag.Id);
+    line += "\t" + Field(tag.FileTagId);
+    line += "\t" + Field(tag.SourceId);
+    line += "\t" + Field(tag.LineNumber);
+    line += "\t" + Field(flags);
+    line += "\t" + Field(tag.Key);
+    line += "\t" + Field(tag.Identifier);
+    line += "\t" + Field(tag.ClassName);
+    line += "\t" + Field(tag.NamespaceName);
+    line += "\t" + Field(tag.Signature);
+    line += "\t" + Field(tag.ReturnType);
+    line += "\t" + Field(tag.Comment);
+    line += "\t" + Field(tag.GetFullPath());
+    return line;
+}
+
+static t4p::PhpTagClass TagFromLine(const std::vector<std::string>& fields) {
+    t4p::PhpTagClass tag;
+    tag.Type = static_cast<t4p::PhpTagClass::Types>(IntField(fields[1]));
+    tag.Id = IntField(fields[2]);
+    tag.FileTagId = IntField(fields[3]);
+    tag.SourceId = IntField(fields[4]);
+    tag.LineNumber = IntField(fields[5]);
+    int flags = IntField(fields[6]);
+    tag.IsProtected = (flags & FLAG_PROTECTED) != 0;
+    tag.IsPrivate = (flags & FLAG_PRIVATE) != 0;
+    tag.IsStatic = (flags & FLAG_STATIC) != 0;
+    tag.IsDynamic = (flags & FLAG_DYNAMIC) != 0;
+    tag.IsNative = (flags & FLAG_NATIVE) != 0;
+    tag.HasVariableArgs = (flags & FLAG_VARIABLE_ARGS) != 0;
+    tag.FileIsNew = (flags & FLAG_FILE_IS_NEW) != 0;
+    tag.Key = t4p::CharToIcu(fields[7].c_str());
+    tag.Identifier = t4p::CharToIcu(fields[8].c_str());
+    tag.ClassName = t4p::CharToIcu(fields[9].c_str());
+    tag.NamespaceName = t4p::CharToIcu(fields[10].c_str());
+    tag.Signature = t4p::CharToIcu(fields[11].c_str());
+    tag.ReturnType = t4p::CharToIcu(fields[12].c_str());
+    tag.Comment = t4p::CharToIcu(fields[13].c_str());
+    tag.SetFullPath(t4p::CharToWx(fields[14].c_str()));
+    return tag;
+}
+
+wxFileName t4p::TagServiceSocketFileName(const wxFileName& tagDbFileName) {
+    wxFileName socketFile(tagDbFileName.GetFullPath());
+    socketFile.SetName(tagDbFileName.GetName() + wxT(".service"));
+    socketFile.SetExt(wxT("sock"));
+    return socketFile;
+}
+
+t4p::TagServiceClass::TagServiceClass(t4p::TagFinderListClass& finders)
+    : Finders(finders)
+    , DirectorySearch()
+    , PendingSources()
+    , PendingPhpFileExtensions()
+    , PendingMiscFileExtensions()
+    , IsSearching(false)
+    , FilesCompleted(0)
+    , FilesTotal(0) {
+}
+
+std::string t4p::TagServiceClass::Handle(const std::string& request) {
+    std::vector<std::vector<std::string> > lines = SplitMessage(request);
+    std::string command = lines[0][0];
+    std::string response;
+    if (command == "EXACT" || command == "NEAR") {
+        Search(lines, command == "EXACT", response);
+    } else if (command == "INDEX") {
+        QueueSources(lines);
+        response = "OK";
+    } else if (command == "STATUS") {
+        response = "OK\nstatus";
+        response += "\t" + Field(IsIndexing() ? 1 : 0);
+        response += "\t" + Field(FilesCompleted);
+        response += "\t" + Field(FilesTotal);
+    } else if (command == "PING") {
+        response = "OK";
+    } else {
+        response = "ERROR\t" + EscapeField("unknown command:" + command);
+    }
+    return response;
+}
+
+void t4p::TagServiceClass::Search(const std::vector<std::vector<std::string> >& lines, bool isExact, std::string& response) {
+    UnicodeString query;
+    std::vector<UnicodeString> parentClasses;
+    std::vector<UnicodeString> traits;
+    std::vector<wxFileName> sourceDirs;
+    int fileItemId = 0;
+    for (size_t i = 1; i < lines.size(); ++i) {
+        if (lines[i].size() < 2) {
+            continue;
+        }
+        const std::string& name = lines[i][0];
+        const std::string& value = lines[i][1];
+        if (name == "query") {
+            query = t4p::CharToIcu(value.c_str());
+        } else if (name == "parent") {
+            parentClasses.push_back(t4p::CharToIcu(value.c_str()));
+        } else if (name == "trait") {
+            traits.push_back(t4p::CharToIcu(value.c_str()));
+        } else if (name == "file_item_id") {
+            fileItemId = IntField(value);
+        } else if (name == "source") {
+            wxFileName sourceDir;
+            sourceDir.AssignDir(t4p::CharToWx(value.c_str()));
+            sourceDirs.push_back(sourceDir);
+        }
+    }
+    t4p::TagSearchClass tagSearch(query);
+    tagSearch.SetParentClasses(parentClasses);
+    tagSearch.SetTraits(traits);
+    tagSearch.SetFileItemId(fileItemId);
+    std::vector<t4p::PhpTagClass> matches;
+    if (isExact) {
+        Finders.ExactProjectMatches(tagSearch, matches, sourceDirs);
+    } else {
+        Finders.NearProjectMatches(tagSearch, matches, sourceDirs);
+    }
+    response = "OK";
+    for (size_t i = 0; i < matches.size(); ++i) {
+        response += "\n";
+        response += TagLine(matches[i]);
+    }
+}
+
+void t4p::TagServiceClass::QueueSources(const std::vector<std::vector<std::string> >& lines) {
+    if (!IsIndexing()) {
+        FilesCompleted = 0;
+        FilesTotal = 0;
+    }
+    std::vector<t4p::SourceClass> sources;
+    std::vector<wxString> phpFileExtensions;
+    std::vector<wxString> miscFileExtensions;
+    for (size_t i = 1; i < lines.size(); ++i) {
+        if (lines[i].size() < 2) {
+            continue;
+        }
+        const std::string& name = lines[i][0];
+        wxString value = t4p::CharToWx(lines[i][1].c_str());
+        if (name == "php_ext") {
+            phpFileExtensions.push_back(value);
+        } else if (name == "misc_ext") {
+            miscFileExtensions.push_back(value);
+        } else if (name == "source" && lines[i].size() >= 4) {
+            t4p::SourceClass source;
+            source.RootDirectory.AssignDir(value);
+            source.SetIncludeWildcards(t4p::CharToWx(lines[i][2].c_str()));
+            source.SetExcludeWildcards(t4p::CharToWx(lines[i][3].c_str()));
+            sources.push_back(source);
+        }
+    }
+    if (!sources.empty()) {
+        PendingSources.push(sources);
+        PendingPhpFileExtensions.push(phpFileExtensions);
+        PendingMiscFileExtensions.push(miscFileExtensions);
+    }
+}
+
+bool t4p::TagServiceClass::IsIndexing() const {
+    return IsSearching || !PendingSources.empty();
+}
+
+void t4p::TagServiceClass::NextSources() {
+    std::vector<t4p::SourceClass> sources = PendingSources.front();
+    Finders.TagParser.PhpFileExtensions = PendingPhpFileExtensions.front();
+    Finders.TagParser.MiscFileExtensions = PendingMiscFileExtensions.front();
+    PendingSources.pop();
+    PendingPhpFileExtensions.pop();
+    PendingMiscFileExtensions.pop();
+
+    IsSearching = DirectorySearch.Init(sources, t4p::DirectorySearchClass::PRECISE);
+    if (IsSearching) {
+        FilesTotal += DirectorySearch.GetTotalFileCount();
+    }
+}
+
+void t4p::TagServiceClass::IndexFiles(int maxFiles) {
+    int walked = 0;
+    while (walked < maxFiles && IsIndexing()) {
+        if (!IsSearching) {
+            NextSources();
+        } else if (DirectorySearch.More()) {
+            Finders.Walk(DirectorySearch);
+            FilesCompleted++;
+            walked++;
+        } else {
+            IsSearching = false;
+        }
+    }
+}
+
+void t4p::TagServiceClass::RefreshTagIndex() {
+    Finders.RefreshTagIndex();
+}
+
+t4p::TagServiceClientClass::TagServiceClientClass()
+    : SocketPath()
+    , IsServiceOk(false) {
+}
+
+bool t4p::TagServiceClientClass::Init(const wxFileName& tagDbFileName) {
+    wxFileName socketFile = t4p::TagServiceSocketFileName(tagDbFileName);
+    SocketPath = t4p::WxToChar(socketFile.GetFullPath());
+    IsServiceOk = false;
+    if (!socketFile.FileExists()) {
+        // no need to attempt a connection, the service is not running
+        return false;
+    }
+    std::string response;
+    return Send("PING", response);
+}
+
+bool t4p::TagServiceClientClass::IsOk() const {
+    return IsServiceOk;
+}
+
+bool t4p::TagServiceClientClass::ExactMatches(const t4p::TagSearchClass& tagSearch, const std::vector<wxFileName>& sourceDirs,
+        std::vector<t4p::PhpTagClass>& matches) {
+    std::string response;
+    if (!Send(SearchRequest("EXACT", tagSearch, sourceDirs), response)) {
+        return false;
+    }
+    return ParseTags(response, matches);
+}
+
+bool t4p::TagServiceClientClass::NearMatches(const t4p::TagSearchClass& tagSearch, const std::vector<wxFileName>& sourceDirs,
+        std::vector<t4p::PhpTagClass>& matches) {
+    std::string response;
+    if (!Send(SearchRequest("NEAR", tagSearch, sourceDirs), response)) {
+        return false;
+    }
+    return ParseTags(response, matches);
+}
+
+bool t4p::TagServiceClientClass::Index(const std::vector<t4p::SourceClass>& sources, const std::vector<wxString>& phpFileExtensions,
+                                       const std::vector<wxString>& miscFileExtensions) {
+    std::string request = "INDEX";
+    for (size_t i = 0; i < phpFileExtensions.size(); ++i) {
+        request += "\nphp_ext\t" + Field(phpFileExtensions[i]);
+    }
+    for (size_t i = 0; i < miscFileExtensions.size(); ++i) {
+        request += "\nmisc_ext\t" + Field(miscFileExtensions[i]);
+    }
+    for (size_t i = 0; i < sources.size(); ++i) {
+        request += "\nsource\t" + Field(sources[i].RootDirectory.GetPath());
+        request += "\t" + Field(sources[i].IncludeWildcardsString());
+        request += "\t" + Field(sources[i].ExcludeWildcardsString());
+    }
+    std::string response;
+    return Send(request, response);
+}
+
+bool t4p::TagServiceClientClass::Status(bool& isIndexing, int& filesCompleted, int& filesTotal) {
+    std::string response;
+    if (!Send("STATUS", response)) {
+        return false;
+    }
+    std::vector<std::vector<std::string> > lines = SplitMessage(response);
+    if (lines.size() < 2 || lines[1].size() < 4 || lines[1][0] != "status") {
+        return false;
+    }
+    isIndexing = IntField(lines[1][1]) != 0;
+    filesCompleted = IntField(lines[1][2]);
+    filesTotal = IntField(lines[1][3]);
+    return true;
+}
+
+std::string t4p::TagServiceClientClass::SearchRequest(const std::string& command, const t4p::TagSearchClass& tagSearch,
+        const std::vector<wxFileName>& sourceDirs) {
+    std::string request = command;
+    request += "\nquery\t" + Field(tagSearch.GetQuery());
+    std::vector<UnicodeString> parentClasses = tagSearch.GetParentClasses();
+    for (size_t i = 0; i < parentClasses.size(); ++i) {
+        request += "\nparent\t" + Field(parentClasses[i]);
+    }
+    std::vector<UnicodeString> traits = tagSearch.GetTraits();
+    for (size_t i = 0; i < traits.size(); ++i) {
+        request += "\ntrait\t" + Field(traits[i]);
+    }
+    request += "\nfile_item_id\t" + Field(tagSearch.GetFileItemId());
+    for (size_t i = 0; i < sourceDirs.size(); ++i) {
+        request += "\nsource\t" + Field(sourceDirs[i].GetPath());
+    }
+    return request;
+}
+
+bool t4p::TagServiceClientClass::ParseTags(const std::string& response, std::vector<t4p::PhpTagClass>& matches) {
+    std::vector<std::vector<std::string> > lines = SplitMessage(response);
+    if (lines[0][0] != "OK") {
+        return false;
+    }
+    for (size_t i = 1; i < lines.size(); ++i) {
+        if (lines[i].size() == TAG_LINE_FIELDS && lines[i][0] == "tag") {
+            matches.push_back(TagFromLine(lines[i]));
+        }
+    }
+    return true;
+}
+
+bool t4p::TagServiceClientClass::Send(const std::string& request, std::string& response) {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    try {
+        // the service may be busy re-reading its tags or serving a stuck
+        // instance; give up instead of freezing the app
+        wxLongLong deadline = wxGetLocalTimeMillis() + SEND_TIMEOUT;
+        boost::asio::io_service ioService;
+        boost::asio::local::stream_protocol::socket socket(ioService);
+        IsServiceOk = t4p::TagServiceConnect(socket, SocketPath, deadline)
+                      && t4p::TagServiceWrite(socket, request, deadline)
+                      && t4p::TagServiceRead(socket, response, deadline);
+    } catch (std::exception& e) {
+        wxUnusedVar(e);
+        IsServiceOk = false;
+    }
+
+    // when the service is not running, has stopped or is too slow, callers
+    // will do the work in-process from now on
+    return IsServiceOk && response.compare(0, 2, "OK") == 0;
+#else
+    wxUnusedVar(request);
+    wxUnusedVar(response);
+    IsServiceOk = false;
+    return false;
+#endif
+}
@@ -0,0 +1,263 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGSERVICECLASS_H_
+#define SRC_LANGUAGE_PHP_TAGSERVICECLASS_H_
+
+#include <unicode/unistr.h>
+#include <wx/filename.h>
+#include <queue>
+#include <string>
+#include <vector>
+#include "language_php/PhpTagClass.h"
+#include "search/DirectorySearchClass.h"
+
+namespace t4p {
+// forward declaration, defined in another file
+class TagFinderListClass;
+class TagSearchClass;
+
+/**
+ * @return the Unix domain socket that the tag service for the given
+ *         tag db listens on. The socket is next to the tag db, so that
+ *         all of the app instances that use the same tag db find the
+ *         same service.
+ */
+wxFileName TagServiceSocketFileName(const wxFileName& tagDbFileName);
+
+/**
+ * The tag service lets many app instances on the same machine share one
+ * tag index. The service is a separate process (see profilers/tag_service.cpp)
+ * that owns the parsing of the projects and the in-memory tag index; the
+ * instances send it their queries through a Unix domain socket instead of
+ * each one parsing and querying the tag db.
+ *
+ * This class is the service side of the protocol: it is given a request
+ * and returns the response, the socket is handled by the caller. It is
+ * separate from the socket so that it can be tested.
+ *
+ * A message is made of lines separated by newlines and is terminated by
+ * a NUL character (the same framing as the debugger protocol). The first
+ * line is the command, the other lines are tab separated fields where
+ * the first field is the name of the line. Tabs, newlines and
+ * backslashes in the fields are escaped.
+ *
+ *   EXACT / NEAR:  query, parent, trait, file_item_id and source lines.
+ *                  The response has one "tag" line per match.
+ *   INDEX:         php_ext, misc_ext and source (root, include, exclude) lines.
+ *                  The sources are queued and tagged by IndexFiles().
+ *   STATUS:        The response has one "status" line: indexing, files
+ *                  completed and files total.
+ *   PING
+ *
+ * The response starts with an "OK" line, or an "ERROR" line that has
+ * the error message.
+ */
+class TagServiceClass {
+ public:
+    /**
+     * @param finders the tag finders to answer queries with; they should
+     *        have been initialized with InitGlobalTag(). This class
+     *        does not own the pointer.
+     */
+    TagServiceClass(t4p::TagFinderListClass& finders);
+
+    /**
+     * @param request the request message, without the NUL terminator
+     * @return the response message, without the NUL terminator
+     */
+    std::string Handle(const std::string& request);
+
+    /**
+     * @return bool TRUE if there are queued sources that have not been
+     *         tagged yet
+     */
+    bool IsIndexing() const;
+
+    /**
+     * tags the next files of the queued sources. Files are tagged a few at a
+     * time so that the service can answer queries while a big project is
+     * being tagged.
+     *
+     * @param maxFiles the most files to tag
+     */
+    void IndexFiles(int maxFiles);
+
+    /**
+     * re-reads the tags that were written since the tag index was loaded,
+     * by this service or by another connection (ie. an instance that
+     * re-tagged a file in-process). Requests are answered from the
+     * tags as of the last refresh; the service loop calls this in between
+     * requests, so that re-reading many tags does not hold up a request.
+     */
+    void RefreshTagIndex();
+
+ private:
+    /**
+     * answers an EXACT or NEAR request
+     */
+    void Search(const std::vector<std::vector<std::string> >& lines, bool isExact, std::string& response);
+
+    /**
+     * queues the sources of an INDEX request
+     */
+    void QueueSources(const std::vector<std::vector<std::string> >& lines);
+
+    /**
+     * starts iterating through the next queued sources
+     */
+    void NextSources();
+
+    /**
+     * the finders to query and tag with
+     */
+    t4p::TagFinderListClass& Finders;
+
+    /**
+     * iterates through the files of the sources being tagged
+     */
+    t4p::DirectorySearchClass DirectorySearch;
+
+    /**
+     * the sources of INDEX requests that have not been tagged yet
+     */
+    std::queue<std::vector<t4p::SourceClass> > PendingSources;
+
+    /**
+     * the file extensions of each of the PendingSources
+     */
+    std::queue<std::vector<wxString> > PendingPhpFileExtensions;
+    std::queue<std::vector<wxString> > PendingMiscFileExtensions;
+
+    /**
+     * TRUE if DirectorySearch has files left to tag
+     */
+    bool IsSearching;
+
+    /**
+     * the progress of the queued sources, reset when the queue is emptied
+     */
+    int FilesCompleted;
+    int FilesTotal;
+};
+
+/**
+ * The app side of the tag service protocol (see TagServiceClass). A
+ * new connection is made for each request, since the service answers
+ * one instance at a time; connecting to a local socket is cheap.
+ *
+ * When the service is not running (or stops answering, or does not answer
+ * within a second), the client is not OK and the callers do the work
+ * in-process as they would without the service. Local sockets are not available on MSW; there the client
+ * is never OK.
+ */
+class TagServiceClientClass {
+ public:
+    TagServiceClientClass();
+
+    /**
+     * connects to the service of the given tag db.
+     *
+     * @return bool TRUE if the service answered
+     */
+    bool Init(const wxFileName& tagDbFileName);
+
+    /**
+     * @return bool TRUE if the service answered the last request
+     */
+    bool IsOk() const;
+
+    /**
+     * asks the service for the tags that match tagSearch exactly, the same
+     * way as TagFinderListClass::ExactMatchesFromAll()
+     *
+     * @return bool FALSE if the service did not answer; matches is not
+     *         modified in that case
+     */
+    bool ExactMatches(const t4p::TagSearchClass& tagSearch, const std::vector<wxFileName>& sourceDirs,
+                      std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * asks the service for the tags that nearly match tagSearch, the same
+     * way as TagFinderListClass::NearMatchesFromAll()
+     *
+     * @return bool FALSE if the service did not answer; matches is not
+     *         modified in that case
+     */
+    bool NearMatches(const t4p::TagSearchClass& tagSearch, const std::vector<wxFileName>& sourceDirs,
+                     std::vector<t4p::PhpTagClass>& matches);
+
+    /**
+     * asks the service to tag the given sources. The service tags them in
+     * the background; use Status() to know when it is done.
+     *
+     * @return bool FALSE if the service did not answer
+     */
+    bool Index(const std::vector<t4p::SourceClass>& sources, const std::vector<wxString>& phpFileExtensions,
+               const std::vector<wxString>& miscFileExtensions);
+
+    /**
+     * @param [out] isIndexing TRUE if the service is still tagging
+     * @param [out] filesCompleted the files tagged so far
+     * @param [out] filesTotal the files to tag
+     * @return bool FALSE if the service did not answer
+     */
+    bool Status(bool& isIndexing, int& filesCompleted, int& filesTotal);
+
+    /**
+     * @return the request message for an EXACT or NEAR search
+     */
+    static std::string SearchRequest(const std::string& command, const t4p::TagSearchClass& tagSearch,
+                                     const std::vector<wxFileName>& sourceDirs);
+
+    /**
+     * parses the tags of a search response
+     *
+     * @return bool FALSE if the response is an error
+     */
+    static bool ParseTags(const std::string& response, std::vector<t4p::PhpTagClass>& matches);
+
+ private:
+    /**
+     * sends the request on a new connection and reads the response. When
+     * the service cannot be reached the client is no longer OK.
+     *
+     * @return bool FALSE if the service could not be reached or the
+     *         response is an error
+     */
+    bool Send(const std::string& request, std::string& response);
+
+    /**
+     * the full path to the service socket
+     */
+    std::string SocketPath;
+
+    /**
+     * TRUE if the service answered the last request
+     */
+    bool IsServiceOk;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGSERVICECLASS_H_
@@ -0,0 +1,126 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagServiceSocket.h"
+#include <wx/utils.h>
+#include <algorithm>
+#include <string>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <errno.h>
+#include <poll.h>
+
+/**
+ * waits until the socket can be read from (POLLIN) or written to (POLLOUT)
+ *
+ * @return bool FALSE if the deadline passed
+ */
+static bool WaitForSocket(boost::asio::local::stream_protocol::socket& socket, short events, wxLongLong deadline) {
+    wxLongLong remaining = deadline - wxGetLocalTimeMillis();
+    if (remaining <= 0) {
+        return false;
+    }
+    pollfd fd;
+    fd.fd = socket.native_handle();
+    fd.events = events;
+    fd.revents = 0;
+    int ret = poll(&fd, 1, remaining.ToLong());
+
+    // when a signal interrupts the wait the caller tries again
+    return ret > 0 || (ret < 0 && errno == EINTR);
+}
+
+bool t4p::TagServiceConnect(boost::asio::local::stream_protocol::socket& socket, const std::string& socketPath,
+                            wxLongLong deadline) {
+    boost::system::error_code error;
+    boost::asio::local::stream_protocol::endpoint endpoint(socketPath);
+    socket.open(endpoint.protocol(), error);
+    if (!error) {
+        socket.non_blocking(true, error);
+    }
+    if (!error) {
+        socket.connect(endpoint, error);
+    }
+    while (error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+        // the service is busy and its backlog of connections is full
+        if (wxGetLocalTimeMillis() >= deadline) {
+            return false;
+        }
+        wxMilliSleep(10);
+        socket.connect(endpoint, error);
+    }
+    if (error == boost::asio::error::in_progress) {
+        return WaitForSocket(socket, POLLOUT, deadline);
+    }
+    return !error;
+}
+
+bool t4p::TagServiceWrite(boost::asio::local::stream_protocol::socket& socket, const std::string& message,
+                          wxLongLong deadline) {
+    boost::system::error_code error;
+    socket.non_blocking(true, error);
+
+    // the NUL terminates the message
+    const char* data = message.c_str();
+    size_t length = message.length() + 1;
+    size_t written = 0;
+    while (!error && written < length) {
+        written += socket.write_some(boost::asio::buffer(data + written, length - written), error);
+        if (error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+            if (!WaitForSocket(socket, POLLOUT, deadline)) {
+                return false;
+            }
+            error.clear();
+        }
+    }
+    return !error;
+}
+
+bool t4p::TagServiceRead(boost::asio::local::stream_protocol::socket& socket, std::string& message,
+                         wxLongLong deadline) {
+    boost::system::error_code error;
+    socket.non_blocking(true, error);
+    message.clear();
+    char buffer[4096];
+    while (!error) {
+        size_t read = socket.read_some(boost::asio::buffer(buffer), error);
+        if (error == boost::asio::error::would_block || error == boost::asio::error::try_again) {
+            if (!WaitForSocket(socket, POLLIN, deadline)) {
+                return false;
+            }
+            error.clear();
+        } else if (!error) {
+            char* end = std::find(buffer, buffer + read, '\0');
+            message.append(buffer, end);
+            if (end != (buffer + read)) {
+                return true;
+            }
+        }
+    }
+
+    // the other side closed the connection before sending the NUL
+    return false;
+}
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGSERVICESOCKET_H_
+#define SRC_LANGUAGE_PHP_TAGSERVICESOCKET_H_
+
+#include <boost/asio.hpp>
+#include <wx/longlong.h>
+#include <string>
+
+namespace t4p {
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+// The socket operations of the tag service protocol (see TagServiceClass),
+// used by both the app and the service. None of them wait past the given
+// deadline: the app queries the service from the main thread, and the
+// service answers one connection at a time, so neither side can be
+// held up by the other side not answering. The socket is put in non-blocking
+// mode.
+
+/**
+ * connects the socket to the service listening on socketPath.
+ *
+ * @param deadline the time (as given by wxGetLocalTimeMillis()) at which to give up
+ * @return bool FALSE if the connection could not be made before the deadline
+ */
+bool TagServiceConnect(boost::asio::local::stream_protocol::socket& socket, const std::string& socketPath,
+                       wxLongLong deadline);
+
+/**
+ * writes a message, along with the NUL that terminates it.
+ *
+ * @param deadline the time (as given by wxGetLocalTimeMillis()) at which to give up
+ * @return bool FALSE if the message could not be written before the deadline
+ */
+bool TagServiceWrite(boost::asio::local::stream_protocol::socket& socket, const std::string& message,
+                     wxLongLong deadline);
+
+/**
+ * reads a message up to the NUL that terminates it.
+ *
+ * @param [out] message the message, without the NUL
+ * @param deadline the time (as given by wxGetLocalTimeMillis()) at which to give up
+ * @return bool FALSE if the message could not be read before the deadline
+ */
+bool TagServiceRead(boost::asio::local::stream_protocol::socket& socket, std::string& message,
+                    wxLongLong deadline);
+
+#endif
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGSERVICESOCKET_H_
@@ -0,0 +1,306 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "language_php/TagShardsClass.h"
+#include <wx/dir.h>
+#include <algorithm>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/Sqlite.h"
+#include "globals/String.h"
+
+/**
+ * @return the name of the schema that a shard is attached as
+ */
+static std::string ShardSchemaName(int sourceId) {
+    std::ostringstream stream;
+    stream << "shard" << sourceId;
+    return stream.str();
+}
+
+t4p::TagShardsClass::TagShardsClass()
+    : Session(NULL)
+    , TagDbFileName()
+    , ShardedSourceIds()
+    , KnownSourceIds()
+    , AttachedSourceIds()
+    , MaxAttached(0) {
+}
+
+void t4p::TagShardsClass::Init(soci::session* session, const wxFileName& tagDbFileName) {
+    Session = session;
+    TagDbFileName.Assign(tagDbFileName.GetFullPath());
+    ShardedSourceIds.clear();
+    KnownSourceIds.clear();
+    AttachedSourceIds.clear();
+
+    // leave one slot free for tag bundles (TagParserClass::ExportBundle
+    // and TagParserClass::ImportBundle)
+    MaxAttached = t4p::SqliteAttachLimit(*Session) - 1;
+    Refresh();
+}
+
+void t4p::TagShardsClass::Refresh() {
+    if (!Session) {
+        return;
+    }
+    std::set<int> sourceIds;
+    try {
+        int sourceId = 0;
+        soci::statement stmt = (Session->prepare << "SELECT source_id FROM sources", soci::into(sourceId));
+        if (stmt.execute(true)) {
+            do {
+                sourceIds.insert(sourceId);
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return;
+    }
+    // the shards of deleted sources
+    std::vector<int> attached(AttachedSourceIds);
+    for (size_t i = 0; i < attached.size(); ++i) {
+        if (sourceIds.count(attached[i]) == 0 && Detach(attached[i])) {
+            ShardedSourceIds.erase(attached[i]);
+        }
+    }
+
+    // the shards of new sources
+    bool attachedNew = false;
+    std::set<int>::const_iterator sourceId;
+    for (sourceId = sourceIds.begin(); sourceId != sourceIds.end(); ++sourceId) {
+        if (KnownSourceIds.count(*sourceId) == 0
+                && ShardFileName(TagDbFileName, *sourceId).FileExists()
+                && AttachShard(*sourceId)) {
+            ShardedSourceIds.insert(*sourceId);
+            attachedNew = true;
+        }
+    }
+    KnownSourceIds = sourceIds;
+    if (attachedNew) {
+        CreateViews();
+    }
+}
+
+bool t4p::TagShardsClass::Attach(int sourceId) {
+    if (!Session) {
+        return false;
+    }
+    if (std::find(AttachedSourceIds.begin(), AttachedSourceIds.end(), sourceId) != AttachedSourceIds.end()) {
+        return true;
+    }
+    if (!ShardFileName(TagDbFileName, sourceId).FileExists()) {
+        // the source tags are in the tags db
+        return false;
+    }
+    KnownSourceIds.insert(sourceId);
+    if (!AttachShard(sourceId)) {
+        return false;
+    }
+    ShardedSourceIds.insert(sourceId);
+    CreateViews();
+    return true;
+}
+
+std::string t4p::TagShardsClass::Schema(int sourceId) const {
+    // a sharded source that is not attached still returns the shard schema; a
+    // write to it fails instead of writing the tags to the wrong db
+    if (ShardedSourceIds.count(sourceId) > 0) {
+        return ShardSchemaName(sourceId);
+    }
+    return "main";
+}
+
+std::vector<std::string> t4p::TagShardsClass::Schemas() const {
+    std::vector<std::string> schemas;
+    schemas.push_back("main");
+    for (size_t i = 0; i < AttachedSourceIds.size(); ++i) {
+        schemas.push_back(ShardSchemaName(AttachedSourceIds[i]));
+    }
+    return schemas;
+}
+
+void t4p::TagShardsClass::Remove(int sourceId) {
+    if (!Session || ShardedSourceIds.count(sourceId) == 0) {
+        return;
+    }
+    if (std::find(AttachedSourceIds.begin(), AttachedSourceIds.end(), sourceId) != AttachedSourceIds.end()) {
+        Detach(sourceId);
+    }
+    ShardedSourceIds.erase(sourceId);
+
+    // if the file cannot be deleted (ie. another connection has it open in
+    // windows) it will be overwritten if a source with the same ID is created
+    wxRemoveFile(ShardFileName(TagDbFileName, sourceId).GetFullPath());
+}
+
+void t4p::TagShardsClass::RemoveAll() {
+    if (!Session) {
+        return;
+    }
+    while (!AttachedSourceIds.empty()) {
+        if (!Detach(AttachedSourceIds.back())) {
+            break;
+        }
+    }
+    ShardedSourceIds.clear();
+    RemoveFiles(TagDbFileName);
+}
+
+wxFileName t4p::TagShardsClass::ShardFileName(const wxFileName& tagDbFileName, int sourceId) {
+    wxFileName shardFile(tagDbFileName.GetFullPath());
+    shardFile.SetName(tagDbFileName.GetName() + wxString::Format(wxT(".source%d"), sourceId));
+    return shardFile;
+}
+
+void t4p::TagShardsClass::RemoveFiles(const wxFileName& tagDbFileName) {
+    if (!tagDbFileName.DirExists()) {
+        return;
+    }
+
+    // the wildcard also matches the sqlite journal files
+    wxArrayString shardFiles;
+    wxDir::GetAllFiles(tagDbFileName.GetPath(), &shardFiles, tagDbFileName.GetName() + wxT(".source*"), wxDIR_FILES);
+    for (size_t i = 0; i < shardFiles.GetCount(); ++i) {
+        wxRemoveFile(shardFiles[i]);
+    }
+}
+
+bool t4p::TagShardsClass::Create(int sourceId) {
+    // when all of the slots are used the source tags are in the tags db
+    if (!Session || static_cast<int>(ShardedSourceIds.size()) >= MaxAttached) {
+        return false;
+    }
+
+    // if there is a shard file from a deleted source that had the same ID, its
+    // tables are dropped by the script
+    wxFileName shardFile = ShardFileName(TagDbFileName, sourceId);
+    soci::session session;
+    if (!t4p::SqliteOpen(session, shardFile.GetFullPath())) {
+        return false;
+    }
+    wxString error;
+    bool ret = t4p::SqliteSqlScript(t4p::TagShardSqlSchemaAsset(), session, error);
+    wxASSERT_MSG(ret, error);
+    if (ret) {
+        // the shard has no tags yet, the VACUUM is quick
+        t4p::SqliteSetIncrementalAutoVacuum(session);
+        try {
+            // the journal mode is stored in the file, the tags db
+            // connection cannot set it once the shard is attached
+            t4p::SqliteSetStorageProfile(session);
+        } catch (std::exception& e) {
+            // ATTN: at some point bubble these exceptions up?
+            // to avoid unreferenced local variable warnings in MSVC
+            wxString msg = t4p::CharToWx(e.what());
+            wxUnusedVar(msg);
+            wxASSERT_MSG(false, msg);
+            ret = false;
+        }
+    }
+    session.close();
+    if (ret) {
+        ShardedSourceIds.insert(sourceId);
+    }
+    return ret;
+}
+
+bool t4p::TagShardsClass::AttachShard(int sourceId) {
+    if (static_cast<int>(AttachedSourceIds.size()) >= MaxAttached) {
+        // only possible when another connection has a different attach
+        // limit; the tags of this source cannot be read by this connection
+        wxASSERT_MSG(false, wxT("too many tag shards"));
+        return false;
+    }
+    try {
+        std::string stdShardFile = t4p::WxToChar(ShardFileName(TagDbFileName, sourceId).GetFullPath());
+        Session->once << "ATTACH DATABASE ? AS " << ShardSchemaName(sourceId), soci::use(stdShardFile);
+        AttachedSourceIds.push_back(sourceId);
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        return false;
+    }
+    return true;
+}
+
+bool t4p::TagShardsClass::Detach(int sourceId) {
+    std::vector<int>::iterator it = std::find(AttachedSourceIds.begin(), AttachedSourceIds.end(), sourceId);
+    if (it == AttachedSourceIds.end()) {
+        return true;
+    }
+
+    // the views cannot use the shard after it is detached
+    AttachedSourceIds.erase(it);
+    CreateViews();
+    try {
+        Session->once << "DETACH DATABASE " << ShardSchemaName(sourceId);
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        // the shard is still in use, ie. a statement is still open
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+        AttachedSourceIds.push_back(sourceId);
+        CreateViews();
+        return false;
+    }
+    return true;
+}
+
+void t4p::TagShardsClass::CreateViews() {
+    const char* tables[] = { "resources", "trait_resources" };
+    try {
+        for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i) {
+            std::string table = tables[i];
+            Session->once << "DROP VIEW IF EXISTS temp." << table;
+            if (AttachedSourceIds.empty()) {
+                // without shards the queries go directly to the tags db tables
+                continue;
+            }
+            std::string sql = "CREATE TEMP VIEW " + table + " AS SELECT * FROM main." + table;
+            for (size_t j = 0; j < AttachedSourceIds.size(); ++j) {
+                sql += " UNION ALL SELECT * FROM " + ShardSchemaName(AttachedSourceIds[j]) + "." + table;
+            }
+            Session->once << sql;
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+    }
+}
@@ -0,0 +1,184 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_LANGUAGE_PHP_TAGSHARDSCLASS_H_
+#define SRC_LANGUAGE_PHP_TAGSHARDSCLASS_H_
+
+#include <soci/soci.h>
+#include <wx/filename.h>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace t4p {
+/**
+ * A tag shard is a SQLite file that holds the tags (the resources and
+ * trait_resources tables) of a single source directory. The shard files
+ * are next to the tags db file ("tags.db" -> "tags.source12.db"), while the
+ * sources and file_items tables are only in the tags db. Because of this,
+ * deleting the tags of a source directory is a file delete instead of
+ * a big DELETE, and a lookup only goes through the indexes of the sources
+ * that are attached.
+ *
+ * The shards are attached to the tags db connection, and they are combined
+ * with the tags db using temporary views that have the same names as the
+ * tables ("resources" and "trait_resources"); this way queries do not need to know about
+ * the shards. Writes must use the schema-qualified tables of the source
+ * being written (see Schema()), since the views are read-only. The PHP
+ * detector scripts open the tags db directly, they attach the shards and
+ * create the views the same way (see Triumph_ResourceTable).
+ *
+ * Only new sources get a shard; tags from sources that were created before
+ * shards existed stay in the tags db. Each shard numbers its tags from 1, so
+ * a tag id is only unique within its source.
+ *
+ * SQLite limits the number of attached files (10 by default). The views must
+ * cover every source, so a new source only gets a shard while there is a
+ * free slot; the tags of the sources created after that stay in the tags db.
+ * This way all of the shards are always attached.
+ *
+ * This class is not thread-safe; each connection needs its own shards object.
+ */
+class TagShardsClass {
+ public:
+    TagShardsClass();
+
+    /**
+     * attaches the shards of all of the sources that are in the tags db.
+     *
+     * @param session the connection to the tags db. this class will NOT own the pointer
+     * @param tagDbFileName the location of the tags db
+     */
+    void Init(soci::session* session, const wxFileName& tagDbFileName);
+
+    /**
+     * creates a new shard file for a new source when there is a free attach
+     * slot, deleting the old shard file if there is one. The shard must be
+     * created before the sources row of the new source is committed; other
+     * connections only look for the shard file of a source the first time
+     * that they see the source (see Refresh()). The shard is not attached,
+     * this can be called inside a transaction.
+     *
+     * @param sourceId the new source
+     * @return bool TRUE if the shard was created. if FALSE the tags of the
+     *         source are in the tags db
+     */
+    bool Create(int sourceId);
+
+    /**
+     * attaches the shard for the given source. This cannot be
+     * called inside a transaction.
+     *
+     * @param sourceId the source to attach
+     * @return bool TRUE if the shard of the source is attached. FALSE if the
+     *         source does not have a shard, its tags are in the tags db
+     */
+    bool Attach(int sourceId);
+
+    /**
+     * attaches the shards that other connections created since Init() and
+     * detaches the shards of the sources that other connections deleted. This
+     * is a query to the tags db; call it once before a group of lookups. This
+     * cannot be called inside a transaction.
+     */
+    void Refresh();
+
+    /**
+     * @return the schema that holds the tags of the given source, either
+     *         "main" or the name of the attached shard
+     */
+    std::string Schema(int sourceId) const;
+
+    /**
+     * @return "main" plus the schemas of all of the attached shards
+     */
+    std::vector<std::string> Schemas() const;
+
+    /**
+     * detaches and deletes the shard of the given source
+     */
+    void Remove(int sourceId);
+
+    /**
+     * detaches and deletes all shards
+     */
+    void RemoveAll();
+
+    /**
+     * @return the shard file of the given source
+     */
+    static wxFileName ShardFileName(const wxFileName& tagDbFileName, int sourceId);
+
+    /**
+     * deletes all shard files of the given tags db. This should be done when the
+     * tags db is re-created, and no connection should have the shards attached.
+     */
+    static void RemoveFiles(const wxFileName& tagDbFileName);
+
+ private:
+    /**
+     * attaches the shard file of the given source, without re-creating the views
+     */
+    bool AttachShard(int sourceId);
+
+    bool Detach(int sourceId);
+
+    /**
+     * re-creates the temporary views so that they use the currently
+     * attached shards
+     */
+    void CreateViews();
+
+    /**
+     * the connection to the tags db, this class will NOT own the pointer
+     */
+    soci::session* Session;
+
+    wxFileName TagDbFileName;
+
+    /**
+     * the sources that have a shard file
+     */
+    std::set<int> ShardedSourceIds;
+
+    /**
+     * all of the sources that were in the tags db the last time that it was
+     * read, so that Refresh() only looks for the shard files of new sources
+     */
+    std::set<int> KnownSourceIds;
+
+    /**
+     * the sources whose shard is attached
+     */
+    std::vector<int> AttachedSourceIds;
+
+    /**
+     * max number of shards that can be attached at once, this is also the
+     * max number of shards
+     */
+    int MaxAttached;
+};
+}  // namespace t4p
+
+#endif  // SRC_LANGUAGE_PHP_TAGSHARDSCLASS_H_
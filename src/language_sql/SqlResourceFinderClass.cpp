@@ -416,3 +416,24 @@ std::vector<UnicodeString> t4p::SqlResourceFinderClass::FindColumns(const t4p::D
     }
     return ret;
 }
+
+void t4p::SqlResourceFinderClass::AllTables(std::vector<UnicodeString>& tableNames, std::vector<UnicodeString>& connectionHashes) {
+    std::string tableName;
+    std::string connectionHash;
+    try {
+        soci::statement stmt = (Session.prepare << "SELECT table_name, connection_label FROM db_tables",
+                                soci::into(tableName), soci::into(connectionHash));
+        if (stmt.execute(true)) {
+            do {
+                tableNames.push_back(t4p::CharToIcu(tableName.c_str()));
+                connectionHashes.push_back(t4p::CharToIcu(connectionHash.c_str()));
+            } while (stmt.fetch());
+        }
+    } catch (std::exception& e) {
+        // ATTN: at some point bubble these exceptions up?
+        // to avoid unreferenced local variable warnings in MSVC
+        wxString msg = t4p::CharToWx(e.what());
+        wxUnusedVar(msg);
+        wxASSERT_MSG(false, msg);
+    }
+}
@@ -262,6 +262,14 @@ class SqlResourceFinderClass : public t4p::SqliteFinderClass {
      * returned column names will be sorted in ascending order
      */
     std::vector<UnicodeString> FindColumns(const DatabaseTagClass& info, const UnicodeString& partialColumnName);
+
+    /**
+     * Gets all of the tables of all connections.
+     * @param tableNames will be filled with the table names
+     * @param connectionHashes will be filled with the connection of each table;
+     *        the Nth hash is the connection of the Nth table
+     */
+    void AllTables(std::vector<UnicodeString>& tableNames, std::vector<UnicodeString>& connectionHashes);
 };
 }  // namespace t4p
 
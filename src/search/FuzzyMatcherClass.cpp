@@ -0,0 +1,399 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "search/FuzzyMatcherClass.h"
+#include <unicode/uchar.h>
+#include <algorithm>
+#include <vector>
+
+/**
+ * the scoring constants; a matched character is worth SCORE_MATCH plus any
+ * bonus. Gaps between matched characters are penalized, the first
+ * character of a gap more than the rest so that one long gap is better
+ * than many short ones.
+ */
+static const int SCORE_MATCH = 16;
+static const int BONUS_BOUNDARY = 8;
+static const int BONUS_CAMEL = 7;
+static const int BONUS_CONSECUTIVE = 4;
+static const int PENALTY_GAP_START = 3;
+static const int PENALTY_GAP_EXTENSION = 1;
+
+/**
+ * each directory level costs PENALTY_DEPTH, up to MAX_DEPTH levels
+ */
+static const int PENALTY_DEPTH = 1;
+static const int MAX_DEPTH = 10;
+
+/**
+ * candidates modified within a day (or a week) of the most recently
+ * modified candidate get a bonus
+ */
+static const int BONUS_RECENT_DAY = 6;
+static const int BONUS_RECENT_WEEK = 3;
+static const long long SECONDS_DAY = 60 * 60 * 24;
+
+static const size_t MASK_OTHER = 63;
+
+static bool IsSeparator(UChar c) {
+    return c == '_' || c == '-' || c == '\\' || c == '/' || c == '.' || c == ':' || c == ' ' || c == '$';
+}
+
+/**
+ * @return the bit of the given folded character in a candidate mask
+ */
+static unsigned long long MaskBit(UChar c) {
+    size_t bit = MASK_OTHER;
+    if (c >= 'a' && c <= 'z') {
+        bit = c - 'a';
+    } else if (c >= '0' && c <= '9') {
+        bit = 26 + (c - '0');
+    } else if (c == '_') {
+        bit = 36;
+    }
+    return 1ULL << bit;
+}
+
+/**
+ * folds the given string and computes its mask
+ */
+static UnicodeString Fold(const UnicodeString& str, unsigned long long& mask) {
+    UnicodeString folded;
+    mask = 0;
+    for (int32_t i = 0; i < str.length(); ++i) {
+        UChar c = static_cast<UChar>(u_foldCase(str.charAt(i), U_FOLD_CASE_DEFAULT));
+        folded.append(c);
+        mask |= MaskBit(c);
+    }
+    return folded;
+}
+
+/**
+ * @return the bonus for matching the character at the given position; the start
+ *         of a word is worth more than the middle of a word
+ */
+static unsigned char Bonus(const UnicodeString& str, int32_t i) {
+    if (i == 0) {
+        return BONUS_BOUNDARY;
+    }
+    UChar prev = str.charAt(i - 1);
+    UChar c = str.charAt(i);
+    if (IsSeparator(prev)) {
+        return BONUS_BOUNDARY;
+    }
+    if (u_islower(prev) && u_isupper(c)) {
+        return BONUS_CAMEL;
+    }
+    if (!u_isdigit(prev) && u_isdigit(c)) {
+        return BONUS_CAMEL;
+    }
+    return 0;
+}
+
+/**
+ * @return the number of directories in the given path
+ */
+static int Depth(const UnicodeString& path) {
+    int depth = 0;
+    for (int32_t i = 0; i < path.length(); ++i) {
+        UChar c = path.charAt(i);
+        if (c == '/' || c == '\\') {
+            depth++;
+        }
+    }
+    return depth;
+}
+
+/**
+ * scores the given folded characters against the given folded query.
+ * The earliest occurrence of the query is found, then the match is
+ * tightened by walking backwards from its end so that "abc" in "aabc"
+ * scores the contiguous "abc".
+ *
+ * @return the score or -1 if the characters do not contain the query
+ */
+static int ScoreChars(const UChar* chars, const unsigned char* bonuses, int32_t length, const UnicodeString& query) {
+    int32_t queryLength = query.length();
+    if (queryLength == 0 || queryLength > length) {
+        return -1;
+    }
+    const UChar* q = query.getBuffer();
+    int32_t j = 0;
+    int32_t end = -1;
+    for (int32_t i = 0; i < length; ++i) {
+        if (chars[i] == q[j]) {
+            j++;
+            if (j == queryLength) {
+                end = i;
+                break;
+            }
+        }
+    }
+    if (end < 0) {
+        return -1;
+    }
+    int32_t start = end;
+    j = queryLength - 1;
+    for (int32_t i = end; i >= 0; --i) {
+        if (chars[i] == q[j]) {
+            if (j == 0) {
+                start = i;
+                break;
+            }
+            j--;
+        }
+    }
+
+    // characters that follow a matched character get (at least) the
+    // bonus of the first character of the run, that way "abc" scores
+    // higher in "abcd" than in "a_b_c"
+    int score = 0;
+    bool inGap = false;
+    int runBonus = -1;
+    j = 0;
+    for (int32_t i = start; i <= end; ++i) {
+        if (j < queryLength && chars[i] == q[j]) {
+            int bonus = bonuses[i];
+            if (runBonus < 0) {
+                runBonus = bonus;
+            } else {
+                bonus = std::max(bonus, std::max(runBonus, BONUS_CONSECUTIVE));
+            }
+            score += SCORE_MATCH + bonus;
+            inGap = false;
+            j++;
+        } else {
+            score -= inGap ? PENALTY_GAP_EXTENSION : PENALTY_GAP_START;
+            inGap = true;
+            runBonus = -1;
+        }
+    }
+    return score;
+}
+
+namespace t4p {
+/**
+ * orders matches best first; ties go to the shorter candidate and then
+ * to the candidate that was added first
+ */
+class FuzzyMatchComparatorClass {
+ public:
+    FuzzyMatchComparatorClass(const std::vector<int>& starts)
+        : Starts(starts) {
+    }
+
+    bool operator()(const t4p::FuzzyMatchClass& a, const t4p::FuzzyMatchClass& b) const {
+        if (a.Score != b.Score) {
+            return a.Score > b.Score;
+        }
+        int aLength = Starts[a.Candidate + 1] - Starts[a.Candidate];
+        int bLength = Starts[b.Candidate + 1] - Starts[b.Candidate];
+        if (aLength != bLength) {
+            return aLength < bLength;
+        }
+        return a.Candidate < b.Candidate;
+    }
+
+ private:
+    const std::vector<int>& Starts;
+};
+}  // namespace t4p
+
+t4p::FuzzyMatchClass::FuzzyMatchClass()
+    : Candidate(0)
+    , Kind(0)
+    , Payload(0)
+    , Score(0) {
+}
+
+t4p::FuzzyMatcherClass::FuzzyMatcherClass()
+    : Chars()
+    , Starts()
+    , Bonuses()
+    , Masks()
+    , Kinds()
+    , Groups()
+    , Payloads()
+    , Depths()
+    , Modified()
+    , LastModified(0)
+    , LastQuery()
+    , LastGroups()
+    , LastCandidates()
+    , IsLastValid(false) {
+    Starts.push_back(0);
+}
+
+void t4p::FuzzyMatcherClass::Add(const UnicodeString& name, const UnicodeString& path, int kind, int group,
+                                 int payload, long long modified) {
+    unsigned long long mask = 0;
+    UnicodeString folded = Fold(name, mask);
+    for (int32_t i = 0; i < folded.length(); ++i) {
+        Chars.push_back(folded.charAt(i));
+        Bonuses.push_back(Bonus(name, i));
+    }
+    Starts.push_back(static_cast<int>(Chars.size()));
+    Masks.push_back(mask);
+    Kinds.push_back(kind);
+    Groups.push_back(group);
+    Payloads.push_back(payload);
+    Depths.push_back(std::min(Depth(path), MAX_DEPTH));
+    Modified.push_back(modified);
+    LastModified = std::max(LastModified, modified);
+    IsLastValid = false;
+}
+
+void t4p::FuzzyMatcherClass::Clear() {
+    Chars.clear();
+    Starts.clear();
+    Starts.push_back(0);
+    Bonuses.clear();
+    Masks.clear();
+    Kinds.clear();
+    Groups.clear();
+    Payloads.clear();
+    Depths.clear();
+    Modified.clear();
+    LastModified = 0;
+    LastQuery.remove();
+    LastGroups.clear();
+    LastCandidates.clear();
+    IsLastValid = false;
+}
+
+void t4p::FuzzyMatcherClass::Swap(t4p::FuzzyMatcherClass& other) {
+    Chars.swap(other.Chars);
+    Starts.swap(other.Starts);
+    Bonuses.swap(other.Bonuses);
+    Masks.swap(other.Masks);
+    Kinds.swap(other.Kinds);
+    Groups.swap(other.Groups);
+    Payloads.swap(other.Payloads);
+    Depths.swap(other.Depths);
+    Modified.swap(other.Modified);
+    std::swap(LastModified, other.LastModified);
+
+    // the last candidates are positions in the old candidates
+    IsLastValid = false;
+    other.IsLastValid = false;
+}
+
+size_t t4p::FuzzyMatcherClass::Count() const {
+    return Masks.size();
+}
+
+void t4p::FuzzyMatcherClass::Match(const UnicodeString& query, const std::vector<int>& groups, size_t limit,
+                                   std::vector<t4p::FuzzyMatchClass>& matches) {
+    matches.clear();
+    unsigned long long queryMask = 0;
+    UnicodeString foldedQuery = Fold(query, queryMask);
+    if (foldedQuery.isEmpty() || limit == 0) {
+        return;
+    }
+
+    // a query that extends the previous query can only match the candidates
+    // that the previous query matched
+    bool isRefinement = IsLastValid && groups == LastGroups && foldedQuery.startsWith(LastQuery);
+    std::vector<int> previous;
+    if (isRefinement) {
+        previous.swap(LastCandidates);
+    }
+    LastCandidates.clear();
+    size_t count = isRefinement ? previous.size() : Masks.size();
+
+    // keep the best matches in a heap, the worst of the best on top, so
+    // that we never sort more than limit matches
+    t4p::FuzzyMatchComparatorClass comparator(Starts);
+    for (size_t i = 0; i < count; ++i) {
+        size_t candidate = isRefinement ? previous[i] : i;
+        if ((Masks[candidate] & queryMask) != queryMask) {
+            continue;
+        }
+        if (!groups.empty() && !std::binary_search(groups.begin(), groups.end(), Groups[candidate])) {
+            continue;
+        }
+        int score = ScoreCandidate(candidate, foldedQuery);
+        if (score < 0) {
+            continue;
+        }
+        LastCandidates.push_back(static_cast<int>(candidate));
+
+        t4p::FuzzyMatchClass match;
+        match.Candidate = static_cast<int>(candidate);
+        match.Kind = Kinds[candidate];
+        match.Payload = Payloads[candidate];
+        match.Score = score;
+        if (matches.size() < limit) {
+            matches.push_back(match);
+            std::push_heap(matches.begin(), matches.end(), comparator);
+        } else if (comparator(match, matches.front())) {
+            std::pop_heap(matches.begin(), matches.end(), comparator);
+            matches.back() = match;
+            std::push_heap(matches.begin(), matches.end(), comparator);
+        }
+    }
+    std::sort_heap(matches.begin(), matches.end(), comparator);
+
+    LastQuery = foldedQuery;
+    LastGroups = groups;
+    IsLastValid = true;
+}
+
+int t4p::FuzzyMatcherClass::Score(const UnicodeString& query, const UnicodeString& name) {
+    unsigned long long mask = 0;
+    UnicodeString foldedQuery = Fold(query, mask);
+    UnicodeString foldedName = Fold(name, mask);
+    std::vector<unsigned char> bonuses;
+    for (int32_t i = 0; i < name.length(); ++i) {
+        bonuses.push_back(Bonus(name, i));
+    }
+    if (bonuses.empty()) {
+        return -1;
+    }
+    return ScoreChars(foldedName.getBuffer(), &bonuses[0], foldedName.length(), foldedQuery);
+}
+
+int t4p::FuzzyMatcherClass::ScoreCandidate(size_t candidate, const UnicodeString& foldedQuery) const {
+    int start = Starts[candidate];
+    int length = Starts[candidate + 1] - start;
+    if (length == 0) {
+        return -1;
+    }
+    int score = ScoreChars(&Chars[start], &Bonuses[start], length, foldedQuery);
+    if (score < 0) {
+        return -1;
+    }
+    score -= Depths[candidate] * PENALTY_DEPTH;
+    if (Modified[candidate] > 0) {
+        long long age = LastModified - Modified[candidate];
+        if (age <= SECONDS_DAY) {
+            score += BONUS_RECENT_DAY;
+        } else if (age <= SECONDS_DAY * 7) {
+            score += BONUS_RECENT_WEEK;
+        }
+    }
+
+    // scores of matches are never negative, so that -1 means no match
+    return std::max(score, 0);
+}
@@ -0,0 +1,183 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef SRC_SEARCH_FUZZYMATCHERCLASS_H_
+#define SRC_SEARCH_FUZZYMATCHERCLASS_H_
+
+#include <unicode/unistr.h>
+#include <vector>
+
+namespace t4p {
+/**
+ * A single candidate that matched a fuzzy query
+ */
+class FuzzyMatchClass {
+ public:
+    /**
+     * the position of the candidate in the matcher
+     */
+    int Candidate;
+
+    /**
+     * the kind and payload that the candidate was added with
+     */
+    int Kind;
+    int Payload;
+
+    /**
+     * how well the candidate matched; higher is better
+     */
+    int Score;
+
+    FuzzyMatchClass();
+};
+
+/**
+ * The fuzzy matcher keeps a list of names (candidates) in memory and finds
+ * the names that contain all of the characters of a query, in order, but not
+ * necessarily next to each other; ie "usrctl" matches "UserController".
+ * Case does not matter.
+ *
+ * Matches are scored so that the best ones come first:
+ *  - characters that are next to each other score higher than scattered ones
+ *  - characters at the start of a word ("user_controller", "UserController",
+ *    "app/user") score higher than characters in the middle of a word
+ *  - candidates that are deep in the directory tree score a little lower
+ *  - candidates that were modified recently score a little higher
+ *
+ * The candidates are stored in a few flat arrays so that scanning hundreds
+ * of thousands of them takes only a few milliseconds. The matcher also
+ * remembers the candidates that matched the previous query; when the user
+ * keeps typing, the new query can only match a subset of those candidates
+ * so only they are scanned.
+ *
+ * This class is not thread-safe.
+ */
+class FuzzyMatcherClass {
+ public:
+    FuzzyMatcherClass();
+
+    /**
+     * Adds a candidate.
+     *
+     * @param name the string that queries are matched against
+     * @param path the full path of the file that the candidate is in; used
+     *        to score shallow files higher than deep ones. Can be empty.
+     * @param kind a caller-defined value; it is returned in the matches
+     * @param group a caller-defined value that can be used to filter
+     *        matches (ie. a source ID); see Match()
+     * @param payload a caller-defined value; it is returned in the matches
+     * @param modified the time (in seconds since the epoch) that the candidate
+     *        was last modified, 0 if not known
+     */
+    void Add(const UnicodeString& name, const UnicodeString& path, int kind, int group, int payload,
+             long long modified);
+
+    /**
+     * Removes all candidates
+     */
+    void Clear();
+
+    /**
+     * exchanges the candidates of this matcher with those of the given
+     * matcher. The results of the last query are dropped from both.
+     */
+    void Swap(FuzzyMatcherClass& other);
+
+    /**
+     * @return the number of candidates
+     */
+    size_t Count() const;
+
+    /**
+     * Finds the best candidates that match the given query.
+     *
+     * @param query the string to look for, case does not matter
+     * @param groups only candidates in these groups will be matched; if
+     *        empty, all candidates are matched. Must be sorted.
+     * @param limit the maximum number of matches to return
+     * @param matches will be filled with the best matches, best match first
+     */
+    void Match(const UnicodeString& query, const std::vector<int>& groups, size_t limit,
+               std::vector<t4p::FuzzyMatchClass>& matches);
+
+    /**
+     * Scores a single name against a query, using the same scoring as Match()
+     * (without the path or modified time).
+     *
+     * @return the score, or -1 if the name does not match the query
+     */
+    static int Score(const UnicodeString& query, const UnicodeString& name);
+
+ private:
+    /**
+     * @return the score of the candidate at the given position, or -1
+     *         if the candidate does not match the query
+     */
+    int ScoreCandidate(size_t candidate, const UnicodeString& foldedQuery) const;
+
+    /**
+     * The case folded characters of all candidates, one after the other.
+     * Candidate N's characters start at Starts[N] and end at Starts[N + 1].
+     */
+    std::vector<UChar> Chars;
+    std::vector<int> Starts;
+
+    /**
+     * the word boundary bonus of each character in Chars
+     */
+    std::vector<unsigned char> Bonuses;
+
+    /**
+     * one bit for each (folded) letter, digit, and underscore that is
+     * in a candidate; candidates that do not have all of the query's
+     * bits cannot match and are skipped without looking at their characters.
+     */
+    std::vector<unsigned long long> Masks;
+
+    /**
+     * the rest of the candidate columns
+     */
+    std::vector<int> Kinds;
+    std::vector<int> Groups;
+    std::vector<int> Payloads;
+    std::vector<int> Depths;
+    std::vector<long long> Modified;
+
+    /**
+     * the most recent modified time of all candidates
+     */
+    long long LastModified;
+
+    /**
+     * the previous (folded) query and groups, and the candidates that matched them
+     */
+    UnicodeString LastQuery;
+    std::vector<int> LastGroups;
+    std::vector<int> LastCandidates;
+    bool IsLastValid;
+};
+}  // namespace t4p
+
+#endif  // SRC_SEARCH_FUZZYMATCHERCLASS_H_
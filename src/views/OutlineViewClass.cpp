@@ -77,10 +77,12 @@ namespace t4p {
  */
 class IdTreeItemDataClass  : public wxTreeItemData {
  public:
+    int SourceId;
     int Id;
 
-    IdTreeItemDataClass(int id)
+    IdTreeItemDataClass(int sourceId, int id)
         : wxTreeItemData()
+        , SourceId(sourceId)
         , Id(id) {
     }
 };
@@ -101,9 +103,9 @@ void t4p::OutlineViewClass::AddKeyboardShortcuts(std::vector<DynamicCmdClass>& s
     AddDynamicCmd(menuItemIds, shortcuts);
 }
 
-void t4p::OutlineViewClass::JumpToResource(int tagId) {
+void t4p::OutlineViewClass::JumpToResource(int sourceId, int tagId) {
     t4p::PhpTagClass tag;
-    bool found = Feature.App.Globals.TagCache.FindById(tagId, tag);
+    bool found = Feature.App.Globals.TagCache.FindById(sourceId, tagId, tag);
     if (found) {
         LoadCodeControl(tag.GetFullPath());
         CodeControlClass* codeControl = GetCurrentCodeControl();
@@ -328,7 +330,7 @@ void t4p::OutlineViewPanelClass::TagToNode(const t4p::PhpTagClass& tag, wxTreeIt
         passesAccessCheck = passesAccessCheck && !isInheritedTag;
     }
     if (t4p::PhpTagClass::DEFINE == type && !tag.IsDynamic) {
-        Tree->AppendItem(treeId, label, IMAGE_OUTLINE_DEFINE, -1, new t4p::IdTreeItemDataClass(tag.Id));
+        Tree->AppendItem(treeId, label, IMAGE_OUTLINE_DEFINE, -1, new t4p::IdTreeItemDataClass(tag.SourceId, tag.Id));
     } else if (t4p::PhpTagClass::MEMBER == tag.Type && ShowProperties && passesAccessCheck) {
         label = t4p::IcuToWx(tag.Identifier);
         if (isInheritedTag) {
@@ -346,7 +348,7 @@ void t4p::OutlineViewPanelClass::TagToNode(const t4p::PhpTagClass& tag, wxTreeIt
         } else if (tag.IsPrivate) {
             image = IMAGE_OUTLINE_PROPERTY_PRIVATE;
         }
-        Tree->AppendItem(treeId, label, image, -1, new t4p::IdTreeItemDataClass(tag.Id));
+        Tree->AppendItem(treeId, label, image, -1, new t4p::IdTreeItemDataClass(tag.SourceId, tag.Id));
     } else if (t4p::PhpTagClass::METHOD == tag.Type && ShowMethods && passesAccessCheck) {
         label = t4p::IcuToWx(tag.Identifier);
         if (isInheritedTag) {
@@ -372,7 +374,7 @@ void t4p::OutlineViewPanelClass::TagToNode(const t4p::PhpTagClass& tag, wxTreeIt
         } else if (tag.IsPrivate) {
             image = IMAGE_OUTLINE_METHOD_PRIVATE;
         }
-        wxTreeItemId funcId = Tree->AppendItem(treeId, label, image, -1, new t4p::IdTreeItemDataClass(tag.Id));
+        wxTreeItemId funcId = Tree->AppendItem(treeId, label, image, -1, new t4p::IdTreeItemDataClass(tag.SourceId, tag.Id));
         if (ShowFunctionArgs) {
             // add the function args under the method name
             int32_t argsStart = tag.Signature.indexOf(UNICODE_STRING_SIMPLE("("));
@@ -382,7 +384,7 @@ void t4p::OutlineViewPanelClass::TagToNode(const t4p::PhpTagClass& tag, wxTreeIt
 
                 wxStringTokenizer tok(t4p::IcuToWx(sig), wxT(","));
                 while (tok.HasMoreTokens()) {
-                    Tree->AppendItem(funcId, tok.NextToken(), IMAGE_OUTLINE_ARGUMENT, -1, new t4p::IdTreeItemDataClass(tag.Id));
+                    Tree->AppendItem(funcId, tok.NextToken(), IMAGE_OUTLINE_ARGUMENT, -1, new t4p::IdTreeItemDataClass(tag.SourceId, tag.Id));
                 }
             }
         }
@@ -390,7 +392,7 @@ void t4p::OutlineViewPanelClass::TagToNode(const t4p::PhpTagClass& tag, wxTreeIt
         if (tag.ClassName != className) {
             label = t4p::IcuToWx(tag.ClassName) + wxT("::") + label;
         }
-        Tree->AppendItem(treeId, label, IMAGE_OUTLINE_CLASS_CONSTANT, -1, new t4p::IdTreeItemDataClass(tag.Id));
+        Tree->AppendItem(treeId, label, IMAGE_OUTLINE_CLASS_CONSTANT, -1, new t4p::IdTreeItemDataClass(tag.SourceId, tag.Id));
     } else if (t4p::PhpTagClass::FUNCTION == type && !tag.IsDynamic) {
         UnicodeString res = tag.Identifier;
         wxString label = t4p::IcuToWx(res);
@@ -405,7 +407,7 @@ void t4p::OutlineViewPanelClass::TagToNode(const t4p::PhpTagClass& tag, wxTreeIt
             wxString returnType = t4p::IcuToWx(tag.ReturnType);
             label += wxT(" [") + returnType + wxT("]");
         }
-        Tree->AppendItem(treeId, label, IMAGE_OUTLINE_FUNCTION, -1, new t4p::IdTreeItemDataClass(tag.Id));
+        Tree->AppendItem(treeId, label, IMAGE_OUTLINE_FUNCTION, -1, new t4p::IdTreeItemDataClass(tag.SourceId, tag.Id));
     }
 }
 
@@ -464,7 +466,7 @@ void t4p::OutlineViewPanelClass::OnTreeItemActivated(wxTreeEvent& event) {
         event.Skip();
         return;
     }
-    View.JumpToResource(idItemData->Id);
+    View.JumpToResource(idItemData->SourceId, idItemData->Id);
 }
 
 void t4p::OutlineViewPanelClass::SearchTagsToOutline(const std::vector<t4p::PhpTagClass>& tags) {
@@ -62,9 +62,10 @@ class OutlineViewClass : public FeatureViewClass {
     /**
      * Opens the file where the given tag is located.
      *
+     * @param int the source of the tag to jump to
      * @param int the tag ID to jump to
      */
-    void JumpToResource(int tagId);
+    void JumpToResource(int sourceId, int tagId);
 
     /**
      * start a tag search; will queue an action that will search the tag cache
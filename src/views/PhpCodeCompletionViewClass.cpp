@@ -32,6 +32,8 @@
 #include "language_php/Keywords.h"
 #include "Triumph.h"
 
+static int ID_PHP_CODE_COMPLETION = wxNewId();
+
 enum AutoCompletionImages {
     AUTOCOMP_IMAGE_VARIABLE = 1,
     AUTOCOMP_IMAGE_KEYWORD,
@@ -51,13 +53,13 @@ enum AutoCompletionImages {
  * @return the signature of the tag at the given index.
  * signature is in a format that is ready for the Scintilla call tip (with up or down arrows as appropriate)
  */
-static wxString PhpCallTipSignature(size_t index, const std::vector<t4p::PhpTagClass>& resources) {
+static wxString PhpCallTipSignature(size_t index, const t4p::CompactTagListClass& resources) {
     wxString callTip;
-    size_t size = resources.size();
+    size_t size = resources.Size();
     if (index >= size) {
         return callTip;
     }
-    wxString sig = t4p::IcuToWx(resources[index].Signature);
+    wxString sig = t4p::IcuToWx(resources.Signature(index));
     if (size == 1) {
         callTip = sig;
     } else {
@@ -89,9 +91,19 @@ static bool InCommentOrStringStyle(wxStyledTextCtrl* ctrl, int posToCheck) {
 
 t4p::PhpCodeCompletionViewClass::PhpCodeCompletionViewClass(t4p::PhpCodeCompletionFeatureClass& feature)
     : FeatureViewClass()
-    , CodeCompletionProvider(feature.App.Globals)
+    , RunningThreads()
+    , CodeCompletionProvider(feature.App.Globals, RunningThreads)
     , CallTipProvider(feature.App.Globals)
     , BraceStyler() {
+    // completions are computed one at a time; a new completion
+    // cancels the previous one
+    RunningThreads.SetMaxThreads(1);
+    RunningThreads.AddEventHandler(this);
+}
+
+t4p::PhpCodeCompletionViewClass::~PhpCodeCompletionViewClass() {
+    RunningThreads.RemoveEventHandler(this);
+    RunningThreads.Shutdown();
 }
 
 void t4p::PhpCodeCompletionViewClass::OnAutoCompletionSelected(wxStyledTextEvent& event) {
@@ -110,13 +122,28 @@ void t4p::PhpCodeCompletionViewClass::OnCallTipClick(wxStyledTextEvent& event) {
     CallTipProvider.OnCallTipClick(event);
 }
 
-t4p::PhpCodeCompletionProviderClass::PhpCodeCompletionProviderClass(t4p::GlobalsClass& globals)
-    : LanguageDiscovery()
-    , Parser()
-    , Lexer()
-    , ScopeFinder()
-    , Globals(globals)
-    , AutoCompletionResourceMatches() {
+void t4p::PhpCodeCompletionViewClass::OnStyledTextModified(wxStyledTextEvent& event) {
+    CodeCompletionProvider.CancelStaleCompletion(event);
+}
+
+void t4p::PhpCodeCompletionViewClass::OnCompletionComplete(t4p::PhpCodeCompletionCompleteEventClass& event) {
+    wxString completeStatus;
+    CodeCompletionProvider.ShowCompletion(GetCurrentCodeControl(), event, completeStatus);
+    t4p::StatusBarWithGaugeClass* gauge = GetStatusBarWithGauge();
+    if (!completeStatus.IsEmpty() && gauge) {
+        gauge->SetColumn0Text(completeStatus);
+    }
+}
+
+t4p::PhpCodeCompletionProviderClass::PhpCodeCompletionProviderClass(t4p::GlobalsClass& globals,
+        t4p::RunningThreadsClass& runningThreads)
+    : Globals(globals)
+    , RunningThreads(runningThreads)
+    , CompletionTags()
+    , AutoCompletionResourceMatches()
+    , PendingActionId(-1)
+    , PendingFileIdentifier()
+    , PendingPos(0) {
 }
 
 bool t4p::PhpCodeCompletionProviderClass::DoesSupport(t4p::FileType type) {
@@ -126,40 +153,88 @@ bool t4p::PhpCodeCompletionProviderClass::DoesSupport(t4p::FileType type) {
 
 void t4p::PhpCodeCompletionProviderClass::Provide(t4p::CodeControlClass* ctrl,
         std::vector<t4p::CodeCompletionItemClass>& suggestions, wxString& completeStatus) {
-    AutoCompletionResourceMatches.clear();
+    // the matches are computed in the background, since finding the scope parses
+    // the entire file and resolving the expression queries the tag dbs.
+    // the list will be shown in ShowCompletion()
+    if (PendingActionId >= 0) {
+        RunningThreads.CancelAction(PendingActionId);
+    }
+    int currentPos = ctrl->GetCurrentPos();
+    t4p::PhpCodeCompletionActionClass* action = new t4p::PhpCodeCompletionActionClass(RunningThreads, ID_PHP_CODE_COMPLETION);
+    action->SetCompletion(Globals, ctrl->GetIdString(), ctrl->GetSnapshot(), currentPos,
+                          ctrl->CodeControlOptions.EnableDynamicAutoCompletion, CompletionTags);
+    PendingActionId = RunningThreads.Queue(action);
+    PendingFileIdentifier = ctrl->GetIdString();
+    PendingPos = currentPos;
+}
+
+void t4p::PhpCodeCompletionProviderClass::CancelStaleCompletion(wxStyledTextEvent& event) {
+    int mask = wxSTC_MOD_INSERTTEXT | wxSTC_MOD_DELETETEXT;
+    if (PendingActionId < 0 || !(event.GetModificationType() & mask)) {
+        return;
+    }
+
+    // typing more of the word being completed does not make the
+    // matches stale; the list will just be filtered when it is shown.
+    // anything else does.
+    t4p::CodeControlClass* ctrl = (t4p::CodeControlClass*)event.GetEventObject();
+    bool isStale = !ctrl || ctrl->GetIdString() != PendingFileIdentifier
+                   || (event.GetModificationType() & wxSTC_MOD_DELETETEXT)
+                   || event.GetPosition() < PendingPos;
+    wxString text = event.GetText();
+    for (size_t i = 0; i < text.length() && !isStale; ++i) {
+        isStale = !wxIsalnum(text[i]) && wxT('_') != text[i];
+    }
+    if (isStale) {
+        RunningThreads.CancelAction(PendingActionId);
+        PendingActionId = -1;
+    }
+}
+
+void t4p::PhpCodeCompletionProviderClass::ShowCompletion(t4p::CodeControlClass* ctrl,
+        const t4p::PhpCodeCompletionCompleteEventClass& event, wxString& completeStatus) {
+    if (event.ActionId != PendingActionId) {
+        // results of a request that was superseded
+        return;
+    }
+    PendingActionId = -1;
+
+    // the user may have switched files or moved away from the word
+    // while the matches were being computed
+    if (!ctrl || ctrl->GetIdString() != event.FileIdentifier) {
+        return;
+    }
     int currentPos = ctrl->GetCurrentPos();
     int startPos = ctrl->WordStartPosition(currentPos, true);
     int endPos = ctrl->WordEndPosition(currentPos, true);
+    if (currentPos < event.Pos || startPos > event.Pos) {
+        return;
+    }
     UnicodeString word = ctrl->GetSafeSubstring(startPos, endPos);
-    UnicodeString code = ctrl->GetSafeSubstring(0, currentPos);
-    std::vector<wxString> ret;
-    if (LanguageDiscovery.Open(code)) {
-        pelet::LanguageDiscoveryClass::Syntax syntax = LanguageDiscovery.at(code.length() - 1);
-        switch (syntax) {
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_SCRIPT:
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_BACKTICK:
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_DOUBLE_QUOTE_STRING:
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_HEREDOC:
-            HandleAutoCompletionPhp(code, word, syntax, ctrl, completeStatus);
-            break;
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_LINE_COMMENT:
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_MULTI_LINE_COMMENT:
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_NOWDOC:
-        case pelet::LanguageDiscoveryClass::SYNTAX_PHP_SINGLE_QUOTE_STRING:
-            HandleAutoCompletionString(word, ctrl, completeStatus);
-            break;
-        case pelet::LanguageDiscoveryClass::SYNTAX_HTML:
-        case pelet::LanguageDiscoveryClass::SYNTAX_HTML_TAG:
-        case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ATTRIBUTE:
-        case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ATTRIBUTE_DOUBLE_QUOTE_VALUE:
-        case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ATTRIBUTE_SINGLE_QUOTE_VALUE:
-        case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ENTITY:
-            HandleAutoCompletionHtml(word, syntax, ctrl, completeStatus);
-            break;
-        default:
-            break;
-        }
-        LanguageDiscovery.Close();
+    AutoCompletionResourceMatches = event.ResourceMatches;
+    switch (event.Syntax) {
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_SCRIPT:
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_BACKTICK:
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_DOUBLE_QUOTE_STRING:
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_HEREDOC:
+        HandleAutoCompletionPhp(event, word, ctrl, completeStatus);
+        break;
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_LINE_COMMENT:
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_MULTI_LINE_COMMENT:
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_NOWDOC:
+    case pelet::LanguageDiscoveryClass::SYNTAX_PHP_SINGLE_QUOTE_STRING:
+        HandleAutoCompletionString(word, ctrl, completeStatus);
+        break;
+    case pelet::LanguageDiscoveryClass::SYNTAX_HTML:
+    case pelet::LanguageDiscoveryClass::SYNTAX_HTML_TAG:
+    case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ATTRIBUTE:
+    case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ATTRIBUTE_DOUBLE_QUOTE_VALUE:
+    case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ATTRIBUTE_SINGLE_QUOTE_VALUE:
+    case pelet::LanguageDiscoveryClass::SYNTAX_HTML_ENTITY:
+        HandleAutoCompletionHtml(word, event.Syntax, ctrl, completeStatus);
+        break;
+    default:
+        break;
     }
 }
 
@@ -243,74 +318,59 @@ void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionHtml(const Unicode
     }
 }
 
-void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionPhp(const UnicodeString& code, const UnicodeString& word,
-        pelet::LanguageDiscoveryClass::Syntax syntax, t4p::CodeControlClass* ctrl,
-        wxString& completeStatus) {
-    Lexer.SetVersion(Globals.Environment.Php.Version);
-    Parser.SetVersion(Globals.Environment.Php.Version);
-    ScopeFinder.SetVersion(Globals.Environment.Php.Version);
-
-    std::vector<wxFileName> sourceDirs = Globals.AllEnabledSourceDirectories();
+void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionPhp(const t4p::PhpCodeCompletionCompleteEventClass& event,
+        const UnicodeString& word, t4p::CodeControlClass* ctrl, wxString& completeStatus) {
     std::vector<wxString> autoCompleteList;
-    std::vector<UnicodeString> variableMatches;
-    int expressionPos = code.length() - 1;
-    UnicodeString lastExpression = Lexer.LastExpression(code);
-    pelet::ScopeClass scope;
-    pelet::VariableClass parsedVariable(scope);
-    pelet::ScopeClass variableScope;
-    t4p::SymbolTableMatchErrorClass error;
-
-    bool doDuckTyping = ctrl->CodeControlOptions.EnableDynamicAutoCompletion;
+    const std::vector<UnicodeString>& variableMatches = event.VariableMatches;
+    const UnicodeString& lastExpression = event.LastExpression;
     if (!lastExpression.isEmpty()) {
-        Parser.ParseExpression(lastExpression, parsedVariable);
-        ScopeFinder.GetScopeString(code, expressionPos, variableScope);
-        Globals.TagCache.ExpressionCompletionMatches(ctrl->GetIdString(), parsedVariable, variableScope, sourceDirs,
-                variableMatches, AutoCompletionResourceMatches, doDuckTyping, error);
         if (!variableMatches.empty()) {
             for (size_t i = 0; i < variableMatches.size(); ++i) {
                 wxString postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_VARIABLE);
                 autoCompleteList.push_back(t4p::IcuToWx(variableMatches[i]) + postFix);
             }
-        } else if (parsedVariable.ChainList.size() == 1) {
+        } else if (event.ChainListSize == 1) {
             // a bunch of function, define, or class names
-            for (size_t i = 0; i < AutoCompletionResourceMatches.size(); ++i) {
-                t4p::PhpTagClass res = AutoCompletionResourceMatches[i];
+            for (size_t i = 0; i < AutoCompletionResourceMatches.Size(); ++i) {
+                t4p::PhpTagClass::Types type = AutoCompletionResourceMatches.Type(i);
                 wxString postFix;
-                if (t4p::PhpTagClass::DEFINE == res.Type) {
+                if (t4p::PhpTagClass::DEFINE == type) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_DEFINE);
-                } else if (t4p::PhpTagClass::FUNCTION == res.Type) {
+                } else if (t4p::PhpTagClass::FUNCTION == type) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_FUNCTION);
-                } else if (t4p::PhpTagClass::CLASS == res.Type) {
+                } else if (t4p::PhpTagClass::CLASS == type) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_CLASS);
                 }
-                autoCompleteList.push_back(t4p::IcuToWx(res.Identifier) + postFix);
+                autoCompleteList.push_back(t4p::IcuToWx(AutoCompletionResourceMatches.Identifier(i)) + postFix);
             }
 
             // when completing standalone function names, also include keyword matches
-            std::vector<wxString> keywordMatches = CollectNearMatchKeywords(t4p::IcuToWx(parsedVariable.ChainList[0].Name));
+            std::vector<wxString> keywordMatches = CollectNearMatchKeywords(t4p::IcuToWx(event.ChainListStart));
             for (size_t i = 0; i < keywordMatches.size(); ++i) {
                 wxString postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_KEYWORD);
                 autoCompleteList.push_back(keywordMatches[i] + postFix);
             }
-        } else if (!AutoCompletionResourceMatches.empty()) {
+        } else if (!AutoCompletionResourceMatches.Empty()) {
             // an object / function "chain"
-            for (size_t i = 0; i < AutoCompletionResourceMatches.size(); ++i) {
-                t4p::PhpTagClass res = AutoCompletionResourceMatches[i];
-                wxString comp = t4p::IcuToWx(res.Identifier);
+            for (size_t i = 0; i < AutoCompletionResourceMatches.Size(); ++i) {
+                wxString comp = t4p::IcuToWx(AutoCompletionResourceMatches.Identifier(i));
+                t4p::PhpTagClass::Types type = AutoCompletionResourceMatches.Type(i);
+                bool isPrivate = AutoCompletionResourceMatches.IsPrivate(i);
+                bool isProtected = AutoCompletionResourceMatches.IsProtected(i);
                 wxString postFix;
-                if (t4p::PhpTagClass::MEMBER == res.Type && res.IsPrivate) {
+                if (t4p::PhpTagClass::MEMBER == type && isPrivate) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_PRIVATE_MEMBER);
-                } else if (t4p::PhpTagClass::MEMBER == res.Type && res.IsProtected) {
+                } else if (t4p::PhpTagClass::MEMBER == type && isProtected) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_PROTECTED_MEMBER);
-                } else if (t4p::PhpTagClass::MEMBER == res.Type) {
+                } else if (t4p::PhpTagClass::MEMBER == type) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_PUBLIC_MEMBER);
-                } else if (t4p::PhpTagClass::METHOD == res.Type && res.IsPrivate) {
+                } else if (t4p::PhpTagClass::METHOD == type && isPrivate) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_PRIVATE_METHOD);
-                } else if (t4p::PhpTagClass::METHOD == res.Type && res.IsProtected) {
+                } else if (t4p::PhpTagClass::METHOD == type && isProtected) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_PROTECTED_METHOD);
-                } else if (t4p::PhpTagClass::METHOD == res.Type) {
+                } else if (t4p::PhpTagClass::METHOD == type) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_PUBLIC_METHOD);
-                } else if (t4p::PhpTagClass::CLASS_CONSTANT == res.Type) {
+                } else if (t4p::PhpTagClass::CLASS_CONSTANT == type) {
                     postFix = wxString::Format(wxT("?%d"), AUTOCOMP_IMAGE_CLASS_CONSTANT);
                 }
                 autoCompleteList.push_back(comp + postFix);
@@ -336,7 +396,7 @@ void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionPhp(const UnicodeS
 
         // in case of a double quoted string, complete SQL table names too
         // this is in addition to auto completing any variable names inside the string too
-        if (pelet::LanguageDiscoveryClass::SYNTAX_PHP_DOUBLE_QUOTE_STRING == syntax) {
+        if (pelet::LanguageDiscoveryClass::SYNTAX_PHP_DOUBLE_QUOTE_STRING == event.Syntax) {
             AppendSqlTableNames(word, autoCompleteList);
         }
     }
@@ -357,31 +417,30 @@ void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionPhp(const UnicodeS
         int wordLength = currentPos - startPos;
         ctrl->AutoCompShow(wordLength, list);
     } else {
-        HandleAutoCompletionPhpStatus(error, lastExpression, parsedVariable,
-                                      variableScope, completeStatus);
+        HandleAutoCompletionPhpStatus(event, completeStatus);
     }
 }
 
 void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionPhpStatus(
-    const t4p::SymbolTableMatchErrorClass& error,
-    const UnicodeString& lastExpression,
-    const pelet::VariableClass& parsedVariable,
-    const pelet::ScopeClass& variableScope,
+    const t4p::PhpCodeCompletionCompleteEventClass& event,
     wxString& completeStatus) {
+    const t4p::SymbolTableMatchErrorClass& error = event.Error;
+    const UnicodeString& lastExpression = event.LastExpression;
+    const pelet::ScopeClass& variableScope = event.VariableScope;
     if (lastExpression.isEmpty()) {
         completeStatus = _("Nothing to complete");
-    } else if (lastExpression.startsWith(UNICODE_STRING_SIMPLE("$")) && parsedVariable.ChainList.size() <= 1) {
+    } else if (lastExpression.startsWith(UNICODE_STRING_SIMPLE("$")) && event.ChainListSize <= 1) {
         completeStatus = _("No matching variables for: ");
         completeStatus += t4p::IcuToWx(lastExpression);
         completeStatus +=  _(" in scope: ");
         completeStatus += t4p::IcuToWx(variableScope.ClassName);
         completeStatus += _("::");
         completeStatus += t4p::IcuToWx(variableScope.MethodName);
-    } else if (parsedVariable.ChainList.size() == 1) {
+    } else if (event.ChainListSize == 1) {
         completeStatus = _("No matching class, function, define, or keyword for: \"");
         completeStatus += t4p::IcuToWx(lastExpression);
         completeStatus += wxT("\"");
-    } else if (AutoCompletionResourceMatches.empty()) {
+    } else if (AutoCompletionResourceMatches.Empty()) {
         if (t4p::SymbolTableMatchErrorClass::PARENT_ERROR == error.Type) {
             completeStatus = _("parent not valid for scope: ");
             completeStatus += t4p::IcuToWx(variableScope.ClassName);
@@ -397,8 +456,7 @@ void t4p::PhpCodeCompletionProviderClass::HandleAutoCompletionPhpStatus(
             completeStatus += t4p::IcuToWx(error.ErrorLexeme);
             completeStatus += wxT("\"");
         } else if (t4p::SymbolTableMatchErrorClass::UNKNOWN_RESOURCE == error.Type) {
-            if (!parsedVariable.ChainList.empty() &&
-                    parsedVariable.ChainList[0].Name == UNICODE_STRING_SIMPLE("$this")) {
+            if (event.ChainListStart == UNICODE_STRING_SIMPLE("$this")) {
                 completeStatus = _("No public, protected, or private member matches for \"");
             } else {
                 completeStatus = _("No public member matches for \"");
@@ -473,13 +531,15 @@ void t4p::PhpCodeCompletionProviderClass::OnAutoCompletionSelected(wxStyledTextE
     }
     t4p::CodeControlClass* ctrl = (t4p::CodeControlClass*)txtCtrl;
 
-    if (!AutoCompletionResourceMatches.empty()) {
+    if (!AutoCompletionResourceMatches.Empty()) {
         UnicodeString selected = t4p::WxToIcu(event.GetText());
 
         bool handled = false;
-        for (size_t i = 0; i < AutoCompletionResourceMatches.size(); ++i) {
-            t4p::PhpTagClass res = AutoCompletionResourceMatches[i];
-            if (res.Identifier == selected) {
+        for (size_t i = 0; i < AutoCompletionResourceMatches.Size(); ++i) {
+            if (AutoCompletionResourceMatches.Identifier(i) == selected) {
+                t4p::PhpTagClass::Types type = AutoCompletionResourceMatches.Type(i);
+                bool hasParameters = AutoCompletionResourceMatches.HasParameters(i);
+
                 // user had selected  a function /method name; let's add the
                 // parenthesis and show the call tip
                 ctrl->AutoCompCancel();
@@ -487,10 +547,10 @@ void t4p::PhpCodeCompletionProviderClass::OnAutoCompletionSelected(wxStyledTextE
                 int startPos = ctrl->WordStartPosition(ctrl->GetCurrentPos(), true);
                 ctrl->SetSelection(startPos, ctrl->GetCurrentPos());
                 wxString status;
-                if ((t4p::PhpTagClass::FUNCTION == res.Type || t4p::PhpTagClass::METHOD == res.Type) && !res.HasParameters()) {
+                if ((t4p::PhpTagClass::FUNCTION == type || t4p::PhpTagClass::METHOD == type) && !hasParameters) {
                     ctrl->ReplaceSelection(selected + wxT("()"));
                     ctrl->HandleCallTip(0, true);
-                } else if (t4p::PhpTagClass::FUNCTION == res.Type || t4p::PhpTagClass::METHOD == res.Type) {
+                } else if (t4p::PhpTagClass::FUNCTION == type || t4p::PhpTagClass::METHOD == type) {
                     ctrl->ReplaceSelection(selected + wxT("("));
                     ctrl->HandleCallTip(0, true);
                 } else {
@@ -574,7 +634,7 @@ void t4p::PhpCallTipProviderClass::ProvideTip(t4p::CodeControlClass* ctrl, wxCha
         }
 
         if (currentPos >= 0) {
-            CurrentCallTipResources.clear();
+            CurrentCallTipResources.Clear();
             CurrentCallTipIndex = 0;
 
             std::vector<t4p::PhpTagClass> matches = Globals.TagCache.GetTagsAtPosition(
@@ -586,10 +646,10 @@ void t4p::PhpCallTipProviderClass::ProvideTip(t4p::CodeControlClass* ctrl, wxCha
             for (size_t i = 0; i < matches.size(); ++i) {
                 t4p::PhpTagClass tag = matches[i];
                 if (t4p::PhpTagClass::FUNCTION == tag.Type || t4p::PhpTagClass::METHOD == tag.Type) {
-                    CurrentCallTipResources.push_back(tag);
+                    CurrentCallTipResources.Append(tag);
                 }
             }
-            if (CurrentCallTipResources.empty() && hasMethodCall && !matches.empty()) {
+            if (CurrentCallTipResources.Empty() && hasMethodCall && !matches.empty()) {
                 // may be the constructor is being called.
                 // when the constructor is called; the matched symbol is the class name and not a method name
                 // here we will look for the constructor
@@ -604,16 +664,19 @@ void t4p::PhpCallTipProviderClass::ProvideTip(t4p::CodeControlClass* ctrl, wxCha
                     delete result;
                     result = Globals.TagCache.ExactNativeTags(constructorSearch);
                 }
+                t4p::CompactTagListClass constructors;
                 while (result->More()) {
-                    result->Next();
-                    t4p::PhpTagClass res = result->Tag;
-                    if (t4p::PhpTagClass::METHOD == res.Type && UNICODE_STRING_SIMPLE("__construct") == res.Identifier) {
-                        CurrentCallTipResources.push_back(res);
+                    result->Next(constructors);
+                }
+                for (size_t i = 0; i < constructors.Size(); ++i) {
+                    if (t4p::PhpTagClass::METHOD == constructors.Type(i)
+                            && UNICODE_STRING_SIMPLE("__construct") == constructors.Identifier(i)) {
+                        CurrentCallTipResources.Append(constructors.Tag(i));
                     }
                 }
                 delete result;
             }
-            size_t matchCount = CurrentCallTipResources.size();
+            size_t matchCount = CurrentCallTipResources.Size();
             if (matchCount > 0) {
                 wxString callTip = PhpCallTipSignature(CurrentCallTipIndex, CurrentCallTipResources);
                 ctrl->CallTipShow(ctrl->GetCurrentPos(), callTip);
@@ -641,8 +704,8 @@ void t4p::PhpCallTipProviderClass::ProvideTip(t4p::CodeControlClass* ctrl, wxCha
             }
             startOfArguments--;
         }
-        if (startOfArguments >= 0 && !CurrentCallTipResources.empty() && CurrentCallTipIndex < CurrentCallTipResources.size()) {
-            wxString currentSignature = t4p::IcuToWx(CurrentCallTipResources[CurrentCallTipIndex].Signature);
+        if (startOfArguments >= 0 && !CurrentCallTipResources.Empty() && CurrentCallTipIndex < CurrentCallTipResources.Size()) {
+            wxString currentSignature = t4p::IcuToWx(CurrentCallTipResources.Signature(CurrentCallTipIndex));
             int startHighlightPos = currentSignature.find(wxT('('));
 
             // sometimes the previous call tip is active, as in for example this line
@@ -675,8 +738,8 @@ void t4p::PhpCallTipProviderClass::ProvideTip(t4p::CodeControlClass* ctrl, wxCha
 void t4p::PhpCallTipProviderClass::OnCallTipClick(wxStyledTextEvent& evt) {
     wxStyledTextCtrl* ctrl = wxDynamicCast(evt.GetEventObject(), wxStyledTextCtrl);
 
-    if (!CurrentCallTipResources.empty()) {
-        size_t resourcesSize = CurrentCallTipResources.size();
+    if (!CurrentCallTipResources.Empty()) {
+        size_t resourcesSize = CurrentCallTipResources.Size();
         int position = evt.GetPosition();
         wxString callTip;
 
@@ -735,5 +798,7 @@ BEGIN_EVENT_TABLE(t4p::PhpCodeCompletionViewClass, t4p::FeatureViewClass)
     EVT_APP_FILE_NEW(t4p::PhpCodeCompletionViewClass::OnAppFileOpened)
     EVT_STC_AUTOCOMP_SELECTION(wxID_ANY, t4p::PhpCodeCompletionViewClass::OnAutoCompletionSelected)
     EVT_STC_CALLTIP_CLICK(wxID_ANY, t4p::PhpCodeCompletionViewClass::OnCallTipClick)
+    EVT_STC_MODIFIED(wxID_ANY, t4p::PhpCodeCompletionViewClass::OnStyledTextModified)
+    EVENT_PHP_CODE_COMPLETION_COMPLETE(ID_PHP_CODE_COMPLETION, t4p::PhpCodeCompletionViewClass::OnCompletionComplete)
 END_EVENT_TABLE()
 
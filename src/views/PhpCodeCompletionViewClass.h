@@ -28,24 +28,58 @@
 #include <pelet/LanguageDiscoveryClass.h>
 #include <pelet/TokenClass.h>
 #include <vector>
+#include "actions/ActionClass.h"
+#include "actions/PhpCodeCompletionActionClass.h"
 #include "code_control/CodeControlClass.h"
 #include "features/PhpCodeCompletionFeatureClass.h"
 #include "globals/Events.h"
+#include "language_php/CompactTagListClass.h"
 #include "language_php/SymbolTableClass.h"
 #include "views/FeatureViewClass.h"
 
 namespace t4p {
 class PhpCodeCompletionProviderClass : public t4p::CodeCompletionProviderClass {
  public:
-    PhpCodeCompletionProviderClass(t4p::GlobalsClass& globals);
+    /**
+     * @param globals to access the tag cache and the php version
+     * @param runningThreads the completion matches are computed in a background
+     *        thread; the view that owns runningThreads will get the
+     *        EVENT_PHP_CODE_COMPLETION_COMPLETE event and should call ShowCompletion()
+     */
+    PhpCodeCompletionProviderClass(t4p::GlobalsClass& globals, t4p::RunningThreadsClass& runningThreads);
 
     /**
      * @return bool TRUE if file type is php or html
      */
     bool DoesSupport(t4p::FileType type);
 
+    /**
+     * queues a background action that computes the completion matches; any
+     * completion that is still being computed is cancelled. The
+     * completion list is shown in ShowCompletion()
+     */
     void Provide(t4p::CodeControlClass* ctrl, std::vector<t4p::CodeCompletionItemClass>& suggestions, wxString& completeStatus);
 
+    /**
+     * shows the completion list with the matches that were computed in the
+     * background. Matches are discarded if they belong to a cancelled request or if
+     * the cursor is no longer on the word that was being completed.
+     *
+     * @param ctrl the currently opened code control, may be NULL
+     * @param event the computed matches
+     * @param completeStatus a bit of text that will help the user understand
+     *        why the complete box did not populate.
+     */
+    void ShowCompletion(t4p::CodeControlClass* ctrl, const t4p::PhpCodeCompletionCompleteEventClass& event,
+                        wxString& completeStatus);
+
+    /**
+     * cancels the pending completion when the text was modified in a way
+     * that makes the matches stale.  Typing more characters
+     * of the word being completed does not cancel the completion.
+     */
+    void CancelStaleCompletion(wxStyledTextEvent& event);
+
     void RegisterAutoCompletionImages(wxStyledTextCtrl* ctrl);
 
     /**
@@ -57,16 +91,15 @@ class PhpCodeCompletionProviderClass : public t4p::CodeCompletionProviderClass {
     /**
      * handles auto completion for PHP.
      *
-     * @param code most current source code; but only up to the current position (this helps determine
-     * the scope)
+     * @param event the matches computed in the background, along with the
+     *        syntax (ie if the cursor is inside of a string) and the
+     *        parsed expression
      * @param word the word to complete
-     * @param syntax the token type that the cursor is currently on.  This helps
-     *        in determining context (ie if the cursor is inside of a string)
      * @param ctrl the code control that contains the source
      * @param completeStatus a bit of text that will help the user understand
      *        why the complete box did not populate.
      */
-    void HandleAutoCompletionPhp(const UnicodeString& code, const UnicodeString& word, pelet::LanguageDiscoveryClass::Syntax syntax,
+    void HandleAutoCompletionPhp(const t4p::PhpCodeCompletionCompleteEventClass& event, const UnicodeString& word,
                                  t4p::CodeControlClass* ctrl, wxString& completeStatus);
 
     /**
@@ -94,9 +127,7 @@ class PhpCodeCompletionProviderClass : public t4p::CodeCompletionProviderClass {
     /**
      * Fills completeStatus with a human-friendly version of the symbol table error
      */
-    void HandleAutoCompletionPhpStatus(const t4p::SymbolTableMatchErrorClass& error,
-                                       const UnicodeString& lastExpression, const pelet::VariableClass& parsedVariable,
-                                       const pelet::ScopeClass& variableScope, wxString& completeStatus);
+    void HandleAutoCompletionPhpStatus(const t4p::PhpCodeCompletionCompleteEventClass& event, wxString& completeStatus);
 
     /**
      * share code between HandleAutoCompletionString and HandleAutoCompletionPhp since
@@ -113,39 +144,39 @@ class PhpCodeCompletionProviderClass : public t4p::CodeCompletionProviderClass {
     std::vector<wxString> CollectNearMatchKeywords(wxString word);
 
     /**
-     * In order to show the proper auto complete keywords we must know what language is
-     * being edited at any given position.  This class will help in this regard.
+     * To access any global structures: the tag cache, template variables
      */
-    pelet::LanguageDiscoveryClass LanguageDiscovery;
+    t4p::GlobalsClass& Globals;
 
     /**
-    * To parse a code snippet to make it suitable for code completion
-    * @var pelet::ParserClass
-    */
-    pelet::ParserClass Parser;
+     * runs the completion actions
+     */
+    t4p::RunningThreadsClass& RunningThreads;
 
     /**
-     * To get the last expression in the source code
-     * @var pelet::LexicalAnalyzerClass
+     * the tag dbs that the completion actions query; they are kept
+     * open between completions. Only the completion thread uses them
      */
-    pelet::LexicalAnalyzerClass Lexer;
+    t4p::PhpCodeCompletionTagsClass CompletionTags;
 
     /**
-     * This will be used to find the scope of any position in a piece of PHP code
-     * @var ScopeFinderClass
+     * The resources that are shown in the code completion list. Keeping these around
+     * so that we can append the '(' for method calls.
      */
-    t4p::ScopeFinderClass ScopeFinder;
+    t4p::CompactTagListClass AutoCompletionResourceMatches;
 
     /**
-     * To access any global structures: the tag cache, template variables
+     * the action ID of the completion that is being computed, -1 if
+     * there is none
      */
-    t4p::GlobalsClass& Globals;
+    int PendingActionId;
 
     /**
-     * The resources that are shown in the code completion list. Keeping these around
-     * so that we can append the '(' for method calls.
+     * the file and position of the completion that is being computed. Used
+     * to tell whether an edit makes the completion stale
      */
-    std::vector<t4p::PhpTagClass> AutoCompletionResourceMatches;
+    wxString PendingFileIdentifier;
+    int PendingPos;
 };
 
 /**
@@ -187,7 +218,7 @@ class PhpCallTipProviderClass : public t4p::CallTipProviderClass {
     /**
      * The resources used to populate the call tips
      */
-    std::vector<t4p::PhpTagClass> CurrentCallTipResources;
+    t4p::CompactTagListClass CurrentCallTipResources;
 
     /**
      * The tag signature currently being displayed in the calltip.
@@ -221,10 +252,20 @@ class PhpCodeCompletionViewClass : public t4p::FeatureViewClass {
  public:
     PhpCodeCompletionViewClass(t4p::PhpCodeCompletionFeatureClass& feature);
 
+    ~PhpCodeCompletionViewClass();
+
  private:
     void OnAppFileOpened(t4p::CodeControlEventClass& event);
     void OnAutoCompletionSelected(wxStyledTextEvent& event);
     void OnCallTipClick(wxStyledTextEvent& event);
+    void OnStyledTextModified(wxStyledTextEvent& event);
+    void OnCompletionComplete(t4p::PhpCodeCompletionCompleteEventClass& event);
+
+    /**
+     * the thread that computes code completion matches. Declared before
+     * the provider since the provider holds a reference to it
+     */
+    t4p::RunningThreadsClass RunningThreads;
 
     t4p::PhpCodeCompletionProviderClass CodeCompletionProvider;
     t4p::PhpCallTipProviderClass CallTipProvider;
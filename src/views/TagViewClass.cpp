@@ -251,7 +251,7 @@ void t4p::TagViewClass::OnActionComplete(t4p::ActionEventClass& event) {
 void t4p::TagViewClass::OnAppFileOpened(t4p::CodeControlEventClass& event) {
     t4p::CodeControlClass* codeControl = event.GetCodeControl();
     if (codeControl && codeControl->GetFileType() == t4p::FILE_TYPE_PHP) {
-        UnicodeString text = codeControl->GetSafeText();
+        t4p::CodeSnapshotClass snapshot = codeControl->GetSnapshot();
 
         // builder action could take a while (more than the timer)
         // stop the timer so that we dont queue up a builder actions before the previous one
@@ -264,7 +264,7 @@ void t4p::TagViewClass::OnAppFileOpened(t4p::CodeControlEventClass& event) {
             Feature.App.Globals,
             codeControl->GetFileName(),
             codeControl->GetIdString(),
-            text,
+            snapshot,
             codeControl->IsNew(),
             Feature.App.Globals.Environment.Php.Version,
 
@@ -301,7 +301,7 @@ void t4p::TagViewClass::OnWorkingCacheComplete(t4p::WorkingCacheCompleteEventCla
 void t4p::TagViewClass::OnAppFileReverted(t4p::CodeControlEventClass& event) {
     t4p::CodeControlClass* codeControl = event.GetCodeControl();
     if (codeControl && codeControl->GetFileType() == t4p::FILE_TYPE_PHP) {
-        UnicodeString text = codeControl->GetSafeText();
+        t4p::CodeSnapshotClass snapshot = codeControl->GetSnapshot();
 
         // builder action could take a while (more than the timer)
         // stop the timer so that we dont queue up a builder actions before the previous one
@@ -314,7 +314,7 @@ void t4p::TagViewClass::OnAppFileReverted(t4p::CodeControlEventClass& event) {
             Feature.App.Globals,
             codeControl->GetFileName(),
             codeControl->GetIdString(),
-            text,
+            snapshot,
             codeControl->IsNew(),
             Feature.App.Globals.Environment.Php.Version,
 
@@ -352,7 +352,7 @@ void t4p::TagViewClass::OnTimerComplete(wxTimerEvent& event) {
         Feature.App.Globals,
         codeControl->GetFileName(),
         codeControl->GetIdString(),
-        codeControl->GetSafeText(),
+        codeControl->GetSnapshot(),
         codeControl->IsNew(),
         Feature.App.Globals.Environment.Php.Version,
         true);
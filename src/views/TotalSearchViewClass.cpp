@@ -55,6 +55,7 @@ void t4p::TotalSearchViewClass::AddKeyboardShortcuts(std::vector<DynamicCmdClass
 void t4p::TotalSearchViewClass::OnTotalSearch(wxCommandEvent& event) {
     std::vector<t4p::TotalTagResultClass> selectedTags;
     int lineNumber = 0;
+    Feature.LoadTables();
     t4p::TotalSearchDialogClass dialog(GetMainWindow(), Feature, selectedTags, lineNumber);
     if (wxOK == dialog.ShowModal() && !selectedTags.empty()) {
         for (size_t i = 0; i < selectedTags.size(); ++i) {
@@ -72,7 +73,7 @@ void t4p::TotalSearchViewClass::OnTotalSearch(wxCommandEvent& event) {
             case t4p::TotalTagResultClass::CLASS_TAG:
             case t4p::TotalTagResultClass::FUNCTION_TAG:
             case t4p::TotalTagResultClass::METHOD_TAG:
-                Feature.OpenPhpTag(result.PhpTag);
+                Feature.OpenPhpTag(result.PhpTag.Tag());
                 break;
             }
         }
@@ -213,9 +214,18 @@ void t4p::TotalSearchDialogClass::OnTimer(wxTimerEvent& event) {
     // trim spaces from the ends
     text.Trim(false).Trim(true);
     if (text != LastSearch && text.length() > 2) {
-        Timer.Stop();
         LastSearch = text;
 
+        // when the project tags are in memory the search is fast
+        // enough to be done right here
+        std::vector<t4p::TotalTagResultClass> results;
+        int lineNumber = 0;
+        if (Feature.FuzzySearch(text, results, lineNumber)) {
+            ShowResults(results, lineNumber);
+            return;
+        }
+        Timer.Stop();
+
         t4p::TotalTagSearchActionClass* action =
             new t4p::TotalTagSearchActionClass(RunningThreads, ID_TAG_SEARCH);
         action->SetSearch(Feature.App.Globals, text, Feature.App.Globals.AllEnabledSourceDirectories());
@@ -224,27 +234,32 @@ void t4p::TotalSearchDialogClass::OnTimer(wxTimerEvent& event) {
 }
 
 void t4p::TotalSearchDialogClass::OnSearchComplete(t4p::TotalTagSearchCompleteEventClass& event) {
+    ShowResults(event.Tags, event.LineNumber);
+    Timer.Start(300, wxTIMER_CONTINUOUS);
+}
+
+void t4p::TotalSearchDialogClass::ShowResults(const std::vector<t4p::TotalTagResultClass>& results, int lineNumber) {
     MatchesList->Clear();
-    Results = event.Tags;
-    LineNumber = event.LineNumber;
+    Results = results;
+    LineNumber = lineNumber;
 
     std::vector<t4p::TotalTagResultClass>::const_iterator tag;
     for (tag = Results.begin(); tag != Results.end(); ++tag) {
         wxString value;
         wxString desc;
         if (t4p::TotalTagResultClass::CLASS_TAG == tag->Type) {
-            value = t4p::IcuToWx(tag->PhpTag.ClassName);
-            desc = tag->PhpTag.FullPath;
+            value = t4p::IcuToWx(tag->PhpTag.ClassName());
+            desc = tag->PhpTag.FullPath();
         } else if (t4p::TotalTagResultClass::FILE_TAG == tag->Type) {
             value = tag->FileTag.Name();
             desc = tag->FileTag.FullPath;
         } else if (t4p::TotalTagResultClass::FUNCTION_TAG == tag->Type) {
-            value = t4p::IcuToWx(tag->PhpTag.Identifier);
-            desc = tag->PhpTag.FullPath;
+            value = t4p::IcuToWx(tag->PhpTag.Identifier());
+            desc = tag->PhpTag.FullPath();
         } else if (t4p::TotalTagResultClass::METHOD_TAG == tag->Type) {
-            value = t4p::IcuToWx(tag->PhpTag.ClassName) +
-                    wxT("::") + t4p::IcuToWx(tag->PhpTag.Identifier);
-            desc = tag->PhpTag.FullPath;
+            value = t4p::IcuToWx(tag->PhpTag.ClassName()) +
+                    wxT("::") + t4p::IcuToWx(tag->PhpTag.Identifier());
+            desc = tag->PhpTag.FullPath();
         } else if (t4p::TotalTagResultClass::TABLE_DATA_TAG == tag->Type) {
             t4p::DatabaseTagClass dbTag;
             Feature.App.Globals.FindDatabaseTagByHash(tag->TableTag.ConnectionHash, dbTag);
@@ -273,9 +288,8 @@ void t4p::TotalSearchDialogClass::OnSearchComplete(t4p::TotalTagSearchCompleteEv
     } else if (MatchesList->GetCount() == 1) {
         MatchesLabel->SetLabel(_("1 match found"));
     } else {
-        MatchesLabel->SetLabel(wxString::Format("%ld matches found", event.Tags.size()));
+        MatchesLabel->SetLabel(wxString::Format("%ld matches found", Results.size()));
     }
-    Timer.Start(300, wxTIMER_CONTINUOUS);
 }
 
 void t4p::TotalSearchDialogClass::ChooseSelectedAndEnd(size_t selected) {
@@ -75,6 +75,11 @@ class TotalSearchDialogClass : public TotalSearchDialogGeneratedClass {
     void OnSearchKeyDown(wxKeyEvent& event);
     void OnSearchComplete(t4p::TotalTagSearchCompleteEventClass& event);
 
+    /**
+     * fill the matches list with the given results
+     */
+    void ShowResults(const std::vector<t4p::TotalTagResultClass>& results, int lineNumber);
+
     /**
      * update the cache status label and internal flags
      */
@@ -134,4 +134,50 @@ SUITE(ProjectTagActionTestClass) {
         CHECK_UNISTR_EQUALS("Role", results->Tag.ClassName);
         delete results;
     }
+
+    TEST_FIXTURE(ProjectTagActionTestClass, MultipleFileActionShouldRetagChangedAndDeletedFiles) {
+        CreateSubDirectory(wxT("src_project_1"));
+        wxString userFile, roleFile, adminFile;
+        MAKE_FILENAME(userFile, wxT("src_project_1"), wxT("User.php"));
+        MAKE_FILENAME(roleFile, wxT("src_project_1"), wxT("Role.php"));
+        MAKE_FILENAME(adminFile, wxT("src_project_1"), wxT("Admin.php"));
+        CreateFixtureFile(userFile, wxT("<?php class User {}"));
+        CreateFixtureFile(roleFile, wxT("<?php class Role {}"));
+        CreateFixtureFile(adminFile, wxT("<?php class Admin {}"));
+        CHECK(ProjectTagAction.Init(Globals));
+        ProjectTagAction.BackgroundWork();
+
+        // change one file, delete another and leave the third alone
+        CreateFixtureFile(userFile, wxT("<?php class Customer {}"));
+        CHECK(wxRemoveFile(TestProjectDir + roleFile));
+        std::vector<wxString> files;
+        files.push_back(TestProjectDir + userFile);
+        files.push_back(TestProjectDir + roleFile);
+
+        t4p::ProjectTagMultipleFileActionClass multipleFileAction(RunningThreads, ID_EVENT);
+        multipleFileAction.SetFilesToParse(files);
+        CHECK(multipleFileAction.Init(Globals));
+        multipleFileAction.BackgroundWork();
+
+        t4p::TagSearchClass customerSearch(UNICODE_STRING_SIMPLE("Customer"));
+        t4p::TagResultClass* results = customerSearch.CreateExactResults();
+        CHECK(Finder.Exec(results));
+        delete results;
+
+        t4p::TagSearchClass userSearch(UNICODE_STRING_SIMPLE("User"));
+        results = userSearch.CreateExactResults();
+        CHECK_EQUAL(false, Finder.Exec(results));
+        delete results;
+
+        t4p::TagSearchClass roleSearch(UNICODE_STRING_SIMPLE("Role"));
+        results = roleSearch.CreateExactResults();
+        CHECK_EQUAL(false, Finder.Exec(results));
+        delete results;
+        CHECK_EQUAL(false, Finder.HasFullPath(TestProjectDir + roleFile));
+
+        t4p::TagSearchClass adminSearch(UNICODE_STRING_SIMPLE("Admin"));
+        results = adminSearch.CreateExactResults();
+        CHECK(Finder.Exec(results));
+        delete results;
+    }
 }
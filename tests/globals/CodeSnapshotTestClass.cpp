@@ -0,0 +1,70 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <string>
+#include "globals/CodeSnapshotClass.h"
+#include "TriumphChecks.h"
+
+SUITE(CodeSnapshotTestClass) {
+    TEST(GetTextShouldConvertUtf8) {
+        // "café" has a 2-byte character
+        std::string utf8 = "<?php $name = 'caf\xc3\xa9';";
+        t4p::CodeSnapshotClass snapshot(utf8.c_str(), utf8.length(), 4);
+        CHECK_EQUAL(4, snapshot.GetRevision());
+        CHECK_EQUAL((int)utf8.length(), snapshot.GetUtf8Length());
+
+        UnicodeString text = snapshot.GetText();
+        CHECK_EQUAL((int32_t)utf8.length() - 1, text.length());
+        CHECK_EQUAL((UChar)0xE9, text.charAt(text.length() - 3));
+    }
+
+    TEST(GetSubstringShouldUseByteOffsets) {
+        std::string utf8 = "caf\xc3\xa9 $name";
+        t4p::CodeSnapshotClass snapshot(utf8.c_str(), utf8.length(), 1);
+        CHECK_UNISTR_EQUALS("$name", snapshot.GetSubstring(6, utf8.length()));
+        CHECK_UNISTR_EQUALS("caf", snapshot.GetSubstring(0, 3));
+
+        // out of range offsets are clamped
+        CHECK_UNISTR_EQUALS("$name", snapshot.GetSubstring(6, 100));
+    }
+
+    TEST(CopiesShouldShareData) {
+        std::string utf8 = "<?php echo 1;";
+        t4p::CodeSnapshotClass snapshot(utf8.c_str(), utf8.length(), 2);
+        t4p::CodeSnapshotClass copy(snapshot);
+        t4p::CodeSnapshotClass assigned;
+        assigned = copy;
+        CHECK(snapshot.GetUtf8() == copy.GetUtf8());
+        CHECK(snapshot.GetUtf8() == assigned.GetUtf8());
+        CHECK(snapshot.GetText() == assigned.GetText());
+    }
+
+    TEST(EmptySnapshot) {
+        t4p::CodeSnapshotClass snapshot;
+        CHECK_EQUAL(-1, snapshot.GetRevision());
+        CHECK_EQUAL(0, snapshot.GetUtf8Length());
+        CHECK(snapshot.GetText().isEmpty());
+    }
+}
@@ -103,4 +103,54 @@ SUITE(SqliteTestClass) {
         int versionNumber = t4p::SqliteSchemaVersion(EmptySession);
         CHECK_EQUAL(2, versionNumber);
     }
+
+    TEST_FIXTURE(SqliteFixtureClass, IncrementalVacuumShouldFreePages) {
+        TouchTestDir();
+        wxFileName dbFileName(TestProjectDir, wxT("vacuum.db"));
+        if (dbFileName.FileExists()) {
+            wxRemoveFile(dbFileName.GetFullPath());
+        }
+        soci::session session(*soci::factory_sqlite3(), t4p::WxToChar(dbFileName.GetFullPath()));
+        session << "PRAGMA auto_vacuum = INCREMENTAL";
+        session << "CREATE TABLE my_table (id INT, name VARCHAR(255))";
+        std::string name(500, 'a');
+        session.begin();
+        for (int i = 0; i < 500; ++i) {
+            session << "INSERT INTO my_table(id, name) VALUES(?, ?)", soci::use(i), soci::use(name);
+        }
+        session.commit();
+        session << "DELETE FROM my_table";
+
+        int pageSize = 0;
+        int pageCount = 0;
+        int freePageCount = 0;
+        CHECK(t4p::SqlitePageCounts(session, pageSize, pageCount, freePageCount));
+        CHECK(freePageCount > 10);
+        int oldPageCount = pageCount;
+        int oldFreePageCount = freePageCount;
+
+        CHECK(t4p::SqliteIncrementalVacuum(session, 10));
+        CHECK(t4p::SqlitePageCounts(session, pageSize, pageCount, freePageCount));
+        CHECK_EQUAL(oldPageCount - 10, pageCount);
+        CHECK_EQUAL(oldFreePageCount - 10, freePageCount);
+        session.close();
+    }
+
+    TEST_FIXTURE(SqliteFixtureClass, SetIncrementalAutoVacuumShouldSwitchExistingDb) {
+        TouchTestDir();
+        wxFileName dbFileName(TestProjectDir, wxT("auto_vacuum.db"));
+        if (dbFileName.FileExists()) {
+            wxRemoveFile(dbFileName.GetFullPath());
+        }
+        soci::session session(*soci::factory_sqlite3(), t4p::WxToChar(dbFileName.GetFullPath()));
+        session << "CREATE TABLE my_table (id INT, name VARCHAR(255))";
+        int autoVacuum = -1;
+        session << "PRAGMA auto_vacuum", soci::into(autoVacuum);
+        CHECK_EQUAL(0, autoVacuum);
+
+        CHECK(t4p::SqliteSetIncrementalAutoVacuum(session));
+        session << "PRAGMA auto_vacuum", soci::into(autoVacuum);
+        CHECK_EQUAL(2, autoVacuum);
+        session.close();
+    }
 }
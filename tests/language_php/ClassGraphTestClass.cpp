@@ -0,0 +1,85 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <vector>
+#include "language_php/ClassGraphClass.h"
+#include "TriumphChecks.h"
+
+SUITE(ClassGraphTestClass) {
+TEST(ParentClassNameShouldBeCaseInsensitive) {
+    t4p::ClassGraphClass graph;
+    graph.AddClass(1, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("class AdminClass extends UserClass"));
+    UnicodeString parent;
+    CHECK(graph.ParentClassName(UNICODE_STRING_SIMPLE("adminclass"), parent));
+    CHECK_UNISTR_EQUALS("UserClass", parent);
+}
+
+TEST(ParentClassNameShouldBeEmptyForRootClass) {
+    t4p::ClassGraphClass graph;
+    graph.AddClass(1, UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("class UserClass"));
+    UnicodeString parent;
+    CHECK(graph.ParentClassName(UNICODE_STRING_SIMPLE("UserClass"), parent));
+    CHECK(parent.isEmpty());
+    CHECK_EQUAL(false, graph.ParentClassName(UNICODE_STRING_SIMPLE("RoleClass"), parent));
+}
+
+TEST(RemoveFilesShouldRemoveClassesAndTraits) {
+    t4p::ClassGraphClass graph;
+    graph.AddClass(1, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("class AdminClass extends UserClass"));
+    graph.AddTrait(1, 1, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("LoggableTrait"));
+    graph.AddClass(2, UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("class UserClass"));
+    CHECK_EQUAL((size_t)2, graph.Count());
+
+    std::vector<int> fileTagIds;
+    fileTagIds.push_back(1);
+    graph.RemoveFiles(fileTagIds);
+    CHECK_EQUAL((size_t)1, graph.Count());
+
+    UnicodeString parent;
+    CHECK_EQUAL(false, graph.ParentClassName(UNICODE_STRING_SIMPLE("AdminClass"), parent));
+    CHECK(graph.ParentClassName(UNICODE_STRING_SIMPLE("UserClass"), parent));
+
+    std::vector<int> sourceIds;
+    std::vector<UnicodeString> traits;
+    graph.Traits(UNICODE_STRING_SIMPLE("AdminClass"), sourceIds, traits);
+    CHECK_VECTOR_SIZE(0, traits);
+}
+
+TEST(TraitsShouldBeUniqueAndFilteredBySource) {
+    t4p::ClassGraphClass graph;
+    graph.AddTrait(1, 1, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("LoggableTrait"));
+    graph.AddTrait(1, 1, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("LoggableTrait"));
+    graph.AddTrait(1, 1, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("CacheableTrait"));
+    graph.AddTrait(3, 2, UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("OtherTrait"));
+
+    std::vector<int> sourceIds;
+    sourceIds.push_back(1);
+    std::vector<UnicodeString> traits;
+    graph.Traits(UNICODE_STRING_SIMPLE("adminClass"), sourceIds, traits);
+    CHECK_VECTOR_SIZE(2, traits);
+    CHECK_UNISTR_EQUALS("CacheableTrait", traits[0]);
+    CHECK_UNISTR_EQUALS("LoggableTrait", traits[1]);
+}
+}
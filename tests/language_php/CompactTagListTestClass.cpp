@@ -0,0 +1,126 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <vector>
+#include "language_php/CompactTagListClass.h"
+#include "TriumphChecks.h"
+
+static t4p::PhpTagClass MakeMethod(const UnicodeString& className, const UnicodeString& identifier) {
+    t4p::PhpTagClass tag;
+    tag.Type = t4p::PhpTagClass::METHOD;
+    tag.ClassName = className;
+    tag.Identifier = identifier;
+    tag.Key = identifier;
+    tag.NamespaceName = UNICODE_STRING_SIMPLE("\\");
+    tag.Signature = UNICODE_STRING_SIMPLE("public function ") + identifier + UNICODE_STRING_SIMPLE("($a)");
+    tag.IsStatic = true;
+    tag.LineNumber = 12;
+    tag.SetFullPath(wxT("/home/user/project/lib/UserClass.php"));
+    return tag;
+}
+
+SUITE(CompactTagListTestClass) {
+    TEST(AppendShouldRoundTripTag) {
+        t4p::CompactTagListClass tags;
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("getName")));
+        CHECK_EQUAL((size_t)1, tags.Size());
+
+        t4p::PhpTagClass tag = tags.Tag(0);
+        CHECK_EQUAL(t4p::PhpTagClass::METHOD, tag.Type);
+        CHECK_UNISTR_EQUALS("UserClass", tag.ClassName);
+        CHECK_UNISTR_EQUALS("getName", tag.Identifier);
+        CHECK_UNISTR_EQUALS("public function getName($a)", tag.Signature);
+        CHECK(tag.IsStatic);
+        CHECK(!tag.IsPrivate);
+        CHECK_EQUAL(12, tag.LineNumber);
+        CHECK_EQUAL(wxT("/home/user/project/lib/UserClass.php"), tag.GetFullPath());
+        CHECK(tags.HasParameters(0));
+    }
+
+    TEST(AppendShouldShareStrings) {
+        t4p::CompactTagListClass tags;
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("getName")));
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("setName")));
+        CHECK_EQUAL((size_t)2, tags.Size());
+
+        // same class name and path are stored once
+        CHECK(&tags.ClassName(0) == &tags.ClassName(1));
+        CHECK(&tags.FullPath(0) == &tags.FullPath(1));
+        CHECK_UNISTR_EQUALS("setName", tags.Identifier(1));
+    }
+
+    TEST(CopyShouldNotSeeLaterAppends) {
+        t4p::CompactTagListClass tags;
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("getName")));
+        t4p::CompactTagListClass copy(tags);
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("setName")));
+
+        CHECK_EQUAL((size_t)2, tags.Size());
+        CHECK_EQUAL((size_t)1, copy.Size());
+        CHECK_UNISTR_EQUALS("getName", copy.Identifier(0));
+    }
+
+    TEST(ViewShouldOutliveList) {
+        t4p::PhpTagViewClass view;
+        CHECK(!view.IsOk());
+        {
+            t4p::CompactTagListClass tags;
+            tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("getName")));
+            view = tags.View(0);
+        }
+        CHECK(view.IsOk());
+        CHECK_UNISTR_EQUALS("getName", view.Identifier());
+        CHECK_UNISTR_EQUALS("\\UserClass", view.FullyQualifiedClassName());
+    }
+
+    TEST(SortShouldOrderByKeyCaseInsensitive) {
+        t4p::CompactTagListClass tags;
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("setName")));
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("Delete")));
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("getName")));
+        tags.Sort();
+        CHECK_UNISTR_EQUALS("Delete", tags.Identifier(0));
+        CHECK_UNISTR_EQUALS("getName", tags.Identifier(1));
+        CHECK_UNISTR_EQUALS("setName", tags.Identifier(2));
+    }
+
+    TEST(AppendFromListShouldCopyTag) {
+        t4p::CompactTagListClass tags;
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("UserClass"), UNICODE_STRING_SIMPLE("getName")));
+        tags.Append(MakeMethod(UNICODE_STRING_SIMPLE("AdminClass"), UNICODE_STRING_SIMPLE("setName")));
+
+        t4p::CompactTagListClass visible;
+        visible.Append(tags, 1);
+        visible.SetIdentifier(0, UNICODE_STRING_SIMPLE("setAdminName"));
+        CHECK_EQUAL((size_t)1, visible.Size());
+        CHECK_UNISTR_EQUALS("AdminClass", visible.ClassName(0));
+        CHECK_UNISTR_EQUALS("setAdminName", visible.Identifier(0));
+        CHECK_EQUAL(wxT("/home/user/project/lib/UserClass.php"), visible.FullPath(0));
+        CHECK(visible.IsStatic(0));
+
+        // the source list is not changed
+        CHECK_UNISTR_EQUALS("setName", tags.Identifier(1));
+    }
+}
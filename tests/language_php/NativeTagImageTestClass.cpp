@@ -0,0 +1,276 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <soci/soci.h>
+#include <wx/filefn.h>
+#include <vector>
+#include "FileTestFixtureClass.h"
+#include "globals/Assets.h"
+#include "globals/String.h"
+#include "language_php/NativeTagImageClass.h"
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/TagParserClass.h"
+#include "SqliteTestFixtureClass.h"
+#include "TriumphChecks.h"
+
+/**
+ * Fixture that parses code into an in-memory db and writes the
+ * db into an image, so that image results can be compared against
+ * db results.
+ */
+class NativeTagImageTestFixtureClass : public FileTestFixtureClass, public SqliteTestFixtureClass {
+ public:
+    NativeTagImageTestFixtureClass()
+        : FileTestFixtureClass(wxT("native_tag_image"))
+        , SqliteTestFixtureClass(t4p::ResourceSqlSchemaAsset())
+        , TagParser()
+        , ParsedTagFinder(Session)
+        , Image()
+        , ImageFileName()
+        , Matches()
+        , DbMatches() {
+        TagParser.PhpFileExtensions.push_back(wxT("*.php"));
+        TagParser.Init(&Session);
+
+        // create the test dir, since FileTestFixture class is lazy
+        if (!wxDirExists(TestProjectDir)) {
+            wxMkdir(TestProjectDir, 0777);
+        }
+        ImageFileName.Assign(TestProjectDir, wxT("php.tagimage"));
+    }
+
+    void Prep(const UnicodeString& source) {
+        TagParser.BuildResourceCacheForFile(wxT(""), wxT("test.php"), source, true);
+    }
+
+    bool WriteAndOpen() {
+        wxString error;
+        return t4p::NativeTagImageClass::Write(Session, ImageFileName, error) && Image.Open(ImageFileName);
+    }
+
+    void NearMatchTags(const UnicodeString& search) {
+        t4p::TagSearchClass tagSearch(search);
+        Matches.clear();
+        Image.NearMatches(tagSearch, Matches);
+
+        t4p::TagResultClass* result = tagSearch.CreateNearMatchResults();
+        ParsedTagFinder.Exec(result);
+        DbMatches = result->Matches();
+        delete result;
+    }
+
+    void ExactMatchTags(const UnicodeString& search) {
+        t4p::TagSearchClass tagSearch(search);
+        Matches.clear();
+        Image.ExactMatches(tagSearch, Matches);
+
+        t4p::TagResultClass* result = tagSearch.CreateExactResults();
+        ParsedTagFinder.Exec(result);
+        DbMatches = result->Matches();
+        delete result;
+    }
+
+    size_t RowCount() {
+        int count = 0;
+        Session.once << "SELECT COUNT(*) FROM resources", soci::into(count);
+        return static_cast<size_t>(count);
+    }
+
+    t4p::TagParserClass TagParser;
+    t4p::ParsedTagFinderClass ParsedTagFinder;
+    t4p::NativeTagImageClass Image;
+    wxFileName ImageFileName;
+    std::vector<t4p::PhpTagClass> Matches;
+    std::vector<t4p::PhpTagClass> DbMatches;
+};
+
+SUITE(NativeTagImageTestClass) {
+TEST_FIXTURE(NativeTagImageTestFixtureClass, OpenShouldReadAllTags) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  function getName() {}\n"
+             "}\n"
+             "function userFunction() {}\n"));
+    CHECK(WriteAndOpen());
+    CHECK(Image.IsOpen());
+    CHECK(Image.Count() > 0);
+    CHECK_EQUAL(RowCount(), Image.Count());
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, OpenShouldRejectOtherFiles) {
+    wxFileName otherFileName(TestProjectDir, wxT("other.tagimage"));
+    CreateFixtureFile(wxT("other.tagimage"), wxT("this is not an image"));
+    CHECK_EQUAL(false, Image.Open(otherFileName));
+    CHECK_EQUAL(false, Image.IsOpen());
+    CHECK_EQUAL((size_t)0, Image.Count());
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, ExactMatchShouldFindMembers) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  private $name;\n"
+             "  /** the name */\n"
+             "  static function getName() { return $this->name; }\n"
+             "  function getNameLength() {}\n"
+             "}\n"));
+    CHECK(WriteAndOpen());
+    ExactMatchTags(UNICODE_STRING_SIMPLE("UserClass::getName"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+    if (!Matches.empty()) {
+        CHECK_UNISTR_EQUALS("getName", Matches[0].Identifier);
+        CHECK_UNISTR_EQUALS("UserClass", Matches[0].ClassName);
+        CHECK_EQUAL(t4p::PhpTagClass::METHOD, Matches[0].Type);
+        CHECK(Matches[0].IsStatic);
+        CHECK_UNISTR_EQUALS("/** the name */", Matches[0].Comment);
+    }
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, ExactMatchShouldNotFindMissingKeys) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"
+             "function userFunction() {}\n"));
+    CHECK(WriteAndOpen());
+    ExactMatchTags(UNICODE_STRING_SIMPLE("UserClas"));
+    CHECK_VECTOR_SIZE(0, Matches);
+    ExactMatchTags(UNICODE_STRING_SIMPLE("RoleClass"));
+    CHECK_VECTOR_SIZE(0, Matches);
+    ExactMatchTags(UNICODE_STRING_SIMPLE("userfunction"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, NearMatchShouldBeCaseInsensitive) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"
+             "class UserAdmin {}\n"
+             "class Role {}\n"
+             "function userFunction() {}\n"));
+    CHECK(WriteAndOpen());
+    NearMatchTags(UNICODE_STRING_SIMPLE("user"));
+    CHECK_VECTOR_SIZE(3, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, NearMatchShouldFindMembersWithoutClass) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  function getName() {}\n"
+             "}\n"
+             "class RoleClass {\n"
+             "  function getNameLength() {}\n"
+             "  function setName() {}\n"
+             "}\n"));
+    CHECK(WriteAndOpen());
+    NearMatchTags(UNICODE_STRING_SIMPLE("::getname"));
+    CHECK_VECTOR_SIZE(2, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, ParentClassNameShouldMatchDb) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"
+             "class AdminClass extends UserClass {}\n"));
+    CHECK(WriteAndOpen());
+    UnicodeString parent;
+    CHECK(Image.ParentClassName(UNICODE_STRING_SIMPLE("adminclass"), parent));
+    CHECK_UNISTR_EQUALS("UserClass", parent);
+    CHECK(parent == ParsedTagFinder.ParentClassName(UNICODE_STRING_SIMPLE("AdminClass"), 0));
+    CHECK(Image.ParentClassName(UNICODE_STRING_SIMPLE("UserClass"), parent));
+    CHECK(parent.isEmpty());
+    CHECK_EQUAL(false, Image.ParentClassName(UNICODE_STRING_SIMPLE("RoleClass"), parent));
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, ClassTraitsShouldMatchDb) {
+    TagParser.SetVersion(pelet::PHP_54);
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "trait ezcReflectionReturnInfo {\n"
+             "    function getReturnType() { }\n"
+             "}\n"
+             "trait ezcReflectionFunctionInfo {\n"
+             "    function getReturnType() { }\n"
+             "}\n"
+             "class ezcReflectionMethod {\n"
+             "    use ezcReflectionReturnInfo, ezcReflectionFunctionInfo {\n"
+             "      ezcReflectionReturnInfo::getReturnType as getFunctionReturnType;\n"
+             "    }\n"
+             "}\n"));
+    CHECK(WriteAndOpen());
+    std::vector<UnicodeString> traits;
+    Image.ClassTraits(UNICODE_STRING_SIMPLE("ezcReflectionMethod"), traits);
+    std::vector<wxFileName> sourceDirs;
+    std::vector<UnicodeString> dbTraits = ParsedTagFinder.GetResourceTraits(
+        UNICODE_STRING_SIMPLE("ezcReflectionMethod"), UNICODE_STRING_SIMPLE(""), sourceDirs);
+    CHECK_VECTOR_SIZE(2, traits);
+    CHECK(dbTraits == traits);
+}
+
+TEST_FIXTURE(NativeTagImageTestFixtureClass, TraitAliasesShouldMatchDb) {
+    TagParser.SetVersion(pelet::PHP_54);
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "trait ezcReflectionReturnInfo {\n"
+             "    function getReturnType() { }\n"
+             "}\n"
+             "trait ezcReflectionFunctionInfo {\n"
+             "    function getReturnType() { }\n"
+             "}\n"
+             "class ezcReflectionMethod {\n"
+             "    use ezcReflectionReturnInfo, ezcReflectionFunctionInfo {\n"
+             "      ezcReflectionReturnInfo::getReturnType as getFunctionReturnType;\n"
+             "    }\n"
+             "}\n"));
+    CHECK(WriteAndOpen());
+    std::vector<UnicodeString> classNames;
+    std::vector<wxFileName> sourceDirs;
+    classNames.push_back(UNICODE_STRING_SIMPLE("ezcReflectionMethod"));
+    Image.TraitAliases(classNames, UNICODE_STRING_SIMPLE("getFunction"), false, Matches);
+
+    t4p::TraitTagResultClass result;
+    result.Set(classNames, UNICODE_STRING_SIMPLE("getFunction"), false, sourceDirs);
+    ParsedTagFinder.Exec(&result);
+    DbMatches = result.MatchesAsTags();
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+    if (!Matches.empty()) {
+        CHECK_UNISTR_EQUALS("ezcReflectionReturnInfo", Matches[0].ClassName);
+        CHECK_UNISTR_EQUALS("getFunctionReturnType", Matches[0].Identifier);
+    }
+
+    Matches.clear();
+    Image.TraitAliases(classNames, UNICODE_STRING_SIMPLE("getFunctionReturnType"), true, Matches);
+    CHECK_VECTOR_SIZE(1, Matches);
+    Matches.clear();
+    Image.TraitAliases(classNames, UNICODE_STRING_SIMPLE("getFunction"), true, Matches);
+    CHECK_VECTOR_SIZE(0, Matches);
+}
+}
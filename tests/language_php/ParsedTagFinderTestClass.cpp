@@ -703,6 +703,7 @@ SUITE(ParsedTagFinderTestClass) {
     TEST_FIXTURE(ParsedTagFinderMemoryTestClass, NearMatchTagsShouldFindMatchesForNativeFunctions) {
         Session.close();
         Session.open(*soci::factory_sqlite3(), t4p::WxToChar(t4p::NativeFunctionsAsset().GetFullPath()));
+        CHECK(ParsedTagFinder.InitNativeDb());
 
         NearMatchTags(UNICODE_STRING_SIMPLE("array_key"));
         CHECK_VECTOR_SIZE(2, Matches);
@@ -1404,6 +1405,76 @@ SUITE(ParsedTagFinderTestClass) {
         CHECK_EQUAL(19, length);
     }
 
+    TEST_FIXTURE(ParsedTagFinderMemoryTestClass, GetResourceMatchPositionShouldUseLineNumber) {
+        UnicodeString icuCode = t4p::CharToIcu(
+                                    "<?php\n"
+                                    "class UserClass {\n"
+                                    "\tfunction getName() {}\n"
+                                    "}\n"
+                                    "class AdminClass {\n"
+                                    "\n"
+                                    "\n"
+                                    "\n"
+                                    "\tfunction getName() {}\n"
+                                    "}\n");
+        int32_t pos = 0,
+                length = 0;
+        t4p::PhpTagClass tag;
+        tag.Type = t4p::PhpTagClass::METHOD;
+        tag.ClassName = UNICODE_STRING_SIMPLE("AdminClass");
+        tag.Identifier = UNICODE_STRING_SIMPLE("getName");
+        tag.LineNumber = 9;
+        CHECK(t4p::ParsedTagFinderClass::GetResourceMatchPosition(tag, icuCode, pos, length));
+        CHECK_EQUAL(icuCode.lastIndexOf(UNICODE_STRING_SIMPLE("function getName()")), pos);
+        CHECK_EQUAL(17, length);
+
+        // line number is past the end of the text, the tag should still
+        // be found by searching the entire text
+        tag.LineNumber = 40;
+        pos = 0;
+        length = 0;
+        CHECK(t4p::ParsedTagFinderClass::GetResourceMatchPosition(tag, icuCode, pos, length));
+        CHECK_EQUAL(icuCode.lastIndexOf(UNICODE_STRING_SIMPLE("function getName()")), pos);
+        CHECK_EQUAL(17, length);
+    }
+
+    TEST_FIXTURE(ParsedTagFinderMemoryTestClass, GetResourceMatchPositionShouldSkipToClassNearLineNumber) {
+        UnicodeString icuCode = t4p::CharToIcu(
+                                    "<?php\n"
+                                    "function getName() {}\n"
+                                    "class AdminClass {\n"
+                                    "\tfunction getName() {}\n"
+                                    "}\n");
+        int32_t pos = 0,
+                length = 0;
+        t4p::PhpTagClass tag;
+        tag.Type = t4p::PhpTagClass::METHOD;
+        tag.ClassName = UNICODE_STRING_SIMPLE("AdminClass");
+        tag.Identifier = UNICODE_STRING_SIMPLE("getName");
+        tag.LineNumber = 4;
+        CHECK(t4p::ParsedTagFinderClass::GetResourceMatchPosition(tag, icuCode, pos, length));
+        CHECK_EQUAL(icuCode.lastIndexOf(UNICODE_STRING_SIMPLE("function getName()")), pos);
+        CHECK_EQUAL(17, length);
+    }
+
+    TEST_FIXTURE(ParsedTagFinderMemoryTestClass, ExactMatchesShouldHaveLineNumbers) {
+        Prep(t4p::CharToIcu(
+                 "<?php\n"
+                 "class UserClass {\n"
+                 "\n"
+                 "\tfunction getName() {}\n"
+                 "}\n"));
+        t4p::TagSearchClass tagSearch(UNICODE_STRING_SIMPLE("UserClass::getName"));
+        t4p::TagResultClass* result = tagSearch.CreateExactResults();
+        ParsedTagFinder.Exec(result);
+        Matches = result->Matches();
+        delete result;
+        CHECK_VECTOR_SIZE(1, Matches);
+        if (!Matches.empty()) {
+            CHECK(Matches[0].LineNumber > 0);
+        }
+    }
+
     TEST_FIXTURE(ParsedTagFinderMemoryTestClass, CollectQualifiedResourceNamespaces) {
         Prep(t4p::CharToIcu(
                  "<?php\n"
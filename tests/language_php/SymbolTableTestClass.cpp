@@ -172,10 +172,19 @@ class ScopeFinderTestClass {
  public:
     t4p::ScopeFinderClass ScopeFinder;
     pelet::ScopeClass Scope;
+    t4p::ScopeMapClass ScopeMap;
 
     ScopeFinderTestClass()
         : ScopeFinder()
-        , Scope() {
+        , Scope()
+        , ScopeMap() {
+    }
+
+    void BuildScopeMap(const UnicodeString& sourceCode) {
+        t4p::SymbolTableClass emptyTable;
+        t4p::SymbolTableClass symbolTable;
+        symbolTable.CreateSymbols(sourceCode, emptyTable);
+        symbolTable.BuildScopeMap(ScopeMap);
     }
 };
 
@@ -293,6 +302,149 @@ SUITE(SymbolTableTestClass) {
         CHECK_EQUAL(UNICODE_STRING_SIMPLE("workB"), ResourceMatches[1].Identifier);
     }
 
+    TEST_FIXTURE(SymbolTableCompletionTestClass, UpdateSymbolsShouldReparseEditedMethod) {
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "class UserClass {\n"
+                                       "  function workA() { $nameOne = 1; }\n"
+                                       "  function workB() { $nameTwo = 2; }\n"
+                                       "}\n"
+                                       "$globalOne = 1;\n");
+        Init(sourceCode);
+
+        // add a variable to workA
+        UnicodeString editedSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "class UserClass {\n"
+                                             "  function workA() { $nameOne = 1; $nameThree = 3; }\n"
+                                             "  function workB() { $nameTwo = 2; }\n"
+                                             "}\n"
+                                             "$globalOne = 1;\n");
+        t4p::SymbolTableClass updatedSymbolTable;
+        CHECK(updatedSymbolTable.UpdateSymbols(editedSourceCode, CompletionSymbolTable));
+
+        ToVariable(UNICODE_STRING_SIMPLE("$name"));
+        Scope.ClassName = UNICODE_STRING_SIMPLE("UserClass");
+        Scope.MethodName = UNICODE_STRING_SIMPLE("workA");
+        updatedSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(2, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameOne"), VariableMatches[0]);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameThree"), VariableMatches[1]);
+
+        // the other method and the global scope should keep their symbols
+        VariableMatches.clear();
+        Scope.MethodName = UNICODE_STRING_SIMPLE("workB");
+        updatedSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(1, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameTwo"), VariableMatches[0]);
+
+        VariableMatches.clear();
+        Scope.Clear();
+        ToVariable(UNICODE_STRING_SIMPLE("$global"));
+        updatedSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(1, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$globalOne"), VariableMatches[0]);
+    }
+
+    TEST_FIXTURE(SymbolTableCompletionTestClass, UpdateSymbolsShouldRemoveDeletedVariables) {
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "function workA() { $nameOne = 1; $nameTwo = 2; }\n"
+                                       "function workB() { $nameThree = 3; }\n");
+        Init(sourceCode);
+        UnicodeString editedSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "function workA() { $nameOne = 1; }\n"
+                                             "function workB() { $nameThree = 3; }\n");
+        t4p::SymbolTableClass updatedSymbolTable;
+        CHECK(updatedSymbolTable.UpdateSymbols(editedSourceCode, CompletionSymbolTable));
+
+        // a second edit should work off of the updated table
+        UnicodeString secondSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "function workA() { $nameOne = 1; }\n"
+                                             "function workB() { $nameThree = 3; $nameFour = 4; }\n");
+        t4p::SymbolTableClass secondSymbolTable;
+        CHECK(secondSymbolTable.UpdateSymbols(secondSourceCode, updatedSymbolTable));
+
+        ToVariable(UNICODE_STRING_SIMPLE("$name"));
+        Scope.MethodName = UNICODE_STRING_SIMPLE("workA");
+        secondSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(1, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameOne"), VariableMatches[0]);
+
+        VariableMatches.clear();
+        Scope.MethodName = UNICODE_STRING_SIMPLE("workB");
+        secondSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(2, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameThree"), VariableMatches[0]);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameFour"), VariableMatches[1]);
+    }
+
+    TEST_FIXTURE(SymbolTableCompletionTestClass, UpdateSymbolsShouldNotModifyPreviousTable) {
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "function workA() { $nameOne = 1; }\n"
+                                       "function workB() { $nameTwo = 2; }\n");
+        Init(sourceCode);
+
+        // the copy shares the scopes of the completion table
+        t4p::SymbolTableClass copiedSymbolTable;
+        copiedSymbolTable.Copy(CompletionSymbolTable);
+        UnicodeString editedSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "function workA() { $nameOne = 1; $nameThree = 3; }\n"
+                                             "function workB() { $nameTwo = 2; }\n");
+        CHECK(CompletionSymbolTable.UpdateSymbols(editedSourceCode, copiedSymbolTable));
+
+        ToVariable(UNICODE_STRING_SIMPLE("$name"));
+        Scope.MethodName = UNICODE_STRING_SIMPLE("workA");
+        CompletionSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(2, VariableMatches);
+
+        VariableMatches.clear();
+        copiedSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(1, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameOne"), VariableMatches[0]);
+
+        VariableMatches.clear();
+        Scope.MethodName = UNICODE_STRING_SIMPLE("workB");
+        CompletionSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(1, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$nameTwo"), VariableMatches[0]);
+    }
+
+    TEST_FIXTURE(SymbolTableCompletionTestClass, UpdateSymbolsWithGlobalEdit) {
+        // edits outside of a function should re-build the entire table
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "function workA() { $nameOne = 1; }\n"
+                                       "$globalOne = 1;\n");
+        Init(sourceCode);
+        UnicodeString editedSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "function workA() { $nameOne = 1; }\n"
+                                             "$globalOne = 1;\n"
+                                             "$globalTwo = 2;\n");
+        t4p::SymbolTableClass updatedSymbolTable;
+        CHECK(updatedSymbolTable.UpdateSymbols(editedSourceCode, CompletionSymbolTable));
+
+        ToVariable(UNICODE_STRING_SIMPLE("$global"));
+        updatedSymbolTable.ExpressionCompletionMatches(ParsedVariable, Scope, SourceDirs, TagFinderList,
+                VariableMatches, ResourceMatches, DoDuckTyping, Error);
+        CHECK_VECTOR_SIZE(2, VariableMatches);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$globalOne"), VariableMatches[0]);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("$globalTwo"), VariableMatches[1]);
+    }
+
     TEST_FIXTURE(SymbolTableCompletionTestClass, MatchesWithMethodCall) {
         UnicodeString sourceCode = t4p::CharToIcu(
                                        "<?php\n"
@@ -1343,4 +1495,85 @@ SUITE(SymbolTableTestClass) {
         CHECK(Scope.IsAnonymousScope());
         CHECK_EQUAL(0, Scope.GetAnonymousFunctionCount());
     }
+
+    TEST_FIXTURE(ScopeFinderTestClass, ScopeMapShouldFindMethodScope) {
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "namespace First\\Child;\n"
+                                       "use PDOException as PE;\n"
+                                       "class UserClass {\n"
+                                       "\tfunction getName() {\n"
+                                       "\t\treturn $this->name;\n"
+                                       "\t}\n"
+                                       "\tfunction setName($anotherName) {\n"
+                                       "\t\t{CURSOR} "
+                                       "\t\t$someName = '';\n"
+                                       "\t}\n"
+                                       "}\n");
+        int32_t pos;
+        sourceCode = FindCursor(sourceCode, pos);
+        BuildScopeMap(sourceCode);
+        CHECK(ScopeMap.GetScope(sourceCode, pos, Scope));
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("UserClass"), Scope.ClassName);
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("setName"), Scope.MethodName);
+        CHECK_UNISTR_EQUALS("\\First\\Child", Scope.NamespaceName);
+        CHECK_UNISTR_EQUALS("\\PDOException", Scope.ResolveAlias(UNICODE_STRING_SIMPLE("PE")));
+        CHECK_UNISTR_EQUALS("\\First\\Child", Scope.ResolveAlias(UNICODE_STRING_SIMPLE("namespace")));
+    }
+
+    TEST_FIXTURE(ScopeFinderTestClass, ScopeMapShouldShiftScopesAfterEdit) {
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "function workA() { $nameOne = 1; }\n"
+                                       "function workB() { $nameTwo = 2; }\n"
+                                       "$globalOne = 1;\n");
+        BuildScopeMap(sourceCode);
+
+        // the edit makes workA longer; positions in workB and in the
+        // global scope must be shifted
+        UnicodeString editedSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "function workA() { $nameOne = 1; $nameThree = 3; }\n"
+                                             "function workB() { $nameTwo = 2;{CURSOR} }\n"
+                                             "$globalOne = 1;\n");
+        int32_t pos;
+        editedSourceCode = FindCursor(editedSourceCode, pos);
+        CHECK(ScopeMap.GetScope(editedSourceCode, pos, Scope));
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("workB"), Scope.MethodName);
+
+        Scope.Clear();
+        CHECK(ScopeMap.GetScope(editedSourceCode, editedSourceCode.length() - 1, Scope));
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE(""), Scope.MethodName);
+
+        // the position inside of the edit
+        Scope.Clear();
+        CHECK(ScopeMap.GetScope(editedSourceCode, editedSourceCode.indexOf(UNICODE_STRING_SIMPLE("$nameThree")), Scope));
+        CHECK_EQUAL(UNICODE_STRING_SIMPLE("workA"), Scope.MethodName);
+    }
+
+    TEST_FIXTURE(ScopeFinderTestClass, ScopeMapShouldNotFindScopeWhenEditAddsFunction) {
+        UnicodeString sourceCode = t4p::CharToIcu(
+                                       "<?php\n"
+                                       "function workA() { $nameOne = 1; }\n"
+                                       "function workB() { $nameTwo = 2; }\n");
+        BuildScopeMap(sourceCode);
+        UnicodeString editedSourceCode = t4p::CharToIcu(
+                                             "<?php\n"
+                                             "function workA() { $nameOne = 1; }\n"
+                                             "function workC() { $nameThree = 3; }\n"
+                                             "function workB() { $nameTwo = 2;{CURSOR} }\n");
+        int32_t pos;
+        editedSourceCode = FindCursor(editedSourceCode, pos);
+        CHECK_EQUAL(false, ScopeMap.GetScope(editedSourceCode, pos, Scope));
+
+        // closures need the scope finder
+        UnicodeString closureSourceCode = t4p::CharToIcu(
+                                              "<?php\n"
+                                              "function workA() {\n"
+                                              "  call_user_func(function() { $nameOne = 1; {CURSOR} });\n"
+                                              "}\n");
+        closureSourceCode = FindCursor(closureSourceCode, pos);
+        BuildScopeMap(closureSourceCode);
+        CHECK_EQUAL(false, ScopeMap.GetScope(closureSourceCode, pos, Scope));
+    }
 }
@@ -246,10 +246,11 @@ SUITE(TagCacheTestClass) {
         TagCache.RegisterGlobal(cache2);
 
         ToProperty(UNICODE_STRING_SIMPLE("$action"), UNICODE_STRING_SIMPLE("w"));
+        t4p::CompactTagListClass tagMatches;
         TagCache.ExpressionCompletionMatches(File2, ParsedVariable, Scope, SourceDirs,
-                                             VariableMatches, TagMatches, DoDuckTyping, Error);
-        CHECK_VECTOR_SIZE(1, TagMatches);
-        CHECK_UNISTR_EQUALS("w", TagMatches[0].Identifier);
+                                             VariableMatches, tagMatches, DoDuckTyping, Error);
+        CHECK_EQUAL((size_t)1, tagMatches.Size());
+        CHECK_UNISTR_EQUALS("w", tagMatches.Identifier(0));
     }
 
     TEST_FIXTURE(ExpressionCompletionMatchesFixtureClass, TagMatchesWithTagFinderList) {
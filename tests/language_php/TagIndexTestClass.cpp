@@ -0,0 +1,446 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <soci/soci.h>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "globals/Assets.h"
+#include "globals/String.h"
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/TagIndexClass.h"
+#include "language_php/TagParserClass.h"
+#include "SqliteTestFixtureClass.h"
+#include "TriumphChecks.h"
+
+/**
+ * Fixture that parses code into an in-memory db, so that
+ * index results can be compared against db results.
+ */
+class TagIndexTestFixtureClass : public SqliteTestFixtureClass {
+ public:
+    TagIndexTestFixtureClass()
+        : SqliteTestFixtureClass(t4p::ResourceSqlSchemaAsset())
+        , TagParser()
+        , ParsedTagFinder(Session)
+        , TagIndex()
+        , TestFile(wxT("test.php"))
+        , Matches()
+        , DbMatches() {
+        TagParser.PhpFileExtensions.push_back(wxT("*.php"));
+        TagParser.Init(&Session);
+    }
+
+    void Prep(const UnicodeString& source) {
+        TagParser.BuildResourceCacheForFile(wxT(""), TestFile, source, true);
+    }
+
+    void NearMatchTags(const UnicodeString& search) {
+        t4p::TagSearchClass tagSearch(search);
+        Matches.clear();
+        TagIndex.NearMatches(tagSearch, Matches);
+
+        t4p::TagResultClass* result = tagSearch.CreateNearMatchResults();
+        ParsedTagFinder.Exec(result);
+        DbMatches = result->Matches();
+        delete result;
+    }
+
+    void ExactMatchTags(const UnicodeString& search) {
+        t4p::TagSearchClass tagSearch(search);
+        Matches.clear();
+        TagIndex.ExactMatches(tagSearch, Matches);
+
+        t4p::TagResultClass* result = tagSearch.CreateExactResults();
+        ParsedTagFinder.Exec(result);
+        DbMatches = result->Matches();
+        delete result;
+    }
+
+    size_t RowCount() {
+        int count = 0;
+        Session.once << "SELECT COUNT(*) FROM resources", soci::into(count);
+        return static_cast<size_t>(count);
+    }
+
+    t4p::TagParserClass TagParser;
+    t4p::ParsedTagFinderClass ParsedTagFinder;
+    t4p::TagIndexClass TagIndex;
+    wxString TestFile;
+    std::vector<t4p::PhpTagClass> Matches;
+    std::vector<t4p::PhpTagClass> DbMatches;
+};
+
+SUITE(TagIndexTestClass) {
+TEST_FIXTURE(TagIndexTestFixtureClass, LoadShouldReadAllTags) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  function getName() {}\n"
+             "}\n"
+             "function userFunction() {}\n"));
+    CHECK(TagIndex.Load(Session));
+    CHECK(TagIndex.IsLoaded());
+    CHECK(TagIndex.Count() > 0);
+    CHECK_EQUAL(RowCount(), TagIndex.Count());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, NearMatchShouldBeCaseInsensitive) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"
+             "class UserAdmin {}\n"
+             "class Role {}\n"
+             "function userFunction() {}\n"));
+    CHECK(TagIndex.Load(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("user"));
+    CHECK_VECTOR_SIZE(3, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+    for (size_t i = 0; i < Matches.size() && i < DbMatches.size(); ++i) {
+        CHECK_EQUAL(DbMatches[i].Identifier, Matches[i].Identifier);
+        CHECK_EQUAL(DbMatches[i].Id, Matches[i].Id);
+        CHECK_EQUAL(DbMatches[i].FullPath, Matches[i].FullPath);
+    }
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, ExactMatchShouldFindMembers) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  private $name;\n"
+             "  /** the name */\n"
+             "  static function getName() { return $this->name; }\n"
+             "  function getNameLength() {}\n"
+             "}\n"));
+    CHECK(TagIndex.Load(Session));
+    ExactMatchTags(UNICODE_STRING_SIMPLE("UserClass::getName"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+    if (!Matches.empty()) {
+        CHECK_UNISTR_EQUALS("getName", Matches[0].Identifier);
+        CHECK_UNISTR_EQUALS("UserClass", Matches[0].ClassName);
+        CHECK_EQUAL(t4p::PhpTagClass::METHOD, Matches[0].Type);
+        CHECK(Matches[0].IsStatic);
+        CHECK_UNISTR_EQUALS("/** the name */", Matches[0].Comment);
+    }
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, ExactMatchShouldHaveLineNumbers) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  function getName() {}\n"
+             "}\n"));
+    CHECK(TagIndex.Load(Session));
+    ExactMatchTags(UNICODE_STRING_SIMPLE("UserClass::getName"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    if (!Matches.empty()) {
+        CHECK(Matches[0].LineNumber > 0);
+    }
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, CompactMatchesShouldBeSameAsTags) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  protected $name;\n"
+             "  static function getName() {}\n"
+             "  function getNameLength() {}\n"
+             "}\n"));
+    CHECK(TagIndex.Load(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("UserClass::getN"));
+    t4p::TagSearchClass tagSearch(UNICODE_STRING_SIMPLE("UserClass::getN"));
+    t4p::CompactTagListClass compactMatches;
+    TagIndex.NearMatches(tagSearch, compactMatches);
+    CHECK_VECTOR_SIZE(2, Matches);
+    CHECK_EQUAL(Matches.size(), compactMatches.Size());
+    for (size_t i = 0; i < Matches.size() && i < compactMatches.Size(); ++i) {
+        t4p::PhpTagClass tag = compactMatches.Tag(i);
+        CHECK_EQUAL(Matches[i].Key, tag.Key);
+        CHECK_EQUAL(Matches[i].Id, tag.Id);
+        CHECK_EQUAL(Matches[i].FullPath, tag.FullPath);
+        CHECK_EQUAL(Matches[i].IsStatic, tag.IsStatic);
+        CHECK_EQUAL(Matches[i].FileIsNew, tag.FileIsNew);
+        CHECK_EQUAL(Matches[i].LineNumber, tag.LineNumber);
+    }
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, NearMatchShouldFindMembersWithoutClass) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {\n"
+             "  function getName() {}\n"
+             "}\n"
+             "class RoleClass {\n"
+             "  function getNameLength() {}\n"
+             "  function setName() {}\n"
+             "}\n"));
+    CHECK(TagIndex.Load(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("::getname"));
+    CHECK_VECTOR_SIZE(2, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, RefreshShouldReadReparsedFiles) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+
+    // re-parsing the file should remove the old tags from the
+    // index and add the new ones
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class AdminClass {}\n"));
+    CHECK(TagIndex.Refresh(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("UserClass"));
+    CHECK_VECTOR_SIZE(0, Matches);
+    NearMatchTags(UNICODE_STRING_SIMPLE("AdminClass"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+    if (!Matches.empty() && !DbMatches.empty()) {
+        CHECK_EQUAL(DbMatches[0].Id, Matches[0].Id);
+    }
+    CHECK_EQUAL(RowCount(), TagIndex.Count());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, NearMatchShouldFindKeysLongerThanTrie) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class AbstractControllerBase {}\n"
+             "class AbstractControllerFactory {}\n"
+             "class AbstractModel {}\n"));
+    CHECK(TagIndex.Load(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("abstractCONTROLLERf"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_UNISTR_EQUALS("AbstractControllerFactory", Matches[0].Identifier);
+    NearMatchTags(UNICODE_STRING_SIMPLE("AbstractController"));
+    CHECK_VECTOR_SIZE(2, Matches);
+    CHECK_EQUAL(DbMatches.size(), Matches.size());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, NearMatchNonMembersShouldFilterTypes) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"
+             "function userFunction() {}\n"
+             "define('USER_CONSTANT', 1);\n"));
+    CHECK(TagIndex.Load(Session));
+    std::vector<int> types;
+    types.push_back(t4p::PhpTagClass::FUNCTION);
+    std::vector<wxFileName> sourceDirs;
+    TagIndex.NearMatchNonMembers(UNICODE_STRING_SIMPLE("user"), types, sourceDirs, Matches);
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_UNISTR_EQUALS("userFunction", Matches[0].Identifier);
+
+    // no methods start with user
+    Matches.clear();
+    TagIndex.NearMatchMembersOnly(UNICODE_STRING_SIMPLE("user"), sourceDirs, Matches);
+    CHECK_VECTOR_SIZE(0, Matches);
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, AllMembersShouldNotBeLimited) {
+    std::string code = "<?php\nclass BigClass {\n";
+    for (int i = 0; i < 150; ++i) {
+        std::ostringstream stream;
+        stream << "  function method" << i << "() {}\n";
+        code += stream.str();
+    }
+    code += "}\n";
+    Prep(t4p::CharToIcu(code.c_str()));
+    CHECK(TagIndex.Load(Session));
+    std::vector<UnicodeString> classNames;
+    classNames.push_back(UNICODE_STRING_SIMPLE("BigClass"));
+    std::vector<wxFileName> sourceDirs;
+    TagIndex.AllMembers(classNames, sourceDirs, Matches);
+    CHECK_VECTOR_SIZE(150, Matches);
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, FuzzyMatchesShouldFindEachTagOnce) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "namespace First;\n"
+             "class UserClass {\n"
+             "  function getName() {}\n"
+             "}\n"
+             "function userFunction() {}\n"));
+    CHECK(TagIndex.Load(Session));
+    std::vector<wxFileName> sourceDirs;
+    std::vector<t4p::FuzzyMatchClass> fuzzyMatches;
+    TagIndex.FuzzyMatches(UNICODE_STRING_SIMPLE("usrcls"), sourceDirs, 10, fuzzyMatches);
+
+    // the class and the method (UserClass::getName)
+    CHECK_VECTOR_SIZE(2, fuzzyMatches);
+    CHECK_EQUAL(t4p::TagIndexClass::FUZZY_TAG, fuzzyMatches[0].Kind);
+    CHECK_UNISTR_EQUALS("UserClass", TagIndex.FuzzyMatchTag(fuzzyMatches[0]).Identifier);
+
+    // methods are matched along with their class
+    TagIndex.FuzzyMatches(UNICODE_STRING_SIMPLE("usrgtnm"), sourceDirs, 10, fuzzyMatches);
+    CHECK_VECTOR_SIZE(1, fuzzyMatches);
+    CHECK_UNISTR_EQUALS("getName", TagIndex.FuzzyMatchTag(fuzzyMatches[0]).Identifier);
+
+    TagIndex.FuzzyMatches(UNICODE_STRING_SIMPLE("tstphp"), sourceDirs, 10, fuzzyMatches);
+    CHECK_VECTOR_SIZE(1, fuzzyMatches);
+    CHECK_EQUAL(t4p::TagIndexClass::FUZZY_FILE, fuzzyMatches[0].Kind);
+    CHECK_EQUAL(TestFile, TagIndex.FuzzyMatchFile(fuzzyMatches[0]).FullPath);
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, ClassHierarchyShouldMatchDb) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "namespace First;\n"
+             "trait LoggableTrait {}\n"
+             "trait CacheableTrait { use LoggableTrait; }\n"
+             "class UserClass {}\n"
+             "class AdminClass extends UserClass {\n"
+             "  use CacheableTrait;\n"
+             "}\n"));
+    CHECK(TagIndex.Load(Session));
+    UnicodeString parent;
+    CHECK(TagIndex.ParentClassName(UNICODE_STRING_SIMPLE("\\First\\AdminClass"), parent));
+    CHECK_UNISTR_EQUALS(ParsedTagFinder.ParentClassName(UNICODE_STRING_SIMPLE("\\First\\AdminClass"), 0), parent);
+    CHECK(!parent.isEmpty());
+
+    CHECK(TagIndex.ParentClassName(UNICODE_STRING_SIMPLE("\\First\\UserClass"), parent));
+    CHECK(parent.isEmpty());
+
+    std::vector<wxFileName> sourceDirs;
+    std::vector<UnicodeString> traits;
+    TagIndex.ClassTraits(UNICODE_STRING_SIMPLE("\\First\\AdminClass"), sourceDirs, traits);
+    std::vector<UnicodeString> dbTraits = ParsedTagFinder.GetResourceTraits(UNICODE_STRING_SIMPLE("\\First\\AdminClass"),
+                                          UNICODE_STRING_SIMPLE(""), sourceDirs);
+    CHECK_VECTOR_SIZE(1, traits);
+    CHECK_EQUAL(dbTraits.size(), traits.size());
+    CHECK_UNISTR_EQUALS("CacheableTrait", traits[0]);
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, ClassHierarchyShouldBeUpdatedWhenFileIsReparsed) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"
+             "class AdminClass extends UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+    int generation = TagIndex.Generation();
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class RoleClass {}\n"
+             "class AdminClass extends RoleClass {}\n"));
+    CHECK(TagIndex.Refresh(Session));
+    CHECK(TagIndex.Generation() != generation);
+    UnicodeString parent;
+    CHECK(TagIndex.ParentClassName(UNICODE_STRING_SIMPLE("AdminClass"), parent));
+    CHECK_UNISTR_EQUALS("RoleClass", parent);
+    CHECK_EQUAL(false, TagIndex.ParentClassName(UNICODE_STRING_SIMPLE("UserClass"), parent));
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, RefreshShouldNotChangeIndexWhenNothingWasWritten) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+    int generation = TagIndex.Generation();
+    CHECK(TagIndex.Refresh(Session));
+    CHECK_EQUAL(generation, TagIndex.Generation());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, RefreshShouldRemoveDeletedFiles) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+    TagParser.DeleteFromFile(TestFile);
+    CHECK(TagIndex.Refresh(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("UserClass"));
+    CHECK_VECTOR_SIZE(0, Matches);
+    CHECK_EQUAL(RowCount(), TagIndex.Count());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, RefreshShouldReloadAfterWipe) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+    TagParser.WipeAll();
+    CHECK(TagIndex.Refresh(Session));
+    CHECK_EQUAL((size_t)0, TagIndex.Count());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, RefreshShouldReloadWhenChangesArePruned) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class AdminClass {}\n"));
+
+    // as if the writer pruned the changes that the index has not seen
+    Session.once << "DELETE FROM tag_changes";
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class RoleClass {}\n"));
+    CHECK(TagIndex.Refresh(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("RoleClass"));
+    CHECK_VECTOR_SIZE(1, Matches);
+    CHECK_EQUAL(RowCount(), TagIndex.Count());
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, RefreshChangesShouldNotReloadWhenChangesArePruned) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    CHECK(TagIndex.Load(Session));
+    Session.once << "DELETE FROM tag_changes";
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class RoleClass {}\n"));
+    CHECK_EQUAL(false, TagIndex.RefreshChanges(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("RoleClass"));
+    CHECK_VECTOR_SIZE(0, Matches);
+}
+
+TEST_FIXTURE(TagIndexTestFixtureClass, SwapShouldExchangeTags) {
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class UserClass {}\n"));
+    t4p::TagIndexClass loaded;
+    CHECK(loaded.Load(Session));
+    int generation = TagIndex.Generation();
+    TagIndex.Swap(loaded);
+    CHECK(TagIndex.IsLoaded());
+    CHECK_EQUAL(false, loaded.IsLoaded());
+    CHECK(generation != TagIndex.Generation());
+    NearMatchTags(UNICODE_STRING_SIMPLE("UserClass"));
+    CHECK_VECTOR_SIZE(1, Matches);
+
+    // the swapped in index keeps up with the db
+    Prep(t4p::CharToIcu(
+             "<?php\n"
+             "class RoleClass {}\n"));
+    CHECK(TagIndex.RefreshChanges(Session));
+    NearMatchTags(UNICODE_STRING_SIMPLE("RoleClass"));
+    CHECK_VECTOR_SIZE(1, Matches);
+}
+}
@@ -28,6 +28,8 @@
 #include "globals/Assets.h"
 #include "globals/Sqlite.h"
 #include "language_php/TagParserClass.h"
+#include "search/DirectorySearchClass.h"
+#include "FileTestFixtureClass.h"
 #include "SqliteTestFixtureClass.h"
 #include <soci/soci.h>  // NOLINT(build/include_order) prevent 'va_list' has not been declared
 #include <soci/sqlite3/soci-sqlite3.h>  // NOLINT(build/include_order) prevent 'va_list' has not been declared
@@ -62,6 +64,41 @@ class TagParserTestFixtureClass : public SqliteTestFixtureClass {
     }
 };
 
+/**
+ * fixture for the tests that need files on disk; ie. to test
+ * a full directory walk
+ */
+class TagParserFileTestFixtureClass : public FileTestFixtureClass, public SqliteTestFixtureClass {
+ public:
+    t4p::TagParserClass TagParser;
+
+    TagParserFileTestFixtureClass()
+        : FileTestFixtureClass(wxT("tag_parser"))
+        , SqliteTestFixtureClass(t4p::ResourceSqlSchemaAsset())
+        , TagParser() {
+        TagParser.Init(&Session);
+        TagParser.PhpFileExtensions.push_back(wxT("*.php"));
+        if (wxDirExists(TestProjectDir)) {
+            RecursiveRmDir(TestProjectDir);
+        }
+    }
+
+    void WalkAll() {
+        t4p::DirectorySearchClass search;
+        if (search.Init(TestProjectDir)) {
+            while (search.More()) {
+                search.Walk(TagParser);
+            }
+        }
+    }
+
+    int RowCount(const std::string& tableName) {
+        int count = 0;
+        Session << ("SELECT COUNT(*) FROM " + tableName), soci::into(count);
+        return count;
+    }
+};
+
 /**
  * ATTN: currently most of the testing for TagParserClass is done in ParsedTagFinderTestClass
  * because the logic of what is now TagParserClass and ParsedTagFinderClass were originally
@@ -87,6 +124,23 @@ SUITE(TagParserTestClass) {
         CHECK_EQUAL(0, count);
     }
 
+    TEST_FIXTURE(TagParserTestFixtureClass, ReparseReplacesTraits) {
+        TagParser.SetVersion(pelet::PHP_54);
+        wxFileName file1 = TestFile(wxT("project1"), wxT("user.php"));
+        UnicodeString code = t4p::CharToIcu(
+                                 "trait Loggable { function log() {} }\n"
+                                 "class User { use Loggable; }\n");
+        AddFile(file1, code);
+        int traitCount = RowCount("trait_resources");
+        CHECK(traitCount > 0);
+
+        // parsing the same file again should replace the traits
+        // not add to them
+        AddFile(file1, code);
+        CHECK_EQUAL(traitCount, RowCount("trait_resources"));
+        CHECK_EQUAL(1, RowCount("file_items"));
+    }
+
     TEST_FIXTURE(TagParserTestFixtureClass, DeleteDirectories) {
         // create 2 files, each in different directories
         wxFileName file1 = TestFile(wxT("project1"), wxT("user.php"));
@@ -194,4 +248,184 @@ SUITE(TagParserTestClass) {
                 soci::use(stdFullPath), soci::into(count);
         CHECK_EQUAL(1, count);
     }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, WalkWithParserThreads) {
+        for (int i = 0; i < 20; ++i) {
+            CreateFixtureFile(wxString::Format(wxT("user%d.php"), i), wxString::Format(wxT(
+                                  "<?php\n"
+                                  "namespace App;\n"
+                                  "class User%d {\n"
+                                  "  function getName() {}\n"
+                                  "}\n"), i));
+        }
+        TagParser.SetParserThreads(4);
+        WalkAll();
+
+        CHECK_EQUAL(20, RowCount("file_items"));
+
+        // each file: 1 class + 1 fully qualified class + 3 method tags
+        // plus 1 namespace tag for all files
+        CHECK_EQUAL(20 * 5 + 1, RowCount("resources"));
+    }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, WalkTwiceKeepsFileItems) {
+        CreateFixtureFile(wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        CreateFixtureFile(wxT("admin.php"), wxT(
+                              "<?php\n"
+                              "class Admin {}\n"));
+        WalkAll();
+        int maxFileItemId = 0;
+        Session << "SELECT MAX(file_item_id) FROM file_items", soci::into(maxFileItemId);
+
+        // files have not changed; the second walk should find the existing
+        // file items and not re-insert them
+        WalkAll();
+        CHECK_EQUAL(2, RowCount("file_items"));
+        CHECK_EQUAL(5, RowCount("resources"));
+        int newMaxFileItemId = 0;
+        Session << "SELECT MAX(file_item_id) FROM file_items", soci::into(newMaxFileItemId);
+        CHECK_EQUAL(maxFileItemId, newMaxFileItemId);
+    }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, WalkSkipsTouchedFiles) {
+        CreateFixtureFile(wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        WalkAll();
+        int fileItemId = 0;
+        Session << "SELECT file_item_id FROM file_items", soci::into(fileItemId);
+
+        // change the modified time but not the contents, like a branch
+        // switch would. the file should not be parsed again
+        wxFileName fileName(TestProjectDir, wxT("user.php"));
+        wxDateTime later = wxDateTime::Now() + wxTimeSpan::Hours(1);
+        CHECK(fileName.SetTimes(NULL, &later, NULL));
+        WalkAll();
+
+        int newFileItemId = 0;
+        Session << "SELECT file_item_id FROM file_items", soci::into(newFileItemId);
+        CHECK_EQUAL(fileItemId, newFileItemId);
+        CHECK_EQUAL(3, RowCount("resources"));
+
+        // now change the contents, keeping the same size
+        CreateFixtureFile(wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class Usea {}\n"));
+        later = later + wxTimeSpan::Hours(1);
+        CHECK(fileName.SetTimes(NULL, &later, NULL));
+        WalkAll();
+        Session << "SELECT file_item_id FROM file_items", soci::into(newFileItemId);
+        CHECK(fileItemId != newFileItemId);
+        int count = 0;
+        Session << "SELECT COUNT(*) FROM resources WHERE identifier = 'Usea'", soci::into(count);
+        CHECK_EQUAL(2, count);
+    }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, WalkInBulkLoad) {
+        for (int i = 0; i < 5; ++i) {
+            CreateFixtureFile(wxString::Format(wxT("user%d.php"), i), wxString::Format(wxT(
+                                  "<?php\n"
+                                  "namespace App;\n"
+                                  "class User%d {}\n"), i));
+        }
+        TagParser.BeginBulkLoad();
+        int count = 0;
+        Session << "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name = 'idxResourceKey'",
+                soci::into(count);
+        CHECK_EQUAL(0, count);
+        WalkAll();
+        TagParser.EndBulkLoad();
+
+        // each file: 1 class + 1 fully qualified class, plus 1
+        // namespace tag for all files
+        CHECK_EQUAL(5, RowCount("file_items"));
+        CHECK_EQUAL(5 * 2 + 1, RowCount("resources"));
+        Session << "SELECT COUNT(*) FROM sqlite_master WHERE type = 'index' AND name IN('idxResourceKey', 'idxResourceSource')",
+                soci::into(count);
+        CHECK_EQUAL(2, count);
+    }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, ImportBundleShouldAddTags) {
+        for (int i = 0; i < 2; ++i) {
+            CreateFixtureFile(wxString::Format(wxT("user%d.php"), i), wxString::Format(wxT(
+                                  "<?php\n"
+                                  "namespace App;\n"
+                                  "class User%d {}\n"), i));
+        }
+        WalkAll();
+        wxFileName sourceDir;
+        sourceDir.AssignDir(TestProjectDir);
+        wxFileName bundleFileName(TestProjectDir, wxT("tags.bundle"));
+        CHECK(TagParser.ExportBundle(sourceDir, bundleFileName));
+        CHECK(bundleFileName.FileExists());
+
+        TagParser.WipeAll();
+        CHECK_EQUAL(0, RowCount("resources"));
+        CHECK_EQUAL(2, TagParser.ImportBundle(bundleFileName, sourceDir));
+        CHECK_EQUAL(2, RowCount("file_items"));
+        CHECK_EQUAL(2 * 2 + 1, RowCount("resources"));
+
+        // the imported files are up-to-date, walking should not
+        // parse them again
+        int maxFileItemId = 0;
+        Session << "SELECT MAX(file_item_id) FROM file_items", soci::into(maxFileItemId);
+        WalkAll();
+        int newMaxFileItemId = 0;
+        Session << "SELECT MAX(file_item_id) FROM file_items", soci::into(newMaxFileItemId);
+        CHECK_EQUAL(maxFileItemId, newMaxFileItemId);
+        CHECK_EQUAL(2 * 2 + 1, RowCount("resources"));
+    }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, ImportBundleShouldSkipChangedFiles) {
+        CreateFixtureFile(wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        CreateFixtureFile(wxT("admin.php"), wxT(
+                              "<?php\n"
+                              "class Admin {}\n"));
+        WalkAll();
+        wxFileName sourceDir;
+        sourceDir.AssignDir(TestProjectDir);
+        wxFileName bundleFileName(TestProjectDir, wxT("tags.bundle"));
+        CHECK(TagParser.ExportBundle(sourceDir, bundleFileName));
+
+        TagParser.WipeAll();
+        CreateFixtureFile(wxT("admin.php"), wxT(
+                              "<?php\n"
+                              "class Admix {}\n"));
+        CHECK_EQUAL(1, TagParser.ImportBundle(bundleFileName, sourceDir));
+        int count = 0;
+        Session << "SELECT COUNT(*) FROM resources WHERE identifier = 'Admin'", soci::into(count);
+        CHECK_EQUAL(0, count);
+        Session << "SELECT COUNT(*) FROM resources WHERE identifier = 'User'", soci::into(count);
+        CHECK_EQUAL(2, count);
+    }
+
+    TEST_FIXTURE(TagParserFileTestFixtureClass, ImportBundleShouldSkipPathsWithParentDirs) {
+        CreateFixtureFile(wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        CreateFixtureFile(wxT("admin.php"), wxT(
+                              "<?php\n"
+                              "class Admin {}\n"));
+        WalkAll();
+        wxFileName sourceDir;
+        sourceDir.AssignDir(TestProjectDir);
+        wxFileName bundleFileName(TestProjectDir, wxT("tags.bundle"));
+        CHECK(TagParser.ExportBundle(sourceDir, bundleFileName));
+
+        // bundles are not trusted, a path may point outside of the
+        // source directory
+        soci::session bundle(*soci::factory_sqlite3(), t4p::WxToChar(bundleFileName.GetFullPath()));
+        bundle << "UPDATE file_items SET relative_path = 'lib/../admin.php' WHERE relative_path = 'admin.php'";
+        bundle.close();
+
+        TagParser.WipeAll();
+        CHECK_EQUAL(1, TagParser.ImportBundle(bundleFileName, sourceDir));
+        int count = 0;
+        Session << "SELECT COUNT(*) FROM resources WHERE identifier = 'Admin'", soci::into(count);
+        CHECK_EQUAL(0, count);
+    }
 }
@@ -0,0 +1,171 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <unicode/ustream.h>  // get the << overloaded operator, needed by UnitTest++
+#include <wx/utils.h>
+#include <string>
+#include <vector>
+#include "FileTestFixtureClass.h"
+#include "globals/String.h"
+#include "language_php/ParsedTagFinderClass.h"
+#include "language_php/TagFinderList.h"
+#include "language_php/TagServiceClass.h"
+#include "language_php/TagServiceSocket.h"
+#include "TriumphChecks.h"
+
+/**
+ * fixture that holds a service that answers with an in-memory
+ * tag db. The requests are given to the service directly, the
+ * same way that the socket loop of the service does.
+ */
+class TagServiceFixtureClass : public FileTestFixtureClass {
+ public:
+    t4p::TagFinderListClass Finders;
+    t4p::TagServiceClass Service;
+    std::vector<wxFileName> SourceDirs;
+    std::vector<t4p::PhpTagClass> Matches;
+
+    TagServiceFixtureClass()
+        : FileTestFixtureClass(wxT("tag_service"))
+        , Finders()
+        , Service(Finders)
+        , SourceDirs()
+        , Matches() {
+        std::vector<wxString> phpFileExtensions;
+        std::vector<wxString> miscFileExtensions;
+        phpFileExtensions.push_back(wxT("*.php"));
+        Finders.CreateGlobalTag(phpFileExtensions, miscFileExtensions, pelet::PHP_53);
+        if (wxDirExists(TestProjectDir)) {
+            RecursiveRmDir(TestProjectDir);
+        }
+        TouchTestDir();
+        SourceDirs.push_back(AbsoluteDir(wxT("src")));
+    }
+
+    void IndexSource() {
+        std::string request = "INDEX\nphp_ext\t*.php\nsource\t";
+        request += t4p::WxToChar(SourceDirs[0].GetPath()) + "\t*.php\t";
+        CHECK_EQUAL("OK", Service.Handle(request));
+        while (Service.IsIndexing()) {
+            Service.IndexFiles(5);
+        }
+    }
+
+    bool Search(const std::string& command, const UnicodeString& query) {
+        Matches.clear();
+        t4p::TagSearchClass tagSearch(query);
+        std::string response = Service.Handle(t4p::TagServiceClientClass::SearchRequest(command, tagSearch, SourceDirs));
+        return t4p::TagServiceClientClass::ParseTags(response, Matches);
+    }
+};
+
+SUITE(TagServiceTestClass) {
+    TEST_FIXTURE(TagServiceFixtureClass, PingShouldAnswer) {
+        CHECK_EQUAL("OK", Service.Handle("PING"));
+    }
+
+    TEST_FIXTURE(TagServiceFixtureClass, UnknownCommandShouldBeAnError) {
+        std::string response = Service.Handle("DROP");
+        CHECK_EQUAL(0, static_cast<int>(response.find("ERROR\t")));
+        std::vector<t4p::PhpTagClass> matches;
+        CHECK(!t4p::TagServiceClientClass::ParseTags(response, matches));
+    }
+
+    TEST_FIXTURE(TagServiceFixtureClass, NearMatchShouldFindIndexedTags) {
+        CreateSubDirectory(wxT("src"));
+        CreateFixtureFile(wxT("src") + wxFileName::GetPathSeparators() + wxT("User.php"), wxString::FromAscii(
+            "<?php\n"
+            "class UserClass {\n"
+            "  function getName() {}\n"
+            "}\n"));
+        IndexSource();
+
+        CHECK(Search("NEAR", UNICODE_STRING_SIMPLE("UserC")));
+        CHECK_VECTOR_SIZE(1, Matches);
+        if (Matches.size() == 1) {
+            CHECK_UNISTR_EQUALS("UserClass", Matches[0].Identifier);
+            CHECK_EQUAL(t4p::PhpTagClass::CLASS, Matches[0].Type);
+            CHECK_EQUAL(SourceDirs[0].GetPathWithSep() + wxT("User.php"), Matches[0].GetFullPath());
+        }
+    }
+
+    TEST_FIXTURE(TagServiceFixtureClass, ExactMatchShouldKeepTabsAndNewlines) {
+        CreateSubDirectory(wxT("src"));
+        CreateFixtureFile(wxT("src") + wxFileName::GetPathSeparators() + wxT("User.php"), wxString::FromAscii(
+            "<?php\n"
+            "class UserClass {\n"
+            "  /**\n"
+            "   * the\tname \\ of the user\n"
+            "   */\n"
+            "  static function getName() {}\n"
+            "}\n"));
+        IndexSource();
+
+        CHECK(Search("EXACT", UNICODE_STRING_SIMPLE("UserClass::getName")));
+        CHECK_VECTOR_SIZE(1, Matches);
+        if (Matches.size() == 1) {
+            CHECK_UNISTR_EQUALS("getName", Matches[0].Identifier);
+            CHECK_UNISTR_EQUALS("UserClass", Matches[0].ClassName);
+            CHECK_UNISTR_EQUALS("/**\n   * the\tname \\ of the user\n   */", Matches[0].Comment);
+            CHECK(Matches[0].IsStatic);
+        }
+    }
+
+    TEST_FIXTURE(TagServiceFixtureClass, StatusShouldReportProgress) {
+        CreateSubDirectory(wxT("src"));
+        CreateFixtureFile(wxT("src") + wxFileName::GetPathSeparators() + wxT("User.php"), wxT("<?php class UserClass {}"));
+        CreateFixtureFile(wxT("src") + wxFileName::GetPathSeparators() + wxT("Admin.php"), wxT("<?php class AdminClass {}"));
+        IndexSource();
+        CHECK_EQUAL("OK\nstatus\t0\t2\t2", Service.Handle("STATUS"));
+    }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+    TEST(ReadShouldReadUpToTheNul) {
+        boost::asio::io_service ioService;
+        boost::asio::local::stream_protocol::socket client(ioService);
+        boost::asio::local::stream_protocol::socket server(ioService);
+        boost::asio::local::connect_pair(client, server);
+        wxLongLong deadline = wxGetLocalTimeMillis() + 1000;
+        CHECK(t4p::TagServiceWrite(client, "PING", deadline));
+        std::string request;
+        CHECK(t4p::TagServiceRead(server, request, deadline));
+        CHECK_EQUAL("PING", request);
+    }
+
+    TEST(ReadShouldGiveUpWhenTheMessageIsNotSent) {
+        boost::asio::io_service ioService;
+        boost::asio::local::stream_protocol::socket client(ioService);
+        boost::asio::local::stream_protocol::socket server(ioService);
+        boost::asio::local::connect_pair(client, server);
+
+        // a message without its NUL, like a stuck instance would send
+        boost::asio::write(client, boost::asio::buffer("PI", 2));
+        wxLongLong start = wxGetLocalTimeMillis();
+        std::string request;
+        CHECK(!t4p::TagServiceRead(server, request, start + 100));
+        CHECK((wxGetLocalTimeMillis() - start) < 1000);
+    }
+#endif
+}
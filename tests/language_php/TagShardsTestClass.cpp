@@ -0,0 +1,189 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <soci/soci.h>
+#include <soci/sqlite3/soci-sqlite3.h>
+#include <string>
+#include "globals/Assets.h"
+#include "globals/Sqlite.h"
+#include "language_php/TagParserClass.h"
+#include "language_php/TagShardsClass.h"
+#include "search/DirectorySearchClass.h"
+#include "FileTestFixtureClass.h"
+
+/**
+ * fixture that creates a tags db file in the test dir, since
+ * the shards are files next to the tags db
+ */
+class TagShardsFixtureClass : public FileTestFixtureClass {
+ public:
+    soci::session Session;
+    wxFileName TagDbFileName;
+    t4p::TagShardsClass TagShards;
+    t4p::TagParserClass TagParser;
+
+    TagShardsFixtureClass()
+        : FileTestFixtureClass(wxT("tag_shards"))
+        , Session()
+        , TagDbFileName()
+        , TagShards()
+        , TagParser() {
+        if (wxDirExists(TestProjectDir)) {
+            RecursiveRmDir(TestProjectDir);
+        }
+        TouchTestDir();
+        TagDbFileName.Assign(TestProjectDir, wxT("tags.db"));
+        Session.open(*soci::factory_sqlite3(), t4p::WxToChar(TagDbFileName.GetFullPath()));
+        wxString error;
+        t4p::SqliteSqlScript(t4p::ResourceSqlSchemaAsset(), Session, error);
+
+        TagShards.Init(&Session, TagDbFileName);
+        TagParser.Init(&Session);
+        TagParser.SetTagShards(&TagShards);
+        TagParser.PhpFileExtensions.push_back(wxT("*.php"));
+    }
+
+    void WalkSource(const wxString& sourceDir) {
+        t4p::DirectorySearchClass search;
+        if (search.Init(AbsoluteDir(sourceDir).GetPath())) {
+            while (search.More()) {
+                search.Walk(TagParser);
+            }
+        }
+    }
+
+    int Count(const std::string& sql) {
+        int count = 0;
+        Session << sql, soci::into(count);
+        return count;
+    }
+};
+
+SUITE(TagShardsTestClass) {
+    TEST_FIXTURE(TagShardsFixtureClass, NewSourceShouldBeInShard) {
+        CreateSubDirectory(wxT("src_one"));
+        CreateFixtureFile(wxT("src_one") + wxFileName::GetPathSeparator() + wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        WalkSource(wxT("src_one"));
+
+        int sourceId = Count("SELECT source_id FROM sources");
+        CHECK(t4p::TagShardsClass::ShardFileName(TagDbFileName, sourceId).FileExists());
+        CHECK_EQUAL(0, Count("SELECT COUNT(*) FROM main.resources"));
+
+        // 1 class + 1 fully qualified class + 1 namespace tag
+        CHECK_EQUAL(3, Count("SELECT COUNT(*) FROM resources"));
+    }
+
+    TEST_FIXTURE(TagShardsFixtureClass, TagIdsShouldBeUniqueWithinSource) {
+        CreateSubDirectory(wxT("src_one"));
+        CreateSubDirectory(wxT("src_two"));
+        CreateFixtureFile(wxT("src_one") + wxFileName::GetPathSeparator() + wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        CreateFixtureFile(wxT("src_two") + wxFileName::GetPathSeparator() + wxT("admin.php"), wxT(
+                              "<?php\n"
+                              "class Admin {}\n"));
+        WalkSource(wxT("src_one"));
+        WalkSource(wxT("src_two"));
+
+        // the namespace tag is only in the first source
+        CHECK_EQUAL(5, Count("SELECT COUNT(*) FROM resources"));
+        CHECK_EQUAL(5, Count("SELECT COUNT(*) FROM (SELECT DISTINCT source_id, id FROM resources)"));
+    }
+
+    TEST_FIXTURE(TagShardsFixtureClass, DeleteSourceShouldDeleteShard) {
+        CreateSubDirectory(wxT("src_one"));
+        CreateFixtureFile(wxT("src_one") + wxFileName::GetPathSeparator() + wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        WalkSource(wxT("src_one"));
+        int sourceId = Count("SELECT source_id FROM sources");
+
+        TagParser.DeleteSource(AbsoluteDir(wxT("src_one")));
+        CHECK_EQUAL(false, t4p::TagShardsClass::ShardFileName(TagDbFileName, sourceId).FileExists());
+        CHECK_EQUAL(0, Count("SELECT COUNT(*) FROM resources"));
+        CHECK_EQUAL(0, Count("SELECT COUNT(*) FROM file_items"));
+    }
+
+    TEST_FIXTURE(TagShardsFixtureClass, DeleteFromFileShouldDeleteTagsOfNestedSource) {
+        wxString libDir = wxT("src_one") + wxFileName::GetPathSeparator() + wxT("lib");
+        CreateSubDirectory(wxT("src_one"));
+        CreateSubDirectory(libDir);
+        CreateFixtureFile(libDir + wxFileName::GetPathSeparator() + wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        WalkSource(libDir);
+        CHECK(Count("SELECT COUNT(*) FROM resources WHERE identifier = 'User'") > 0);
+
+        // the file is in the shard of the nested source, not the shard
+        // of the source being tagged
+        TagParser.BeginSearch(AbsoluteDir(wxT("src_one")).GetPath());
+        TagParser.DeleteFromFile(AbsoluteDir(libDir).GetPathWithSep() + wxT("user.php"));
+        TagParser.EndSearch();
+        CHECK_EQUAL(0, Count("SELECT COUNT(*) FROM resources WHERE identifier = 'User'"));
+        CHECK_EQUAL(0, Count("SELECT COUNT(*) FROM file_items"));
+    }
+
+    TEST_FIXTURE(TagShardsFixtureClass, SourcesPastTheAttachLimitShouldBeFound) {
+        int sourceCount = t4p::SqliteAttachLimit(Session) + 2;
+        for (int i = 0; i < sourceCount; ++i) {
+            wxString dir = wxString::Format(wxT("src_%d"), i);
+            CreateSubDirectory(dir);
+            CreateFixtureFile(dir + wxFileName::GetPathSeparator() + wxT("user.php"),
+                              wxString::Format(wxT("<?php\nclass User%d {}\n"), i));
+            WalkSource(dir);
+        }
+        std::string sql = "SELECT COUNT(DISTINCT identifier) FROM resources WHERE identifier LIKE 'User%'";
+        CHECK_EQUAL(sourceCount, Count(sql));
+
+        // a new connection should see the tags of all sources too
+        soci::session otherSession(*soci::factory_sqlite3(), t4p::WxToChar(TagDbFileName.GetFullPath()));
+        t4p::TagShardsClass otherShards;
+        otherShards.Init(&otherSession, TagDbFileName);
+        int count = 0;
+        otherSession << sql, soci::into(count);
+        CHECK_EQUAL(sourceCount, count);
+    }
+
+    TEST_FIXTURE(TagShardsFixtureClass, RefreshShouldAttachShardsOfOtherConnections) {
+        soci::session otherSession(*soci::factory_sqlite3(), t4p::WxToChar(TagDbFileName.GetFullPath()));
+        t4p::TagShardsClass otherShards;
+        otherShards.Init(&otherSession, TagDbFileName);
+
+        CreateSubDirectory(wxT("src_one"));
+        CreateFixtureFile(wxT("src_one") + wxFileName::GetPathSeparator() + wxT("user.php"), wxT(
+                              "<?php\n"
+                              "class User {}\n"));
+        WalkSource(wxT("src_one"));
+
+        std::string sql = "SELECT COUNT(*) FROM resources WHERE identifier = 'User'";
+        int count = 0;
+        otherShards.Refresh();
+        otherSession << sql, soci::into(count);
+        CHECK_EQUAL(Count(sql), count);
+        CHECK(count > 0);
+    }
+}
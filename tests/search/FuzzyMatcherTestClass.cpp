@@ -0,0 +1,154 @@
+/**
+ * @copyright  2015 Roberto Perpuly
+ * @license    http://www.opensource.org/licenses/mit-license.php The MIT License
+ *
+ * This software is released under the terms of the MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include <UnitTest++.h>
+#include <unicode/unistr.h>
+#include <unicode/ustream.h>  // get the << overloaded operator, needed by UnitTest++
+#include <vector>
+#include "search/FuzzyMatcherClass.h"
+
+class FuzzyMatcherFixtureClass {
+ public:
+    FuzzyMatcherFixtureClass()
+        : Matcher()
+        , Groups()
+        , Matches() {
+    }
+
+    void Add(const char* name, int payload) {
+        Matcher.Add(UnicodeString(name), UNICODE_STRING_SIMPLE("/project/file.php"), 0, 1, payload, 0);
+    }
+
+    void Match(const char* query) {
+        Matcher.Match(UnicodeString(query), Groups, 10, Matches);
+    }
+
+    t4p::FuzzyMatcherClass Matcher;
+    std::vector<int> Groups;
+    std::vector<t4p::FuzzyMatchClass> Matches;
+};
+
+SUITE(FuzzyMatcherTestClass) {
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldFindSubsequences) {
+        Add("UserController", 1);
+        Add("user_controller", 2);
+        Add("UserModel", 3);
+        Match("usrctl");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        for (size_t i = 0; i < Matches.size(); ++i) {
+            CHECK(Matches[i].Payload != 3);
+        }
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldBeCaseInsensitive) {
+        Add("UserController", 1);
+        Match("USERCONTROLLER");
+        CHECK_EQUAL((size_t)1, Matches.size());
+        Match("usercontroller");
+        CHECK_EQUAL((size_t)1, Matches.size());
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldRankWordBoundariesFirst) {
+        Add("lucid", 1);
+        Add("UserController", 2);
+        Match("uc");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+        CHECK_EQUAL(1, Matches[1].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldRankConsecutiveCharactersFirst) {
+        Add("a_b_c_d", 1);
+        Add("abcd_e", 2);
+        Match("abc");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldRankShorterCandidatesFirstOnTies) {
+        Add("UserControllerTest", 1);
+        Add("UserController", 2);
+        Match("UserController");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldPreferShallowFiles) {
+        Matcher.Add(UNICODE_STRING_SIMPLE("index.php"), UNICODE_STRING_SIMPLE("/project/a/b/c/d/index.php"), 0, 1, 1, 0);
+        Matcher.Add(UNICODE_STRING_SIMPLE("index.php"), UNICODE_STRING_SIMPLE("/project/index.php"), 0, 1, 2, 0);
+        Match("index");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldPreferRecentlyModified) {
+        long long now = 1400000000;
+        Matcher.Add(UNICODE_STRING_SIMPLE("index.php"), UNICODE_STRING_SIMPLE("/project/index.php"), 0, 1, 1, now - 60 * 60 * 24 * 30);
+        Matcher.Add(UNICODE_STRING_SIMPLE("index.php"), UNICODE_STRING_SIMPLE("/project/index.php"), 0, 1, 2, now);
+        Match("index");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldFilterGroups) {
+        Matcher.Add(UNICODE_STRING_SIMPLE("UserController"), UNICODE_STRING_SIMPLE(""), 0, 1, 1, 0);
+        Matcher.Add(UNICODE_STRING_SIMPLE("UserController"), UNICODE_STRING_SIMPLE(""), 0, 2, 2, 0);
+        Groups.push_back(2);
+        Match("user");
+        CHECK_EQUAL((size_t)1, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldBeLimited) {
+        for (int i = 0; i < 50; ++i) {
+            Add("UserController", i);
+        }
+        Match("user");
+        CHECK_EQUAL((size_t)10, Matches.size());
+
+        // ties go to the candidates that were added first
+        CHECK_EQUAL(0, Matches[0].Payload);
+        CHECK_EQUAL(9, Matches[9].Payload);
+    }
+
+    TEST_FIXTURE(FuzzyMatcherFixtureClass, MatchShouldHandleGrowingAndShrinkingQueries) {
+        Add("UserController", 1);
+        Add("UserModel", 2);
+        Add("Session", 3);
+        Match("us");
+        CHECK_EQUAL((size_t)2, Matches.size());
+        Match("usm");
+        CHECK_EQUAL((size_t)1, Matches.size());
+        CHECK_EQUAL(2, Matches[0].Payload);
+
+        // user hit backspace; previous candidates no longer apply
+        Match("s");
+        CHECK_EQUAL((size_t)3, Matches.size());
+    }
+
+    TEST(ScoreShouldNotMatchOutOfOrderCharacters) {
+        CHECK_EQUAL(-1, t4p::FuzzyMatcherClass::Score(UNICODE_STRING_SIMPLE("cba"), UNICODE_STRING_SIMPLE("abc")));
+        CHECK(t4p::FuzzyMatcherClass::Score(UNICODE_STRING_SIMPLE("abc"), UNICODE_STRING_SIMPLE("abc")) > 0);
+    }
+}